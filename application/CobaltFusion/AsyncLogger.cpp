@@ -0,0 +1,249 @@
+// (C) Copyright Gert-Jan de Vos and Jan Wilmans 2013.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#include <algorithm>
+#include <boost/asio.hpp>
+#include "CobaltFusion/AsyncLogger.h"
+#include "ShmRingLib/ShmRing.h"
+
+namespace fusion {
+
+namespace {
+
+// calls 'fn' for every line in 'batch', including its '\n'
+template <typename Fn>
+void ForEachLine(const std::string& batch, Fn fn)
+{
+    size_t begin = 0;
+    while (begin < batch.size())
+    {
+        auto end = std::min(batch.find('\n', begin), batch.size() - 1) + 1;
+        fn(std::string_view(batch).substr(begin, end - begin));
+        begin = end;
+    }
+}
+
+class OdsTransport : public LogTransport
+{
+public:
+    void Send(const std::string& batch) override
+    {
+        ForEachLine(batch, [this](std::string_view line) {
+            m_line.assign(line);
+            OutputDebugStringA(m_line.c_str());
+        });
+    }
+
+private:
+    std::string m_line;
+};
+
+class UdpTransport : public LogTransport
+{
+public:
+    // stays below the 64 KB limit of a datagram, that DebugView++'s UdpReader receives in one piece
+    static constexpr size_t MaxDatagramSize = 60000;
+
+    UdpTransport(const std::string& host, int port) :
+        m_socket(m_ioContext)
+    {
+        boost::asio::ip::udp::resolver resolver(m_ioContext);
+        m_endpoint = *resolver.resolve(boost::asio::ip::udp::v4(), host, std::to_string(port)).begin();
+        m_socket.open(boost::asio::ip::udp::v4());
+    }
+
+    void Send(const std::string& batch) override
+    {
+        // the UdpReader splits a datagram in lines, so only a line longer than a datagram is cut in pieces
+        size_t begin = 0;
+        while (begin < batch.size())
+        {
+            auto size = std::min(batch.size() - begin, MaxDatagramSize);
+            if (begin + size < batch.size())
+            {
+                auto newline = batch.rfind('\n', begin + size - 1);
+                if (newline != std::string::npos && newline >= begin)
+                {
+                    size = newline + 1 - begin;
+                }
+            }
+            boost::system::error_code ec;
+            m_socket.send_to(boost::asio::buffer(batch.data() + begin, size), m_endpoint, 0, ec);
+            begin += size;
+        }
+    }
+
+private:
+    boost::asio::io_context m_ioContext;
+    boost::asio::ip::udp::socket m_socket;
+    boost::asio::ip::udp::endpoint m_endpoint;
+};
+
+class PipeTransport : public LogTransport
+{
+public:
+    explicit PipeTransport(HANDLE hPipe) :
+        m_hPipe(hPipe)
+    {
+    }
+
+    void Send(const std::string& batch) override
+    {
+        const char* data = batch.data();
+        auto size = batch.size();
+        while (size > 0)
+        {
+            DWORD written = 0;
+            if (WriteFile(m_hPipe, data, static_cast<DWORD>(std::min<size_t>(size, 1u << 30)), &written, nullptr) == FALSE)
+            {
+                return; // the reading end is gone, nobody is listening anymore
+            }
+            data += written;
+            size -= written;
+        }
+    }
+
+private:
+    HANDLE m_hPipe;
+};
+
+class RingTransport : public LogTransport
+{
+public:
+    explicit RingTransport(const std::string& name) :
+        m_writer(name)
+    {
+    }
+
+    void Send(const std::string& batch) override
+    {
+        // a full ring counts the message as dropped itself
+        ForEachLine(batch, [this](std::string_view line) { m_writer.Write(line); });
+    }
+
+private:
+    shmring::ShmRingWriter m_writer;
+};
+
+} // namespace
+
+std::unique_ptr<LogTransport> MakeOdsTransport()
+{
+    return std::make_unique<OdsTransport>();
+}
+
+std::unique_ptr<LogTransport> MakeUdpTransport(const std::string& host, int port)
+{
+    return std::make_unique<UdpTransport>(host, port);
+}
+
+std::unique_ptr<LogTransport> MakePipeTransport(HANDLE hPipe)
+{
+    return std::make_unique<PipeTransport>(hPipe);
+}
+
+std::unique_ptr<LogTransport> MakeRingTransport(const std::string& name)
+{
+    return std::make_unique<RingTransport>(name);
+}
+
+AsyncLogger::AsyncLogger(std::unique_ptr<LogTransport> pTransport, size_t maxPending) :
+    m_pTransport(std::move(pTransport)),
+    m_maxPending(maxPending),
+    m_thread([this] { Run(); })
+{
+}
+
+AsyncLogger::~AsyncLogger()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_end = true;
+    }
+    m_pendingCondition.notify_one();
+    m_thread.join();
+}
+
+void AsyncLogger::write(std::string_view lines)
+{
+    bool wasEmpty;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_pending.size() + lines.size() > m_maxPending)
+        {
+            auto count = std::count(lines.begin(), lines.end(), '\n');
+            m_dropped.fetch_add(std::max<uint64_t>(count, 1), std::memory_order_relaxed);
+            return;
+        }
+        wasEmpty = m_pending.empty();
+        m_pending.append(lines);
+        ++m_written;
+    }
+
+    // while the writer thread is sending it collects the next batch, it only needs a wake-up to start a new one
+    if (wasEmpty)
+    {
+        m_pendingCondition.notify_one();
+    }
+}
+
+void AsyncLogger::Flush()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    auto written = m_written;
+    m_sentCondition.wait(lock, [&] { return m_sent >= written; });
+}
+
+uint64_t AsyncLogger::GetDropped() const
+{
+    return m_dropped.load(std::memory_order_relaxed);
+}
+
+void AsyncLogger::Run()
+{
+    std::string batch;
+    uint64_t reported = 0;
+    for (;;)
+    {
+        uint64_t written;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_pendingCondition.wait(lock, [this] { return !m_pending.empty() || m_end; });
+            if (m_pending.empty())
+            {
+                return;
+            }
+
+            // the swap hands the capacity of the previous batch back to the writers
+            batch.swap(m_pending);
+            written = m_written;
+        }
+
+        auto dropped = GetDropped();
+        if (dropped != reported)
+        {
+            batch += "<" + std::to_string(dropped - reported) + " lines dropped by the AsyncLogger>\n";
+            reported = dropped;
+        }
+
+        try
+        {
+            m_pTransport->Send(batch);
+        }
+        catch (std::exception&)
+        {
+            // a failing transport loses the batch, logging must not take the application down
+        }
+        batch.clear();
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_sent = written;
+        }
+        m_sentCondition.notify_all();
+    }
+}
+
+} // namespace fusion
@@ -12,10 +12,14 @@
 #define BOOST_TEST_MODULE CobaltFusionLib Unit Test
 #include <boost/test/unit_test_gui.hpp>
 
+#include <condition_variable>
 #include <mutex>
 #include <thread>
 #include <chrono>
 #include <random>
+#include <sstream>
+#include <vector>
+#include "CobaltFusion/AsyncLogger.h"
 #include "CobaltFusion/CircularBuffer.h"
 #include "CobaltFusion/Throttle.h"
 #include "CobaltFusion/Timer.h"
@@ -359,6 +363,108 @@ BOOST_AUTO_TEST_CASE(TimerTest)
     Timer t;
 }
 
+// collects the batches, Send() blocks while the gate is closed
+class TestTransport : public LogTransport
+{
+public:
+    void Send(const std::string& batch) override
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        ++m_batches;
+        m_received += batch;
+        m_condition.notify_all();
+        m_condition.wait(lock, [this] { return m_open; });
+    }
+
+    void SetOpen(bool open)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_open = open;
+        m_condition.notify_all();
+    }
+
+    void WaitForBatches(int count)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_condition.wait(lock, [&] { return m_batches >= count; });
+    }
+
+    std::string GetReceived()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_received;
+    }
+
+private:
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    bool m_open = true;
+    int m_batches = 0;
+    std::string m_received;
+};
+
+BOOST_AUTO_TEST_CASE(AsyncLoggerDbgStream)
+{
+    auto pTransport = std::make_unique<TestTransport>();
+    auto& transport = *pTransport;
+    AsyncLogger logger(std::move(pTransport));
+    dbgstream::set_line_sink(&logger);
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t)
+    {
+        threads.emplace_back([t] {
+            for (int i = 0; i < 1000; ++i)
+            {
+                cdbg << "thread " << t << std::flush << " line " << i << "\n";
+            }
+        });
+    }
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+    dbgstream::set_line_sink(nullptr);
+    logger.Flush();
+
+    // the lines of the threads interleave, but every line arrives whole, also when it was flushed halfway
+    std::istringstream received(transport.GetReceived());
+    std::vector<int> next(4);
+    std::string line;
+    while (std::getline(received, line))
+    {
+        int t = line[7] - '0';
+        BOOST_REQUIRE(t >= 0 && t < 4);
+        BOOST_TEST(line == std::string(stringbuilder() << "thread " << t << " line " << next[t]));
+        ++next[t];
+    }
+    BOOST_TEST(next == std::vector<int>(4, 1000), boost::test_tools::per_element());
+    BOOST_TEST(logger.GetDropped() == 0u);
+}
+
+BOOST_AUTO_TEST_CASE(AsyncLoggerDropsWhenFull)
+{
+    auto pTransport = std::make_unique<TestTransport>();
+    auto& transport = *pTransport;
+    AsyncLogger logger(std::move(pTransport), 32);
+
+    // hold the writer thread in Send(), the next lines wait for it in the pending batch of at most 32 bytes
+    transport.SetOpen(false);
+    logger.write("first\n");
+    transport.WaitForBatches(1);
+    for (int i = 0; i < 10; ++i)
+    {
+        logger.write("123456789\n");
+    }
+    logger.write("two\nlines\n");
+    transport.SetOpen(true);
+    logger.Flush();
+    transport.WaitForBatches(2);
+
+    BOOST_TEST(logger.GetDropped() == 9u);
+    BOOST_TEST(transport.GetReceived() == "first\n123456789\n123456789\n123456789\n<9 lines dropped by the AsyncLogger>\n");
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 } // namespace fusion
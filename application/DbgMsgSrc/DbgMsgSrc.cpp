@@ -6,6 +6,7 @@
 #include "dbgstream.h"
 #include "Win32/Win32Lib.h"
 #include "Timer.h"
+#include "LoadGenerator.h"
 
 #include <iostream>
 #include <string>
@@ -366,7 +367,20 @@ void PrintUsage()
                  "  -A cout/cerr test\n"
                  "  -u <address> <port> Send UDP messsages to address:port\n"
                  "  -b Send 4 lines large enough to rule out any small string optimizations (50 chars)\n"
-                 "  -c Send 2 lines with utf-8 encoded unicode (chinese characters)\n";
+                 "  -c Send 2 lines with utf-8 encoded unicode (chinese characters)\n"
+                 "  -L [options] load generator, sends messages at a target rate and reports the achieved rate and send stalls\n"
+                 "     --rate <msg/s>        target rate of all producers together, 0 is unlimited (10000)\n"
+                 "     --producers <n>       sending threads (1)\n"
+                 "     --duration <s>        (10)\n"
+                 "     --size <bytes>        mean of the exponentially distributed message size (80)\n"
+                 "     --max-size <bytes>    (4096)\n"
+                 "     --processes <n>       simulated processes, named in the message prefix (8)\n"
+                 "     --templates <n>       distinct message templates (100)\n"
+                 "     --zipf <s>            skew of the process and template mix, 0 is uniform (1.0)\n"
+                 "     --burst <on>/<off>    send in bursts of <on> ms followed by <off> ms of silence, same average rate\n"
+                 "     --stall <ms>          a send that takes longer counts as a stall (1)\n"
+                 "     --seed <n>            (20130101)\n"
+                 "     --sink <sink>         ods, ring[:<name>], pipe (stdout), file:<path>, udp:<host>:<port> or tcp:<host>:<port> (ods)\n";
 }
 
 int Main(int argc, char* argv[])
@@ -491,6 +505,11 @@ int Main(int argc, char* argv[])
             PrintUsage();
             return -1;
         }
+        else if (arg == "-L")
+        {
+            GenerateLoad(ParseLoadSettings(argc, argv, i + 1));
+            return 0;
+        }
         else if (arg == "-B")
         {
             CoutCerrTest2();
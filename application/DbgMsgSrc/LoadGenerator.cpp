@@ -0,0 +1,509 @@
+// (C) Copyright Gert-Jan de Vos and Jan Wilmans 2013.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+// The load generator only uses standard C++, boost::asio and the portable shared-memory ring (except for the
+// OutputDebugString sink), so the udp, tcp, pipe and file sinks can also produce load from a Linux machine.
+
+#include "LoadGenerator.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+#include <boost/asio.hpp>
+#include "ShmRingLib/ShmRing.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+namespace fusion {
+namespace DbgMsgSrc {
+
+using Clock = std::chrono::steady_clock;
+
+class Sink
+{
+public:
+    virtual ~Sink() = default;
+    virtual void Send(const std::string& message) = 0;
+};
+
+class OdsSink : public Sink
+{
+public:
+    void Send(const std::string& message) override
+    {
+#ifdef _WIN32
+        OutputDebugStringA(message.c_str());
+#else
+        static_cast<void>(message);
+        throw std::runtime_error("the ods sink is only available on Windows");
+#endif
+    }
+};
+
+// all producers share one writer, the ring takes concurrent writes and drops messages instead of blocking when it is full
+class RingSink : public Sink
+{
+public:
+    explicit RingSink(std::shared_ptr<shmring::ShmRingWriter> pWriter) :
+        m_pWriter(std::move(pWriter))
+    {
+    }
+
+    void Send(const std::string& message) override
+    {
+        m_pWriter->Write(message);
+    }
+
+private:
+    std::shared_ptr<shmring::ShmRingWriter> m_pWriter;
+};
+
+// pipe and file sinks share a single stream between the producers
+class StreamSink : public Sink
+{
+public:
+    StreamSink(std::shared_ptr<std::ostream> pStream, std::shared_ptr<std::mutex> pMutex) :
+        m_pStream(std::move(pStream)),
+        m_pMutex(std::move(pMutex))
+    {
+    }
+
+    void Send(const std::string& message) override
+    {
+        std::lock_guard<std::mutex> lock(*m_pMutex);
+        m_pStream->write(message.data(), static_cast<std::streamsize>(message.size()));
+    }
+
+private:
+    std::shared_ptr<std::ostream> m_pStream;
+    std::shared_ptr<std::mutex> m_pMutex;
+};
+
+class UdpSink : public Sink
+{
+public:
+    UdpSink(const std::string& host, const std::string& port) :
+        m_socket(m_ioContext)
+    {
+        boost::asio::ip::udp::resolver resolver(m_ioContext);
+        m_endpoint = *resolver.resolve(boost::asio::ip::udp::v4(), host, port).begin();
+        m_socket.open(boost::asio::ip::udp::v4());
+    }
+
+    void Send(const std::string& message) override
+    {
+        m_socket.send_to(boost::asio::buffer(message), m_endpoint);
+    }
+
+private:
+    boost::asio::io_context m_ioContext;
+    boost::asio::ip::udp::socket m_socket;
+    boost::asio::ip::udp::endpoint m_endpoint;
+};
+
+// every producer has its own connection, so each producer shows up as a separate process in DebugView++
+class TcpSink : public Sink
+{
+public:
+    TcpSink(const std::string& host, const std::string& port) :
+        m_socket(m_ioContext)
+    {
+        boost::asio::ip::tcp::resolver resolver(m_ioContext);
+        boost::asio::connect(m_socket, resolver.resolve(host, port));
+    }
+
+    void Send(const std::string& message) override
+    {
+        boost::asio::write(m_socket, boost::asio::buffer(message));
+    }
+
+private:
+    boost::asio::io_context m_ioContext;
+    boost::asio::ip::tcp::socket m_socket;
+};
+
+std::vector<std::unique_ptr<Sink>> CreateSinks(const std::string& sink, size_t count)
+{
+    std::vector<std::unique_ptr<Sink>> sinks;
+    auto separator = sink.find(':');
+    auto type = sink.substr(0, separator);
+    auto argument = separator == std::string::npos ? std::string() : sink.substr(separator + 1);
+
+    std::shared_ptr<std::ostream> pStream;
+    auto pMutex = std::make_shared<std::mutex>();
+    if (type == "pipe")
+    {
+        std::ios::sync_with_stdio(false);
+        pStream = std::shared_ptr<std::ostream>(&std::cout, [](std::ostream* p) { p->flush(); });
+    }
+    else if (type == "file")
+    {
+        auto pFile = std::make_shared<std::ofstream>(argument, std::ofstream::binary | std::ofstream::trunc);
+        if (!*pFile)
+        {
+            throw std::runtime_error("unable to create '" + argument + "'");
+        }
+        pStream = pFile;
+    }
+
+    std::shared_ptr<shmring::ShmRingWriter> pRingWriter;
+    if (type == "ring")
+    {
+        pRingWriter = std::make_shared<shmring::ShmRingWriter>(argument.empty() ? shmring::DefaultName : argument);
+    }
+
+    std::string host;
+    std::string port;
+    if (type == "udp" || type == "tcp")
+    {
+        auto colon = argument.rfind(':');
+        if (colon == std::string::npos)
+        {
+            throw std::invalid_argument("expected " + type + ":<host>:<port>");
+        }
+        host = argument.substr(0, colon);
+        port = argument.substr(colon + 1);
+    }
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (type == "ods")
+        {
+            sinks.push_back(std::make_unique<OdsSink>());
+        }
+        else if (pRingWriter)
+        {
+            sinks.push_back(std::make_unique<RingSink>(pRingWriter));
+        }
+        else if (pStream)
+        {
+            sinks.push_back(std::make_unique<StreamSink>(pStream, pMutex));
+        }
+        else if (type == "udp")
+        {
+            sinks.push_back(std::make_unique<UdpSink>(host, port));
+        }
+        else if (type == "tcp")
+        {
+            sinks.push_back(std::make_unique<TcpSink>(host, port));
+        }
+        else
+        {
+            throw std::invalid_argument("unknown sink '" + sink + "'");
+        }
+    }
+    return sinks;
+}
+
+ZipfDistribution::ZipfDistribution(size_t n, double s) :
+    m_cdf(std::max<size_t>(n, 1))
+{
+    double sum = 0.0;
+    for (size_t i = 0; i < m_cdf.size(); ++i)
+    {
+        sum += 1.0 / std::pow(static_cast<double>(i + 1), s);
+        m_cdf[i] = sum;
+    }
+    for (auto& value : m_cdf)
+    {
+        value /= sum;
+    }
+}
+
+size_t ZipfDistribution::Sample(double u) const
+{
+    auto it = std::lower_bound(m_cdf.begin(), m_cdf.end(), u);
+    return std::min(static_cast<size_t>(it - m_cdf.begin()), m_cdf.size() - 1);
+}
+
+struct Statistics
+{
+    std::atomic<size_t> messages = 0;
+    std::atomic<size_t> bytes = 0;
+    std::atomic<size_t> stalls = 0;
+    std::mutex mutex; // protects the members below
+    Clock::duration stallTime = Clock::duration::zero();
+    Clock::duration longestSend = Clock::duration::zero();
+    Clock::duration maxLag = Clock::duration::zero();
+    std::vector<std::string> errors; // producers that stopped on a failed send
+};
+
+class Producer
+{
+public:
+    Producer(const LoadSettings& settings, const std::vector<std::string>& processNames, const std::vector<std::string>& templates, unsigned seed) :
+        m_settings(settings),
+        m_processNames(processNames),
+        m_templates(templates),
+        m_rng(seed),
+        m_process(processNames.size(), settings.zipf),
+        m_template(templates.size(), settings.zipf),
+        m_size(1.0 / std::max<double>(static_cast<double>(settings.meanSize), 1.0))
+    {
+        auto rate = m_settings.rate / static_cast<double>(m_settings.producers);
+        m_interval = rate > 0 ? 1.0 / rate : 0.0;
+        if (m_settings.burstOn > 0 && m_settings.burstOff > 0)
+        {
+            m_burstOn = m_settings.burstOn / 1000;
+            m_burstPeriod = (m_settings.burstOn + m_settings.burstOff) / 1000;
+        }
+    }
+
+    void Run(Sink& sink, Statistics& statistics, Clock::time_point start, Clock::time_point end)
+    {
+        auto stallThreshold = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double, std::milli>(m_settings.stallThreshold));
+        auto stallTime = Clock::duration::zero();
+        auto longestSend = Clock::duration::zero();
+        auto maxLag = Clock::duration::zero();
+        std::string message;
+        std::string error;
+        size_t sent = 0;
+        for (size_t n = 0;; ++n)
+        {
+            auto due = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(GetScheduledTime(n)));
+            if (due >= end)
+            {
+                break;
+            }
+            auto now = Clock::now();
+            if (now < due)
+            {
+                std::this_thread::sleep_until(due);
+            }
+            else
+            {
+                maxLag = std::max(maxLag, now - due);
+            }
+
+            Format(message);
+            auto t0 = Clock::now();
+            try
+            {
+                sink.Send(message);
+            }
+            catch (std::exception& e)
+            {
+                error = std::string(e.what()) + " after " + std::to_string(sent) + " messages";
+                break;
+            }
+            ++sent;
+            auto duration = Clock::now() - t0;
+            if (duration > stallThreshold)
+            {
+                ++statistics.stalls;
+                stallTime += duration;
+            }
+            longestSend = std::max(longestSend, duration);
+            ++statistics.messages;
+            statistics.bytes += message.size();
+            if (m_interval == 0.0 && t0 >= end)
+            {
+                break;
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(statistics.mutex);
+        statistics.stallTime += stallTime;
+        statistics.longestSend = std::max(statistics.longestSend, longestSend);
+        statistics.maxLag = std::max(statistics.maxLag, maxLag);
+        if (!error.empty())
+        {
+            statistics.errors.push_back(error);
+        }
+    }
+
+private:
+    // seconds after the start that message 'n' is due, bursts compress the schedule into the 'on' part of each period
+    double GetScheduledTime(size_t n) const
+    {
+        if (m_burstPeriod == 0.0)
+        {
+            return n * m_interval;
+        }
+        auto active = n * m_interval * m_burstOn / m_burstPeriod;
+        auto cycle = std::floor(active / m_burstOn);
+        return cycle * m_burstPeriod + (active - cycle * m_burstOn);
+    }
+
+    void Format(std::string& message)
+    {
+        message = m_processNames[m_process(m_rng)];
+        message += ": ";
+        message += m_templates[m_template(m_rng)];
+        message += ' ';
+        message += std::to_string(m_rng() % 100000);
+        auto size = std::min(static_cast<size_t>(m_size(m_rng)), m_settings.maxSize);
+        if (message.size() + 1 < size)
+        {
+            message.append(size - message.size() - 1, '.');
+        }
+        message += '\n';
+    }
+
+    const LoadSettings& m_settings;
+    const std::vector<std::string>& m_processNames;
+    const std::vector<std::string>& m_templates;
+    std::mt19937 m_rng;
+    ZipfDistribution m_process;
+    ZipfDistribution m_template;
+    std::exponential_distribution<double> m_size;
+    double m_interval = 0.0;
+    double m_burstOn = 0.0;
+    double m_burstPeriod = 0.0;
+};
+
+std::vector<std::string> CreateTemplates(const LoadSettings& settings)
+{
+    static const char* words[] = {"error", "warning", "info", "connect", "socket", "timeout", "frame", "render", "update", "buffer", "thread", "queue",
+        "retry", "open", "close", "read", "write", "flush", "cache", "miss", "hit", "request", "response", "latency"};
+
+    std::mt19937 rng(settings.seed);
+    std::uniform_int_distribution<size_t> word(0, std::size(words) - 1);
+    std::uniform_int_distribution<size_t> length(2, 8);
+    std::vector<std::string> templates;
+    for (size_t i = 0; i < std::max<size_t>(settings.templates, 1); ++i)
+    {
+        std::string text = "#" + std::to_string(i);
+        for (size_t n = length(rng); n > 0; --n)
+        {
+            text += ' ';
+            text += words[word(rng)];
+        }
+        templates.push_back(text);
+    }
+    return templates;
+}
+
+std::vector<std::string> CreateProcessNames(const LoadSettings& settings)
+{
+    std::vector<std::string> names;
+    for (size_t i = 0; i < std::max<size_t>(settings.processes, 1); ++i)
+    {
+        names.push_back("process" + std::to_string(i) + ".exe");
+    }
+    return names;
+}
+
+double ToMs(Clock::duration duration)
+{
+    return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+LoadSettings ParseLoadSettings(int argc, char* argv[], int i)
+{
+    LoadSettings settings;
+    for (; i < argc; ++i)
+    {
+        std::string option(argv[i]);
+        if (i + 1 >= argc)
+        {
+            throw std::invalid_argument("missing value for " + option);
+        }
+        std::string value(argv[++i]);
+        if (option == "--rate")
+            settings.rate = std::stod(value);
+        else if (option == "--producers")
+            settings.producers = std::max<size_t>(std::stoul(value), 1);
+        else if (option == "--duration")
+            settings.duration = std::stod(value);
+        else if (option == "--size")
+            settings.meanSize = std::stoul(value);
+        else if (option == "--max-size")
+            settings.maxSize = std::stoul(value);
+        else if (option == "--processes")
+            settings.processes = std::stoul(value);
+        else if (option == "--templates")
+            settings.templates = std::stoul(value);
+        else if (option == "--zipf")
+            settings.zipf = std::stod(value);
+        else if (option == "--burst")
+        {
+            auto slash = value.find('/');
+            if (slash == std::string::npos)
+            {
+                throw std::invalid_argument("expected --burst <on-ms>/<off-ms>");
+            }
+            settings.burstOn = std::stod(value.substr(0, slash));
+            settings.burstOff = std::stod(value.substr(slash + 1));
+        }
+        else if (option == "--stall")
+            settings.stallThreshold = std::stod(value);
+        else if (option == "--seed")
+            settings.seed = static_cast<unsigned>(std::stoul(value));
+        else if (option == "--sink")
+            settings.sink = value;
+        else
+            throw std::invalid_argument("unknown load generator option " + option);
+    }
+    return settings;
+}
+
+void GenerateLoad(const LoadSettings& settings)
+{
+    std::ostream& report = settings.sink == "pipe" ? std::cerr : std::cout;
+    auto processNames = CreateProcessNames(settings);
+    auto templates = CreateTemplates(settings);
+    auto sinks = CreateSinks(settings.sink, settings.producers);
+
+    report << "Sending " << (settings.rate > 0 ? std::to_string(static_cast<size_t>(settings.rate)) : "unlimited") << " msg/s for " << settings.duration << " s from "
+           << settings.producers << " producers to " << settings.sink << "\n";
+
+    Statistics statistics;
+    auto start = Clock::now() + std::chrono::milliseconds(10);
+    auto end = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(settings.duration));
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < settings.producers; ++i)
+    {
+        threads.emplace_back([&, i] {
+            Producer producer(settings, processNames, templates, settings.seed + static_cast<unsigned>(i) + 1);
+            producer.Run(*sinks[i], statistics, start, end);
+        });
+    }
+
+    // the rate per second shows where the sender cannot keep up
+    size_t previous = 0;
+    for (auto second = start + std::chrono::seconds(1); second <= end; second += std::chrono::seconds(1))
+    {
+        std::this_thread::sleep_until(second);
+        size_t messages = statistics.messages;
+        report << std::setw(6) << std::chrono::duration_cast<std::chrono::seconds>(second - start).count() << " s: " << messages - previous << " msg/s, " << statistics.stalls << " stalls\n";
+        previous = messages;
+    }
+
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+    auto elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+    sinks.clear();
+
+    report << std::fixed << std::setprecision(1);
+    report << "sent " << statistics.messages << " messages (" << statistics.bytes / (1024.0 * 1024.0) << " MB) in " << elapsed << " s: " << statistics.messages / elapsed << " msg/s, "
+           << statistics.bytes / elapsed / (1024.0 * 1024.0) << " MB/s\n";
+    report << "stalls: " << statistics.stalls << " sends took longer than " << settings.stallThreshold << " ms, " << ToMs(statistics.stallTime) << " ms in total, longest send "
+           << ToMs(statistics.longestSend) << " ms\n";
+    if (settings.rate > 0)
+    {
+        report << "max lag behind schedule: " << ToMs(statistics.maxLag) << " ms\n";
+    }
+    for (auto& error : statistics.errors)
+    {
+        report << "producer stopped: " << error << "\n";
+    }
+}
+
+} // namespace DbgMsgSrc
+} // namespace fusion
@@ -0,0 +1,58 @@
+// (C) Copyright Gert-Jan de Vos and Jan Wilmans 2013.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <random>
+#include <string>
+#include <vector>
+
+namespace fusion {
+namespace DbgMsgSrc {
+
+struct LoadSettings
+{
+    double rate = 10000;          // messages per second of all producers together, 0 is as fast as possible
+    size_t producers = 1;         // threads that each send rate / producers messages per second
+    double duration = 10;         // seconds
+    size_t meanSize = 80;         // message sizes are exponentially distributed around meanSize ...
+    size_t maxSize = 4096;        // ... and limited to maxSize
+    size_t processes = 8;         // simulated processes, the name is the prefix of each message
+    size_t templates = 100;       // distinct message templates
+    double zipf = 1.0;            // skew of the process and template mix, 0 is uniform
+    double burstOn = 0;           // milliseconds of sending at an increased rate ...
+    double burstOff = 0;          // ... followed by milliseconds of silence, the average rate stays 'rate'
+    double stallThreshold = 1;    // milliseconds, a send that blocks longer counts as a stall
+    unsigned seed = 20130101;
+    std::string sink = "ods";     // ods, ring[:<name>], pipe (stdout), file:<path>, udp:<host>:<port> or tcp:<host>:<port>
+};
+
+// samples 0..n-1 with probability proportional to 1 / (i + 1)^s
+class ZipfDistribution
+{
+public:
+    ZipfDistribution(size_t n, double s);
+
+    template <typename Rng>
+    size_t operator()(Rng& rng)
+    {
+        return Sample(std::uniform_real_distribution<double>(0.0, 1.0)(rng));
+    }
+
+private:
+    size_t Sample(double u) const;
+
+    std::vector<double> m_cdf;
+};
+
+// parses the options that follow -L, starting at argv[i]
+LoadSettings ParseLoadSettings(int argc, char* argv[], int i);
+
+// sends messages according to 'settings' and reports the achieved rate and the send-side stalls on stdout,
+// or on stderr when the messages go to stdout
+void GenerateLoad(const LoadSettings& settings);
+
+} // namespace DbgMsgSrc
+} // namespace fusion
@@ -4,28 +4,36 @@
 // http://www.boost.org/LICENSE_1_0.txt)
 
 #include <iostream>
-#include <iomanip>
 #include <fstream>
 #include <vector>
 #include <memory>
 #include <algorithm>
+#include <condition_variable>
+#include <thread>
 #include <boost/asio.hpp>
+#include <boost/algorithm/string/predicate.hpp>
 #include "Win32/Utilities.h"
 #include "CobaltFusion/scope_guard.h"
 #include "CobaltFusion/Str.h"
 #include "CobaltFusion/ExecutorClient.h"
 #include "CobaltFusion/Executor.h"
+#include "DebugViewppLib/BatchFilter.h"
 #include "DebugViewppLib/DBWinBuffer.h"
 #include "DebugViewppLib/DBWinReader.h"
 #include "DebugViewppLib/FileIO.h"
 #include "DebugViewppLib/ProcessInfo.h"
 #include "DebugViewppLib/LogSources.h"
 #include "DebugViewppLib/Conversions.h"
+#include "DebugViewppLib/LatencyTrace.h"
 #include "DebugViewppLib/LineBuffer.h"
+#include "DebugViewppLib/Metrics.h"
+#include "DebugViewppLib/ShmRingReader.h"
+#include "DebugViewppLib/StreamWriter.h"
 #include "../DebugViewpp/version.h"
 
 #include "DebugViewppLib/Filter.h"
 #include "DebugViewppLib/LogFile.h"
+#include "DebugViewppLib/LogFilter.h"
 
 #define DOCOPT_HEADER_ONLY
 #include "docopt.h"
@@ -45,7 +53,16 @@ struct Settings
     bool linenumber;
     bool console;
     bool verbose;
+    bool stream;
+    bool batch;
+    bool ring;
+    OutputFormat format;
     std::string filename;
+    std::string filterfile;
+    std::string record;
+    std::string stats;
+    unsigned latency;
+    std::vector<std::string> logfiles;
     std::vector<std::string> include;
     std::vector<std::string> exclude;
     std::vector<std::string> includeprocesses;
@@ -53,33 +70,29 @@ struct Settings
     std::string quitmessage;
 };
 
-void OutputDetails(Settings settings, const Line& line)
+OutputColumns GetOutputColumns(const Settings& settings)
 {
-    std::string separator = settings.tabs ? "\t" : " ";
-    if (settings.timestamp)
-    {
-        std::cout << GetTimeText(line.systemTime) << separator;
-    }
-    if (settings.performanceCounter)
-    {
-        std::cout << GetTimeText(line.time) << separator;
-    }
-    if (settings.pid)
-    {
-        std::cout << line.pid << separator;
-    }
-    if (settings.processName)
-    {
-        std::cout << line.processName.c_str() << separator;
-    }
+    OutputColumns columns;
+    columns.lineNumber = settings.linenumber;
+    columns.systemTime = settings.timestamp;
+    columns.time = settings.performanceCounter;
+    columns.pid = settings.pid;
+    columns.processName = settings.processName;
+    columns.tabs = settings.tabs;
+    return columns;
 }
 
 static bool g_quit = false;
 static Win32::Handle g_quitMessageHandle;
+static Win32::Handle g_wakeupHandle;
 
 void Quit()
 {
     g_quit = true;
+    if (g_wakeupHandle)
+    {
+        Win32::SetEvent(g_wakeupHandle);
+    }
 }
 
 bool ContainsText(const std::string& line, const std::string& message)
@@ -114,19 +127,9 @@ bool IsIncluded(LogFilter& filter, const Line& line)
     return IsIncluded(filter.processFilters, line.processName, matchcolors) && IsIncluded(filter.messageFilters, line.message, matchcolors);
 }
 
-void LogMessages(Settings settings)
+LogFilter CreateFilter(const Settings& settings)
 {
-    using namespace std::chrono_literals;
     LogFilter filter;
-    ActiveExecutorClient executor;
-    LogSources logsources(executor);
-    executor.Call([&] {
-        logsources.AddDBWinReader(false);
-        if (IsWindowsVistaOrGreater() && HasGlobalDBWinReaderRights())
-            logsources.AddDBWinReader(true);
-        logsources.SetAutoNewLine(settings.autonewline);
-    });
-
     for (const auto& value : settings.include)
     {
         AddMessageFilter(filter, FilterType::Include, value);
@@ -146,6 +149,77 @@ void LogMessages(Settings settings)
     {
         AddProcessFilter(filter, FilterType::Exclude, value);
     }
+    return filter;
+}
+
+// appends a JSON snapshot of the metrics registry to a file every second, one object per line
+class StatsWriter
+{
+public:
+    explicit StatsWriter(const std::string& filename) :
+        m_file(filename, std::ofstream::app)
+    {
+        if (!m_file)
+        {
+            throw std::runtime_error("unable to open '" + filename + "'");
+        }
+        m_thread = std::thread([this] { Run(); });
+    }
+
+    ~StatsWriter()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_end = true;
+        }
+        m_cv.notify_one();
+        m_thread.join();
+    }
+
+private:
+    void Run()
+    {
+        using namespace std::chrono_literals;
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while (!m_cv.wait_for(lock, 1s, [this] { return m_end; }))
+        {
+            m_file << ToJson(GetMetrics().Sample()) << std::endl;
+        }
+        m_file << ToJson(GetMetrics().Sample()) << std::endl;
+    }
+
+    std::ofstream m_file;
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    bool m_end = false;
+    std::thread m_thread;
+};
+
+void AddReaders(LogSources& logsources, const Settings& settings)
+{
+    logsources.AddDBWinReader(false);
+    if (IsWindowsVistaOrGreater() && HasGlobalDBWinReaderRights())
+        logsources.AddDBWinReader(true);
+    if (settings.ring)
+    {
+        logsources.AddShmRingReader(shmring::DefaultName);
+    }
+    logsources.SetAutoNewLine(settings.autonewline);
+    if (!settings.record.empty())
+    {
+        logsources.StartRecording(WStr(settings.record));
+    }
+}
+
+void LogMessages(Settings settings)
+{
+    using namespace std::chrono_literals;
+    auto filter = CreateFilter(settings);
+    ActiveExecutorClient executor;
+    LogSources logsources(executor);
+    executor.Call([&] {
+        AddReaders(logsources, settings);
+    });
 
     std::ofstream fs;
     if (!settings.filename.empty())
@@ -163,14 +237,14 @@ void LogMessages(Settings settings)
         }
     });
 
-    std::string separator = settings.tabs ? "\t" : " ";
+    LineFormatter formatter(settings.format, GetOutputColumns(settings));
+    std::string buffer;
     while (!g_quit && (!IsEventSet(g_quitMessageHandle)))
     {
         Lines lines;
         executor.Call([&] {
             lines = logsources.GetLines();
         });
-        int linenumber = 0;
         for (const auto& line : lines)
         {
             if (ContainsText(line.message, settings.quitmessage))
@@ -184,19 +258,18 @@ void LogMessages(Settings settings)
 
             if (settings.console)
             {
-                if (settings.linenumber)
-                {
-                    ++linenumber;
-                    std::cout << std::setw(5) << std::setfill('0') << linenumber << std::setfill(' ') << separator;
-                }
-                OutputDetails(settings, line);
-                std::cout << separator << line.message.c_str() << "\n";
+                formatter.Format(line, buffer);
             }
             if (!settings.filename.empty())
             {
                 WriteLogFileMessage(fs, line.time, line.systemTime, line.pid, line.processName, line.message);
             }
         }
+        if (!buffer.empty())
+        {
+            std::cout.write(buffer.data(), buffer.size());
+            buffer.clear();
+        }
         if (settings.flush)
         {
             std::cout.flush();
@@ -207,6 +280,144 @@ void LogMessages(Settings settings)
     std::cout.flush();
 }
 
+// drains the sources whenever LogSources signals an update and hands the formatted lines to a writer thread
+void StreamMessages(const Settings& settings)
+{
+    auto filter = CreateFilter(settings);
+    g_wakeupHandle = Win32::CreateEvent(nullptr, false, false, nullptr);
+    ActiveExecutorClient executor;
+    LogSources logsources(executor);
+    executor.Call([&] {
+        AddReaders(logsources, settings);
+        logsources.SubscribeToUpdate([] {
+            Win32::SetEvent(g_wakeupHandle);
+            return true;
+        });
+    });
+
+    LineFormatter consoleFormatter(settings.format, GetOutputColumns(settings));
+    std::string consoleBuffer;
+    std::unique_ptr<StreamWriter> pConsoleWriter;
+    if (settings.console)
+    {
+        pConsoleWriter = std::make_unique<StreamWriter>(std::cout);
+    }
+
+    LineFormatter fileFormatter(OutputFormat::Native);
+    std::string fileBuffer;
+    std::ofstream fs;
+    std::unique_ptr<StreamWriter> pFileWriter;
+    if (!settings.filename.empty())
+    {
+        OpenLogFile(fs, WStr(settings.filename));
+        pFileWriter = std::make_unique<StreamWriter>(fs);
+    }
+
+    std::vector<HANDLE> handles = {g_wakeupHandle.get(), g_quitMessageHandle.get()};
+    while (!g_quit)
+    {
+        auto result = Win32::WaitForAnyObject(handles, INFINITE);
+        if (result.signaled && result.index == WAIT_OBJECT_0 + 1)
+        {
+            break;
+        }
+
+        Lines lines;
+        executor.Call([&] {
+            lines = logsources.GetLines();
+        });
+        for (const auto& line : lines)
+        {
+            if (ContainsText(line.message, settings.quitmessage))
+            {
+                Quit();
+                break;
+            }
+
+            if (!debugviewpp::IsIncluded(filter, line))
+                continue;
+
+            if (pConsoleWriter)
+            {
+                consoleFormatter.Format(line, consoleBuffer);
+            }
+            if (pFileWriter)
+            {
+                fileFormatter.Format(line, fileBuffer);
+            }
+        }
+
+        if (pConsoleWriter)
+        {
+            pConsoleWriter->Write(consoleBuffer);
+        }
+        if (pFileWriter)
+        {
+            pFileWriter->Write(fileBuffer);
+        }
+        if (settings.flush)
+        {
+            if (pConsoleWriter)
+                pConsoleWriter->Flush();
+            if (pFileWriter)
+                pFileWriter->Flush();
+        }
+    }
+
+    pConsoleWriter.reset();
+    if (pFileWriter)
+    {
+        pFileWriter.reset();
+        fs.close();
+        std::cerr << "Log file closed.\n";
+    }
+}
+
+// filters saved log files like grep, returns 0 when any line matched
+int FilterLogFiles(const Settings& settings)
+{
+    auto filter = CreateFilter(settings);
+    if (!settings.filterfile.empty())
+    {
+        auto data = boost::iends_with(settings.filterfile, ".xml") ? LoadXml(settings.filterfile) : LoadJson(settings.filterfile);
+        filter.messageFilters.insert(filter.messageFilters.end(), data.filter.messageFilters.begin(), data.filter.messageFilters.end());
+        filter.processFilters.insert(filter.processFilters.end(), data.filter.processFilters.begin(), data.filter.processFilters.end());
+    }
+
+    std::vector<std::wstring> filenames;
+    for (const auto& logfile : settings.logfiles)
+    {
+        filenames.push_back(WStr(logfile).str());
+    }
+
+    LineFormatter formatter(settings.format, GetOutputColumns(settings));
+    StreamWriter writer(std::cout);
+    std::string buffer;
+    size_t count = 0;
+    BatchFilter batchFilter(filter);
+    batchFilter.Run(
+        filenames,
+        [&](const Line& line) {
+            formatter.Format(line, buffer);
+            if (buffer.size() >= StreamWriter::BufferSize)
+            {
+                writer.Write(buffer);
+            }
+            ++count;
+        },
+        [](const std::wstring& filename, const std::string& message) {
+            std::cerr << Str(filename).str() << ": " << message << "\n";
+        });
+    writer.Write(buffer);
+    writer.Flush();
+
+    if (settings.verbose)
+    {
+        std::cerr << count << " matching lines in " << filenames.size() << " files, filtered on " << batchFilter.GetThreadCount() << " threads\n";
+    }
+    return count > 0 ? 0 : 1;
+}
+
 } // namespace debugviewpp
 } // namespace fusion
 
@@ -241,7 +452,8 @@ static const char USAGE[] =
     R"(DebugviewConsole )" VERSION_STR
     R"(
     Usage:
-        DebugviewConsole [-acflsqtpnv] [-d <file>] [-i <pattern>]... [-e <pattern>]... [-m <message>] [--include-process <pattern>]... [--exclude-process <pattern>]...
+        DebugviewConsole [-acflsqtpnv] [-d <file>] [-i <pattern>]... [-e <pattern>]... [-m <message>] [--include-process <pattern>]... [--exclude-process <pattern>]... [--stream] [--ring] [--format <format>] [--record <file>] [--stats <file> [--latency <interval>]]
+        DebugviewConsole -b [-lsqtpnv] [--filter-file <file>] [-i <pattern>]... [-e <pattern>]... [--include-process <pattern>]... [--exclude-process <pattern>]... [--format <format>] <logfile>...
         DebugviewConsole (-h | --help)
         DebugviewConsole [-x]
         DebugviewConsole [-u]
@@ -256,6 +468,8 @@ static const char USAGE[] =
         -c              enable console output
         -d <file>       write to .dblog file
         -v              verbose
+        -b, --batch     filter saved log files (.dblog, Sysinternals .log or text) on all cores and write the matching lines in order
+        --filter-file <file>    filters saved by DebugView++ (.xml or .json), combined with the other filter options
 
     Console options:    (no effect on .dblog file)
         -l              prefix line number
@@ -264,11 +478,17 @@ static const char USAGE[] =
         -t              tab-separated output
         -p              add PID (process ID)
         -n              add process name
+        --format <format>   console output format: text, json (JSON Lines) or native (.dblog) [default: text]
 
     Advanced options:
         -f              aggressively flush buffers, if unsure, do not use
+        --stream        high-throughput output, lines are written as soon as they arrive by a separate writer thread
+        --ring          also capture the messages that clients write to the shared-memory ring
         -x              stop all running debugviewconsole instances
         -u              send a UDP test-message, used only for debugging
+        --record <file> record all received messages to a binary trace that can be replayed by DebugViewppBench --replay
+        --stats <file>  append a JSON snapshot of the pipeline statistics to <file> every second (JSON Lines)
+        --latency <interval>    trace the latency of 1 in <interval> lines through the pipeline, reported by --stats [default: 0]
         -m <message>, --quit-message <message>  if this message is received the application exits
 )";
 
@@ -293,6 +513,18 @@ fusion::debugviewpp::Settings CreateSettings(const std::map<std::string, docopt:
     settings.excludeprocesses = args.at("--exclude-process").asStringList();
     auto quitmessageEntry = args.at("--quit-message");
     settings.quitmessage = (quitmessageEntry) ? quitmessageEntry.asString() : "";
+    settings.stream = args.at("--stream").asBool();
+    settings.batch = args.at("--batch").asBool();
+    settings.ring = args.at("--ring").asBool();
+    auto filterfileEntry = args.at("--filter-file");
+    settings.filterfile = (filterfileEntry) ? filterfileEntry.asString() : "";
+    settings.logfiles = args.at("<logfile>").asStringList();
+    auto recordEntry = args.at("--record");
+    settings.record = (recordEntry) ? recordEntry.asString() : "";
+    auto statsEntry = args.at("--stats");
+    settings.stats = (statsEntry) ? statsEntry.asString() : "";
+    settings.latency = static_cast<unsigned>(std::stoul(args.at("--latency").asString()));
+    settings.format = fusion::debugviewpp::ParseOutputFormat(args.at("--format").asString());
     return settings;
 }
 
@@ -320,7 +552,9 @@ try
         }
     }
 
-    std::cout << "DebugViewConsole " << VERSION_STR << std::endl;
+    // keep stdout clean for the formatted lines when streaming into another tool
+    std::ostream& info = settings.stream || settings.batch ? std::cerr : std::cout;
+    info << "DebugViewConsole " << VERSION_STR << std::endl;
 
     g_quitMessageHandle = fusion::Win32::CreateEvent(nullptr, true, false, L"DebugViewConsoleQuitEvent");
     if (args.at("-x").asBool())
@@ -353,15 +587,34 @@ try
         return 0;
     }
 
-    if (settings.filename.empty() && settings.console == false)
+    if (settings.batch)
+    {
+        return FilterLogFiles(settings);
+    }
+
+    if (settings.filename.empty() && settings.console == false && settings.record.empty())
     {
         std::cout << "Neither output to logfile or console was specified, nothing to do...\n";
         return 1;
     }
 
-    std::cout << "Listening for OutputDebugString messages..." << std::endl;
-    LogMessages(settings);
-    std::cout << "Process ended normally.\n";
+    std::unique_ptr<StatsWriter> pStatsWriter;
+    if (!settings.stats.empty())
+    {
+        pStatsWriter = std::make_unique<StatsWriter>(settings.stats);
+        SetLatencySampling(settings.latency);
+    }
+
+    info << "Listening for OutputDebugString messages..." << std::endl;
+    if (settings.stream)
+    {
+        StreamMessages(settings);
+    }
+    else
+    {
+        LogMessages(settings);
+    }
+    info << "Process ended normally.\n";
     return 0;
 }
 catch (std::exception& e)
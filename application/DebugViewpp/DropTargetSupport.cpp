@@ -80,9 +80,9 @@ std::string GetCF_TEXT(IDataObject* pDataObject)
     return result;
 }
 
-std::wstring GetCF_HDROP(IDataObject* pDataObject)
+std::vector<std::wstring> GetCF_HDROP(IDataObject* pDataObject)
 {
-    std::wstring result;
+    std::vector<std::wstring> result;
     // construct a FORMATETC object
     FORMATETC fmtetc = {CF_HDROP, nullptr, DVASPECT_CONTENT, -1, TYMED_HGLOBAL};
     STGMEDIUM stgmed;
@@ -92,12 +92,13 @@ std::wstring GetCF_HDROP(IDataObject* pDataObject)
         // we asked for the data as a HGLOBAL, so access it appropriately
         auto hDropInfo = static_cast<HDROP>(GlobalLock(stgmed.hGlobal));
 
-        if (DragQueryFile(hDropInfo, 0xFFFFFFFF, nullptr, 0) == 1)
+        UINT count = DragQueryFile(hDropInfo, 0xFFFFFFFF, nullptr, 0);
+        for (UINT i = 0; i < count; ++i)
         {
-            std::vector<wchar_t> filename(DragQueryFile(hDropInfo, 0, nullptr, 0) + 1);
-            if (DragQueryFile(hDropInfo, 0, filename.data(), static_cast<UINT>(filename.size())))
+            std::vector<wchar_t> filename(DragQueryFile(hDropInfo, i, nullptr, 0) + 1);
+            if (DragQueryFile(hDropInfo, i, filename.data(), static_cast<UINT>(filename.size())))
             {
-                result = std::wstring(filename.data());
+                result.emplace_back(filename.data());
             }
         }
         GlobalUnlock(stgmed.hGlobal);
@@ -120,7 +121,15 @@ STDMETHODIMP DropTargetSupport::Drop(IDataObject* pDataObject, DWORD /*grfKeySta
     if (QueryDataObject(pDataObject, CF_HDROP))
     {
         *pdwEffect = DROPEFFECT_COPY;
-        m_onDropped(GetCF_HDROP(pDataObject));
+        auto files = GetCF_HDROP(pDataObject);
+        if (files.size() == 1)
+        {
+            m_onDropped(files.front());
+        }
+        else if (files.size() > 1)
+        {
+            m_onDroppedFiles(files);
+        }
     }
 
     return S_OK;
@@ -131,5 +140,10 @@ boost::signals2::connection DropTargetSupport::SubscribeToDropped(DroppedSignal:
     return m_onDropped.connect(slot);
 }
 
+boost::signals2::connection DropTargetSupport::SubscribeToDroppedFiles(DroppedFilesSignal::slot_type slot)
+{
+    return m_onDroppedFiles.connect(slot);
+}
+
 } // namespace debugviewpp
 } // namespace fusion
@@ -7,6 +7,8 @@
 
 #include <atlbase.h>
 #include <atlcom.h>
+#include <string>
+#include <vector>
 #include <boost/signals2/signal.hpp>
 
 namespace fusion {
@@ -33,9 +35,14 @@ public:
     using DroppedSignal = boost::signals2::signal<void(const std::wstring&)>;
     boost::signals2::connection SubscribeToDropped(DroppedSignal::slot_type slot);
 
+    // more than one file dropped at once
+    using DroppedFilesSignal = boost::signals2::signal<void(const std::vector<std::wstring>&)>;
+    boost::signals2::connection SubscribeToDroppedFiles(DroppedFilesSignal::slot_type slot);
+
 private:
     HWND m_hwnd = nullptr;
     DroppedSignal m_onDropped;
+    DroppedFilesSignal m_onDroppedFiles;
 };
 
 } // namespace debugviewpp
@@ -0,0 +1,68 @@
+// (C) Copyright Gert-Jan de Vos and Jan Wilmans 2013.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#include "CobaltFusion/AtlWinExt.h"
+#include "CobaltFusion/Str.h"
+#include "CobaltFusion/fusionassert.h"
+#include "Win32/Utilities.h"
+#include "DebugViewppLib/Conversions.h"
+#include "GoToTimeDlg.h"
+
+namespace fusion {
+namespace debugviewpp {
+
+BEGIN_MSG_MAP2(CGoToTimeDlg)
+    MSG_WM_INITDIALOG(OnInitDialog)
+    COMMAND_ID_HANDLER_EX(IDCANCEL, OnCancel)
+    COMMAND_ID_HANDLER_EX(IDOK, OnOk)
+    REFLECT_NOTIFICATIONS()
+END_MSG_MAP()
+
+CGoToTimeDlg::CGoToTimeDlg(const SYSTEMTIME& time) :
+    m_time(time)
+{
+}
+
+SYSTEMTIME CGoToTimeDlg::GetTime() const
+{
+    return m_time;
+}
+
+void CGoToTimeDlg::OnException() const
+{
+    FUSION_REPORT_EXCEPTION("Unknown Exception");
+}
+
+void CGoToTimeDlg::OnException(const std::exception& ex) const
+{
+    FUSION_REPORT_EXCEPTION(ex.what());
+}
+
+BOOL CGoToTimeDlg::OnInitDialog(CWindow /*wndFocus*/, LPARAM /*lInitParam*/)
+{
+    SetDlgItemText(IDC_GOTO_DATE, WStr(GetDateText(m_time)));
+    SetDlgItemText(IDC_GOTO_TIME, WStr(GetTimeText(m_time)));
+    CenterWindow(GetParent());
+    return TRUE;
+}
+
+void CGoToTimeDlg::OnCancel(UINT /*uNotifyCode*/, int nID, CWindow /*wndCtl*/)
+{
+    EndDialog(nID);
+}
+
+void CGoToTimeDlg::OnOk(UINT /*uNotifyCode*/, int nID, CWindow /*wndCtl*/)
+{
+    if (!ReadTimeOfDay(Str(Win32::GetDlgItemText(*this, IDC_GOTO_TIME)), m_time))
+    {
+        MessageBox(L"Enter the time as hh:mm:ss.fff", L"Go To Time", MB_ICONEXCLAMATION | MB_OK);
+        GetDlgItem(IDC_GOTO_TIME).SetFocus();
+        return;
+    }
+    EndDialog(nID);
+}
+
+} // namespace debugviewpp
+} // namespace fusion
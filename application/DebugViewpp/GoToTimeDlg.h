@@ -0,0 +1,43 @@
+// (C) Copyright Gert-Jan de Vos and Jan Wilmans 2013.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <string>
+#include "CobaltFusion/AtlWinExt.h"
+#include "resource.h"
+
+#include "atleverything.h"
+
+namespace fusion {
+namespace debugviewpp {
+
+class CGoToTimeDlg : public CDialogImpl<CGoToTimeDlg>,
+                     public ExceptionHandler<CGoToTimeDlg, std::exception>
+{
+public:
+    enum
+    {
+        IDD = IDD_GOTOTIME
+    };
+
+    // 'time' provides the date and the initial time of day, in local time
+    explicit CGoToTimeDlg(const SYSTEMTIME& time);
+    SYSTEMTIME GetTime() const;
+
+private:
+    DECLARE_MSG_MAP()
+
+    void OnException() const;
+    void OnException(const std::exception& ex) const;
+    BOOL OnInitDialog(CWindow /*wndFocus*/, LPARAM /*lInitParam*/);
+    void OnCancel(UINT /*uNotifyCode*/, int nID, CWindow /*wndCtl*/);
+    void OnOk(UINT /*uNotifyCode*/, int nID, CWindow /*wndCtl*/);
+
+    SYSTEMTIME m_time;
+};
+
+} // namespace debugviewpp
+} // namespace fusion
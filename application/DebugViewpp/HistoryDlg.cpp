@@ -20,9 +20,10 @@ BEGIN_MSG_MAP2(CHistoryDlg)
     REFLECT_NOTIFICATIONS()
 END_MSG_MAP()
 
-CHistoryDlg::CHistoryDlg(size_t historySize, bool unlimited) :
+CHistoryDlg::CHistoryDlg(size_t historySize, bool unlimited, size_t memoryLimit) :
     m_historySize(static_cast<int>(historySize)),
-    m_unlimited(unlimited)
+    m_unlimited(unlimited),
+    m_memoryLimit(memoryLimit)
 {
 }
 
@@ -39,6 +40,7 @@ void CHistoryDlg::OnException(const std::exception& ex) const
 BOOL CHistoryDlg::OnInitDialog(CWindow /*wndFocus*/, LPARAM /*lInitParam*/)
 {
     SetDlgItemInt(IDC_HISTORY, m_historySize);
+    SetDlgItemInt(IDC_MEMORY_LIMIT, static_cast<UINT>(m_memoryLimit), FALSE);
 
     CButton unlimited(GetDlgItem(IDC_UNLIMITED));
     unlimited.SetCheck(static_cast<int>(m_unlimited));
@@ -69,6 +71,7 @@ void CHistoryDlg::OnCancel(UINT /*uNotifyCode*/, int nID, CWindow /*wndCtl*/)
 void CHistoryDlg::OnOk(UINT /*uNotifyCode*/, int nID, CWindow /*wndCtl*/)
 {
     m_historySize = GetDlgItemInt(IDC_HISTORY);
+    m_memoryLimit = GetDlgItemInt(IDC_MEMORY_LIMIT, nullptr, FALSE);
     //    m_unlimited = fusion::GetDlgItemText(*this, IDC_ARGUMENTS);
 
     EndDialog(nID);
@@ -79,5 +82,10 @@ int CHistoryDlg::GetHistorySize() const
     return m_historySize;
 }
 
+size_t CHistoryDlg::GetMemoryLimit() const
+{
+    return m_memoryLimit;
+}
+
 } // namespace debugviewpp
 } // namespace fusion
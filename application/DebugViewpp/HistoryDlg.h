@@ -22,8 +22,9 @@ public:
         IDD = IDD_HISTORY
     };
 
-    CHistoryDlg(size_t historySize, bool unlimited);
+    CHistoryDlg(size_t historySize, bool unlimited, size_t memoryLimit);
     int GetHistorySize() const;
+    size_t GetMemoryLimit() const; // MB, 0 is unlimited
 
 private:
     DECLARE_MSG_MAP()
@@ -38,6 +39,7 @@ private:
 
     int m_historySize;
     bool m_unlimited;
+    size_t m_memoryLimit;
 };
 
 } // namespace debugviewpp
@@ -12,8 +12,11 @@
 #include "Win32/Registry.h"
 #include "DebugViewppLib/Conversions.h"
 #include "DebugViewppLib/FileIO.h"
+#include "DebugViewppLib/LatencyTrace.h"
+#include "DebugViewppLib/Snapshot.h"
 #include "resource.h"
 #include "MainFrame.h"
+#include "GoToTimeDlg.h"
 #include "RenameProcessDlg.h"
 //#include "VersionHelpers.h"  // IsWindows10OrGreater ??
 
@@ -78,6 +81,22 @@ int GetTextOffset(HDC hdc, const std::wstring& s, int xPos)
     return SkipTabOffset(s, nFit);
 }
 
+// "  (repeated 4,312 times)"
+std::wstring FormatRepeats(int repeats)
+{
+    auto digits = std::to_wstring(repeats);
+    std::wstring text;
+    for (size_t i = 0; i < digits.size(); ++i)
+    {
+        if (i > 0 && (digits.size() - i) % 3 == 0)
+        {
+            text += L',';
+        }
+        text += digits[i];
+    }
+    return L"  (repeated " + text + (repeats == 1 ? L" time)" : L" times)");
+}
+
 void AddEllipsis(HDC hdc, std::wstring& text, int width)
 {
     static const std::wstring ellipsis(L"...");
@@ -115,12 +134,6 @@ Highlight::Highlight(int id, int begin, int end, const TextColor& color) :
 {
 }
 
-LogLine::LogLine(int line) :
-    bookmark(false),
-    line(line)
-{
-}
-
 ItemData::ItemData() :
     color(Colors::BackGround, Colors::Text)
 {
@@ -155,6 +168,14 @@ BEGIN_MSG_MAP2(CLogView)
     COMMAND_ID_HANDLER_EX(ID_VIEW_SCROLL_STOP, OnViewAutoScrollStop)
     COMMAND_ID_HANDLER_EX(ID_VIEW_TIME, OnViewTime)
     COMMAND_ID_HANDLER_EX(ID_VIEW_PROCESSCOLORS, OnViewProcessColors);
+    COMMAND_ID_HANDLER_EX(ID_VIEW_COLLAPSE_REPEATS, OnViewCollapseRepeats)
+    COMMAND_ID_HANDLER_EX(ID_VIEW_EXPAND_REPEATS, OnViewExpandRepeats)
+    COMMAND_ID_HANDLER_EX(ID_VIEW_TEMPLATE_ONLY, OnViewTemplateOnly)
+    COMMAND_ID_HANDLER_EX(ID_VIEW_TEMPLATE_HIDE, OnViewTemplateHide)
+    COMMAND_ID_HANDLER_EX(ID_VIEW_TEMPLATE_ALL, OnViewTemplateAll)
+    COMMAND_ID_HANDLER_EX(ID_VIEW_GOTO_TIME, OnViewGoToTime)
+    COMMAND_ID_HANDLER_EX(ID_VIEW_TIME_RANGE, OnViewTimeRange)
+    COMMAND_ID_HANDLER_EX(ID_VIEW_TIME_RANGE_ALL, OnViewTimeRangeAll)
     COMMAND_ID_HANDLER_EX(ID_VIEW_HIDE_HIGHLIGHT, OnEscapeKey)
     COMMAND_ID_HANDLER_EX(ID_VIEW_FIND_NEXT, OnViewFindNext)
     COMMAND_ID_HANDLER_EX(ID_VIEW_FIND_PREVIOUS, OnViewFindPrevious)
@@ -225,6 +246,7 @@ CLogView::CLogView(std::wstring name, CMainFrame& mainFrame, LogFile& logFile, L
     m_firstLine(0),
     m_clockTime(false),
     m_processColors(false),
+    m_collapseRepeats(false),
     m_autoScrollDown(true),
     m_autoScrollStop(true),
     m_dirty(false),
@@ -315,6 +337,8 @@ LRESULT CLogView::OnCreate(const CREATESTRUCT* /*pCreate*/)
     m_columns.push_back(MakeColumn(Column::Pid, L"PID", LVCFMT_RIGHT, 60));
     m_columns.push_back(MakeColumn(Column::Process, L"Process", LVCFMT_LEFT, 140));
     m_columns.push_back(MakeColumn(Column::Message, L"Message", LVCFMT_LEFT, 1500));
+    m_columns.push_back(MakeColumn(Column::Template, L"Template", LVCFMT_RIGHT, 60));
+    m_columns.back().enable = false;
     UpdateColumns();
 
     ApplyFilters();
@@ -324,6 +348,9 @@ LRESULT CLogView::OnCreate(const CREATESTRUCT* /*pCreate*/)
     m_pDropTargetSupport->SubscribeToDropped([this](const std::wstring& uri) {
         m_mainFrame.OnDropped(uri);
     });
+    m_pDropTargetSupport->SubscribeToDroppedFiles([this](const std::vector<std::wstring>& files) {
+        m_mainFrame.OnDroppedFiles(files);
+    });
     return 0;
 }
 
@@ -425,6 +452,9 @@ void CLogView::OnContextMenu(HWND /*hWnd*/, CPoint pt)
         case Column::Process:
             menuId = IDR_PROCESS_CONTEXTMENU;
             break;
+        case Column::Template:
+            menuId = IDR_TEMPLATE_CONTEXTMENU;
+            break;
         case Column::Message:
             menuId = TextHighlightHitTest(info.iItem, pt) == 1 ? IDR_HIGHLIGHT_CONTEXTMENU : IDR_VIEW_CONTEXTMENU;
             break;
@@ -894,13 +924,29 @@ ItemData CLogView::GetItemData(int iItem) const
     data.text[Column::Time] = GetItemWText(iItem, ColumnToSubItem(Column::Time));
     data.text[Column::Pid] = GetItemWText(iItem, ColumnToSubItem(Column::Pid));
     data.text[Column::Process] = GetItemWText(iItem, ColumnToSubItem(Column::Process));
-    auto text = TabsToSpaces(m_logFile[m_logLines[iItem].line].text);
-    data.highlights = GetHighlights(WStr(m_logFile[m_logLines[iItem].line].text).str());
-    data.text[Column::Message] = WStr(text).str();
-    data.color = GetTextColor(m_logFile[m_logLines[iItem].line]);
+    data.text[Column::Template] = GetColumnText(iItem, Column::Template);
+    auto msg = m_logFile[m_logLines[iItem].line];
+    data.highlights = GetHighlights(WStr(msg.text).str());
+    data.text[Column::Message] = WStr(TabsToSpaces(msg.text)).str();
+    if (m_logLines[iItem].repeats > 0)
+    {
+        data.text[Column::Message] += FormatRepeats(m_logLines[iItem].repeats);
+    }
+    data.color = GetTextColor(msg);
     return data;
 }
 
+std::wstring CLogView::GetMessageText(int iItem) const
+{
+    auto& logLine = m_logLines[iItem];
+    std::wstring text = WStr(m_logFile[logLine.line].text);
+    if (logLine.repeats > 0)
+    {
+        text += FormatRepeats(logLine.repeats);
+    }
+    return text;
+}
+
 Highlight CLogView::GetSelectionHighlight(CDCHandle dc, int iItem) const
 {
     auto rect = GetSubItemRect(iItem, ColumnToSubItem(Column::Message), LVIR_BOUNDS);
@@ -962,6 +1008,10 @@ void CLogView::DrawItem(CDCHandle dc, int iItem, unsigned /*iItemState*/) const
     {
         DrawSubItem(dc, iItem, i, data);
     }
+
+    auto& logLine = m_logLines[iItem];
+    RecordLatency(LatencyStage::Paint, logLine.ingestTicks);
+    logLine.ingestTicks = 0;
     //if (focused)
     //    dc.DrawFocusRect(&rect);
 }
@@ -969,6 +1019,12 @@ void CLogView::DrawItem(CDCHandle dc, int iItem, unsigned /*iItemState*/) const
 std::wstring CLogView::GetColumnText(int iItem, Column::type column) const
 {
     int line = m_logLines[iItem].line;
+    if (column == Column::Template)
+    {
+        auto id = m_logFile.GetTemplateId(line);
+        return id == 0 ? L"" : std::to_wstring(id);
+    }
+
     const Message& msg = m_logFile[line];
 
     switch (column)
@@ -978,7 +1034,7 @@ std::wstring CLogView::GetColumnText(int iItem, Column::type column) const
     case Column::Time: return WStr(m_clockTime ? GetTimeText(msg.systemTime) : GetTimeText(msg.time));
     case Column::Pid: return std::to_wstring(msg.processId + 0ULL);
     case Column::Process: return WStr(msg.processName);
-    case Column::Message: return WStr(msg.text);
+    case Column::Message: return GetMessageText(iItem);
     default: break;
     }
     return L"";
@@ -1014,7 +1070,7 @@ SelectionInfo CLogView::GetSelectedRange() const
         item = GetNextItem(item, LVNI_SELECTED);
     } while (item > 0);
 
-    return SelectionInfo(m_logLines[first].line, m_logLines[last].line, last - first + 1);
+    return SelectionInfo(m_logLines[first].line, m_logLines[last].lastLine, last - first + 1);
 }
 
 SelectionInfo CLogView::GetViewRange() const
@@ -1024,7 +1080,7 @@ SelectionInfo CLogView::GetViewRange() const
         return SelectionInfo();
     }
 
-    return SelectionInfo(m_logLines.front().line, m_logLines.back().line, static_cast<int>(m_logLines.size()));
+    return SelectionInfo(m_logLines.front().line, m_logLines.back().lastLine, static_cast<int>(m_logLines.size()));
 }
 
 bool Contains(const std::string& text, const std::string& substring)
@@ -1160,6 +1216,96 @@ void CLogView::OnViewProcessColors(UINT /*uNotifyCode*/, int /*nID*/, CWindow /*
     SetViewProcessColors(!GetViewProcessColors());
 }
 
+void CLogView::OnViewCollapseRepeats(UINT /*uNotifyCode*/, int /*nID*/, CWindow /*wndCtl*/)
+{
+    SetCollapseRepeats(!GetCollapseRepeats());
+}
+
+void CLogView::OnViewExpandRepeats(UINT /*uNotifyCode*/, int /*nID*/, CWindow /*wndCtl*/)
+{
+    // from the last selected item back, so expanding does not move the items still to expand
+    std::vector<int> items;
+    for (int item = GetNextItem(-1, LVNI_SELECTED); item >= 0; item = GetNextItem(item, LVNI_SELECTED))
+    {
+        items.push_back(item);
+    }
+    for (auto it = items.rbegin(); it != items.rend(); ++it)
+    {
+        ExpandRepeats(*it);
+    }
+    SetItemCountEx(static_cast<int>(m_logLines.size()), LVSICF_NOSCROLL);
+    Invalidate();
+}
+
+void CLogView::OnViewTemplateOnly(UINT /*uNotifyCode*/, int /*nID*/, CWindow /*wndCtl*/)
+{
+    int item = GetNextItem(-1, LVNI_ALL | LVNI_SELECTED);
+    if (item < 0)
+    {
+        return;
+    }
+    m_onlyTemplate = m_logFile.GetTemplateId(m_logLines[item].line);
+    m_hiddenTemplates.clear();
+    ApplyFilters();
+}
+
+void CLogView::OnViewTemplateHide(UINT /*uNotifyCode*/, int /*nID*/, CWindow /*wndCtl*/)
+{
+    int item = -1;
+    while ((item = GetNextItem(item, LVNI_ALL | LVNI_SELECTED)) >= 0)
+    {
+        m_hiddenTemplates.insert(m_logFile.GetTemplateId(m_logLines[item].line));
+    }
+    ApplyFilters();
+}
+
+void CLogView::OnViewTemplateAll(UINT /*uNotifyCode*/, int /*nID*/, CWindow /*wndCtl*/)
+{
+    m_onlyTemplate = 0;
+    m_hiddenTemplates.clear();
+    ApplyFilters();
+}
+
+void CLogView::OnViewGoToTime(UINT /*uNotifyCode*/, int /*nID*/, CWindow /*wndCtl*/)
+{
+    if (m_logLines.empty())
+    {
+        return;
+    }
+
+    // the time of day entered is taken on the date of the focused line
+    int item = std::max(GetNextItem(-1, LVNI_FOCUSED), 0);
+    auto systemTime = m_logFile[m_logLines[item].line].systemTime;
+    if (systemTime == FILETIME())
+    {
+        return;
+    }
+
+    CGoToTimeDlg dlg(Win32::FileTimeToSystemTime(Win32::FileTimeToLocalFileTime(systemTime)));
+    if (dlg.DoModal() == IDOK)
+    {
+        GoToTime(Win32::LocalFileTimeToFileTime(Win32::SystemTimeToFileTime(dlg.GetTime())));
+    }
+}
+
+void CLogView::OnViewTimeRange(UINT /*uNotifyCode*/, int /*nID*/, CWindow /*wndCtl*/)
+{
+    int item = GetNextItem(-1, LVNI_FOCUSED);
+    if (item < 0)
+    {
+        return;
+    }
+
+    const uint64_t halfRange = 5 * 10000000ULL; // FILETIME ticks are 100 ns
+    auto time = FileTimeToUInt64(m_logFile[m_logLines[item].line].systemTime);
+    SetTimeRange(MakeFileTime(time > halfRange ? time - halfRange : 0), MakeFileTime(time + halfRange));
+}
+
+void CLogView::OnViewTimeRangeAll(UINT /*uNotifyCode*/, int /*nID*/, CWindow /*wndCtl*/)
+{
+    ClearTimeRange();
+}
+
 void CLogView::OnEscapeKey(UINT /*uNotifyCode*/, int /*nID*/, CWindow /*wndCtl*/)
 {
     SetHighlightText(L"");
@@ -1324,6 +1470,7 @@ void CLogView::ToggleBookmark(int iItem)
     m_logLines[iItem].bookmark = !m_logLines[iItem].bookmark;
     auto rect = GetSubItemRect(iItem, 0, LVIR_BOUNDS);
     InvalidateRect(&rect);
+    m_mainFrame.AddChange();
 }
 
 void CLogView::OnViewBookmark(UINT /*uNotifyCode*/, int /*nID*/, CWindow /*wndCtl*/)
@@ -1363,6 +1510,7 @@ void CLogView::OnViewClearBookmarks(UINT /*uNotifyCode*/, int /*nID*/, CWindow /
         line.bookmark = false;
     }
     Invalidate();
+    m_mainFrame.AddChange();
 }
 
 #ifndef _WIN64
@@ -1404,6 +1552,7 @@ std::wstring CLogView::GetName() const
 void CLogView::SetName(const std::wstring& name)
 {
     m_name = name;
+    m_mainFrame.AddChange();
 }
 
 void CLogView::SetFont(HFONT hFont)
@@ -1464,7 +1613,15 @@ void CLogView::Clear()
         m_autoScrollDown = true;
     }
 
+    // template ids start over when the log is cleared
+    if (m_logFile.Empty())
+    {
+        m_onlyTemplate = 0;
+        m_hiddenTemplates.clear();
+    }
+
     ResetFilters();
+    m_mainFrame.AddChange();
 }
 
 int CLogView::GetFocusLine() const
@@ -1484,19 +1641,62 @@ void CLogView::SetFocusLine(int line)
     ScrollToIndex(static_cast<int>(it - m_logLines.begin() - 1), false);
 }
 
-void CLogView::Add(int beginIndex, int line, const Message& msg)
+// focuses the first viewed line at or after 'time', or the last line if all lines are earlier
+void CLogView::GoToTime(const FILETIME& time)
 {
-    if (IsClearMessage(msg))
+    if (m_logLines.empty())
+    {
+        return;
+    }
+
+    StopTracking();
+    int line = m_logFile.LowerBoundTime(time);
+    auto it = std::lower_bound(m_logLines.begin(), m_logLines.end(), line, [](const LogLine& logLine, int line) { return logLine.lastLine < line; });
+    int item = std::min(static_cast<int>(it - m_logLines.begin()), static_cast<int>(m_logLines.size()) - 1);
+    ScrollToIndex(item, true);
+}
+
+void CLogView::SetTimeRange(const FILETIME& begin, const FILETIME& end)
+{
+    m_timeRange = true;
+    m_timeBegin = begin;
+    m_timeEnd = end;
+    ApplyFilters();
+}
+
+void CLogView::ClearTimeRange()
+{
+    m_timeRange = false;
+    ApplyFilters();
+}
+
+// the filters are evaluated once for all views, a view only registers them and interprets the result of each line
+void CLogView::RegisterFilters(FilterEvaluator& evaluator)
+{
+    m_messageSlots = evaluator.Register(m_filter.messageFilters, FilterSubject::Text);
+    m_processSlots = evaluator.Register(m_filter.processFilters, FilterSubject::ProcessName);
+}
+
+void CLogView::Add(int beginIndex, int line, const Message& msg, const FilterResult& result)
+{
+    if (IsClearMessage(result))
     {
         Clear();
     }
 
-    if (!IsIncluded(msg))
+    if (!IsTemplateIncluded(line) || !IsTimeIncluded(msg))
     {
         return;
     }
 
-    if (IsBeepMessage(msg))
+    bool included = IsIncluded(result);
+    RecordLatency(LatencyStage::Filter, msg.ingestTicks);
+    if (!included)
+    {
+        return;
+    }
+
+    if (IsBeepMessage(result))
     {
         MessageBeep(0xFFFFFFFF); // A simple beep. If the sound card is not available, the sound is generated using the speaker.
     }
@@ -1510,13 +1710,19 @@ void CLogView::Add(int beginIndex, int line, const Message& msg)
     }
     m_logLines.erase(m_logLines.begin(), it);
 
+    if (!m_logLines.empty() && CollapseRepeat(m_logLines.back(), line))
+    {
+        return;
+    }
+
     int viewline = static_cast<int>(m_logLines.size());
 
     LogLine logline(line);
-    logline.bookmark = MatchFilterType(FilterType::Bookmark, msg);
+    logline.bookmark = MatchFilterType(FilterType::Bookmark, result);
+    logline.ingestTicks = msg.ingestTicks;
     m_logLines.push_back(logline);
 
-    if (m_autoScrollDown && MatchFilterType(FilterType::Stop, msg))
+    if (m_autoScrollDown && MatchFilterType(FilterType::Stop, result))
     {
         m_stop = [this, viewline]() {
             StopScrolling();
@@ -1525,7 +1731,7 @@ void CLogView::Add(int beginIndex, int line, const Message& msg)
         return;
     }
 
-    if (MatchFilterType(FilterType::Track, msg))
+    if (MatchFilterType(FilterType::Track, result))
     {
         m_autoScrollDown = false;
         m_track = [this, viewline]() {
@@ -1655,12 +1861,14 @@ void CLogView::SetClockTime(bool clockTime)
 {
     m_clockTime = clockTime;
     Invalidate(0);
+    m_mainFrame.AddChange();
 }
 
 void CLogView::SetViewProcessColors(bool value)
 {
     m_processColors = value;
     Invalidate(0);
+    m_mainFrame.AddChange();
 }
 
 bool CLogView::GetViewProcessColors() const
@@ -1668,6 +1876,85 @@ bool CLogView::GetViewProcessColors() const
     return m_processColors;
 }
 
+void CLogView::SetCollapseRepeats(bool value)
+{
+    if (value == m_collapseRepeats)
+    {
+        return;
+    }
+    m_collapseRepeats = value;
+    ApplyFilters();
+}
+
+bool CLogView::GetCollapseRepeats() const
+{
+    return m_collapseRepeats;
+}
+
+// a run of identical lines of one process is shown as its first line with the number of repeats,
+// so painting a flood costs one row instead of one row per line
+bool CLogView::CollapseRepeat(LogLine& logLine, int line) const
+{
+    if (!m_collapseRepeats || logLine.expanded || logLine.bookmark || !m_logFile.IsRepeat(logLine.line, line))
+    {
+        return false;
+    }
+    logLine.lastLine = line;
+    ++logLine.repeats;
+    return true;
+}
+
+bool CLogView::IsIncluded(int line)
+{
+    auto msg = m_logFile[line];
+    return IsTimeIncluded(msg) && IsIncluded(msg);
+}
+
+bool CLogView::IsTimeIncluded(const Message& msg) const
+{
+    return !m_timeRange || (m_timeBegin <= msg.systemTime && msg.systemTime <= m_timeEnd);
+}
+
+// selects on the integer template id of a line, that costs no decompression or text matching
+bool CLogView::IsTemplateIncluded(int line) const
+{
+    if (m_onlyTemplate == 0 && m_hiddenTemplates.empty())
+    {
+        return true;
+    }
+    auto id = m_logFile.GetTemplateId(line);
+    if (m_onlyTemplate != 0 && id != m_onlyTemplate)
+    {
+        return false;
+    }
+    return m_hiddenTemplates.count(id) == 0;
+}
+
+void CLogView::ExpandRepeats(int iItem)
+{
+    auto& logLine = m_logLines[iItem];
+    if (logLine.repeats == 0)
+    {
+        return;
+    }
+
+    // the lines in between that are not in the view differ from the run, so they were never part of it
+    std::deque<LogLine> lines;
+    for (int line = logLine.line + 1; line <= logLine.lastLine; ++line)
+    {
+        if (m_logFile.IsRepeat(logLine.line, line))
+        {
+            lines.emplace_back(line);
+            lines.back().expanded = true;
+        }
+    }
+    logLine.expanded = true;
+    logLine.lastLine = logLine.line;
+    logLine.repeats = 0;
+    m_logLines.insert(m_logLines.begin() + iItem + 1, lines.begin(), lines.end());
+    m_mainFrame.AddChange();
+}
+
 void CLogView::SelectAll()
 {
     int lines = GetItemCount();
@@ -1904,6 +2191,7 @@ void CLogView::LoadSettings(CRegKey& reg)
     SetAutoScrollStop(Win32::RegGetDWORDValue(reg, L"AutoScrollStop", 1) != 0);
     SetClockTime(Win32::RegGetDWORDValue(reg, L"ClockTime", 1) != 0);
     SetViewProcessColors(Win32::RegGetDWORDValue(reg, L"ShowProcessColors", 0) != 0);
+    m_collapseRepeats = Win32::RegGetDWORDValue(reg, L"CollapseRepeats", 0) != 0;
 
     std::vector<ColumnInfo> columns;
     for (int i = 0; i < Column::Count; ++i)
@@ -1920,8 +2208,10 @@ void CLogView::LoadSettings(CRegKey& reg)
         column.column.iOrder = Win32::RegGetDWORDValue(regColumn, L"Order", column.column.iOrder);
         columns.push_back(column);
     }
-    if (columns.size() == m_columns.size())
+    // settings saved before the Template column existed keep their layout, the new column gets its default
+    if (columns.size() >= Column::Template)
     {
+        columns.insert(columns.end(), m_columns.begin() + columns.size(), m_columns.end());
         m_columns.swap(columns);
     }
 
@@ -1944,6 +2234,7 @@ void CLogView::SaveSettings(CRegKey& reg)
     reg.SetDWORDValue(L"AutoScrollStop", static_cast<DWORD>(GetAutoScrollStop()));
     reg.SetDWORDValue(L"ClockTime", static_cast<DWORD>(GetClockTime()));
     reg.SetDWORDValue(L"ShowProcessColors", static_cast<DWORD>(GetViewProcessColors()));
+    reg.SetDWORDValue(L"CollapseRepeats", static_cast<DWORD>(GetCollapseRepeats()));
 
     int i = 0;
     for (auto& col : m_columns)
@@ -1967,6 +2258,170 @@ void CLogView::SaveSettings(CRegKey& reg)
     }
 }
 
+void WriteFilters(SnapshotWriter& writer, const std::vector<Filter>& filters)
+{
+    writer.WriteNumber(filters.size());
+    for (auto& filter : filters)
+    {
+        writer.WriteString(filter.text);
+        writer.WriteNumber(filter.matchType);
+        writer.WriteNumber(filter.filterType);
+        writer.WriteNumber(filter.bgColor);
+        writer.WriteNumber(filter.fgColor);
+        writer.WriteNumber(static_cast<uint64_t>(filter.enable));
+        writer.WriteNumber(static_cast<uint64_t>(filter.matched));
+    }
+}
+
+std::vector<Filter> ReadFilters(SnapshotReader& reader)
+{
+    std::vector<Filter> filters;
+    auto count = reader.ReadCount();
+    for (size_t i = 0; i < count; ++i)
+    {
+        auto text = reader.ReadString();
+        auto matchType = static_cast<MatchType::type>(reader.ReadNumber());
+        auto filterType = static_cast<FilterType::type>(reader.ReadNumber());
+        auto bgColor = static_cast<COLORREF>(reader.ReadNumber());
+        auto fgColor = static_cast<COLORREF>(reader.ReadNumber());
+        auto enable = reader.ReadNumber() != 0;
+        auto matched = reader.ReadNumber() != 0;
+        filters.emplace_back(text, matchType, filterType, bgColor, fgColor, enable, matched);
+    }
+    return filters;
+}
+
+// the viewed lines are saved with the state of the filters that selected them, so they are restored without
+// running the filters again; the filters of type Once and the match colors continue where they were
+void CLogView::SaveSnapshot(SnapshotWriter& writer) const
+{
+    writer.WriteString(Str(m_name).str());
+    WriteFilters(writer, m_filter.messageFilters);
+    WriteFilters(writer, m_filter.processFilters);
+    writer.WriteNumber(m_matchColors.size());
+    for (auto& matchColor : m_matchColors)
+    {
+        writer.WriteString(matchColor.first);
+        writer.WriteNumber(matchColor.second);
+    }
+
+    writer.WriteNumber(m_firstLine);
+    SaveLogLines(writer, m_logLines, GetFocusLine());
+    writer.WriteNumber(static_cast<uint64_t>(m_clockTime));
+    writer.WriteNumber(static_cast<uint64_t>(m_processColors));
+    writer.WriteNumber(static_cast<uint64_t>(m_collapseRepeats));
+    writer.WriteNumber(m_onlyTemplate);
+    writer.WriteArray(std::vector<TemplateId>(m_hiddenTemplates.begin(), m_hiddenTemplates.end()));
+    writer.WriteNumber(static_cast<uint64_t>(m_timeRange));
+    writer.WriteNumber(FileTimeToUInt64(m_timeBegin));
+    writer.WriteNumber(FileTimeToUInt64(m_timeEnd));
+}
+
+void CLogView::LoadSnapshot(SnapshotReader& reader)
+{
+    StopTracking();
+    ClearSelection();
+
+    SetName(WStr(reader.ReadString()));
+    m_filter.messageFilters = ReadFilters(reader);
+    m_filter.processFilters = ReadFilters(reader);
+    m_matchColors.clear();
+    auto matchColors = reader.ReadCount();
+    for (size_t i = 0; i < matchColors; ++i)
+    {
+        auto key = reader.ReadString();
+        m_matchColors[key] = static_cast<COLORREF>(reader.ReadNumber());
+    }
+
+    auto firstLine = reader.ReadNumber();
+    bool valid = firstLine <= static_cast<uint64_t>(m_logFile.Count());
+    m_firstLine = static_cast<int>(firstLine);
+    int focusLine = -1;
+    m_logLines.clear();
+    try
+    {
+        m_logLines = LoadLogLines(reader, m_logFile.Count(), focusLine);
+    }
+    catch (std::exception&)
+    {
+        SetItemCountEx(0, 0);
+        throw;
+    }
+    m_clockTime = reader.ReadNumber() != 0;
+    m_processColors = reader.ReadNumber() != 0;
+    m_collapseRepeats = reader.ReadNumber() != 0;
+    m_onlyTemplate = static_cast<TemplateId>(reader.ReadNumber());
+    std::vector<TemplateId> hiddenTemplates;
+    reader.ReadArray(hiddenTemplates);
+    m_hiddenTemplates = std::unordered_set<TemplateId>(hiddenTemplates.begin(), hiddenTemplates.end());
+    auto templateCount = m_logFile.GetTemplates().GetTemplateCount();
+    valid = valid && m_onlyTemplate <= templateCount &&
+        std::all_of(hiddenTemplates.begin(), hiddenTemplates.end(), [=](TemplateId id) { return id <= templateCount; });
+    m_timeRange = reader.ReadNumber() != 0;
+    m_timeBegin = MakeFileTime(reader.ReadNumber());
+    m_timeEnd = MakeFileTime(reader.ReadNumber());
+    if (!valid)
+    {
+        m_logLines.clear();
+        SetItemCountEx(0, 0);
+        throw std::runtime_error("snapshot is damaged");
+    }
+
+    m_dirty = false;
+    SetItemCountEx(static_cast<int>(m_logLines.size()), LVSICF_NOSCROLL);
+    if (focusLine >= 0)
+    {
+        SetFocusLine(focusLine);
+    }
+    else if (m_autoScrollDown)
+    {
+        ScrollDown();
+    }
+    Invalidate();
+}
+
+size_t CLogView::GetMemorySize() const
+{
+    size_t size = m_logLines.size() * sizeof(LogLine);
+    for (auto& matchColor : m_matchColors)
+    {
+        size += sizeof(matchColor) + matchColor.first.size() + 2 * sizeof(void*);
+    }
+    return size;
+}
+
+void CLogView::ShrinkCaches()
+{
+    m_logLines.shrink_to_fit();
+}
+
+// the log dropped its first 'count' lines, the lines that remain keep their filter results and bookmarks
+void CLogView::Evict(int count)
+{
+    int focusLine = GetFocusLine();
+    ClearSelection();
+
+    auto it = std::lower_bound(m_logLines.begin(), m_logLines.end(), count, [](const LogLine& logLine, int line) { return logLine.line < line; });
+    m_logLines.erase(m_logLines.begin(), it);
+    for (auto& logLine : m_logLines)
+    {
+        logLine.line -= count;
+        logLine.lastLine -= count;
+    }
+    m_firstLine = std::max(0, m_firstLine - count);
+
+    SetItemCountEx(static_cast<int>(m_logLines.size()), LVSICF_NOSCROLL);
+    if (focusLine >= count)
+    {
+        SetFocusLine(focusLine - count);
+    }
+    else if (m_autoScrollDown)
+    {
+        ScrollDown();
+    }
+    Invalidate();
+}
+
 void CLogView::SaveSelection(const std::wstring& fileName) const
 {
     if (!m_highlightText.empty())
@@ -2061,6 +2516,7 @@ void CLogView::ApplyFilters()
 {
     ResetFilters();
     ClearSelection();
+    m_mainFrame.AddChange();
 
     int focusItem = GetNextItem(-1, LVIS_FOCUSED);
     SetItemState(focusItem, 0, LVIS_FOCUSED);
@@ -2073,25 +2529,40 @@ void CLogView::ApplyFilters()
     //    logLines.reserve(m_logLines.size());
     int count = m_logFile.Count();
     int line = m_firstLine;
+    if (m_timeRange)
+    {
+        // the time index bounds the lines to visit, lines that arrived out of order still need the check
+        line = std::max(line, m_logFile.LowerBoundTime(m_timeBegin));
+        count = m_logFile.UpperBoundTime(m_timeEnd);
+    }
+    itBookmark = std::lower_bound(bookmarks.begin(), bookmarks.end(), line);
     int item = 0;
     focusItem = -1;
     while (line < count)
     {
-        if (IsIncluded(m_logFile[line]))
+        if (IsTemplateIncluded(line) && IsIncluded(line))
         {
-            logLines.emplace_back(LogLine(line));
-            if (itBookmark != bookmarks.end() && *itBookmark == line)
+            // bookmarks of lines that are filtered out now are passed over
+            while (itBookmark != bookmarks.end() && *itBookmark < line)
+            {
+                ++itBookmark;
+            }
+            bool bookmark = itBookmark != bookmarks.end() && *itBookmark == line;
+            if (bookmark || logLines.empty() || !CollapseRepeat(logLines.back(), line))
+            {
+                logLines.emplace_back(LogLine(line));
+                logLines.back().bookmark = bookmark;
+                ++item;
+            }
+            if (bookmark)
             {
-                logLines.back().bookmark = true;
                 ++itBookmark;
             }
 
             if (line <= focusLine)
             {
-                focusItem = item;
+                focusItem = item - 1;
             }
-
-            ++item;
         }
         ++line;
     }
@@ -2158,16 +2629,21 @@ TextColor CLogView::GetTextColor(const Message& msg) const
     return TextColor(m_processColors ? msg.color : Colors::BackGround, Colors::Text);
 }
 
-bool CLogView::IsClearMessage(const Message& msg) const
+bool CLogView::IsClearMessage(const FilterResult& result) const
 {
     using debugviewpp::MatchFilterType;
-    return MatchFilterType(m_filter.messageFilters, FilterType::Clear, msg.text);
+    return MatchFilterType(m_filter.messageFilters, m_messageSlots, FilterType::Clear, result);
 }
 
-bool CLogView::IsBeepMessage(const Message& msg) const
+bool CLogView::IsBeepMessage(const FilterResult& result) const
 {
-    using debugviewpp::MatchFilterType;
-    return MatchFilterType(m_filter.messageFilters, FilterType::Beep, msg.text) || MatchFilterType(m_filter.processFilters, FilterType::Beep, msg.text);
+    return MatchFilterType(FilterType::Beep, result);
+}
+
+bool CLogView::IsIncluded(const FilterResult& result)
+{
+    using debugviewpp::IsIncluded;
+    return IsIncluded(m_filter.processFilters, m_processSlots, result, m_matchColors) && IsIncluded(m_filter.messageFilters, m_messageSlots, result, m_matchColors);
 }
 
 bool CLogView::IsIncluded(const Message& msg)
@@ -2176,11 +2652,11 @@ bool CLogView::IsIncluded(const Message& msg)
     return IsIncluded(m_filter.processFilters, msg.processName, m_matchColors) && IsIncluded(m_filter.messageFilters, msg.text, m_matchColors);
 }
 
-bool CLogView::MatchFilterType(FilterType::type type, const Message& msg) const
+bool CLogView::MatchFilterType(FilterType::type type, const FilterResult& result) const
 {
     using debugviewpp::MatchFilterType;
-    return MatchFilterType(m_filter.messageFilters, type, msg.text) ||
-           MatchFilterType(m_filter.processFilters, type, msg.processName);
+    return MatchFilterType(m_filter.messageFilters, m_messageSlots, type, result) ||
+           MatchFilterType(m_filter.processFilters, m_processSlots, type, result);
 }
 
 } // namespace debugviewpp
@@ -10,7 +10,9 @@
 #include "Win32/Win32Lib.h"
 #include "CobaltFusion/AtlWinExt.h"
 #include "CobaltFusion/stringbuilder.h"
+#include "DebugViewppLib/FilterEvaluator.h"
 #include "DebugViewppLib/LogFile.h"
+#include "DebugViewppLib/LogLine.h"
 #include "FilterDlg.h"
 #include "DropTargetSupport.h"
 #include "Win32/Com.h"
@@ -19,6 +21,7 @@
 
 #include <vector>
 #include <deque>
+#include <unordered_set>
 
 namespace fusion {
 namespace debugviewpp {
@@ -53,14 +56,6 @@ struct Highlight
     TextColor color;
 };
 
-struct LogLine
-{
-    explicit LogLine(int line);
-
-    bool bookmark;
-    int line;
-};
-
 struct Column
 {
     enum type
@@ -72,6 +67,7 @@ struct Column
         Pid,
         Process,
         Message,
+        Template,
         Count
     };
 };
@@ -167,7 +163,11 @@ public:
     void Clear();
     int GetFocusLine() const;
     void SetFocusLine(int line);
-    void Add(int beginIndex, int line, const Message& msg);
+    void GoToTime(const FILETIME& time);
+    void SetTimeRange(const FILETIME& begin, const FILETIME& end);
+    void ClearTimeRange();
+    void RegisterFilters(FilterEvaluator& evaluator);
+    void Add(int beginIndex, int line, const Message& msg, const FilterResult& result);
     void BeginUpdate();
     bool EndUpdate();
     void ClearSelection();
@@ -181,6 +181,8 @@ public:
     void SetClockTime(bool clockTime);
     void SetViewProcessColors(bool value);
     bool GetViewProcessColors() const;
+    void SetCollapseRepeats(bool value);
+    bool GetCollapseRepeats() const;
     bool GetBookmark() const;
     void SelectAll();
     void Copy();
@@ -199,6 +201,13 @@ public:
 
     void LoadSettings(CRegKey& reg);
     void SaveSettings(CRegKey& reg);
+    void SaveSnapshot(SnapshotWriter& writer) const;
+    void LoadSnapshot(SnapshotReader& reader);
+
+    // memory pressure, see MemoryGovernor
+    size_t GetMemorySize() const;
+    void ShrinkCaches();
+    void Evict(int count);
     void Save(const std::wstring& fileName) const;
     void SaveSelection(const std::wstring& fileName) const;
 
@@ -243,6 +252,14 @@ private:
     void OnViewAutoScrollStop(UINT uNotifyCode, int nID, CWindow wndCtl);
     void OnViewTime(UINT uNotifyCode, int nID, CWindow wndCtl);
     void OnViewProcessColors(UINT uNotifyCode, int nID, CWindow wndCtl);
+    void OnViewCollapseRepeats(UINT uNotifyCode, int nID, CWindow wndCtl);
+    void OnViewExpandRepeats(UINT uNotifyCode, int nID, CWindow wndCtl);
+    void OnViewTemplateOnly(UINT uNotifyCode, int nID, CWindow wndCtl);
+    void OnViewTemplateHide(UINT uNotifyCode, int nID, CWindow wndCtl);
+    void OnViewTemplateAll(UINT uNotifyCode, int nID, CWindow wndCtl);
+    void OnViewGoToTime(UINT uNotifyCode, int nID, CWindow wndCtl);
+    void OnViewTimeRange(UINT uNotifyCode, int nID, CWindow wndCtl);
+    void OnViewTimeRangeAll(UINT uNotifyCode, int nID, CWindow wndCtl);
     void OnEscapeKey(UINT uNotifyCode, int nID, CWindow wndCtl);
     void OnViewFindNext(UINT uNotifyCode, int nID, CWindow wndCtl);
     void OnViewFindPrevious(UINT uNotifyCode, int nID, CWindow wndCtl);
@@ -286,6 +303,7 @@ private:
     std::vector<Highlight> GetHighlights(std::wstring_view text) const;
     void DrawBookmark(CDCHandle dc, int iItem) const;
     void DrawSubItem(CDCHandle dc, int iItem, int iSubItem, const ItemData& data) const;
+    std::wstring GetMessageText(int iItem) const;
 
     ItemData GetItemData(int iItem) const;
 
@@ -298,11 +316,17 @@ private:
 
     bool Find(std::wstring_view text, int direction);
     bool FindProcess(int direction);
+    bool CollapseRepeat(LogLine& logLine, int line) const;
+    bool IsTemplateIncluded(int line) const;
+    bool IsTimeIncluded(const Message& msg) const;
+    void ExpandRepeats(int iItem);
     void ApplyFilters();
-    bool IsClearMessage(const Message& msg) const;
-    bool IsBeepMessage(const Message& msg) const;
+    bool IsClearMessage(const FilterResult& result) const;
+    bool IsBeepMessage(const FilterResult& result) const;
+    bool IsIncluded(const FilterResult& result);
     bool IsIncluded(const Message& msg);
-    bool MatchFilterType(FilterType::type type, const Message& msg) const;
+    bool IsIncluded(int line);
+    bool MatchFilterType(FilterType::type type, const FilterResult& result) const;
     TextColor GetTextColor(const Message& msg) const;
     void ResetFilters();
 
@@ -310,6 +334,8 @@ private:
     CMainFrame& m_mainFrame;
     LogFile& m_logFile;
     LogFilter m_filter;
+    FilterSlots m_messageSlots; // of m_filter in the FilterEvaluator of the main frame, see RegisterFilters()
+    FilterSlots m_processSlots;
     MatchColors m_matchColors;
     CMyHeaderCtrl m_hdr;
     std::vector<ColumnInfo> m_columns;
@@ -317,6 +343,12 @@ private:
     std::deque<LogLine> m_logLines;
     bool m_clockTime;
     bool m_processColors;
+    bool m_collapseRepeats;
+    TemplateId m_onlyTemplate = 0;                  // show only the lines of this template, 0 shows all
+    std::unordered_set<TemplateId> m_hiddenTemplates; // but not the lines of these
+    bool m_timeRange = false;                       // show only the lines with a system time from m_timeBegin ...
+    FILETIME m_timeBegin = {};
+    FILETIME m_timeEnd = {};                        // ... up to and including m_timeEnd
     bool m_autoScrollDown;
     bool m_autoScrollStop;
     bool m_dirty;
@@ -26,16 +26,19 @@
 #include "Win32/Registry.h"
 #include "DebugViewppLib/ProcessReader.h"
 #include "DebugViewppLib/DbgviewReader.h"
-#include "DebugViewppLib/SocketReader.h"
+#include "DebugViewppLib/UdpReader.h"
 #include "DebugViewppLib/FileReader.h"
 #include "DebugViewppLib/FileIO.h"
 #include "DebugViewppLib/LogFilter.h"
+#include "DebugViewppLib/Snapshot.h"
 
 #include "resource.h"
 #include "RunDlg.h"
 #include "HistoryDlg.h"
+#include "RateLimitDlg.h"
 #include "FilterDlg.h"
 #include "SourcesDlg.h"
+#include "StatsDlg.h"
 #include "AboutDlg.h"
 #include "FileOptionDlg.h"
 #include "LogView.h"
@@ -57,6 +60,29 @@ std::wstring GetPersonalPath()
     return path;
 }
 
+// the auto snapshot of the first instance, see CMainFrame::StartRecovery()
+std::wstring GetRecoveryFileName()
+{
+    wchar_t szPath[MAX_PATH];
+    if (FAILED(SHGetFolderPath(nullptr, CSIDL_LOCAL_APPDATA, nullptr, 0, szPath)))
+    {
+        return L"";
+    }
+
+    std::filesystem::path path(szPath);
+    path /= L"DebugView++";
+    std::error_code ec;
+    std::filesystem::create_directories(path, ec);
+    return (path / L"Recovery.dvsnap").wstring();
+}
+
+// the blocks the memory governor moves out of memory, one file per instance
+std::wstring GetSpillFileName()
+{
+    std::wstring spillName = wstringbuilder() << L"DebugView++-" << GetCurrentProcessId() << L".spill";
+    return (std::filesystem::temp_directory_path() / spillName).wstring();
+}
+
 std::wstring FormatUnits(int n, const std::wstring& unit)
 {
     if (n == 0)
@@ -127,6 +153,8 @@ BEGIN_MSG_MAP2(CMainFrame)
     COMMAND_ID_HANDLER_EX(ID_FILE_SAVE_VIEW_SELECTION, OnFileSaveViewSelection)
     COMMAND_ID_HANDLER_EX(ID_FILE_LOAD_CONFIGURATION, OnFileLoadConfiguration)
     COMMAND_ID_HANDLER_EX(ID_FILE_SAVE_CONFIGURATION, OnFileSaveConfiguration)
+    COMMAND_ID_HANDLER_EX(ID_FILE_OPEN_SNAPSHOT, OnFileOpenSnapshot)
+    COMMAND_ID_HANDLER_EX(ID_FILE_SAVE_SNAPSHOT, OnFileSaveSnapshot)
     COMMAND_ID_HANDLER_EX(ID_LOG_CLEAR, OnLogClear)
     COMMAND_ID_HANDLER_EX(ID_LOG_CROP, OnLogCrop)
     COMMAND_ID_HANDLER_EX(ID_LOG_PAUSE, OnLogPause)
@@ -134,7 +162,10 @@ BEGIN_MSG_MAP2(CMainFrame)
     COMMAND_ID_HANDLER_EX(ID_LOG_KERNEL, OnLogKernel)
     COMMAND_ID_HANDLER_EX(ID_LOG_KERNEL_VERBOSE, OnLogKernelVerbose)
     COMMAND_ID_HANDLER_EX(ID_LOG_KERNEL_PASSTHROUGH, OnLogKernelPassThrough)
+    COMMAND_ID_HANDLER_EX(ID_LOG_RING, OnLogRing)
     COMMAND_ID_HANDLER_EX(ID_LOG_HISTORY, OnLogHistory)
+    COMMAND_ID_HANDLER_EX(ID_LOG_RATELIMIT, OnLogRateLimit)
+    COMMAND_ID_HANDLER_EX(ID_LOG_STATISTICS, OnLogStatistics)
     COMMAND_ID_HANDLER_EX(ID_LOG_DEBUGVIEW_AGENT, OnLogDebugviewAgent)
     COMMAND_ID_HANDLER_EX(ID_VIEW_FIND, OnViewFind)
     COMMAND_ID_HANDLER_EX(ID_VIEW_FILTER, OnViewFilter)
@@ -189,7 +220,8 @@ CMainFrame::CMainFrame() :
     m_initialPrivateBytes(ProcessInfo::GetPrivateBytes()),
     m_logfont(GetDefaultLogFont()),
     m_GuiExecutorClient(std::make_unique<GuiExecutorClient>()),
-    m_logSources(*m_GuiExecutorClient)
+    m_logSources(*m_GuiExecutorClient),
+    m_metricsHistory(600)
 {
     m_notifyIconData.cbSize = 0;
 }
@@ -272,6 +304,8 @@ LRESULT CMainFrame::OnCreate(const CREATESTRUCT* /*pCreate*/)
     pLoop->AddIdleHandler(this);
 
     m_logSources.SubscribeToUpdate([this] { return OnUpdate(); });
+    SampleMetrics();
+    m_GuiExecutorClient->CallAsync([this] { StartRecovery(); });
 
     // Resume can throw if a second debugview is running
     // so do not rely on any commands executed afterwards
@@ -282,6 +316,7 @@ LRESULT CMainFrame::OnCreate(const CREATESTRUCT* /*pCreate*/)
 void CMainFrame::OnClose()
 {
     SaveSettings();
+    StopRecovery();
     DestroyWindow();
 
     if (m_notifyIconData.cbSize != 0u)
@@ -313,6 +348,7 @@ void CMainFrame::UpdateUI()
 
     UISetCheck(ID_VIEW_TIME, GetView().GetClockTime());
     UISetCheck(ID_VIEW_PROCESSCOLORS, GetView().GetViewProcessColors());
+    UISetCheck(ID_VIEW_COLLAPSE_REPEATS, GetView().GetCollapseRepeats());
     UISetCheck(ID_VIEW_SCROLL, GetView().GetAutoScroll());
     UISetCheck(ID_VIEW_SCROLL_STOP, GetView().GetAutoScrollStop());
     UISetCheck(ID_VIEW_BOOKMARK, GetView().GetBookmark());
@@ -336,6 +372,7 @@ void CMainFrame::UpdateUI()
     UIEnable(ID_LOG_KERNEL_PASSTHROUGH, !!m_pKernelReader);
     UISetCheck(ID_LOG_KERNEL_VERBOSE, m_verboseKernelMessage);
     UISetCheck(ID_LOG_KERNEL_PASSTHROUGH, m_passthroughMode);
+    UISetCheck(ID_LOG_RING, m_tryRing);
 }
 
 std::wstring FormatDateTime(const SYSTEMTIME& systemTime)
@@ -416,8 +453,11 @@ void CMainFrame::ProcessLines(const Lines& lines)
         return;
     }
 
-    // design decision: filtering is done on the UI thread, see CLogView::Add
-    // changing this would introduces extra thread and thus complexity. Do that only if it solves a problem.
+    static auto& processTime = GetMetrics().GetHistogram("ui.processlines.us");
+    ScopedTimer timer(processTime);
+
+    // design decision: the views are updated on the UI thread, see CLogView::Add. Their filters are evaluated once
+    // for all views by m_filterEvaluator, which spreads large batches over its threads.
 
     int views = GetViewCount();
     for (int i = 0; i < views; ++i)
@@ -425,19 +465,23 @@ void CMainFrame::ProcessLines(const Lines& lines)
         GetView(i).BeginUpdate();
     }
 
-    if (m_logSources.GetProcessPrefix())
+    m_filterMessages.clear();
+    bool processPrefix = m_logSources.GetProcessPrefix();
+    for (auto& line : lines)
     {
-        for (auto& line : lines)
-        {
-            AddMessage(Message(line.time, line.systemTime, line.pid, line.processName, "[" + std::to_string(line.pid) + "] " + line.message));
-        }
+        m_filterMessages.emplace_back(line.time, line.systemTime, line.pid, line.processName, processPrefix ? "[" + std::to_string(line.pid) + "] " + line.message : line.message);
+        m_filterMessages.back().ingestTicks = line.ingestTicks;
     }
-    else
+
+    RegisterFilters();
     {
-        for (auto& line : lines)
-        {
-            AddMessage(Message(line.time, line.systemTime, line.pid, line.processName, line.message));
-        }
+        static auto& filterTime = GetMetrics().GetHistogram("filters.evaluate.us");
+        ScopedTimer filterTimer(filterTime);
+        m_filterEvaluator.Evaluate(m_filterMessages, m_filterResults);
+    }
+    for (size_t i = 0; i < m_filterMessages.size(); ++i)
+    {
+        AddMessage(m_filterMessages[i], m_filterResults[i]);
     }
 
     for (int i = 0; i < views; ++i)
@@ -451,6 +495,105 @@ void CMainFrame::ProcessLines(const Lines& lines)
     }
 }
 
+// samples the metrics registry into m_metricsHistory once a second, for the statistics dialog
+void CMainFrame::SampleMetrics()
+{
+    auto& metrics = GetMetrics();
+    metrics.GetGauge("logfile.lines").Set(m_logFile.Count());
+    metrics.GetGauge("logfile.bytes.raw").Set(static_cast<int64_t>(m_logFile.GetRawSize()));
+    metrics.GetGauge("logfile.bytes.stored").Set(static_cast<int64_t>(m_logFile.GetStoredSize()));
+    metrics.GetGauge("logfile.texts").Set(static_cast<int64_t>(m_logFile.GetDistinctCount()));
+    metrics.GetGauge("logfile.templates").Set(static_cast<int64_t>(m_logFile.GetTemplates().GetTemplateCount()));
+    metrics.GetGauge("logfile.bytes.spilled").Set(static_cast<int64_t>(m_logFile.GetSpilledSize()));
+    GovernMemory();
+    m_metricsHistory.Add(metrics.Sample());
+    m_GuiExecutorClient->CallAfter(1s, [this] { SampleMetrics(); });
+}
+
+// keeps the log under the memory limit, the actions of the governor are taken cheapest first until it is
+void CMainFrame::GovernMemory()
+{
+    AccountMemory();
+    m_memoryGovernor.BeginRound();
+    for (auto action = m_memoryGovernor.Next(); action != MemoryGovernor::Action::None; action = m_memoryGovernor.Next())
+    {
+        switch (action)
+        {
+        case MemoryGovernor::Action::ShrinkCaches:
+            m_logFile.ShrinkCaches();
+            for (int i = 0; i < GetViewCount(); ++i)
+            {
+                GetView(i).ShrinkCaches();
+            }
+            m_incomingMessages.shrink_to_fit();
+            break;
+        case MemoryGovernor::Action::CompressWriteBlock:
+            m_logFile.CompressWriteBlock();
+            break;
+        case MemoryGovernor::Action::SpillBlocks:
+            try
+            {
+                m_logFile.SpillBlocks(m_memoryGovernor.GetExcess());
+            }
+            catch (std::exception&)
+            {
+                // no room on disk either, eviction is next
+            }
+            break;
+        case MemoryGovernor::Action::EvictHistory:
+            EvictHistory();
+            break;
+        default: break;
+        }
+        AccountMemory();
+    }
+}
+
+void CMainFrame::AccountMemory()
+{
+    m_memoryGovernor.Account("logfile.storage", m_logFile.GetStoredSize());
+    m_memoryGovernor.Account("logfile.lines", m_logFile.GetLineMemorySize());
+    m_memoryGovernor.Account("logfile.caches", m_logFile.GetCacheSize());
+
+    size_t views = 0;
+    for (int i = 0; i < GetViewCount(); ++i)
+    {
+        views += GetView(i).GetMemorySize();
+    }
+    m_memoryGovernor.Account("views", views);
+
+    size_t incoming = 0;
+    for (auto& lines : m_incomingMessages)
+    {
+        for (auto& line : lines)
+        {
+            incoming += sizeof(line) + line.message.size() + line.processName.size();
+        }
+    }
+    m_memoryGovernor.Account("incoming", incoming);
+}
+
+// drops enough of the oldest lines to get under the low mark of the governor, so this does not repeat every second
+void CMainFrame::EvictHistory()
+{
+    auto logSize = m_logFile.GetStoredSize() + m_logFile.GetLineMemorySize();
+    int count = m_logFile.Count();
+    if (count == 0 || logSize == 0)
+    {
+        return;
+    }
+
+    auto fraction = std::min(1.0, static_cast<double>(m_memoryGovernor.GetExcess()) / logSize);
+    auto evict = static_cast<int>(count * fraction);
+    m_logFile.Evict(evict);
+    for (int i = 0; i < GetViewCount(); ++i)
+    {
+        GetView(i).Evict(evict);
+    }
+    AddChange();
+    m_logSources.AddMessage(stringbuilder() << "<" << evict << " oldest lines evicted to stay under the memory limit>");
+}
+
 bool CMainFrame::OnUpdate()
 {
     Lines bucket;
@@ -480,6 +623,18 @@ bool CMainFrame::OnUpdate()
     }
 
 
+    static auto& backlog = GetMetrics().GetGauge("ui.backlog");
+    size_t pending = 0;
+    for (auto& pendingLines : m_incomingMessages)
+    {
+        pending += pendingLines.size();
+    }
+    backlog.Set(static_cast<int64_t>(pending));
+    if (m_rateLimits.uiBudget != 0 && pending > m_rateLimits.uiBudget)
+    {
+        ProtectUi(pending);
+    }
+
     auto linesbucket = std::move(m_incomingMessages.front());
     m_incomingMessages.pop_front();
     ProcessLines(linesbucket);
@@ -491,6 +646,28 @@ bool CMainFrame::OnUpdate()
     return true;
 }
 
+// skips the oldest pending lines, so the view catches up with the most recent ones
+void CMainFrame::ProtectUi(size_t pending)
+{
+    auto skip = pending - m_rateLimits.uiBudget;
+    auto skipped = skip;
+    while (skip > 0)
+    {
+        auto& lines = m_incomingMessages.front();
+        if (lines.size() <= skip)
+        {
+            skip -= lines.size();
+            m_incomingMessages.pop_front();
+        }
+        else
+        {
+            lines.erase(lines.begin(), lines.begin() + skip);
+            skip = 0;
+        }
+    }
+    m_logSources.AddMessage(stringbuilder() << "<" << skipped << " lines skipped to protect the UI>");
+}
+
 bool CMainFrame::OnMouseWheel(UINT nFlags, short zDelta, CPoint /*pt*/)
 {
     if ((nFlags & MK_CONTROL) == 0)
@@ -559,6 +736,35 @@ void CMainFrame::HandleDroppedFile(const std::wstring& file)
     }
 }
 
+// text logs dropped together are merged into one log in time order, other files are handled one by one
+void CMainFrame::OnDroppedFiles(const std::vector<std::wstring>& files)
+{
+    using boost::algorithm::iequals;
+    std::vector<std::wstring> logs;
+    for (auto& file : files)
+    {
+        auto ext = std::filesystem::path(file).extension().wstring();
+        if (iequals(ext, L".exe") || iequals(ext, L".cmd") || iequals(ext, L".bat") || IsBinaryFileType(IdentifyFile(file)))
+        {
+            HandleDroppedFile(file);
+        }
+        else
+        {
+            logs.push_back(file);
+        }
+    }
+
+    if (logs.size() == 1)
+    {
+        HandleDroppedFile(logs.front());
+    }
+    else if (logs.size() > 1)
+    {
+        SetTitle(wstringbuilder() << logs.size() << L" merged files");
+        m_logSources.AddMergeFileReader(logs);
+    }
+}
+
 void CMainFrame::OnDropped(const std::wstring uri)
 {
     if (std::filesystem::is_regular_file(uri))
@@ -741,6 +947,10 @@ bool CMainFrame::LoadSettings()
     SetTitle();
 
     m_hide = Win32::RegGetDWORDValue(reg, L"Hide", 0) != 0;
+    m_autoSnapshotInterval = Win32::RegGetDWORDValue(reg, L"AutoSnapshot", 60);
+    m_memoryGovernor.SetLimit(MemoryGovernor::MegabytesToBytes(Win32::RegGetDWORDValue(reg, L"MemoryLimit", 0)));
+    m_spillLimit = Win32::RegGetDWORDValue(reg, L"SpillLimit", m_spillLimit);
+    m_logFile.SetSpillFile(GetSpillFileName(), MemoryGovernor::MegabytesToBytes(m_spillLimit));
 
     auto fontName = Win32::RegGetStringValue(reg, L"FontName", L"").substr(0, LF_FACESIZE - 1);
     int fontSize = Win32::RegGetDWORDValue(reg, L"FontSize", 8);
@@ -780,6 +990,17 @@ bool CMainFrame::LoadSettings()
         GetTabCtrl().Invalidate();
     }
 
+    CRegKey regRateLimit;
+    if (regRateLimit.Open(reg, L"RateLimit") == ERROR_SUCCESS)
+    {
+        m_rateLimits.linesPerSecond = Win32::RegGetDWORDValue(regRateLimit, L"LinesPerSecond", 0);
+        m_rateLimits.burst = Win32::RegGetDWORDValue(regRateLimit, L"Burst", 0);
+        m_rateLimits.sampleInterval = Win32::RegGetDWORDValue(regRateLimit, L"SampleInterval", 0);
+        m_rateLimits.processLimits = ParseProcessLimits(Str(Win32::RegGetStringValue(regRateLimit, L"Processes", L"")));
+        m_rateLimits.uiBudget = Win32::RegGetDWORDValue(regRateLimit, L"UiBudget", 0);
+        m_logSources.SetRateLimits(m_rateLimits);
+    }
+
     CRegKey regColors;
     if (regColors.Open(reg, L"Colors") == ERROR_SUCCESS)
     {
@@ -817,6 +1038,9 @@ void CMainFrame::SaveSettings()
     reg.SetDWORDValue(L"AutoNewLine", static_cast<DWORD>(m_logSources.GetAutoNewLine()));
     reg.SetDWORDValue(L"AlwaysOnTop", static_cast<DWORD>(GetAlwaysOnTop()));
     reg.SetDWORDValue(L"Hide", static_cast<DWORD>(m_hide));
+    reg.SetDWORDValue(L"AutoSnapshot", m_autoSnapshotInterval);
+    reg.SetDWORDValue(L"MemoryLimit", static_cast<DWORD>(m_memoryGovernor.GetLimit() / (1024 * 1024)));
+    reg.SetDWORDValue(L"SpillLimit", m_spillLimit);
 
     reg.SetStringValue(L"FontName", m_logfont.lfFaceName);
     reg.SetDWORDValue(L"FontSize", LogFontSizeToPointSize(m_logfont.lfHeight));
@@ -836,6 +1060,14 @@ void CMainFrame::SaveSettings()
         GetView(i).SaveSettings(regView);
     }
 
+    CRegKey regRateLimit;
+    regRateLimit.Create(reg, L"RateLimit");
+    regRateLimit.SetDWORDValue(L"LinesPerSecond", static_cast<DWORD>(m_rateLimits.linesPerSecond));
+    regRateLimit.SetDWORDValue(L"Burst", static_cast<DWORD>(m_rateLimits.burst));
+    regRateLimit.SetDWORDValue(L"SampleInterval", m_rateLimits.sampleInterval);
+    regRateLimit.SetStringValue(L"Processes", WStr(FormatProcessLimits(m_rateLimits.processLimits)));
+    regRateLimit.SetDWORDValue(L"UiBudget", static_cast<DWORD>(m_rateLimits.uiBudget));
+
     CRegKey regColors;
     regColors.Create(reg, L"Colors");
     auto colors = ColorDialog::GetCustomColors();
@@ -896,6 +1128,7 @@ void CMainFrame::AddFilterView(std::shared_ptr<CLogView> logview)
     GetTabCtrl().InsertItem(newIndex, pTabItem.release());
     GetTabCtrl().SetCurSel(newIndex);
     ShowTabControl();
+    AddChange();
 }
 
 LRESULT CMainFrame::OnBeginTabDrag(NMHDR* pnmh)
@@ -908,6 +1141,7 @@ LRESULT CMainFrame::OnBeginTabDrag(NMHDR* pnmh)
 LRESULT CMainFrame::OnChangeTab(NMHDR* pnmh)
 {
     SetMsgHandled(win32::False);
+    AddChange();
 
     auto& nmhdr = *reinterpret_cast<NMCTC2ITEMS*>(pnmh);
 
@@ -1164,6 +1398,166 @@ void CMainFrame::SaveConfiguration(const std::wstring& fileName)
     boost::property_tree::write_xml(Str(fileName), pt, std::locale(), settings);
 }
 
+void CMainFrame::SaveSnapshot(const std::wstring& fileName)
+{
+    SnapshotWriter writer(fileName);
+    SaveSnapshot(writer);
+    writer.Commit();
+}
+
+// format: the number of views, the log, each view and the index of the current view, see Snapshot.h
+void CMainFrame::SaveSnapshot(SnapshotWriter& writer)
+{
+    int views = GetViewCount();
+    writer.WriteNumber(views);
+    m_logFile.SaveSnapshot(writer);
+    for (int i = 0; i < views; ++i)
+    {
+        GetView(i).SaveSnapshot(writer);
+    }
+    writer.WriteNumber(GetTabCtrl().GetCurSel());
+}
+
+void CMainFrame::LoadSnapshot(const std::wstring& fileName)
+{
+    SnapshotReader reader(fileName);
+    ClearLog();
+
+    // the views are created while the log is still empty, so creating them filters nothing
+    auto views = static_cast<int>(reader.ReadCount());
+    while (GetViewCount() < views)
+    {
+        AddFilterView(L"View");
+    }
+    while (GetViewCount() > std::max(views, 1))
+    {
+        CloseView(GetViewCount() - 1);
+    }
+
+    try
+    {
+        m_logFile.LoadSnapshot(reader);
+        for (int i = 0; i < views; ++i)
+        {
+            auto& logView = GetView(i);
+            logView.LoadSnapshot(reader);
+            GetTabCtrl().GetItem(i)->SetText(logView.GetName().c_str());
+        }
+        auto current = reader.ReadNumber();
+        if (current >= static_cast<uint64_t>(views))
+        {
+            throw std::runtime_error("snapshot is damaged");
+        }
+        GetTabCtrl().SetCurSel(static_cast<int>(current));
+    }
+    catch (...)
+    {
+        ClearLog();
+        throw;
+    }
+    m_snapshotChanges = m_changes;
+    GetTabCtrl().UpdateLayout();
+    GetTabCtrl().Invalidate();
+    UpdateStatusBar();
+}
+
+// the first instance owns the recovery snapshot, finding it at startup means the previous session did not end in OnClose()
+void CMainFrame::StartRecovery()
+{
+    m_recoveryMutex = Win32::CreateMutex(nullptr, false, L"Local\\DebugView++Recovery");
+    auto rc = WaitForSingleObject(m_recoveryMutex.get(), 0);
+    m_recoveryFileName = rc == WAIT_OBJECT_0 || rc == WAIT_ABANDONED ? GetRecoveryFileName() : L"";
+    if (m_recoveryFileName.empty())
+    {
+        return;
+    }
+
+    if (std::filesystem::exists(m_recoveryFileName))
+    {
+        try
+        {
+            if (MessageBox(L"DebugView++ did not close normally.\nRestore the log of the previous session?", m_applicationName.c_str(), MB_YESNO | MB_ICONQUESTION) == IDYES)
+            {
+                Win32::ScopedCursor cursor(::LoadCursor(nullptr, IDC_WAIT));
+                LoadSnapshot(m_recoveryFileName);
+            }
+        }
+        catch (std::exception& ex)
+        {
+            OnException(ex);
+        }
+        if (m_logFile.Empty())
+        {
+            std::error_code ec;
+            std::filesystem::remove(m_recoveryFileName, ec);
+        }
+    }
+    AutoSnapshot();
+}
+
+void CMainFrame::StopRecovery()
+{
+    if (!m_recoveryFileName.empty())
+    {
+        m_snapshotExecutor.Synchronize();
+        std::error_code ec;
+        std::filesystem::remove(m_recoveryFileName, ec);
+        m_recoveryFileName.clear();
+    }
+}
+
+void CMainFrame::AddChange()
+{
+    ++m_changes;
+}
+
+// writes the recovery snapshot when the log or a view changed since the last one. Only the line records and the views are
+// copied here, the compressed blocks are shared with the log and m_snapshotExecutor writes them to disk, reading the
+// spilled ones back from the spill file, while the log goes on.
+void CMainFrame::AutoSnapshot()
+{
+    if (m_recoveryFileName.empty() || m_autoSnapshotInterval == 0)
+    {
+        return;
+    }
+
+    if (!m_snapshotBusy && m_snapshotFailed.exchange(false))
+    {
+        AddChange();
+    }
+
+    if (!m_snapshotBusy && m_changes != m_snapshotChanges)
+    {
+        std::shared_ptr<SnapshotWriter> writer;
+        if (!m_logFile.Empty())
+        {
+            writer = std::make_shared<SnapshotWriter>(m_recoveryFileName);
+            SaveSnapshot(*writer);
+        }
+        m_snapshotChanges = m_changes;
+        m_snapshotBusy = true;
+        m_snapshotExecutor.CallAsync([this, writer, fileName = m_recoveryFileName] {
+            try
+            {
+                if (writer)
+                {
+                    writer->Commit();
+                }
+                else
+                {
+                    std::filesystem::remove(fileName);
+                }
+            }
+            catch (std::exception&)
+            {
+                m_snapshotFailed = true;
+            }
+            m_snapshotBusy = false;
+        });
+    }
+    m_GuiExecutorClient->CallAfter(std::chrono::seconds(m_autoSnapshotInterval), [this] { AutoSnapshot(); });
+}
+
 void CMainFrame::OnFileOpen(UINT /*uNotifyCode*/, int /*nID*/, CWindow /*wndCtl*/)
 {
     CFileOptionDlg dlg(1, L"Keep file open", L".dblog", m_logFileName.c_str(), OFN_FILEMUSTEXIST,
@@ -1222,6 +1616,7 @@ void CMainFrame::Load(std::istream& file, const std::string& name, FILETIME file
     Win32::ScopedCursor cursor(::LoadCursor(nullptr, IDC_WAIT));
 
     ClearLog();
+    RegisterFilters();
 
     Line line(0.0);
     line.processName = name;
@@ -1319,10 +1714,39 @@ void CMainFrame::OnFileSaveConfiguration(UINT /*uNotifyCode*/, int /*nID*/, CWin
     }
 }
 
+void CMainFrame::OnFileOpenSnapshot(UINT /*uNotifyCode*/, int /*nID*/, CWindow /*wndCtl*/)
+{
+    CFileDialog dlg(1, L".dvsnap", m_snapshotFileName.c_str(), OFN_FILEMUSTEXIST | OFN_HIDEREADONLY,
+        L"DebugView++ Snapshots (*.dvsnap)\0*.dvsnap\0\0");
+    dlg.m_ofn.nFilterIndex = 0;
+    dlg.m_ofn.lpstrTitle = L"Open Snapshot";
+    if (dlg.DoModal() == IDOK)
+    {
+        Win32::ScopedCursor cursor(::LoadCursor(nullptr, IDC_WAIT));
+        m_snapshotFileName = dlg.m_szFileName;
+        LoadSnapshot(m_snapshotFileName);
+        SetTitle(m_snapshotFileName);
+    }
+}
+
+void CMainFrame::OnFileSaveSnapshot(UINT /*uNotifyCode*/, int /*nID*/, CWindow /*wndCtl*/)
+{
+    CFileDialog dlg(0, L".dvsnap", m_snapshotFileName.c_str(), OFN_OVERWRITEPROMPT, L"DebugView++ Snapshots (*.dvsnap)\0*.dvsnap\0\0");
+    dlg.m_ofn.nFilterIndex = 0;
+    dlg.m_ofn.lpstrTitle = L"Save Snapshot";
+    if (dlg.DoModal() == IDOK)
+    {
+        Win32::ScopedCursor cursor(::LoadCursor(nullptr, IDC_WAIT));
+        m_snapshotFileName = dlg.m_szFileName;
+        SaveSnapshot(m_snapshotFileName);
+    }
+}
+
 void CMainFrame::ClearLog()
 {
     m_logFile.Clear();
     m_logSources.ResetTimer();
+    AddChange();
     int views = GetViewCount();
     for (int i = 0; i < views; ++i)
     {
@@ -1423,6 +1847,11 @@ void CMainFrame::Pause()
         m_logSources.Remove(m_pKernelReader);
         m_pKernelReader = nullptr;
     }
+    // removing the ring would fail to create it again on Resume() while writers still map it
+    if (m_pRingReader != nullptr)
+    {
+        m_pRingReader->SetPaused(true);
+    }
     m_logSources.AddMessage("<paused>");
 }
 
@@ -1502,6 +1931,27 @@ void CMainFrame::Resume()
             m_tryKernel = false;
         }
     }
+
+    if (m_pRingReader != nullptr)
+    {
+        m_pRingReader->SetPaused(false);
+    }
+    else if (m_tryRing)
+    {
+        try
+        {
+            m_pRingReader = m_logSources.AddShmRingReader(shmring::DefaultName);
+        }
+        catch (std::exception& e)
+        {
+            const auto message = std::format("Unable to capture Shared-Memory Ring Messages.\n"
+                                             "({})\n\n"
+                                             "Another DebugView++ might be running.",
+                e.what());
+            MessageBox(WStr(message), m_applicationName.c_str(), MB_ICONERROR | MB_OK);
+            m_tryRing = false;
+        }
+    }
     UpdateTitle();
 }
 
@@ -1581,6 +2031,22 @@ void CMainFrame::OnLogKernel(UINT /*uNotifyCode*/, int /*nID*/, CWindow /*wndCtl
     UpdateTitle();
 }
 
+void CMainFrame::OnLogRing(UINT /*uNotifyCode*/, int /*nID*/, CWindow /*wndCtl*/)
+{
+    m_tryRing = (m_pRingReader == nullptr);
+
+    if (m_tryRing)
+    {
+        Resume();
+    }
+    else
+    {
+        m_logSources.Remove(m_pRingReader);
+        m_pRingReader = nullptr;
+    }
+    UpdateTitle();
+}
+
 void CMainFrame::OnLogKernelVerbose(UINT /*uNotifyCode*/, int /*nID*/, CWindow /*wndCtl*/)
 {
     m_verboseKernelMessage = !m_verboseKernelMessage;
@@ -1601,13 +2067,31 @@ void CMainFrame::OnLogKernelPassThrough(UINT /*uNotifyCode*/, int /*nID*/, CWind
 
 void CMainFrame::OnLogHistory(UINT /*uNotifyCode*/, int /*nID*/, CWindow /*wndCtl*/)
 {
-    CHistoryDlg dlg(m_logFile.GetHistorySize(), m_logFile.GetHistorySize() == 0);
+    CHistoryDlg dlg(m_logFile.GetHistorySize(), m_logFile.GetHistorySize() == 0, m_memoryGovernor.GetLimit() / (1024 * 1024));
     if (dlg.DoModal() == IDOK)
     {
         m_logFile.SetHistorySize(dlg.GetHistorySize());
+        m_memoryGovernor.SetLimit(MemoryGovernor::MegabytesToBytes(dlg.GetMemoryLimit()));
+        SaveSettings();
     }
 }
 
+void CMainFrame::OnLogRateLimit(UINT /*uNotifyCode*/, int /*nID*/, CWindow /*wndCtl*/)
+{
+    CRateLimitDlg dlg(m_rateLimits);
+    if (dlg.DoModal() == IDOK)
+    {
+        m_rateLimits = dlg.GetSettings();
+        m_logSources.SetRateLimits(m_rateLimits);
+    }
+}
+
+void CMainFrame::OnLogStatistics(UINT /*uNotifyCode*/, int /*nID*/, CWindow /*wndCtl*/)
+{
+    CStatsDlg dlg(m_metricsHistory);
+    dlg.DoModal();
+}
+
 std::wstring GetExecutionPath()
 {
     auto path = std::filesystem::absolute(Win32::GetModuleFilename());
@@ -1703,6 +2187,10 @@ void CMainFrame::UpdateLogSources(const std::vector<SourceInfo>& sources)
         {
             return false;
         }
+        if (logsource == m_pRingReader)
+        {
+            return false;
+        }
         return true;
     });
 
@@ -1721,7 +2209,7 @@ void CMainFrame::AddLogSource(const SourceInfo& info)
     {
     case SourceType::DebugViewAgent: m_logSources.AddDbgviewReader(Str(info.address)); break;
     case SourceType::Udp: m_logSources.AddUDPReader(info.port); break;
-    case SourceType::Tcp: throw std::exception("SourceType::Tcp not implememted");
+    case SourceType::Tcp: m_logSources.AddTCPReader(info.port); break;
     default:
         // do nothing
         throw std::exception("SourceType not implememted");
@@ -1740,6 +2228,7 @@ void CMainFrame::CloseView(int i)
         {
             HideTabControl();
         }
+        AddChange();
     }
 }
 
@@ -1801,7 +2290,29 @@ bool IsClearBufferMessage(const std::string& message)
     return message.find("DBGVIEWCLEAR") == 0;
 }
 
+// identical filters of different views share a slot, a view that adds no new filters adds no evaluation
+void CMainFrame::RegisterFilters()
+{
+    m_filterEvaluator.BeginRegistration();
+    for (int i = 0; i < GetViewCount(); ++i)
+    {
+        GetView(i).RegisterFilters(m_filterEvaluator);
+    }
+
+    auto& metrics = GetMetrics();
+    metrics.GetGauge("filters.registered").Set(static_cast<int64_t>(m_filterEvaluator.GetRegisteredCount()));
+    metrics.GetGauge("filters.evaluated").Set(static_cast<int64_t>(m_filterEvaluator.GetSlotCount()));
+}
+
+// the filters must be registered, see RegisterFilters()
 void CMainFrame::AddMessage(const Message& message)
+{
+    FilterResult result;
+    m_filterEvaluator.Evaluate(message, result);
+    AddMessage(message, result);
+}
+
+void CMainFrame::AddMessage(const Message& message, const FilterResult& result)
 {
     if (IsClearBufferMessage(message.text))
     {
@@ -1812,10 +2323,11 @@ void CMainFrame::AddMessage(const Message& message)
     int beginIndex = m_logFile.BeginIndex();
     int index = m_logFile.EndIndex();
     m_logFile.Add(message);
+    AddChange();
     int views = GetViewCount();
     for (int i = 0; i < views; ++i)
     {
-        GetView(i).Add(beginIndex, index, message);
+        GetView(i).Add(beginIndex, index, message, result);
     }
 }
 
@@ -5,6 +5,7 @@
 
 #pragma once
 
+#include <atomic>
 #include <memory>
 
 #include "atleverything.h"
@@ -28,9 +29,12 @@ using ATL::CString;
 #include "DebugViewppLib/DBWinBuffer.h"
 #include "DebugViewppLib/DBWinReader.h"
 #include "DebugViewppLib/KernelReader.h"
+#include "DebugViewppLib/ShmRingReader.h"
 #include "DebugViewppLib/LineBuffer.h"
 #include "DebugViewppLib/LogSources.h"
 #include "DebugViewppLib/FileWriter.h"
+#include "DebugViewppLib/MemoryGovernor.h"
+#include "DebugViewppLib/Metrics.h"
 #include "CLogViewTabItem2.h"
 #include "FindDlg.h"
 #include "RunDlg.h"
@@ -66,16 +70,19 @@ public:
         UPDATE_ELEMENT(ID_LOG_KERNEL, UPDUI_MENUPOPUP)
         UPDATE_ELEMENT(ID_LOG_KERNEL_VERBOSE, UPDUI_MENUPOPUP)
         UPDATE_ELEMENT(ID_LOG_KERNEL_PASSTHROUGH, UPDUI_MENUPOPUP)
+        UPDATE_ELEMENT(ID_LOG_RING, UPDUI_MENUPOPUP)
         UPDATE_ELEMENT(ID_VIEW_SCROLL, UPDUI_MENUPOPUP | UPDUI_TOOLBAR)
         UPDATE_ELEMENT(ID_VIEW_SCROLL_STOP, UPDUI_MENUPOPUP | UPDUI_TOOLBAR)
         UPDATE_ELEMENT(ID_VIEW_TIME, UPDUI_MENUPOPUP | UPDUI_TOOLBAR)
         UPDATE_ELEMENT(ID_VIEW_PROCESSCOLORS, UPDUI_MENUPOPUP)
+        UPDATE_ELEMENT(ID_VIEW_COLLAPSE_REPEATS, UPDUI_MENUPOPUP)
         UPDATE_ELEMENT(ID_VIEW_BOOKMARK, UPDUI_MENUPOPUP | UPDUI_TOOLBAR)
         UPDATE_ELEMENT(ID_VIEW_COLUMN_LINE, UPDUI_MENUPOPUP)
         UPDATE_ELEMENT(ID_VIEW_COLUMN_DATE, UPDUI_MENUPOPUP)
         UPDATE_ELEMENT(ID_VIEW_COLUMN_TIME, UPDUI_MENUPOPUP)
         UPDATE_ELEMENT(ID_VIEW_COLUMN_PID, UPDUI_MENUPOPUP)
         UPDATE_ELEMENT(ID_VIEW_COLUMN_PROCESS, UPDUI_MENUPOPUP)
+        UPDATE_ELEMENT(ID_VIEW_COLUMN_TEMPLATE, UPDUI_MENUPOPUP)
         UPDATE_ELEMENT(ID_OPTIONS_LINKVIEWS, UPDUI_MENUPOPUP | UPDUI_TOOLBAR)
         UPDATE_ELEMENT(ID_OPTIONS_AUTONEWLINE, UPDUI_MENUPOPUP)
         UPDATE_ELEMENT(ID_OPTIONS_PROCESS_PREFIX, UPDUI_MENUPOPUP)
@@ -91,6 +98,8 @@ public:
     void SetLogging();
     void LoadConfiguration(const std::wstring& fileName);
     void SaveConfiguration(const std::wstring& fileName);
+    void LoadSnapshot(const std::wstring& fileName);
+    void SaveSnapshot(const std::wstring& fileName);
     void Load(const std::wstring& fileName, bool keeptailing);
     void Load(HANDLE hFile);
     void Load(std::istream& file, const std::string& name, FILETIME fileTime);
@@ -99,6 +108,10 @@ public:
     void FindNext(const std::wstring& text);
     void FindPrevious(const std::wstring& text);
     void OnDropped(std::wstring uri);
+    void OnDroppedFiles(const std::vector<std::wstring>& files);
+
+    // counts an edit of the log or of a view, AutoSnapshot() writes a recovery snapshot when there are new ones
+    void AddChange();
 
     // Return the command which should be used to show the window, it is
     // restored from the registry when creating it.
@@ -125,6 +138,15 @@ private:
     bool OnUpdate();
     bool OnMouseWheel(UINT nFlags, short zDelta, CPoint pt);
     void ProcessLines(const Lines& lines);
+    void SampleMetrics();
+    void GovernMemory();
+    void AccountMemory();
+    void EvictHistory();
+    void StartRecovery();
+    void StopRecovery();
+    void AutoSnapshot();
+    void SaveSnapshot(SnapshotWriter& writer);
+    void ProtectUi(size_t pending);
 
     int LogFontSizeFromPointSize(int fontSize);
     int LogFontSizeToPointSize(int logFontSize);
@@ -147,6 +169,8 @@ private:
     void AddFilterView(const std::wstring& name, const LogFilter& filter = LogFilter());
     void AddFilterView(std::shared_ptr<CLogView> logview);
     void AddMessage(const Message& message);
+    void AddMessage(const Message& message, const FilterResult& result);
+    void RegisterFilters();
 
     void SetModifiedMark(int tabindex, bool modified);
     void ClearLog();
@@ -172,6 +196,8 @@ private:
     void OnFileSaveViewSelection(UINT uNotifyCode, int nID, CWindow wndCtl);
     void OnFileLoadConfiguration(UINT uNotifyCode, int nID, CWindow wndCtl);
     void OnFileSaveConfiguration(UINT uNotifyCode, int nID, CWindow wndCtl);
+    void OnFileOpenSnapshot(UINT uNotifyCode, int nID, CWindow wndCtl);
+    void OnFileSaveSnapshot(UINT uNotifyCode, int nID, CWindow wndCtl);
     void OnLinkViews(UINT uNotifyCode, int nID, CWindow wndCtl);
     void OnAutoNewline(UINT uNotifyCode, int nID, CWindow wndCtl);
     void OnProcessPrefix(UINT uNotifyCode, int nID, CWindow wndCtl);
@@ -184,7 +210,10 @@ private:
     void OnLogKernel(UINT uNotifyCode, int nID, CWindow wndCtl);
     void OnLogKernelVerbose(UINT uNotifyCode, int nID, CWindow wndCtl);
     void OnLogKernelPassThrough(UINT uNotifyCode, int nID, CWindow wndCtl);
+    void OnLogRing(UINT uNotifyCode, int nID, CWindow wndCtl);
     void OnLogHistory(UINT uNotifyCode, int nID, CWindow wndCtl);
+    void OnLogRateLimit(UINT uNotifyCode, int nID, CWindow wndCtl);
+    void OnLogStatistics(UINT uNotifyCode, int nID, CWindow wndCtl);
     void OnLogDebugviewAgent(UINT uNotifyCode, int nID, CWindow wndCtl);
     void OnViewFind(UINT uNotifyCode, int nID, CWindow wndCtl);
     void OnViewFont(UINT uNotifyCode, int nID, CWindow wndCtl);
@@ -220,10 +249,20 @@ private:
     bool m_hide = false;
     bool m_tryGlobal = false;
     bool m_tryKernel = false;
+    bool m_tryRing = false;
     CRunDlg m_runDlg;
     std::wstring m_logFileName;
     std::wstring m_txtFileName;
     std::wstring m_configFileName;
+    std::wstring m_snapshotFileName;
+    std::wstring m_recoveryFileName; // empty if another instance owns the recovery snapshot
+    Win32::Handle m_recoveryMutex;
+    DWORD m_autoSnapshotInterval = 60; // seconds, 0 disables the recovery snapshot
+    uint64_t m_changes = 0;            // see AddChange()
+    uint64_t m_snapshotChanges = 0;    // m_changes at the last recovery snapshot
+    DWORD m_spillLimit = 4096;         // MB, the memory governor evicts lines when the spill file is this large
+    std::atomic<bool> m_snapshotBusy = false;   // the recovery snapshot is being written
+    std::atomic<bool> m_snapshotFailed = false; // and writing it failed, it is written again after the next interval
     size_t m_initialPrivateBytes;
     NOTIFYICONDATA m_notifyIconData;
     LOGFONT m_logfont;
@@ -231,6 +270,7 @@ private:
     DBWinReader* m_pLocalReader = nullptr;
     DBWinReader* m_pGlobalReader = nullptr;
     KernelReader* m_pKernelReader = nullptr;
+    ShmRingReader* m_pRingReader = nullptr;
     bool m_verboseKernelMessage = false;
     bool m_passthroughMode = false;
     DbgviewReader* m_pDbgviewReader = nullptr;
@@ -240,8 +280,15 @@ private:
     Win32::JobObject m_jobs;
     Win32::Handle m_httpMonitorHandle;
     std::deque<Lines> m_incomingMessages;
+    RateLimitSettings m_rateLimits;
+    MetricsHistory m_metricsHistory;
+    MemoryGovernor m_memoryGovernor;
+    FilterEvaluator m_filterEvaluator;
+    std::vector<Message> m_filterMessages;     // of the batch in ProcessLines(), kept to reuse their memory
+    std::vector<FilterResult> m_filterResults; // and the result of each
     int m_showCmd = SW_SHOWDEFAULT;
     std::string m_driverLocation = GetDebugviewDriverLocation();
+    ActiveExecutorClient m_snapshotExecutor; // writes the recovery snapshot, declared last so it stops first
 };
 
 } // namespace debugviewpp
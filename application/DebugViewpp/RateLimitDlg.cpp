@@ -0,0 +1,98 @@
+// (C) Copyright Gert-Jan de Vos and Jan Wilmans 2013.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#include "CobaltFusion/AtlWinExt.h"
+#include "CobaltFusion/Str.h"
+#include "CobaltFusion/fusionassert.h"
+#include "Win32/Utilities.h"
+#include "RateLimitDlg.h"
+
+namespace fusion {
+namespace debugviewpp {
+
+// the UI budget proposed when 'protect the UI' is switched on
+const int DefaultUiBudget = 100000;
+
+BEGIN_MSG_MAP2(CRateLimitDlg)
+    MSG_WM_INITDIALOG(OnInitDialog)
+    COMMAND_ID_HANDLER_EX(IDC_PROTECT_UI, OnProtectUi)
+    COMMAND_ID_HANDLER_EX(IDCANCEL, OnCancel)
+    COMMAND_ID_HANDLER_EX(IDOK, OnOk)
+    REFLECT_NOTIFICATIONS()
+END_MSG_MAP()
+
+CRateLimitDlg::CRateLimitDlg(const RateLimitSettings& settings) :
+    m_settings(settings)
+{
+}
+
+void CRateLimitDlg::OnException() const
+{
+    FUSION_REPORT_EXCEPTION("Unknown Exception");
+}
+
+void CRateLimitDlg::OnException(const std::exception& ex) const
+{
+    FUSION_REPORT_EXCEPTION(ex.what());
+}
+
+BOOL CRateLimitDlg::OnInitDialog(CWindow /*wndFocus*/, LPARAM /*lInitParam*/)
+{
+    SetDlgItemInt(IDC_RATE_DEFAULT, static_cast<UINT>(m_settings.linesPerSecond));
+    SetDlgItemInt(IDC_RATE_BURST, static_cast<UINT>(m_settings.burst));
+    SetDlgItemInt(IDC_RATE_SAMPLE, m_settings.sampleInterval);
+    SetDlgItemText(IDC_RATE_PROCESSES, WStr(FormatProcessLimits(m_settings.processLimits, "\r\n")));
+
+    CButton protectUi(GetDlgItem(IDC_PROTECT_UI));
+    protectUi.SetCheck(static_cast<int>(m_settings.uiBudget != 0));
+    SetDlgItemInt(IDC_UI_BUDGET, static_cast<UINT>(m_settings.uiBudget != 0 ? m_settings.uiBudget : DefaultUiBudget));
+    UpdateUi();
+
+    CenterWindow(GetParent());
+
+    return TRUE;
+}
+
+void CRateLimitDlg::OnProtectUi(UINT /*uNotifyCode*/, int /*nID*/, CWindow /*wndCtl*/)
+{
+    UpdateUi();
+}
+
+void CRateLimitDlg::UpdateUi() const
+{
+    CButton protectUi(GetDlgItem(IDC_PROTECT_UI));
+    GetDlgItem(IDC_UI_BUDGET).EnableWindow(static_cast<BOOL>(protectUi.GetCheck() == BST_CHECKED));
+}
+
+void CRateLimitDlg::OnCancel(UINT /*uNotifyCode*/, int nID, CWindow /*wndCtl*/)
+{
+    EndDialog(nID);
+}
+
+void CRateLimitDlg::OnOk(UINT /*uNotifyCode*/, int nID, CWindow /*wndCtl*/)
+{
+    RateLimitSettings settings;
+    settings.linesPerSecond = GetDlgItemInt(IDC_RATE_DEFAULT);
+    settings.burst = GetDlgItemInt(IDC_RATE_BURST);
+    settings.sampleInterval = GetDlgItemInt(IDC_RATE_SAMPLE);
+    settings.processLimits = ParseProcessLimits(Str(Win32::GetDlgItemText(*this, IDC_RATE_PROCESSES)));
+
+    CButton protectUi(GetDlgItem(IDC_PROTECT_UI));
+    if (protectUi.GetCheck() == BST_CHECKED)
+    {
+        settings.uiBudget = GetDlgItemInt(IDC_UI_BUDGET);
+    }
+    m_settings = settings;
+
+    EndDialog(nID);
+}
+
+RateLimitSettings CRateLimitDlg::GetSettings() const
+{
+    return m_settings;
+}
+
+} // namespace debugviewpp
+} // namespace fusion
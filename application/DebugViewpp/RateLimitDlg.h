@@ -0,0 +1,44 @@
+// (C) Copyright Gert-Jan de Vos and Jan Wilmans 2013.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include "CobaltFusion/AtlWinExt.h"
+#include "DebugViewppLib/RateLimiter.h"
+#include "resource.h"
+
+#include "atleverything.h"
+
+namespace fusion {
+namespace debugviewpp {
+
+class CRateLimitDlg : public CDialogImpl<CRateLimitDlg>,
+                      public ExceptionHandler<CRateLimitDlg, std::exception>
+{
+public:
+    enum
+    {
+        IDD = IDD_RATELIMIT
+    };
+
+    explicit CRateLimitDlg(const RateLimitSettings& settings);
+    RateLimitSettings GetSettings() const;
+
+private:
+    DECLARE_MSG_MAP()
+
+    void OnException() const;
+    void OnException(const std::exception& ex) const;
+    BOOL OnInitDialog(CWindow /*wndFocus*/, LPARAM /*lInitParam*/);
+    void OnProtectUi(UINT /*uNotifyCode*/, int /*nID*/, CWindow /*wndCtl*/);
+    void OnCancel(UINT /*uNotifyCode*/, int nID, CWindow /*wndCtl*/);
+    void OnOk(UINT /*uNotifyCode*/, int nID, CWindow /*wndCtl*/);
+    void UpdateUi() const;
+
+    RateLimitSettings m_settings;
+};
+
+} // namespace debugviewpp
+} // namespace fusion
@@ -0,0 +1,172 @@
+// (C) Copyright Gert-Jan de Vos and Jan Wilmans 2013.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#include <fstream>
+#include <iomanip>
+#include <stdexcept>
+#include <unordered_map>
+#include "CobaltFusion/AtlWinExt.h"
+#include "CobaltFusion/Str.h"
+#include "CobaltFusion/stringbuilder.h"
+#include "CobaltFusion/fusionassert.h"
+#include "DebugViewppLib/LatencyTrace.h"
+#include "StatsDlg.h"
+
+namespace fusion {
+namespace debugviewpp {
+
+namespace {
+
+const UINT_PTR RefreshTimer = 1;
+const unsigned LatencySampling = 64;
+
+std::wstring FormatRate(double rate)
+{
+    return wstringbuilder() << std::fixed << std::setprecision(1) << rate;
+}
+
+} // namespace
+
+BEGIN_MSG_MAP2(CStatsDlg)
+    MSG_WM_INITDIALOG(OnInitDialog)
+    MSG_WM_TIMER(OnTimer)
+    COMMAND_ID_HANDLER_EX(IDC_STATS_SAVE, OnSave)
+    COMMAND_ID_HANDLER_EX(IDC_STATS_LATENCY, OnLatency)
+    COMMAND_ID_HANDLER_EX(IDOK, OnClose)
+    COMMAND_ID_HANDLER_EX(IDCANCEL, OnClose)
+    CHAIN_MSG_MAP(CDialogResize<CStatsDlg>)
+END_MSG_MAP()
+
+CStatsDlg::CStatsDlg(const MetricsHistory& history) :
+    m_history(history)
+{
+}
+
+void CStatsDlg::OnException()
+{
+    FUSION_REPORT_EXCEPTION("Unknown Exception");
+}
+
+void CStatsDlg::OnException(const std::exception& ex)
+{
+    FUSION_REPORT_EXCEPTION(ex.what());
+}
+
+BOOL CStatsDlg::OnInitDialog(CWindow /*wndFocus*/, LPARAM /*lInitParam*/)
+{
+    m_list.Attach(GetDlgItem(IDC_STATS_LIST));
+    m_list.SetExtendedListViewStyle(LVS_EX_FULLROWSELECT | LVS_EX_GRIDLINES);
+    m_list.InsertColumn(0, L"Metric", LVCFMT_LEFT, 220, 0);
+    m_list.InsertColumn(1, L"Value", LVCFMT_RIGHT, 90, 0);
+    m_list.InsertColumn(2, L"Per second", LVCFMT_RIGHT, 80, 0);
+    m_list.InsertColumn(3, L"p50", LVCFMT_RIGHT, 60, 0);
+    m_list.InsertColumn(4, L"p90", LVCFMT_RIGHT, 60, 0);
+    m_list.InsertColumn(5, L"p99", LVCFMT_RIGHT, 60, 0);
+    m_list.InsertColumn(6, L"Max", LVCFMT_RIGHT, 60, 0);
+
+    CButton latency(GetDlgItem(IDC_STATS_LATENCY));
+    latency.SetCheck(GetLatencySampling() != 0 ? BST_CHECKED : BST_UNCHECKED);
+
+    UpdateList();
+    SetTimer(RefreshTimer, 1000);
+
+    CenterWindow(GetParent());
+    DlgResize_Init();
+    return TRUE;
+}
+
+void CStatsDlg::OnTimer(UINT_PTR nIDEvent)
+{
+    if (nIDEvent == RefreshTimer)
+    {
+        UpdateList();
+    }
+}
+
+// counters show their rate since the previous sample, histograms show the number of samples as their value
+void CStatsDlg::UpdateList()
+{
+    auto& snapshots = m_history.GetSnapshots();
+    if (snapshots.empty())
+    {
+        return;
+    }
+
+    auto& last = snapshots.back();
+    std::unordered_map<std::string, int64_t> previous;
+    double interval = 0;
+    if (snapshots.size() > 1)
+    {
+        auto& before = snapshots[snapshots.size() - 2];
+        interval = last.time - before.time;
+        for (auto& value : before.values)
+        {
+            previous[value.name] = value.value;
+        }
+    }
+
+    m_list.SetRedraw(FALSE);
+    m_list.DeleteAllItems();
+    for (auto& value : last.values)
+    {
+        int item = m_list.GetItemCount();
+        m_list.InsertItem(item, WStr(value.name));
+        if (value.type == MetricType::Histogram)
+        {
+            auto& h = value.histogram;
+            m_list.SetItemText(item, 1, std::to_wstring(h.count).c_str());
+            m_list.SetItemText(item, 3, std::to_wstring(h.p50).c_str());
+            m_list.SetItemText(item, 4, std::to_wstring(h.p90).c_str());
+            m_list.SetItemText(item, 5, std::to_wstring(h.p99).c_str());
+            m_list.SetItemText(item, 6, std::to_wstring(h.max).c_str());
+            continue;
+        }
+
+        m_list.SetItemText(item, 1, std::to_wstring(value.value).c_str());
+        auto it = previous.find(value.name);
+        if (value.type == MetricType::Counter && interval > 0 && it != previous.end())
+        {
+            m_list.SetItemText(item, 2, FormatRate((value.value - it->second) / interval).c_str());
+        }
+    }
+    m_list.SetRedraw(TRUE);
+}
+
+void CStatsDlg::OnSave(UINT /*uNotifyCode*/, int /*nID*/, CWindow /*wndCtl*/)
+{
+    CFileDialog dlg(0, L".json", L"DebugView++Stats.json", OFN_OVERWRITEPROMPT,
+        L"JSON Files (*.json)\0*.json\0"
+        L"All Files (*.*)\0*.*\0\0",
+        nullptr);
+    dlg.m_ofn.nFilterIndex = 0;
+    dlg.m_ofn.lpstrTitle = L"Save statistics time series";
+    if (dlg.DoModal() != IDOK)
+    {
+        return;
+    }
+
+    std::ofstream file(dlg.m_szFileName);
+    file << ToJson(m_history) << "\n";
+    if (!file)
+    {
+        throw std::runtime_error("unable to write '" + Str(dlg.m_szFileName).str() + "'");
+    }
+}
+
+// the latency.<stage>.us histograms fill up while tracing is on, see LatencyTrace.h
+void CStatsDlg::OnLatency(UINT /*uNotifyCode*/, int /*nID*/, CWindow /*wndCtl*/)
+{
+    CButton latency(GetDlgItem(IDC_STATS_LATENCY));
+    SetLatencySampling(latency.GetCheck() == BST_CHECKED ? LatencySampling : 0);
+}
+
+void CStatsDlg::OnClose(UINT /*uNotifyCode*/, int nID, CWindow /*wndCtl*/)
+{
+    KillTimer(RefreshTimer);
+    EndDialog(nID);
+}
+
+} // namespace debugviewpp
+} // namespace fusion
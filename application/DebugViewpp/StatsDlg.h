@@ -0,0 +1,54 @@
+// (C) Copyright Gert-Jan de Vos and Jan Wilmans 2013.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include "CobaltFusion/AtlWinExt.h"
+#include "DebugViewppLib/Metrics.h"
+#include "resource.h"
+
+#include "atleverything.h"
+
+namespace fusion {
+namespace debugviewpp {
+
+// shows the latest sample of the metrics registry, refreshed every second while the MainFrame keeps sampling
+class CStatsDlg : public CDialogImpl<CStatsDlg>,
+                  public CDialogResize<CStatsDlg>,
+                  public ExceptionHandler<CStatsDlg, std::exception>
+{
+public:
+    explicit CStatsDlg(const MetricsHistory& history);
+
+    enum
+    {
+        IDD = IDD_STATS
+    };
+
+    BEGIN_DLGRESIZE_MAP(CStatsDlg)
+        DLGRESIZE_CONTROL(IDC_STATS_LIST, DLSZ_SIZE_X | DLSZ_SIZE_Y)
+        DLGRESIZE_CONTROL(IDC_STATS_SAVE, DLSZ_MOVE_Y)
+        DLGRESIZE_CONTROL(IDC_STATS_LATENCY, DLSZ_MOVE_Y)
+        DLGRESIZE_CONTROL(IDOK, DLSZ_MOVE_X | DLSZ_MOVE_Y)
+    END_DLGRESIZE_MAP()
+
+private:
+    DECLARE_MSG_MAP()
+
+    void OnException();
+    void OnException(const std::exception& ex);
+    BOOL OnInitDialog(CWindow wndFocus, LPARAM lInitParam);
+    void OnTimer(UINT_PTR nIDEvent);
+    void OnSave(UINT uNotifyCode, int nID, CWindow wndCtl);
+    void OnLatency(UINT uNotifyCode, int nID, CWindow wndCtl);
+    void OnClose(UINT uNotifyCode, int nID, CWindow wndCtl);
+    void UpdateList();
+
+    const MetricsHistory& m_history;
+    CListViewCtrl m_list;
+};
+
+} // namespace debugviewpp
+} // namespace fusion
@@ -25,6 +25,7 @@
 #define IDR_VIEW_CONTEXTMENU 203
 #define IDR_PROCESS_CONTEXTMENU 204
 #define IDR_HIGHLIGHT_CONTEXTMENU 205
+#define IDR_TEMPLATE_CONTEXTMENU 209
 #define IDC_NAME 206
 #define IDD_TASKFILTER_PAGE 207
 #define IDD_FILTER_PAGE 208
@@ -57,6 +58,21 @@
 #define IDC_TYPE 315
 #define IDC_PORT 316
 #define IDD_RENAMEPROCESS 317
+#define IDD_STATS 318
+#define IDC_STATS_LIST 319
+#define IDC_STATS_SAVE 320
+#define IDC_STATS_LATENCY 321
+#define IDD_RATELIMIT 322
+#define IDC_RATE_DEFAULT 323
+#define IDC_RATE_BURST 324
+#define IDC_RATE_SAMPLE 325
+#define IDC_RATE_PROCESSES 326
+#define IDC_PROTECT_UI 327
+#define IDC_UI_BUDGET 328
+#define IDD_GOTOTIME 329
+#define IDC_GOTO_DATE 330
+#define IDC_GOTO_TIME 331
+#define IDC_MEMORY_LIMIT 332
 #define IDC_DATE 1010
 #define IDC_VERSION 1011
 #define ID_FILE_NEWVIEW 32777
@@ -107,7 +123,8 @@
 #define ID_VIEW_COLUMN_PID 32830
 #define ID_VIEW_COLUMN_PROCESS 32831
 #define ID_VIEW_COLUMN_LOG 32832
-#define ID_VIEW_COLUMN_LAST 32832
+#define ID_VIEW_COLUMN_TEMPLATE 32833
+#define ID_VIEW_COLUMN_LAST 32833
 #define ID_OPTIONS_LINKVIEWS 32840
 #define ID_OPTIONS_AUTONEWLINE 32841
 #define ID_OPTIONS_FONT 32842
@@ -129,6 +146,19 @@
 #define ID_LOG_KERNEL 32860
 #define ID_LOG_KERNEL_VERBOSE 32861
 #define ID_LOG_KERNEL_PASSTHROUGH 32862
+#define ID_LOG_STATISTICS 32863
+#define ID_LOG_RING 32864
+#define ID_LOG_RATELIMIT 32865
+#define ID_VIEW_COLLAPSE_REPEATS 32866
+#define ID_VIEW_EXPAND_REPEATS 32867
+#define ID_VIEW_TEMPLATE_ONLY 32868
+#define ID_VIEW_TEMPLATE_HIDE 32869
+#define ID_VIEW_TEMPLATE_ALL 32870
+#define ID_VIEW_GOTO_TIME 32871
+#define ID_VIEW_TIME_RANGE 32872
+#define ID_VIEW_TIME_RANGE_ALL 32873
+#define ID_FILE_OPEN_SNAPSHOT 32874
+#define ID_FILE_SAVE_SNAPSHOT 32875
 
 
 // Next default values for new objects
@@ -136,7 +166,7 @@
 #ifdef APSTUDIO_INVOKED
 #ifndef APSTUDIO_READONLY_SYMBOLS
 #define _APS_NEXT_RESOURCE_VALUE 401
-#define _APS_NEXT_COMMAND_VALUE 32863
+#define _APS_NEXT_COMMAND_VALUE 32876
 #define _APS_NEXT_CONTROL_VALUE 801
 #define _APS_NEXT_SYMED_VALUE 107
 #endif
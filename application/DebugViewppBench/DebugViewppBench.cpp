@@ -0,0 +1,492 @@
+// (C) Copyright Gert-Jan de Vos and Jan Wilmans 2013.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+// Microbenchmarks of the ingest, storage, filter and parse hot paths.
+// Every corpus is generated from a fixed seed, so runs on the same machine are comparable.
+// usage: DebugViewppBench [name-filter]
+//        DebugViewppBench --record <trace>           write the corpus as a trace
+//        DebugViewppBench --replay <trace> [speed]   end-to-end throughput of a trace, speed 0 (default) replays as fast as possible
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include <nanobench.h>
+#include "windows.h"
+#include <psapi.h>
+#include "CobaltFusion/CircularBuffer.h"
+#include "CobaltFusion/Executor.h"
+#include "CobaltFusion/ExecutorClient.h"
+#include "CobaltFusion/Str.h"
+#include "CobaltFusion/stringbuilder.h"
+#include "DebugViewppLib/Conversions.h"
+#include "DebugViewppLib/FileIO.h"
+#include "DebugViewppLib/Filter.h"
+#include "DebugViewppLib/Line.h"
+#include "DebugViewppLib/LogFile.h"
+#include "DebugViewppLib/LogSources.h"
+#include "DebugViewppLib/NewlineFilter.h"
+#include "DebugViewppLib/ReplaySource.h"
+#include "DebugViewppLib/TestSource.h"
+#include "DebugViewppLib/Trace.h"
+#include "DebugViewppLib/VectorLineBuffer.h"
+#include "IndexedStorageLib/IndexedStorage.h"
+
+#pragma comment(lib, "psapi.lib")
+
+namespace fusion {
+namespace debugviewpp {
+
+const unsigned Seed = 20130101;
+const size_t CorpusSize = 100000;
+
+// messages that look like real OutputDebugString traffic: a handful of processes, skewed message lengths and some repetition
+struct Corpus
+{
+    std::vector<std::string> messages;
+    std::vector<std::string> processNames;
+    std::vector<DWORD> pids;
+    std::vector<FILETIME> systemTimes;
+};
+
+Corpus CreateCorpus(size_t size, unsigned seed = Seed)
+{
+    static const char* words[] = {"error", "warning", "info", "connect", "socket", "timeout", "frame", "render", "update", "buffer", "thread", "queue",
+        "retry", "open", "close", "read", "write", "flush", "cache", "miss", "hit", "request", "response", "latency"};
+    static const char* processes[] = {"explorer.exe", "chrome.exe", "devenv.exe", "MsMpEng.exe", "svchost.exe", "game.exe", "renderer.exe", "service.exe"};
+
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<size_t> word(0, std::size(words) - 1);
+    std::uniform_int_distribution<size_t> process(0, std::size(processes) - 1);
+    std::geometric_distribution<size_t> length(0.08);
+    std::uniform_int_distribution<int> number(0, 99999);
+
+    Corpus corpus;
+    auto ft = Win32::GetSystemTimeAsFileTime();
+    for (size_t i = 0; i < size; ++i)
+    {
+        std::string message;
+        auto count = 1 + length(rng);
+        for (size_t w = 0; w < count; ++w)
+        {
+            message += words[word(rng)];
+            message += ' ';
+            if (w % 4 == 3)
+            {
+                message += std::to_string(number(rng)) + ' ';
+            }
+        }
+        corpus.messages.push_back(message);
+        auto p = process(rng);
+        corpus.processNames.push_back(processes[p]);
+        corpus.pids.push_back(static_cast<DWORD>(1000 + 4 * p));
+        corpus.systemTimes.push_back(ft);
+        auto ticks = FileTimeToUInt64(ft) + 10000; // 1 ms
+        ft.dwLowDateTime = static_cast<DWORD>(ticks);
+        ft.dwHighDateTime = static_cast<DWORD>(ticks >> 32);
+    }
+    return corpus;
+}
+
+// roughly what a user has configured when hunting a problem
+LogFilter CreateFilters()
+{
+    LogFilter filter;
+    filter.processFilters.push_back(Filter("svchost.exe", MatchType::Simple, FilterType::Exclude));
+    filter.processFilters.push_back(Filter("MsMpEng", MatchType::Simple, FilterType::Exclude));
+    filter.messageFilters.push_back(Filter("error", MatchType::Simple, FilterType::Include));
+    filter.messageFilters.push_back(Filter("warn*", MatchType::Wildcard, FilterType::Include));
+    filter.messageFilters.push_back(Filter("timeout [0-9]+", MatchType::Regex, FilterType::Include));
+    filter.messageFilters.push_back(Filter("cache (hit|miss)", MatchType::Regex, FilterType::Exclude));
+    filter.messageFilters.push_back(Filter("latency", MatchType::Simple, FilterType::Highlight));
+    return filter;
+}
+
+class Benchmarks
+{
+public:
+    explicit Benchmarks(std::string nameFilter) :
+        m_nameFilter(std::move(nameFilter))
+    {
+    }
+
+    void Run(const std::string& name, size_t batch, const std::function<void()>& fn)
+    {
+        if (!m_nameFilter.empty() && name.find(m_nameFilter) == std::string::npos)
+        {
+            return;
+        }
+        ankerl::nanobench::Bench().title("DebugView++").unit("item").batch(batch).epochs(5).warmup(1).run(name, fn);
+    }
+
+private:
+    std::string m_nameFilter;
+};
+
+void StorageBenchmarks(Benchmarks& bench, const Corpus& corpus)
+{
+    std::mt19937 rng(Seed);
+    std::vector<size_t> indices(CorpusSize);
+    std::uniform_int_distribution<size_t> index(0, CorpusSize - 1);
+    for (auto& i : indices)
+    {
+        i = index(rng);
+    }
+
+    bench.Run("VectorStorage::Add", CorpusSize, [&] {
+        indexedstorage::VectorStorage storage;
+        for (auto& message : corpus.messages)
+        {
+            storage.Add(message);
+        }
+        ankerl::nanobench::doNotOptimizeAway(storage.Count());
+    });
+
+    bench.Run("SnappyStorage::Add", CorpusSize, [&] {
+        indexedstorage::SnappyStorage storage;
+        for (auto& message : corpus.messages)
+        {
+            storage.Add(message);
+        }
+        ankerl::nanobench::doNotOptimizeAway(storage.Count());
+    });
+
+    indexedstorage::VectorStorage vectorStorage;
+    indexedstorage::SnappyStorage snappyStorage;
+    for (auto& message : corpus.messages)
+    {
+        vectorStorage.Add(message);
+        snappyStorage.Add(message);
+    }
+
+    bench.Run("VectorStorage::operator[] random", CorpusSize, [&] {
+        size_t size = 0;
+        for (auto i : indices)
+        {
+            size += vectorStorage[i].size();
+        }
+        ankerl::nanobench::doNotOptimizeAway(size);
+    });
+
+    bench.Run("SnappyStorage::operator[] random", CorpusSize, [&] {
+        size_t size = 0;
+        for (auto i : indices)
+        {
+            size += snappyStorage[i].size();
+        }
+        ankerl::nanobench::doNotOptimizeAway(size);
+    });
+
+    bench.Run("SnappyStorage::operator[] sequential", CorpusSize, [&] {
+        size_t size = 0;
+        for (size_t i = 0; i < CorpusSize; ++i)
+        {
+            size += snappyStorage[i].size();
+        }
+        ankerl::nanobench::doNotOptimizeAway(size);
+    });
+
+    bench.Run("LogFile::Add", CorpusSize, [&] {
+        LogFile logfile;
+        for (size_t i = 0; i < CorpusSize; ++i)
+        {
+            logfile.Add(Message(i * 0.001, corpus.systemTimes[i], corpus.pids[i], corpus.processNames[i], corpus.messages[i]));
+        }
+        ankerl::nanobench::doNotOptimizeAway(logfile.Count());
+    });
+
+    LogFile logfile;
+    for (size_t i = 0; i < CorpusSize; ++i)
+    {
+        logfile.Add(Message(i * 0.001, corpus.systemTimes[i], corpus.pids[i], corpus.processNames[i], corpus.messages[i]));
+    }
+    bench.Run("LogFile::operator[] random", CorpusSize, [&] {
+        size_t size = 0;
+        for (auto i : indices)
+        {
+            size += logfile[static_cast<int>(i)].text.size();
+        }
+        ankerl::nanobench::doNotOptimizeAway(size);
+    });
+}
+
+void FilterBenchmarks(Benchmarks& bench, const Corpus& corpus)
+{
+    auto filter = CreateFilters();
+    bench.Run("IsIncluded", CorpusSize, [&] {
+        MatchColors matchColors;
+        size_t included = 0;
+        for (size_t i = 0; i < CorpusSize; ++i)
+        {
+            if (IsIncluded(filter.processFilters, corpus.processNames[i], matchColors) && IsIncluded(filter.messageFilters, corpus.messages[i], matchColors))
+            {
+                ++included;
+            }
+        }
+        ankerl::nanobench::doNotOptimizeAway(included);
+    });
+}
+
+void IngestBenchmarks(Benchmarks& bench, const Corpus& corpus)
+{
+    Timer timer;
+    VectorLineBuffer buffer(0);
+    TestSource source(timer, buffer);
+    source.SetAutoNewLine(false);
+
+    // messages arrive in fragments, like a process that writes a line with several OutputDebugString calls
+    Lines fragments;
+    for (size_t i = 0; i < CorpusSize; ++i)
+    {
+        auto& message = corpus.messages[i];
+        auto split = message.size() / 2;
+        fragments.emplace_back(0.0, corpus.systemTimes[i], corpus.pids[i], corpus.processNames[i], message.substr(0, split), &source);
+        fragments.emplace_back(0.0, corpus.systemTimes[i], corpus.pids[i], corpus.processNames[i], message.substr(split) + "\n", &source);
+    }
+
+    bench.Run("NewlineFilter::Process", CorpusSize, [&] {
+        NewlineFilter newlineFilter;
+        size_t count = 0;
+        for (auto& fragment : fragments)
+        {
+            count += newlineFilter.Process(fragment).size();
+        }
+        ankerl::nanobench::doNotOptimizeAway(count);
+    });
+
+    const size_t producers = 4;
+    bench.Run("VectorLineBuffer 4 producers 1 consumer", CorpusSize, [&] {
+        VectorLineBuffer lineBuffer(0);
+        std::atomic<size_t> done(0);
+        std::vector<std::thread> threads;
+        for (size_t p = 0; p < producers; ++p)
+        {
+            threads.emplace_back([&, p] {
+                for (size_t i = p; i < CorpusSize; i += producers)
+                {
+                    lineBuffer.Add(0.0, corpus.systemTimes[i], corpus.pids[i], corpus.processNames[i], corpus.messages[i], nullptr);
+                }
+                ++done;
+            });
+        }
+        size_t count = 0;
+        while (count < CorpusSize)
+        {
+            count += lineBuffer.GetLines().size();
+            if (done == producers)
+            {
+                count += lineBuffer.GetLines().size();
+                break;
+            }
+        }
+        for (auto& thread : threads)
+        {
+            thread.join();
+        }
+        ankerl::nanobench::doNotOptimizeAway(count);
+    });
+
+    bench.Run("CircularBuffer WriteStringZ/ReadStringZ", CorpusSize, [&] {
+        CircularBuffer circularBuffer(64 * 1024);
+        size_t size = 0;
+        for (auto& message : corpus.messages)
+        {
+            if (circularBuffer.Available() <= message.size() + 1)
+            {
+                while (!circularBuffer.Empty())
+                {
+                    size += circularBuffer.ReadStringZ().size();
+                }
+            }
+            circularBuffer.WriteStringZ(message.c_str());
+        }
+        ankerl::nanobench::doNotOptimizeAway(size);
+    });
+
+    const size_t calls = 10000;
+    bench.Run("ActiveExecutor::CallAsync", calls, [&] {
+        ActiveExecutor executor;
+        size_t count = 0;
+        for (size_t i = 0; i < calls; ++i)
+        {
+            executor.CallAsync([&count] { ++count; });
+        }
+        executor.Call([] {});
+        ankerl::nanobench::doNotOptimizeAway(count);
+    });
+
+    ActiveExecutor executor;
+    bench.Run("ActiveExecutor::Call round trip", calls, [&] {
+        size_t count = 0;
+        for (size_t i = 0; i < calls; ++i)
+        {
+            executor.Call([&count] { ++count; });
+        }
+        ankerl::nanobench::doNotOptimizeAway(count);
+    });
+}
+
+void ParseBenchmarks(Benchmarks& bench, const Corpus& corpus)
+{
+    std::vector<std::string> dblogLines;
+    std::vector<std::string> sysinternalsLines;
+    for (size_t i = 0; i < CorpusSize; ++i)
+    {
+        dblogLines.push_back(stringbuilder() << GetTimeText(i * 0.001) << "\t" << GetDateTimeText(corpus.systemTimes[i]) << "\t" << corpus.pids[i] << "\t" << corpus.processNames[i] << "\t" << corpus.messages[i]);
+        sysinternalsLines.push_back(stringbuilder() << i << "\t" << GetTimeText(corpus.systemTimes[i]) << "\t[" << corpus.pids[i] << "] " << corpus.messages[i]);
+    }
+
+    bench.Run("ReadLogFileMessage", CorpusSize, [&] {
+        size_t size = 0;
+        for (auto& data : dblogLines)
+        {
+            Line line;
+            ReadLogFileMessage(data, line);
+            size += line.message.size();
+        }
+        ankerl::nanobench::doNotOptimizeAway(size);
+    });
+
+    bench.Run("ReadSysInternalsLogFileMessage", CorpusSize, [&] {
+        USTimeConverter converter;
+        size_t size = 0;
+        for (auto& data : sysinternalsLines)
+        {
+            Line line;
+            ReadSysInternalsLogFileMessage(data, line, converter);
+            size += line.message.size();
+        }
+        ankerl::nanobench::doNotOptimizeAway(size);
+    });
+}
+
+// the corpus as a trace with bursts of 100 lines every 10ms
+void RecordCorpus(const std::wstring& filename)
+{
+    auto corpus = CreateCorpus(CorpusSize);
+    TraceWriter writer(filename);
+    TraceRecord record;
+    record.source = "DebugViewppBench";
+    for (size_t i = 0; i < CorpusSize; ++i)
+    {
+        record.time = (i / 100) * 0.01 + (i % 100) * 0.000001;
+        record.systemTime = corpus.systemTimes[i];
+        record.pid = corpus.pids[i];
+        record.processName = corpus.processNames[i];
+        record.message = corpus.messages[i] + "\n";
+        writer.Write(record);
+    }
+    std::cout << writer.GetCount() << " lines written to " << Str(filename).str() << "\n";
+}
+
+double Percentile(const std::vector<double>& sorted, double fraction)
+{
+    if (sorted.empty())
+    {
+        return 0.0;
+    }
+    return sorted[std::min(sorted.size() - 1, static_cast<size_t>(fraction * sorted.size()))];
+}
+
+// replays a trace through the same path as the UI: LogSources::GetLines() on every update, LogFile and filtering.
+// the drain latency of a line is the time from its hand-over by the ReplaySource until it is stored and filtered.
+void ReplayTrace(const std::wstring& filename, double speed)
+{
+    auto updateEvent = Win32::CreateEvent(nullptr, false, false, nullptr);
+    ActiveExecutorClient executor;
+    LogSources logsources(executor);
+    ReplaySource* pSource = nullptr;
+    executor.Call([&] {
+        pSource = logsources.AddReplaySource(filename, speed);
+        logsources.SubscribeToUpdate([&updateEvent] {
+            Win32::SetEvent(updateEvent);
+            return true;
+        });
+    });
+
+    LogFile logfile;
+    auto filter = CreateFilters();
+    MatchColors matchColors;
+    size_t included = 0;
+    std::vector<double> latencies;
+    auto start = std::chrono::steady_clock::now();
+    for (;;)
+    {
+        Win32::WaitForSingleObject(updateEvent.get(), 100);
+        bool finished = pSource->IsFinished();
+
+        Lines lines;
+        executor.Call([&] {
+            lines = logsources.GetLines();
+        });
+        for (auto& line : lines)
+        {
+            logfile.Add(Message(line.time, line.systemTime, line.pid, line.processName, line.message));
+            if (IsIncluded(filter.processFilters, line.processName, matchColors) && IsIncluded(filter.messageFilters, line.message, matchColors))
+            {
+                ++included;
+            }
+        }
+
+        auto now = pSource->GetTimeSinceOrigin(GetTicks());
+        for (auto& line : lines)
+        {
+            latencies.push_back(now - line.time);
+        }
+        if (finished)
+        {
+            break;
+        }
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    PROCESS_MEMORY_COUNTERS memoryCounters = PROCESS_MEMORY_COUNTERS();
+    GetProcessMemoryInfo(GetCurrentProcess(), &memoryCounters, sizeof(memoryCounters));
+
+    std::sort(latencies.begin(), latencies.end());
+    std::cout << "replayed:        " << pSource->GetCount() << " messages, " << logfile.Count() << " lines, " << included << " lines included by the filters\n";
+    std::cout << "elapsed:         " << elapsed.count() << " s\n";
+    std::cout << "throughput:      " << static_cast<size_t>(logfile.Count() / elapsed.count()) << " lines/s\n";
+    std::cout << "drain latency:   p50 " << Percentile(latencies, 0.5) * 1000 << " ms, p90 " << Percentile(latencies, 0.9) * 1000 << " ms, p99 " << Percentile(latencies, 0.99) * 1000 << " ms, max " << Percentile(latencies, 1.0) * 1000 << " ms\n";
+    std::cout << "peak memory:     " << memoryCounters.PeakWorkingSetSize / (1024 * 1024) << " MB working set, " << memoryCounters.PeakPagefileUsage / (1024 * 1024) << " MB committed\n";
+}
+
+} // namespace debugviewpp
+} // namespace fusion
+
+int main(int argc, char* argv[])
+try
+{
+    using namespace fusion::debugviewpp;
+
+    if (argc > 2 && argv[1] == std::string("--record"))
+    {
+        RecordCorpus(fusion::WStr(argv[2]));
+        return 0;
+    }
+    if (argc > 2 && argv[1] == std::string("--replay"))
+    {
+        ReplayTrace(fusion::WStr(argv[2]), argc > 3 ? std::stod(argv[3]) : 0.0);
+        return 0;
+    }
+
+    Benchmarks bench(argc > 1 ? argv[1] : "");
+    auto corpus = CreateCorpus(CorpusSize);
+    StorageBenchmarks(bench, corpus);
+    FilterBenchmarks(bench, corpus);
+    IngestBenchmarks(bench, corpus);
+    ParseBenchmarks(bench, corpus);
+    return 0;
+}
+catch (std::exception& e)
+{
+    std::cerr << "Unexpected error occurred: " << e.what() << std::endl;
+    return 1;
+}
@@ -20,19 +20,6 @@ AnyFileReader::AnyFileReader(Timer& timer, ILineBuffer& linebuffer, FileType::ty
 {
 }
 
-uint64_t FileTimeToUInt64(const FILETIME& ft)
-{
-    ULARGE_INTEGER value;
-    value.LowPart = ft.dwLowDateTime;
-    value.HighPart = ft.dwHighDateTime;
-    return value.QuadPart;
-}
-
-double GetDifference(FILETIME ft1, FILETIME ft2)
-{
-    return (FileTimeToUInt64(ft2) - FileTimeToUInt64(ft1)) * 100e-9;
-}
-
 // used to create a relative time from the systemtime when only systemtime is stored in Sysinternals DbgView files.
 // the reverse (creating system-time from relative times) makes no sense.
 void AnyFileReader::GetRelativeTime(Line& line)
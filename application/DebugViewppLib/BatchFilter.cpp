@@ -0,0 +1,300 @@
+// (C) Copyright Gert-Jan de Vos and Jan Wilmans 2013.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <thread>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include "CobaltFusion/scope_guard.h"
+#include "CobaltFusion/Str.h"
+#include "DebugViewppLib/BatchFilter.h"
+#include "DebugViewppLib/Conversions.h"
+
+namespace fusion {
+namespace debugviewpp {
+
+struct BatchFilter::File
+{
+    std::wstring filename;
+    std::string filenameOnly;
+    FileType::type fileType;
+    boost::interprocess::file_mapping mapping;
+    boost::interprocess::mapped_region region;
+};
+
+struct BatchFilter::Chunk
+{
+    File* pFile;
+    const char* begin;
+    const char* end;
+    bool first;
+    bool last;
+    bool done;
+    Lines lines;
+    std::string error;
+};
+
+namespace {
+
+bool HasOnceFilter(const std::vector<Filter>& filters)
+{
+    return std::any_of(filters.begin(), filters.end(), [](const Filter& filter) { return filter.enable && filter.filterType == FilterType::Once; });
+}
+
+} // namespace
+
+BatchFilter::BatchFilter(const LogFilter& filter, size_t threadCount) :
+    m_filter(filter),
+    m_threadCount(threadCount != 0 ? threadCount : std::max<size_t>(std::thread::hardware_concurrency(), 1))
+{
+    if (HasOnceFilter(m_filter.messageFilters) || HasOnceFilter(m_filter.processFilters))
+    {
+        m_threadCount = 1;
+    }
+
+    // bounds the number of chunks that are parsed ahead of the output
+    m_window = 2 * m_threadCount + 2;
+}
+
+BatchFilter::~BatchFilter() = default;
+
+size_t BatchFilter::GetThreadCount() const
+{
+    return m_threadCount;
+}
+
+void BatchFilter::Run(const std::vector<std::wstring>& filenames, const Output& output, const Error& error)
+{
+    m_pFilenames = &filenames;
+    m_files.clear();
+    m_chunks.clear();
+    m_next = 0;
+    m_output = 0;
+    m_end = false;
+
+    std::vector<std::thread> threads;
+    auto guard = make_guard([this, &threads] {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_end = true;
+        }
+        m_cv.notify_all();
+        for (auto& thread : threads)
+        {
+            thread.join();
+        }
+        m_chunks.clear();
+        m_files.clear();
+    });
+
+    for (size_t i = 0; i < m_threadCount; ++i)
+    {
+        threads.emplace_back([this] { Work(); });
+    }
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (;;)
+    {
+        m_cv.wait(lock, [this] { return m_output < m_chunks.size() ? m_chunks[m_output].done : m_files.size() == m_pFilenames->size(); });
+        if (m_output == m_chunks.size())
+        {
+            break;
+        }
+
+        auto& chunk = m_chunks[m_output];
+        auto lines = std::move(chunk.lines);
+        lock.unlock();
+        if (!chunk.error.empty())
+        {
+            error(chunk.pFile->filename, chunk.error);
+        }
+        for (auto& line : lines)
+        {
+            output(line);
+        }
+        lines.clear();
+        lock.lock();
+
+        if (chunk.last)
+        {
+            // unmap files as soon as they are done, many large logs do not fit the address space of a 32-bit process
+            chunk.pFile->region = boost::interprocess::mapped_region();
+            chunk.pFile->mapping = boost::interprocess::file_mapping();
+        }
+        ++m_output;
+        m_cv.notify_all();
+    }
+}
+
+void BatchFilter::Work()
+{
+    // IsIncluded() updates the state of FilterType::Once filters, so every thread uses its own copy
+    auto filter = m_filter;
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (;;)
+    {
+        m_cv.wait(lock, [this] { return m_end || m_next < m_output + m_window; });
+        if (m_end)
+        {
+            return;
+        }
+        while (m_next == m_chunks.size() && m_files.size() < m_pFilenames->size())
+        {
+            MapNextFile();
+        }
+        if (m_next == m_chunks.size())
+        {
+            m_cv.notify_all();
+            return;
+        }
+
+        auto& chunk = m_chunks[m_next++];
+        if (chunk.done)
+        {
+            m_cv.notify_all();
+            continue;
+        }
+        lock.unlock();
+        auto lines = Parse(chunk, filter);
+        lock.lock();
+        chunk.lines = std::move(lines);
+        chunk.done = true;
+        m_cv.notify_all();
+    }
+}
+
+// must be called with m_mutex locked, adds the chunks of the next file or a chunk that reports why it cannot be read
+void BatchFilter::MapNextFile()
+{
+    m_files.emplace_back(std::make_unique<File>());
+    auto& file = *m_files.back();
+    file.filename = (*m_pFilenames)[m_files.size() - 1];
+    file.filenameOnly = Str(std::filesystem::path(file.filename).filename().wstring()).str();
+    file.fileType = IdentifyFile(file.filename);
+
+    auto fail = [this, &file](const std::string& message) {
+        m_chunks.push_back(Chunk{&file, nullptr, nullptr, true, true, true, Lines(), message});
+    };
+
+    size_t skip = 0;
+    switch (file.fileType)
+    {
+    case FileType::Unknown:
+    {
+        std::error_code ec;
+        if (!std::filesystem::exists(file.filename, ec))
+        {
+            fail("unable to open file");
+        }
+        return; // an existing but empty file
+    }
+    case FileType::UTF16BE:
+    case FileType::UTF16LE:
+        fail("UTF-16 encoded files are not supported in batch mode");
+        return;
+    case FileType::UTF8:
+        skip = 3; // byte order mark
+        break;
+    default:
+        break;
+    }
+
+    try
+    {
+        if (std::filesystem::file_size(file.filename) <= skip)
+        {
+            return;
+        }
+        file.mapping = boost::interprocess::file_mapping(std::filesystem::path(file.filename).c_str(), boost::interprocess::read_only);
+        file.region = boost::interprocess::mapped_region(file.mapping, boost::interprocess::read_only);
+    }
+    catch (std::exception& e)
+    {
+        fail(e.what());
+        return;
+    }
+
+    auto begin = static_cast<const char*>(file.region.get_address()) + skip;
+    auto end = static_cast<const char*>(file.region.get_address()) + file.region.get_size();
+
+    // the day rollover of Sysinternals timestamps and the relative time are derived from the preceding lines
+    auto chunkSize = file.fileType == FileType::Sysinternals ? file.region.get_size() : ChunkSize;
+    bool first = true;
+    while (begin != end)
+    {
+        auto next = end;
+        if (static_cast<size_t>(end - begin) > chunkSize)
+        {
+            auto p = static_cast<const char*>(std::memchr(begin + chunkSize, '\n', end - begin - chunkSize));
+            next = p == nullptr ? end : p + 1;
+        }
+        m_chunks.push_back(Chunk{&file, begin, next, first, next == end, false, Lines(), std::string()});
+        first = false;
+        begin = next;
+    }
+}
+
+// the same line parsing as AnyFileReader and FileReader
+Lines BatchFilter::Parse(const Chunk& chunk, LogFilter& filter) const
+{
+    Lines lines;
+    MatchColors matchColors; // not used, but IsIncluded() collects them
+    USTimeConverter converter;
+    FILETIME firstFiletime = FILETIME();
+    long linenumber = 0;
+    std::string data;
+    auto& file = *chunk.pFile;
+    for (auto p = chunk.begin; p != chunk.end;)
+    {
+        auto newline = static_cast<const char*>(std::memchr(p, '\n', chunk.end - p));
+        auto lineEnd = newline == nullptr ? chunk.end : newline;
+        data.assign(p, lineEnd);
+        p = newline == nullptr ? chunk.end : newline + 1;
+        if (!data.empty() && data.back() == '\r')
+        {
+            data.pop_back();
+        }
+        ++linenumber;
+
+        Line line;
+        switch (file.fileType)
+        {
+        case FileType::Sysinternals:
+            ReadSysInternalsLogFileMessage(data, line, converter);
+            if (linenumber == 1)
+            {
+                firstFiletime = line.systemTime;
+            }
+            else if (line.time == 0.0)
+            {
+                line.time = GetDifference(firstFiletime, line.systemTime);
+            }
+            break;
+        case FileType::DebugViewPP1:
+        case FileType::DebugViewPP2:
+            if (chunk.first && linenumber == 1) // ignore the header line
+            {
+                continue;
+            }
+            ReadLogFileMessage(data, line);
+            break;
+        default:
+            line.processName = file.filenameOnly;
+            line.message = data;
+            break;
+        }
+
+        if (IsIncluded(filter.processFilters, line.processName, matchColors) && IsIncluded(filter.messageFilters, line.message, matchColors))
+        {
+            lines.push_back(std::move(line));
+        }
+    }
+    return lines;
+}
+
+} // namespace debugviewpp
+} // namespace fusion
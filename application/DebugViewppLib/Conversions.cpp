@@ -56,6 +56,55 @@ std::string GetTimeText(const FILETIME& ft)
     return GetTimeText(Win32::FileTimeToSystemTime(Win32::FileTimeToLocalFileTime(ft)));
 }
 
+uint64_t FileTimeToUInt64(const FILETIME& ft)
+{
+    ULARGE_INTEGER value;
+    value.LowPart = ft.dwLowDateTime;
+    value.HighPart = ft.dwHighDateTime;
+    return value.QuadPart;
+}
+
+bool ReadTimeOfDay(const std::string& text, SYSTEMTIME& st)
+{
+    std::istringstream is(text);
+    WORD h = 0;
+    WORD m = 0;
+    WORD s = 0;
+    char c = 0;
+    is >> h >> c >> m;
+    if (!is || c != ':' || h > 23 || m > 59)
+    {
+        return false;
+    }
+
+    // the fraction is read as digits, so ".5" is 500 ms and digits beyond the milliseconds are ignored
+    std::string fraction;
+    if (is >> c)
+    {
+        if (c != ':' || !(is >> s) || s > 59)
+        {
+            return false;
+        }
+        if (is >> c && (c != '.' || !(is >> fraction) || fraction.find_first_not_of("0123456789") != std::string::npos))
+        {
+            return false;
+        }
+    }
+    fraction.resize(3, '0');
+
+    st.wHour = h;
+    st.wMinute = m;
+    st.wSecond = s;
+    st.wMilliseconds = static_cast<WORD>(std::stoi(fraction.substr(0, 3)));
+    return true;
+}
+
+double GetDifference(FILETIME ft1, FILETIME ft2)
+{
+    // signed, a line can be earlier than the one the relative time counts from
+    return static_cast<double>(static_cast<int64_t>(FileTimeToUInt64(ft2) - FileTimeToUInt64(ft1))) * 100e-9;
+}
+
 SYSTEMTIME GetSystemTime(WORD year, WORD month, WORD day)
 {
     SYSTEMTIME st = {};
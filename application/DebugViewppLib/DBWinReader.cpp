@@ -6,6 +6,7 @@
 #include "DebugViewppLib/DBWinBuffer.h"
 #include "DebugViewppLib/DBWinReader.h"
 #include "DebugViewppLib/ProcessInfo.h"
+#include "DebugViewppLib/ProcessMonitor.h"
 #include "DebugViewppLib/LineBuffer.h"
 #include "CobaltFusion/stringbuilder.h"
 
@@ -31,14 +32,15 @@ Win32::Handle CreateDBWinBufferMapping(bool global)
     return hMap;
 }
 
-DBWinReader::DBWinReader(Timer& timer, ILineBuffer& linebuffer, bool global) :
+DBWinReader::DBWinReader(Timer& timer, ILineBuffer& linebuffer, bool global, const PidMap* pPidMap) :
     LogSource(timer, SourceType::System, linebuffer),
     m_hBuffer(CreateDBWinBufferMapping(global)),
 
     m_dbWinBufferReady(Win32::CreateEvent(nullptr, false, true, GetDBWinName(global, L"DBWIN_BUFFER_READY").c_str())),
     m_dbWinDataReady(Win32::CreateEvent(nullptr, false, false, GetDBWinName(global, L"DBWIN_DATA_READY").c_str())),
     m_mappedViewOfFile(m_hBuffer.get(), PAGE_READONLY, 0, 0, sizeof(DbWinBuffer)),
-    m_dbWinBuffer(static_cast<const DbWinBuffer*>(m_mappedViewOfFile.Ptr()))
+    m_dbWinBuffer(static_cast<const DbWinBuffer*>(m_mappedViewOfFile.Ptr())),
+    m_pPidMap(pPidMap)
 {
     SetDescription(global ? L"Global Win32 Messages" : L"Win32 Messages");
 
@@ -64,6 +66,11 @@ void DBWinReader::Notify()
     {
         Add(m_dbWinBuffer->processId, systemProcessNames[m_dbWinBuffer->processId], m_dbWinBuffer->data);
     }
+    else if (std::string processName; m_pPidMap != nullptr && m_pPidMap->Find(m_dbWinBuffer->processId, processName))
+    {
+        // the process already has a handle in the PidMap until ProcessMonitor reports it ended
+        Add(m_dbWinBuffer->processId, processName, m_dbWinBuffer->data);
+    }
     else
     {
         HANDLE handle = ::OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION | SYNCHRONIZE, FALSE, m_dbWinBuffer->processId);
@@ -9,6 +9,9 @@
 #include "DebugViewppLib/DbgviewReader.h"
 #include "DebugViewppLib/LineBuffer.h"
 
+#include <array>
+#include <charconv>
+#include <cstring>
 #include <iomanip>
 #include <string>
 #include <thread>
@@ -18,25 +21,6 @@ namespace debugviewpp {
 
 const std::string SysinternalsDebugViewAgentPort = "2020";
 
-DbgviewReader::DbgviewReader(Timer& timer, ILineBuffer& linebuffer, const std::string& hostname) :
-    PolledLogSource(timer, SourceType::Pipe, linebuffer, 40),
-    m_hostname(hostname),
-    m_thread([this] { Loop(); })
-{
-    SetDescription(wstringbuilder() << "Dbgview Agent at " << m_hostname);
-}
-
-std::vector<unsigned char> Read(std::stringstream& is, size_t amount)
-{
-    if (amount < 1)
-    {
-        return std::vector<unsigned char>();
-    }
-    std::vector<unsigned char> buffer(amount);
-    is.read(reinterpret_cast<char*>(buffer.data()), amount);
-    return buffer;
-}
-
 namespace Magic {
 const DWORD ColumnnOneMark = 1;
 const DWORD ColumnnTwoMark = 2;
@@ -89,133 +73,309 @@ std::string ToChar(const T& s)
     return result.str();
 }
 
-void DbgviewReader::SetAutoNewLine(bool value)
-{
-    LogSource::SetAutoNewLine(value);
-    //     todo: send ForceCarriageReturnsEnable/ForceCarriageReturnsDisable to dbgview-agent
-}
 
-void DbgviewReader::Loop()
-{
-    SetDescription(wstringbuilder() << "Dbgview Agent at " << m_hostname);
-    m_iostream.connect(m_hostname, SysinternalsDebugViewAgentPort);
-    const std::string processName("[tcp]");
+using boost::asio::ip::tcp;
 
-    Write<DWORD>(m_iostream, Magic::RequestQueryPerformanceFrequency);
-    auto qpFrequency = Read<DWORD>(m_iostream);
-    long long t0 = 0;
-    bool first = true;
+constexpr size_t ReceiveBufferSize = 64 * 1024;
+constexpr size_t RecordHeaderSize = sizeof(DWORD) + sizeof(FILETIME) + sizeof(long long);
 
-    if (!m_iostream || qpFrequency == 0)
-    {
-        LogSource::Add(stringbuilder() << "Unable to connect to " << GetDescription() << ", " << m_iostream.error().message());
-        Signal();
-        return;
-    }
-
-    Write<DWORD>(m_iostream, Magic::CaptureKernelEnable);
-    Write<DWORD>(m_iostream, Magic::VerboseKernelMessagesEnable);
-    Write<DWORD>(m_iostream, Magic::CaptureWin32Enable);
-    Write<DWORD>(m_iostream, Magic::PassThroughEnable);
+template <typename T>
+T ReadValue(const char* data)
+{
+    T t = T();
+    std::memcpy(&t, data, sizeof(t));
+    return t;
+}
 
-    if (GetAutoNewLine())
-    {
-        Write<DWORD>(m_iostream, Magic::ForceCarriageReturnsEnable);
-    }
-    else
-    {
-        Write<DWORD>(m_iostream, Magic::ForceCarriageReturnsDisable);
-    }
+template <typename T>
+void AppendValue(std::vector<char>& buffer, T t)
+{
+    auto p = reinterpret_cast<const char*>(&t);
+    buffer.insert(buffer.end(), p, p + sizeof(t));
+}
 
-    double timerUnit = 1. / qpFrequency;
-    AddMessage(stringbuilder() << "Connected to " << GetDescription());
-    Signal();
+DbgviewDecoder::DbgviewDecoder(DWORD qpFrequency) :
+    m_timerUnit(1. / qpFrequency)
+{
+}
 
-    while (!AtEnd())
+size_t DbgviewDecoder::Decode(const char* data, size_t size, Lines& lines)
+{
+    size_t pos = 0;
+    while (size - pos >= sizeof(DWORD))
     {
-        m_iostream.clear();
-        auto messageLength = Read<DWORD>(m_iostream);
-
-        if (m_iostream.eof())
+        auto messageLength = ReadValue<DWORD>(data + pos);
+        if (messageLength > MaxMessageLength)
         {
-            AddMessage(stringbuilder() << "Connection to " << GetDescription() << " closed.");
-            LogSource::Abort();
-            Signal();
-            break;
+            throw std::runtime_error("<error parsing messageLength>");
         }
-
-        if (!m_iostream || messageLength >= 0x7fffffff)
+        if (size - pos - sizeof(DWORD) < messageLength)
         {
-            AddMessage(0, processName, "<error parsing messageLength>");
-            Signal();
             break;
         }
+        // a zero length message is a keep alive
+        DecodeBlock(data + pos + sizeof(DWORD), messageLength, lines);
+        pos += sizeof(DWORD) + messageLength;
+    }
+    return pos;
+}
 
-        if (messageLength == 0)
-        { // keep alive
-            continue;
+void DbgviewDecoder::DecodeBlock(const char* data, size_t size, Lines& lines)
+{
+    size_t pos = 0;
+    while (size - pos >= RecordHeaderSize)
+    {
+        pos += sizeof(DWORD); // lineNr
+        auto filetime = ReadValue<FILETIME>(data + pos);
+        pos += sizeof(FILETIME);
+        auto qpcTime = ReadValue<long long>(data + pos);
+        pos += sizeof(long long);
+        if (m_first)
+        {
+            m_t0 = qpcTime;
+            m_first = false;
         }
 
-        // dont read from the tcp::iostream directly,
-        // instead use read() to receive the complete message.
-        // this allows us to use ss.tellg() to determine the amount of trash bytes.
-        std::vector<char> buffer(messageLength);
-        m_iostream.read(buffer.data(), messageLength);
-        std::stringstream ss(std::ios_base::in | std::ios_base::out | std::ios::binary);
-        ss.write(buffer.data(), buffer.size());
-
         DWORD pid = 0;
-        std::string msg;
-        for (;;)
+        if (pos < size && data[pos] == Magic::ColumnnOneMark)
         {
-            Read<DWORD>(ss); // lineNr
-            if (!ss)
+            auto pidEnd = static_cast<const char*>(std::memchr(data + pos, Magic::ColumnnTwoMark, size - pos));
+            if (pidEnd == nullptr)
             {
-                break;
+                throw std::runtime_error("<error parsing pid>");
             }
-
-            auto filetime = Read<FILETIME>(ss);
-            auto qpcTime = Read<long long>(ss);
-            if (first)
+            auto pidBegin = data + pos + 1;
+            while (pidBegin != pidEnd && *pidBegin == ' ')
+            {
+                ++pidBegin;
+            }
+            std::from_chars(pidBegin, pidEnd, pid);
+            pos = static_cast<size_t>(pidEnd - data) + 1;
+            if (pos < size)
             {
-                t0 = qpcTime;
-                first = false;
+                ++pos; // discard one leading space
             }
-            auto time = (qpcTime - t0) * timerUnit;
+        }
+
+        auto textEnd = static_cast<const char*>(std::memchr(data + pos, '\0', size - pos));
+        auto length = textEnd != nullptr ? static_cast<size_t>(textEnd - data) - pos : size - pos;
+        std::string message(data + pos, length);
+        message.push_back('\n'); // newlines are never send as part of the message
+        lines.emplace_back((qpcTime - m_t0) * m_timerUnit, filetime, pid, "[tcp]", message, nullptr);
+
+        // strangely, messages are always send in multiples of 4 bytes.
+        // this means depending on the message length there are 1, 2 or 3 trailing bytes of undefined data.
+        pos = std::min(size, (pos + length + 1 + 3) & ~size_t(3));
+    }
+}
 
-            if (buffer[20] == Magic::ColumnnOneMark)
+std::vector<char> DbgviewDecoder::Encode(const Lines& lines, DWORD qpFrequency)
+{
+    std::vector<char> block;
+    DWORD lineNr = 0;
+    for (auto& line : lines)
+    {
+        AppendValue<DWORD>(block, lineNr++);
+        AppendValue<FILETIME>(block, line.systemTime);
+        AppendValue<long long>(block, static_cast<long long>(line.time * qpFrequency));
+        std::string text = stringbuilder() << static_cast<char>(Magic::ColumnnOneMark) << line.pid << static_cast<char>(Magic::ColumnnTwoMark) << " " << line.message;
+        block.insert(block.end(), text.begin(), text.end());
+        block.push_back('\0');
+        block.resize((block.size() + 3) & ~size_t(3));
+    }
+
+    std::vector<char> result;
+    AppendValue<DWORD>(result, static_cast<DWORD>(block.size()));
+    result.insert(result.end(), block.begin(), block.end());
+    return result;
+}
+
+DbgviewReader::DbgviewReader(Timer& timer, ILineBuffer& linebuffer, const std::string& hostname, const std::string& port) :
+    PolledLogSource(timer, SourceType::DebugViewAgent, linebuffer, 0),
+    m_hostname(hostname),
+    m_port(port),
+    m_resolver(m_ioContext),
+    m_socket(m_ioContext),
+    m_buffer(ReceiveBufferSize)
+{
+    SetDescription(wstringbuilder() << L"Dbgview Agent at " << m_hostname);
+
+    m_resolver.async_resolve(m_hostname, m_port, [this](const boost::system::error_code& ec, const tcp::resolver::results_type& endpoints) {
+        if (ec)
+        {
+            Close(stringbuilder() << "Unable to connect to " << GetDescription() << ", " << ec.message());
+            return;
+        }
+        boost::asio::async_connect(m_socket, endpoints, [this](const boost::system::error_code& ec, const tcp::endpoint&) {
+            if (ec)
             {
-                unsigned char c1 = 0;
-                unsigned char c2 = 0;
-                if (!((ss >> c1 >> pid >> c2) && c1 == Magic::ColumnnOneMark && c2 == Magic::ColumnnTwoMark))
-                {
-                    AddMessage(0, processName, "<error parsing pid>");
-                    break;
-                }
-                Read(ss, 1); // discard one leading space
+                Close(stringbuilder() << "Unable to connect to " << GetDescription() << ", " << ec.message());
+                return;
             }
+            Connected();
+        });
+    });
+    m_thread = std::thread([this] { m_ioContext.run(); });
+}
+
+DbgviewReader::~DbgviewReader()
+{
+    DbgviewReader::Abort();
+}
 
-            std::getline(ss, msg, '\0');
-            msg.push_back('\n'); // newlines are never send as part of the message
-            AddMessage(time, filetime, pid, processName, msg);
+void DbgviewReader::SetAutoNewLine(bool value)
+{
+    LogSource::SetAutoNewLine(value);
+    //     todo: send ForceCarriageReturnsEnable/ForceCarriageReturnsDisable to dbgview-agent
+}
 
-            // strangely, messages are always send in multiples of 4 bytes.
-            // this means depending on the message length there are 1, 2 or 3 trailing bytes of undefined data.
-            auto remainder = static_cast<int>(ss.tellg() % 4);
-            if (remainder > 0)
+void DbgviewReader::Connected()
+{
+    m_request.clear();
+    AppendValue<DWORD>(m_request, Magic::RequestQueryPerformanceFrequency);
+    boost::asio::async_write(m_socket, boost::asio::buffer(m_request), [this](const boost::system::error_code& ec, size_t) {
+        if (ec)
+        {
+            Close(stringbuilder() << "Unable to connect to " << GetDescription() << ", " << ec.message());
+            return;
+        }
+        boost::asio::async_read(m_socket, boost::asio::buffer(&m_qpFrequency, sizeof(m_qpFrequency)), [this](const boost::system::error_code& ec, size_t) {
+            if (ec || m_qpFrequency == 0)
             {
-                Read(ss, 4 - remainder);
+                Close(stringbuilder() << "Unable to connect to " << GetDescription() << ", " << ec.message());
+                return;
             }
+            Handshake();
+        });
+    });
+}
+
+void DbgviewReader::Handshake()
+{
+    m_decoder = DbgviewDecoder(m_qpFrequency);
+
+    m_request.clear();
+    AppendValue<DWORD>(m_request, Magic::CaptureKernelEnable);
+    AppendValue<DWORD>(m_request, Magic::VerboseKernelMessagesEnable);
+    AppendValue<DWORD>(m_request, Magic::CaptureWin32Enable);
+    AppendValue<DWORD>(m_request, Magic::PassThroughEnable);
+    AppendValue<DWORD>(m_request, GetAutoNewLine() ? Magic::ForceCarriageReturnsEnable : Magic::ForceCarriageReturnsDisable);
+
+    boost::asio::async_write(m_socket, boost::asio::buffer(m_request), [this](const boost::system::error_code& ec, size_t) {
+        if (ec)
+        {
+            Close(stringbuilder() << "Unable to connect to " << GetDescription() << ", " << ec.message());
+            return;
         }
+        AddMessage(stringbuilder() << "Connected to " << GetDescription());
         Signal();
+        BeginRead();
+    });
+}
+
+// complete records are decoded straight out of m_buffer and added as one batch per receive,
+// only an incomplete message block at the end of the buffer is moved to the front.
+void DbgviewReader::BeginRead()
+{
+    // Decode() rejects a length over MaxMessageLength, so the buffer never grows beyond one such block
+    if (m_end == m_buffer.size())
+    {
+        m_buffer.resize(std::min(m_buffer.size() * 2, DbgviewDecoder::MaxMessageLength + sizeof(DWORD)));
     }
+
+    m_socket.async_read_some(boost::asio::buffer(m_buffer.data() + m_end, m_buffer.size() - m_end), [this](const boost::system::error_code& ec, size_t size) {
+        if (ec == boost::asio::error::operation_aborted)
+        {
+            return;
+        }
+        if (ec)
+        {
+            Close(stringbuilder() << "Connection to " << GetDescription() << " closed.");
+            return;
+        }
+
+        m_end += size;
+        Lines lines;
+        size_t consumed = 0;
+        try
+        {
+            consumed = m_decoder.Decode(m_buffer.data(), m_end, lines);
+        }
+        catch (std::exception& e)
+        {
+            AddMessages(lines);
+            Close(e.what());
+            return;
+        }
+
+        std::memmove(m_buffer.data(), m_buffer.data() + consumed, m_end - consumed);
+        m_end -= consumed;
+        if (!lines.empty())
+        {
+            AddMessages(lines);
+            Signal();
+        }
+        BeginRead();
+    });
 }
 
-void DbgviewReader::Abort()
+void DbgviewReader::Close(const std::string& message)
 {
-    m_iostream.close();
+    boost::system::error_code ec;
+    m_socket.close(ec);
+    AddMessage(message);
     LogSource::Abort();
-    m_thread.join();
+    Signal();
+}
+
+void DbgviewReader::Abort()
+{
+    if (m_thread.joinable())
+    {
+        boost::asio::post(m_ioContext, [this] {
+            m_resolver.cancel();
+            boost::system::error_code ec;
+            m_socket.close(ec);
+        });
+        m_thread.join();
+    }
+    PolledLogSource::Abort();
+}
+
+DbgviewAgentSimulator::DbgviewAgentSimulator(DWORD qpFrequency) :
+    m_acceptor(m_ioContext, tcp::endpoint(boost::asio::ip::address_v4::loopback(), 0)),
+    m_socket(m_ioContext),
+    m_qpFrequency(qpFrequency)
+{
+}
+
+unsigned short DbgviewAgentSimulator::GetPort() const
+{
+    return m_acceptor.local_endpoint().port();
+}
+
+void DbgviewAgentSimulator::Accept()
+{
+    m_acceptor.accept(m_socket);
+
+    DWORD request = 0;
+    boost::asio::read(m_socket, boost::asio::buffer(&request, sizeof(request)));
+    boost::asio::write(m_socket, boost::asio::buffer(&m_qpFrequency, sizeof(m_qpFrequency)));
+
+    std::array<DWORD, 5> settings;
+    boost::asio::read(m_socket, boost::asio::buffer(settings));
+}
+
+void DbgviewAgentSimulator::Send(const std::vector<char>& block)
+{
+    boost::asio::write(m_socket, boost::asio::buffer(block));
+}
+
+void DbgviewAgentSimulator::Close()
+{
+    boost::system::error_code ec;
+    m_socket.shutdown(tcp::socket::shutdown_both, ec);
+    m_socket.close(ec);
 }
 
 } // namespace debugviewpp
@@ -0,0 +1,297 @@
+// (C) Copyright Gert-Jan de Vos and Jan Wilmans 2013.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#include <algorithm>
+#include <thread>
+#include "DebugViewppLib/Colors.h"
+#include "DebugViewppLib/FilterEvaluator.h"
+
+namespace fusion {
+namespace debugviewpp {
+
+bool FilterResult::IsMatch(size_t slot) const
+{
+    return slot < matches.size() && matches[slot];
+}
+
+FilterEvaluator::FilterEvaluator(size_t threadCount) :
+    m_threadCount(std::min(threadCount != 0 ? threadCount : std::max<size_t>(std::thread::hardware_concurrency(), 1), MaxThreadCount))
+{
+}
+
+FilterEvaluator::~FilterEvaluator()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_end = true;
+    }
+    m_workAvailable.notify_all();
+    for (auto& thread : m_threads)
+    {
+        thread.join();
+    }
+}
+
+void FilterEvaluator::BeginRegistration()
+{
+    m_slots.erase(std::remove_if(m_slots.begin(), m_slots.end(), [](const Slot& slot) { return !slot.used; }), m_slots.end());
+    m_keys.clear();
+    for (size_t i = 0; i < m_slots.size(); ++i)
+    {
+        m_keys.emplace(m_slots[i].key, i);
+        m_slots[i].tokens = false;
+        m_slots[i].used = false;
+    }
+    m_registered = 0;
+}
+
+// the regex of a filter follows from its text and match type, so does the slot; the filter type and colors only
+// matter to the views that interpret the result
+std::string FilterEvaluator::MakeKey(const Filter& filter, FilterSubject subject)
+{
+    std::string key;
+    key.reserve(filter.text.size() + 2);
+    key += static_cast<char>('0' + static_cast<int>(subject));
+    key += static_cast<char>('0' + MatchTypeToInt(filter.matchType));
+    key += filter.text;
+    return key;
+}
+
+size_t FilterEvaluator::Register(const Filter& filter, FilterSubject subject)
+{
+    if (!filter.enable)
+    {
+        return NoSlot;
+    }
+
+    ++m_registered;
+    auto key = MakeKey(filter, subject);
+    auto it = m_keys.find(key);
+    if (it == m_keys.end())
+    {
+        it = m_keys.emplace(key, m_slots.size()).first;
+        m_slots.push_back(Slot{key, filter.re, filter.matchType, subject, false, false});
+    }
+
+    auto& slot = m_slots[it->second];
+    slot.used = true;
+    slot.tokens |= filter.bgColor == Colors::Auto;
+    return it->second;
+}
+
+FilterSlots FilterEvaluator::Register(const std::vector<Filter>& filters, FilterSubject subject)
+{
+    FilterSlots slots;
+    slots.reserve(filters.size());
+    for (auto& filter : filters)
+    {
+        slots.push_back(Register(filter, subject));
+    }
+    return slots;
+}
+
+size_t FilterEvaluator::GetSlotCount() const
+{
+    return std::count_if(m_slots.begin(), m_slots.end(), [](const Slot& slot) { return slot.used; });
+}
+
+size_t FilterEvaluator::GetRegisteredCount() const
+{
+    return m_registered;
+}
+
+size_t FilterEvaluator::GetThreadCount() const
+{
+    return m_threadCount;
+}
+
+void FilterEvaluator::Evaluate(const Message& msg, FilterResult& result) const
+{
+    result.matches.assign(m_slots.size(), false);
+    result.tokens.clear();
+    for (size_t slotIndex = 0; slotIndex < m_slots.size(); ++slotIndex)
+    {
+        auto& slot = m_slots[slotIndex];
+        if (!slot.used)
+        {
+            continue;
+        }
+
+        auto& text = slot.subject == FilterSubject::Text ? msg.text : msg.processName;
+        if (slot.tokens)
+        {
+            std::sregex_iterator begin(text.begin(), text.end(), slot.re);
+            std::sregex_iterator end;
+            for (auto tok = begin; tok != end; ++tok)
+            {
+                result.tokens.emplace_back(slotIndex, MatchKey(*tok, slot.matchType));
+                result.matches[slotIndex] = true;
+            }
+        }
+        else
+        {
+            result.matches[slotIndex] = std::regex_search(text, slot.re);
+        }
+    }
+}
+
+void FilterEvaluator::Evaluate(const std::vector<Message>& messages, std::vector<FilterResult>& results)
+{
+    auto count = messages.size();
+    results.resize(count);
+    auto threadCount = std::min(m_threadCount, count / MinLinesPerThread);
+    if (threadCount <= 1)
+    {
+        Evaluate(messages, results, 0, count);
+        return;
+    }
+
+    while (m_threads.size() < m_threadCount - 1)
+    {
+        m_threads.emplace_back([this] { Work(); });
+    }
+
+    // std::regex is safe to search from several threads, every thread writes the results of its own lines
+    auto chunkSize = (count + threadCount - 1) / threadCount;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_pMessages = &messages;
+        m_pResults = &results;
+        m_chunkSize = chunkSize;
+        m_chunkCount = (count + chunkSize - 1) / chunkSize;
+        m_nextChunk = 1;
+        m_pending = m_chunkCount - 1;
+    }
+    m_workAvailable.notify_all();
+
+    std::exception_ptr error;
+    try
+    {
+        Evaluate(messages, results, 0, chunkSize);
+    }
+    catch (...)
+    {
+        error = std::current_exception();
+    }
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_batchDone.wait(lock, [this] { return m_pending == 0; });
+    if (!error)
+    {
+        error = m_error;
+    }
+    m_error = nullptr;
+    if (error)
+    {
+        std::rethrow_exception(error);
+    }
+}
+
+void FilterEvaluator::Work()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (;;)
+    {
+        m_workAvailable.wait(lock, [this] { return m_end || m_nextChunk < m_chunkCount; });
+        if (m_end)
+        {
+            return;
+        }
+
+        auto chunk = m_nextChunk++;
+        lock.unlock();
+        std::exception_ptr error;
+        try
+        {
+            Evaluate(*m_pMessages, *m_pResults, chunk * m_chunkSize, std::min(m_pMessages->size(), (chunk + 1) * m_chunkSize));
+        }
+        catch (...)
+        {
+            error = std::current_exception();
+        }
+        lock.lock();
+        if (error && !m_error)
+        {
+            m_error = error;
+        }
+        if (--m_pending == 0)
+        {
+            m_batchDone.notify_one();
+        }
+    }
+}
+
+void FilterEvaluator::Evaluate(const std::vector<Message>& messages, std::vector<FilterResult>& results, size_t begin, size_t end) const
+{
+    for (size_t i = begin; i < end; ++i)
+    {
+        Evaluate(messages[i], results[i]);
+    }
+}
+
+bool IsIncluded(std::vector<Filter>& filters, const FilterSlots& slots, const FilterResult& result, MatchColors& matchColors)
+{
+    auto slot = [&slots](size_t i) { return i < slots.size() ? slots[i] : FilterEvaluator::NoSlot; };
+
+    for (size_t i = 0; i < filters.size(); ++i)
+    {
+        if (filters[i].enable && filters[i].filterType == FilterType::Exclude && result.IsMatch(slot(i)))
+        {
+            return false;
+        }
+    }
+
+    bool included = false;
+    bool includeFilterPresent = false;
+    for (size_t i = 0; i < filters.size(); ++i)
+    {
+        auto& filter = filters[i];
+        if (!filter.enable)
+        {
+            continue;
+        }
+
+        if (filter.bgColor == Colors::Auto)
+        {
+            for (auto& token : result.tokens)
+            {
+                if (token.first == slot(i) && matchColors.find(token.second) == matchColors.end())
+                {
+                    matchColors.emplace(token.second, GetRandomBackColor());
+                }
+            }
+        }
+
+        if (filter.filterType == FilterType::Include)
+        {
+            includeFilterPresent = true;
+            included |= result.IsMatch(slot(i));
+        }
+
+        if (filter.filterType == FilterType::Once && result.IsMatch(slot(i)))
+        {
+            included |= !filter.matched;
+            filter.matched = true;
+        }
+    }
+
+    return !includeFilterPresent || included;
+}
+
+bool MatchFilterType(const std::vector<Filter>& filters, const FilterSlots& slots, FilterType::type type, const FilterResult& result)
+{
+    for (size_t i = 0; i < filters.size() && i < slots.size(); ++i)
+    {
+        if (filters[i].enable && filters[i].filterType == type && result.IsMatch(slots[i]))
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+} // namespace debugviewpp
+} // namespace fusion
@@ -99,14 +99,14 @@ bool KernelReader::AtEnd() const
     return false;
 }
 
-void KernelReader::Poll()
+bool KernelReader::Poll()
 {
     memset(m_pBuf, 0, kernelMessageBufferSize);
     DWORD dwOut = 0;
     ::DeviceIoControl(m_handle.get(), DBGV_READ_LOG, NULL, 0, m_pBuf, kernelMessageBufferSize, &dwOut, NULL);
     if (dwOut == 0)
     {
-        return; // no messages to be read
+        return false; // no messages to be read
     }
 
     PLOG_ITEM pNextItem = m_pBuf;
@@ -115,6 +115,7 @@ void KernelReader::Poll()
         AddMessage(0, "kernel", pNextItem->strData);
         pNextItem = (PLOG_ITEM)((char*)pNextItem + sizeof(LOG_ITEM) + (strlen(pNextItem->strData) + 4) / 4 * 4);
     }
+    return true;
 }
 
 void KernelReader::SetKernelMessagesDriverFeature(DWORD feature)
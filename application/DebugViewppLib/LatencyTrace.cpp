@@ -0,0 +1,75 @@
+// (C) Copyright Gert-Jan de Vos and Jan Wilmans 2013.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#include <array>
+#include <atomic>
+#include "CobaltFusion/Timer.h"
+#include "DebugViewppLib/LatencyTrace.h"
+#include "DebugViewppLib/Metrics.h"
+
+namespace fusion {
+namespace debugviewpp {
+
+namespace {
+
+std::atomic<unsigned> g_latencySampling = 0;
+
+double GetMicrosecondsPerTick()
+{
+    LARGE_INTEGER li;
+    QueryPerformanceFrequency(&li);
+    return 1e6 / li.QuadPart;
+}
+
+Histogram& GetStageHistogram(LatencyStage stage)
+{
+    static const std::array<Histogram*, 5> histograms = {
+        &GetMetrics().GetHistogram("latency.drain.us"),
+        &GetMetrics().GetHistogram("latency.newline.us"),
+        &GetMetrics().GetHistogram("latency.store.us"),
+        &GetMetrics().GetHistogram("latency.filter.us"),
+        &GetMetrics().GetHistogram("latency.paint.us")};
+    return *histograms[static_cast<size_t>(stage)];
+}
+
+} // namespace
+
+void SetLatencySampling(unsigned interval)
+{
+    g_latencySampling = interval;
+}
+
+unsigned GetLatencySampling()
+{
+    return g_latencySampling;
+}
+
+long long SampleLatency()
+{
+    auto interval = g_latencySampling.load(std::memory_order_relaxed);
+    if (interval == 0)
+    {
+        return 0;
+    }
+
+    // every source thread counts its own lines, so sampling does not add contention between sources
+    thread_local unsigned count = 0;
+    if (++count < interval)
+    {
+        return 0;
+    }
+    count = 0;
+    return GetTicks();
+}
+
+void RecordLatencySample(LatencyStage stage, long long ingestTicks)
+{
+    static const double microsecondsPerTick = GetMicrosecondsPerTick();
+    auto ticks = GetTicks() - ingestTicks;
+    GetStageHistogram(stage).Record(ticks > 0 ? static_cast<uint64_t>(ticks * microsecondsPerTick) : 0);
+}
+
+} // namespace debugviewpp
+} // namespace fusion
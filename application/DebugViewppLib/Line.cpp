@@ -5,6 +5,7 @@
 
 #include "Win32/Win32Lib.h"
 #include "DebugViewppLib/Line.h"
+#include "DebugViewppLib/LogSource.h"
 
 namespace fusion {
 namespace debugviewpp {
@@ -15,7 +16,9 @@ Line::Line(double time, FILETIME systemTime, HANDLE handle, const std::string& m
     handle(handle),
     pid(0),
     message(message),
-    pLogSource(pLogSource)
+    pLogSource(pLogSource),
+    sourceId(pLogSource != nullptr ? pLogSource->GetSourceId() : 0),
+    ingestTicks(0)
 {
 }
 
@@ -26,7 +29,9 @@ Line::Line(double time, FILETIME systemTime, DWORD pid, const std::string& proce
     pid(pid),
     processName(processName),
     message(message),
-    pLogSource(pLogSource)
+    pLogSource(pLogSource),
+    sourceId(pLogSource != nullptr ? pLogSource->GetSourceId() : 0),
+    ingestTicks(0)
 {
 }
 
@@ -0,0 +1,318 @@
+// (C) Copyright Gert-Jan de Vos and Jan Wilmans 2013.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#include <algorithm>
+#include <cassert>
+#include <limits>
+#include <queue>
+#include "Win32/Win32Lib.h"
+#include "DebugViewppLib/ListenerPool.h"
+#include "DebugViewppLib/LogSource.h"
+
+namespace fusion {
+namespace debugviewpp {
+
+ListenerPool::ListenerPool(size_t threadCount, std::function<void()> notified) :
+    m_threadCount(std::max<size_t>(threadCount, 1)),
+    m_notified(std::move(notified)),
+    m_queueSemaphore(::CreateSemaphore(nullptr, 0, std::numeric_limits<LONG>::max(), nullptr))
+{
+}
+
+ListenerPool::~ListenerPool()
+{
+    Abort();
+}
+
+size_t ListenerPool::DefaultThreadCount()
+{
+    // threads are only started once there are sources to listen to
+    return std::clamp<size_t>(std::thread::hardware_concurrency(), 2, 8);
+}
+
+void ListenerPool::Merge(Lines& lines)
+{
+    // a stable sort by source leaves the lines of each source in the order they were added
+    std::vector<size_t> order(lines.size());
+    for (size_t i = 0; i < order.size(); ++i)
+    {
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), [&lines](size_t a, size_t b) { return lines[a].sourceId < lines[b].sourceId; });
+
+    // then the first line of each source competes with the first lines of the other sources
+    struct Run
+    {
+        size_t begin;
+        size_t end;
+    };
+    std::vector<Run> runs;
+    for (size_t i = 0; i < order.size(); ++i)
+    {
+        if (runs.empty() || lines[order[i]].sourceId != lines[order[runs.back().begin]].sourceId)
+        {
+            runs.push_back(Run{i, i});
+        }
+        ++runs.back().end;
+    }
+    if (runs.size() < 2)
+    {
+        return;
+    }
+
+    auto later = [&lines, &order](const Run& a, const Run& b) {
+        auto& lineA = lines[order[a.begin]];
+        auto& lineB = lines[order[b.begin]];
+        return lineA.time != lineB.time ? lineA.time > lineB.time : lineA.sourceId > lineB.sourceId;
+    };
+    std::priority_queue<Run, std::vector<Run>, decltype(later)> heads(later, std::move(runs));
+    Lines merged;
+    merged.reserve(lines.size());
+    while (!heads.empty())
+    {
+        auto run = heads.top();
+        heads.pop();
+        merged.push_back(std::move(lines[order[run.begin]]));
+        if (++run.begin != run.end)
+        {
+            heads.push(run);
+        }
+    }
+    lines.swap(merged);
+}
+
+void ListenerPool::Add(LogSource* pLogSource)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_end)
+    {
+        return;
+    }
+
+    auto& shard = SelectShard();
+    ++shard.sourceCount;
+    m_entries.emplace_back(std::make_unique<Entry>(Entry{pLogSource, &shard}));
+
+    // Initialize() can read a complete file, it runs on whichever thread is idle and the owning shard
+    // starts waiting for the source when it is done
+    Queue(*m_entries.back());
+}
+
+void ListenerPool::Remove(LogSource* pLogSource)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    auto it = std::find_if(m_entries.begin(), m_entries.end(), [pLogSource](const std::unique_ptr<Entry>& pEntry) { return pEntry->pLogSource == pLogSource; });
+    if (it == m_entries.end())
+    {
+        return;
+    }
+
+    auto pEntry = it->get();
+    pEntry->removed = true;
+    auto queued = std::find(m_queue.begin(), m_queue.end(), pEntry);
+    if (queued != m_queue.end())
+    {
+        m_queue.erase(queued);
+        pEntry->busy = false;
+    }
+    m_idle.wait(lock, [pEntry] { return !pEntry->busy; });
+
+    // the handle of pLogSource must stay valid until the shard stopped waiting for it
+    auto& shard = *pEntry->pShard;
+    auto generation = shard.generation;
+    Win32::SetEvent(shard.updateEvent);
+    m_idle.wait(lock, [this, &shard, generation] { return m_end || shard.generation != generation; });
+
+    --shard.sourceCount;
+    m_entries.erase(std::find_if(m_entries.begin(), m_entries.end(), [pEntry](const std::unique_ptr<Entry>& p) { return p.get() == pEntry; }));
+}
+
+void ListenerPool::Abort()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_end = true;
+        for (auto pEntry : m_queue)
+        {
+            pEntry->busy = false;
+        }
+        m_queue.clear();
+        for (auto& pShard : m_shards)
+        {
+            Win32::SetEvent(pShard->updateEvent);
+        }
+    }
+    m_idle.notify_all();
+
+    for (auto& pShard : m_shards)
+    {
+        if (pShard->thread.joinable())
+        {
+            pShard->thread.join();
+        }
+    }
+}
+
+size_t ListenerPool::GetThreadCount() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_shards.size();
+}
+
+ListenerPool::Shard& ListenerPool::SelectShard()
+{
+    if (m_shards.size() >= m_threadCount)
+    {
+        auto it = std::min_element(m_shards.begin(), m_shards.end(), [](const std::unique_ptr<Shard>& a, const std::unique_ptr<Shard>& b) { return a->sourceCount < b->sourceCount; });
+        if ((*it)->sourceCount < MaxSourcesPerShard)
+        {
+            return **it;
+        }
+    }
+
+    // more threads than requested are started only when all wait sets are full
+    m_shards.emplace_back(std::make_unique<Shard>());
+    auto& shard = *m_shards.back();
+    shard.updateEvent = Win32::CreateEvent(nullptr, false, false, nullptr);
+    shard.thread = std::thread([this, &shard] { Listen(shard); });
+    return shard;
+}
+
+void ListenerPool::Listen(Shard& shard)
+{
+    for (;;)
+    {
+        std::vector<HANDLE> waitHandles;
+        std::vector<Entry*> entries;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_end)
+            {
+                return;
+            }
+            for (auto& pEntry : m_entries)
+            {
+                if (pEntry->pShard != &shard || pEntry->busy || pEntry->removed || pEntry->pLogSource->AtEnd())
+                {
+                    continue;
+                }
+                HANDLE handle = pEntry->pLogSource->GetHandle();
+                assert(handle != nullptr && "GetHandle() cant return nullptr");
+                if (handle != INVALID_HANDLE_VALUE)
+                {
+                    waitHandles.push_back(handle);
+                    entries.push_back(pEntry.get());
+                }
+            }
+            ++shard.generation;
+        }
+        m_idle.notify_all();
+
+        auto updateEventIndex = waitHandles.size();
+        waitHandles.push_back(shard.updateEvent.get());
+        waitHandles.push_back(m_queueSemaphore.get());
+        for (;;)
+        {
+            auto res = Win32::WaitForAnyObject(waitHandles, INFINITE);
+            if (!res.signaled)
+            {
+                continue;
+            }
+
+            auto index = static_cast<size_t>(res.index - WAIT_OBJECT_0);
+            if (index == updateEventIndex)
+            {
+                break;
+            }
+            if (index == updateEventIndex + 1)
+            {
+                RunQueued();
+                continue;
+            }
+            assert(index < entries.size() && "res.index out of range");
+            if (!Dispatch(*entries[index]))
+            {
+                break;
+            }
+        }
+    }
+}
+
+// returns false when the wait set of the shard needs to be rebuilt
+bool ListenerPool::Dispatch(Entry& entry)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_end || entry.removed)
+        {
+            return false;
+        }
+        if (entry.expensive)
+        {
+            // the shard stops waiting for this source until the queued call is done
+            Queue(entry);
+            return false;
+        }
+        entry.busy = true;
+    }
+
+    Run(entry);
+    bool atEnd = entry.pLogSource->AtEnd();
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        entry.busy = false;
+    }
+    m_idle.notify_all();
+    return !atEnd;
+}
+
+// must be called with m_mutex locked
+void ListenerPool::Queue(Entry& entry)
+{
+    entry.busy = true;
+    m_queue.push_back(&entry);
+    ::ReleaseSemaphore(m_queueSemaphore.get(), 1, nullptr);
+}
+
+void ListenerPool::RunQueued()
+{
+    Entry* pEntry = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_end || m_queue.empty())
+        {
+            return; // the entry was removed before it could run
+        }
+        pEntry = m_queue.front();
+        m_queue.pop_front();
+    }
+
+    Run(*pEntry);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        pEntry->busy = false;
+        Win32::SetEvent(pEntry->pShard->updateEvent);
+    }
+    m_idle.notify_all();
+}
+
+void ListenerPool::Run(Entry& entry)
+{
+    if (!entry.initialized)
+    {
+        entry.pLogSource->Initialize();
+        entry.initialized = true;
+    }
+    else
+    {
+        auto start = std::chrono::steady_clock::now();
+        entry.pLogSource->Notify();
+        entry.expensive = std::chrono::steady_clock::now() - start > ExpensiveNotification;
+    }
+    m_notified();
+}
+
+} // namespace debugviewpp
+} // namespace fusion
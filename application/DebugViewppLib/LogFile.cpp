@@ -3,21 +3,34 @@
 // (See accompanying file LICENSE_1_0.txt or copy at
 // http://www.boost.org/LICENSE_1_0.txt)
 
+#include <algorithm>
+#include <limits>
+#include <memory>
+#include <stdexcept>
 #include <vector>
-#include "CobaltFusion/Str.h"
 #include "Win32/Utilities.h"
+#include "DebugViewppLib/Conversions.h"
+#include "DebugViewppLib/LatencyTrace.h"
 #include "DebugViewppLib/LogFile.h"
+#include "DebugViewppLib/Snapshot.h"
 
 namespace fusion {
 namespace debugviewpp {
 
+// a flood is mostly a few texts repeated many times, remembering the last few thousand distinct texts catches those
+// while the table stays small; longer texts are rarely repeated verbatim and are always stored
+const size_t RecentTextCount = 4096;
+const size_t MaxRecentTextSize = 1024;
+const size_t RecentTextOverhead = 2 * sizeof(std::string) + 64; // the entries and hash nodes of both tables
+
 Message::Message(double time, FILETIME systemTime, DWORD pid, const std::string& processName, const std::string& msg, COLORREF color) :
     time(time),
     systemTime(systemTime),
     processId(pid),
     processName(processName),
     text(msg),
-    color(color)
+    color(color),
+    ingestTicks(0)
 {
 }
 
@@ -32,14 +45,56 @@ void LogFile::Clear()
     m_messages.shrink_to_fit();
     m_storage.Clear();
     m_storage.shrink_to_fit();
+    m_recentTexts.clear();
+    m_recentTextIds.clear();
+    m_recentTextSize = 0;
+    m_rawSize = 0;
+    m_distinctCount = 0;
+    m_templateMiner.Clear();
+    m_timeIndex.Clear();
     m_processInfo.Clear();
 }
 
+uint32_t LogFile::AddText(const std::string& text)
+{
+    if (text.size() > MaxRecentTextSize)
+    {
+        ++m_distinctCount;
+        return static_cast<uint32_t>(m_storage.Add(text));
+    }
+
+    auto it = m_recentTexts.find(text);
+    if (it != m_recentTexts.end())
+    {
+        return it->second;
+    }
+
+    // forgetting all texts at once is cheaper than tracking which one was used least recently,
+    // the texts that are still repeated are back in the table after their next occurrence
+    if (m_recentTexts.size() >= RecentTextCount)
+    {
+        m_recentTexts.clear();
+        m_recentTextIds.clear();
+        m_recentTextSize = 0;
+    }
+    ++m_distinctCount;
+    auto textId = static_cast<uint32_t>(m_storage.Add(text));
+    auto recent = m_recentTexts.emplace(text, textId).first;
+    m_recentTextIds.emplace(textId, &recent->first);
+    m_recentTextSize += text.size() + RecentTextOverhead;
+    return textId;
+}
+
 void LogFile::Add(const Message& msg)
 {
-    auto props = m_processInfo.GetProcessProperties(msg.processId, WStr(msg.processName).str());
-    m_messages.emplace_back(InternalMessage(msg.time, msg.systemTime, props.uid));
-    m_storage.Add(msg.text);
+    auto uid = m_processInfo.GetUid(msg.processId, msg.processName);
+    auto match = m_templateMiner.Add(msg.text, m_params);
+    bool encoded = m_templateEncoding && match.patternId != 0;
+    auto textId = AddText(encoded ? m_params : msg.text);
+    m_messages.emplace_back(InternalMessage(msg.time, msg.systemTime, uid, textId, match.patternId, encoded));
+    m_timeIndex.Add(FileTimeToUInt64(msg.systemTime));
+    m_rawSize += msg.text.size();
+    RecordLatency(LatencyStage::Store, msg.ingestTicks);
 }
 
 int LogFile::BeginIndex() const
@@ -57,11 +112,70 @@ int LogFile::Count() const
     return static_cast<int>(m_messages.size());
 }
 
+size_t LogFile::GetRawSize() const
+{
+    return m_rawSize;
+}
+
+size_t LogFile::GetStoredSize() const
+{
+    return m_storage.GetStoredSize();
+}
+
+size_t LogFile::GetDistinctCount() const
+{
+    return m_distinctCount;
+}
+
 Message LogFile::operator[](int i) const
 {
     auto& msg = m_messages[i];
     auto props = m_processInfo.GetProcessProperties(msg.uid);
-    return Message(msg.time, msg.systemTime, props.pid, Str(props.name).str(), m_storage[i], props.color);
+    return Message(msg.time, msg.systemTime, props.pid, std::string(props.name), GetText(msg), props.color);
+}
+
+std::string LogFile::GetText(const InternalMessage& msg) const
+{
+    auto recent = m_recentTextIds.find(msg.textId);
+    auto text = recent != m_recentTextIds.end() ? *recent->second : m_storage[msg.textId];
+    return msg.encoded ? m_templateMiner.Format(msg.patternId, text) : text;
+}
+
+bool LogFile::IsRepeat(int i, int j) const
+{
+    auto& a = m_messages[i];
+    auto& b = m_messages[j];
+    return a.textId == b.textId && a.encoded == b.encoded && (!a.encoded || a.patternId == b.patternId) && a.uid == b.uid;
+}
+
+TemplateId LogFile::GetTemplateId(int i) const
+{
+    return m_templateMiner.GetTemplateId(m_messages[i].patternId);
+}
+
+const TemplateMiner& LogFile::GetTemplates() const
+{
+    return m_templateMiner;
+}
+
+void LogFile::SetTemplateEncoding(bool enable)
+{
+    m_templateEncoding = enable;
+}
+
+bool LogFile::GetTemplateEncoding() const
+{
+    return m_templateEncoding;
+}
+
+int LogFile::LowerBoundTime(const FILETIME& time) const
+{
+    return m_timeIndex.LowerBound(FileTimeToUInt64(time), [this](int i) { return FileTimeToUInt64(m_messages[i].systemTime); });
+}
+
+int LogFile::UpperBoundTime(const FILETIME& time) const
+{
+    return m_timeIndex.UpperBound(FileTimeToUInt64(time), [this](int i) { return FileTimeToUInt64(m_messages[i].systemTime); });
 }
 
 int LogFile::GetHistorySize() const
@@ -74,6 +188,138 @@ void LogFile::SetHistorySize(int size)
     m_historySize = size;
 }
 
+size_t LogFile::GetLineMemorySize() const
+{
+    return m_messages.capacity() * sizeof(InternalMessage);
+}
+
+size_t LogFile::GetCacheSize() const
+{
+    return m_recentTextSize + m_storage.GetCacheSize();
+}
+
+size_t LogFile::GetSpilledSize() const
+{
+    return m_storage.GetSpilledSize();
+}
+
+void LogFile::ShrinkCaches()
+{
+    std::unordered_map<std::string, uint32_t>().swap(m_recentTexts);
+    std::unordered_map<uint32_t, const std::string*>().swap(m_recentTextIds);
+    m_recentTextSize = 0;
+    m_storage.ClearCache();
+}
+
+void LogFile::CompressWriteBlock()
+{
+    // the recent texts keep their ids, only where the storage keeps the texts changes
+    m_storage.CompressWriteBlock();
+}
+
+void LogFile::SetSpillFile(const std::wstring& filename, uint64_t maxSize)
+{
+    m_storage.SetSpillFile(filename, maxSize);
+}
+
+size_t LogFile::SpillBlocks(size_t bytes)
+{
+    return m_storage.Spill(bytes);
+}
+
+void LogFile::Evict(int count)
+{
+    count = std::min(count, Count());
+    m_messages.erase(m_messages.begin(), m_messages.begin() + count);
+    m_messages.shrink_to_fit();
+
+    // a later line may still refer to an older text, the blocks before the oldest text in use are freed. The recent
+    // texts could hand out the id of a freed text to a new line, they start over.
+    ShrinkCaches();
+    auto oldest = std::numeric_limits<uint32_t>::max();
+    for (auto& msg : m_messages)
+    {
+        oldest = std::min(oldest, msg.textId);
+    }
+    m_storage.Release(oldest);
+
+    m_timeIndex.Clear();
+    for (auto& msg : m_messages)
+    {
+        m_timeIndex.Add(FileTimeToUInt64(msg.systemTime));
+    }
+}
+
+void LogFile::SaveSnapshot(SnapshotWriter& writer) const
+{
+    writer.WriteNumber(m_messages.size());
+    for (auto& msg : m_messages)
+    {
+        writer.WriteDouble(msg.time);
+        writer.WriteNumber(FileTimeToUInt64(msg.systemTime));
+        writer.WriteNumber(msg.uid);
+        writer.WriteNumber(msg.textId);
+        writer.WriteNumber(msg.patternId);
+        writer.WriteNumber(msg.encoded);
+    }
+    m_processInfo.SaveSnapshot(writer);
+    m_templateMiner.SaveSnapshot(writer);
+
+    // the compressed blocks do not change, the writer takes them when it commits, spilled ones from the spill file
+    auto blocks = std::make_shared<indexedstorage::SnappyBlocks>(m_storage.GetBlocks());
+    writer.WriteNumber(blocks->Count());
+    for (size_t i = 0; i < blocks->Count(); ++i)
+    {
+        writer.WriteString([blocks, i] { return (*blocks)[i]; });
+    }
+    writer.WriteStrings(m_storage.GetWriteBlock());
+    writer.WriteNumber(m_storage.GetRawSize());
+    writer.WriteNumber(m_rawSize);
+    writer.WriteNumber(m_distinctCount);
+}
+
+void LogFile::LoadSnapshot(SnapshotReader& reader)
+{
+    Clear();
+    auto count = reader.ReadCount();
+    m_messages.reserve(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        auto time = reader.ReadDouble();
+        auto ticks = reader.ReadNumber();
+        FILETIME systemTime = {static_cast<DWORD>(ticks), static_cast<DWORD>(ticks >> 32)};
+        auto uid = static_cast<DWORD>(reader.ReadNumber());
+        auto textId = static_cast<uint32_t>(reader.ReadNumber());
+        auto patternId = static_cast<uint32_t>(reader.ReadNumber());
+        auto encoded = reader.ReadNumber() != 0;
+        m_messages.emplace_back(InternalMessage(time, systemTime, uid, textId, patternId, encoded));
+    }
+    m_processInfo.LoadSnapshot(reader);
+    m_templateMiner.LoadSnapshot(reader);
+    auto blocks = reader.ReadStrings();
+    auto writeBlock = reader.ReadStrings();
+    m_storage.Restore(std::move(blocks), std::move(writeBlock), static_cast<size_t>(reader.ReadNumber()));
+    m_rawSize = static_cast<size_t>(reader.ReadNumber());
+    m_distinctCount = static_cast<size_t>(reader.ReadNumber());
+
+    // the lines are read without checking what they refer to
+    for (auto& msg : m_messages)
+    {
+        if (msg.uid >= m_processInfo.GetCount() || !m_storage.Contains(msg.textId) ||
+            msg.patternId > m_templateMiner.GetPatternCount() || (msg.encoded && msg.patternId == 0))
+        {
+            Clear();
+            throw std::runtime_error("snapshot is damaged");
+        }
+    }
+
+    // the time index is not saved, it is rebuilt from the times in m_messages without decompressing anything
+    for (auto& msg : m_messages)
+    {
+        m_timeIndex.Add(FileTimeToUInt64(msg.systemTime));
+    }
+}
+
 void LogFile::Append(const LogFile& logfile, int beginIndex, int endIndex)
 {
     for (int i = beginIndex; i <= endIndex; ++i)
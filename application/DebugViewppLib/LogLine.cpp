@@ -0,0 +1,72 @@
+// (C) Copyright Gert-Jan de Vos and Jan Wilmans 2013.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#include <cstdint>
+#include <stdexcept>
+#include "DebugViewppLib/LogLine.h"
+#include "DebugViewppLib/Snapshot.h"
+
+namespace fusion {
+namespace debugviewpp {
+
+LogLine::LogLine(int line) :
+    bookmark(false),
+    expanded(false),
+    line(line),
+    lastLine(line),
+    repeats(0),
+    ingestTicks(0)
+{
+}
+
+void SaveLogLines(SnapshotWriter& writer, const std::vector<LogLine>& logLines, int focusLine)
+{
+    writer.WriteNumber(logLines.size());
+    for (auto& logLine : logLines)
+    {
+        writer.WriteNumber(logLine.line);
+        writer.WriteNumber(logLine.lastLine);
+        writer.WriteNumber(logLine.repeats);
+        writer.WriteNumber(logLine.bookmark);
+        writer.WriteNumber(logLine.expanded);
+    }
+    writer.WriteNumber(static_cast<uint64_t>(static_cast<int64_t>(focusLine)));
+}
+
+std::vector<LogLine> LoadLogLines(SnapshotReader& reader, int logCount, int& focusLine)
+{
+    // the lines are in order and refer to lines of the log, their repeats come before the next line
+    std::vector<LogLine> logLines;
+    auto count = reader.ReadCount();
+    logLines.reserve(count);
+    bool valid = true;
+    int64_t next = 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        auto line = static_cast<int64_t>(reader.ReadNumber());
+        auto lastLine = static_cast<int64_t>(reader.ReadNumber());
+        auto repeats = static_cast<int64_t>(reader.ReadNumber());
+        valid = valid && line >= next && lastLine >= line && lastLine < logCount && repeats >= 0 && repeats <= lastLine - line;
+        next = lastLine + 1;
+        LogLine logLine(static_cast<int>(line));
+        logLine.lastLine = static_cast<int>(lastLine);
+        logLine.repeats = static_cast<int>(repeats);
+        logLine.bookmark = reader.ReadNumber() != 0;
+        logLine.expanded = reader.ReadNumber() != 0;
+        logLines.push_back(logLine);
+    }
+
+    // a line of the log, not of the view
+    auto focus = static_cast<int64_t>(reader.ReadNumber());
+    if (!valid || focus < -1 || focus >= logCount)
+    {
+        throw std::runtime_error("snapshot is damaged");
+    }
+    focusLine = static_cast<int>(focus);
+    return logLines;
+}
+
+} // namespace debugviewpp
+} // namespace fusion
@@ -3,6 +3,7 @@
 // (See accompanying file LICENSE_1_0.txt or copy at
 // http://www.boost.org/LICENSE_1_0.txt)
 
+#include <atomic>
 #include "CobaltFusion/Str.h"
 #include "DebugViewppLib/LogSource.h"
 #include "DebugViewppLib/LineBuffer.h"
@@ -11,9 +12,13 @@
 namespace fusion {
 namespace debugviewpp {
 
+// 0 is never used, it is the SourceId of lines that have no LogSource
+static std::atomic<SourceId> g_lastSourceId(0);
+
 LogSource::LogSource(Timer& timer, SourceType::type sourceType, ILineBuffer& linebuffer) :
     m_linebuffer(linebuffer),
     m_sourceType(sourceType),
+    m_sourceId(++g_lastSourceId),
     m_timer(timer)
 {
 }
@@ -67,11 +72,23 @@ SourceType::type LogSource::GetSourceType() const
     return m_sourceType;
 }
 
+SourceId LogSource::GetSourceId() const
+{
+    return m_sourceId;
+}
+
 void LogSource::Add(double time, FILETIME systemTime, DWORD pid, const std::string& processName, const std::string& message)
 {
     m_linebuffer.Add(time, systemTime, pid, processName, message, this);
 }
 
+void LogSource::Add(double time, FILETIME systemTime, DWORD pid, const std::string& processName, const std::string& message, const std::string& source)
+{
+    Line line(time, systemTime, pid, processName, message, this);
+    line.source = source;
+    m_linebuffer.Add(std::move(line));
+}
+
 void LogSource::Add(DWORD pid, const std::string& processName, const std::string& message)
 {
     m_linebuffer.Add(m_timer.Get(), Win32::GetSystemTimeAsFileTime(), pid, processName, message, this);
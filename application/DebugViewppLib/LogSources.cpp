@@ -3,6 +3,7 @@
 // (See accompanying file LICENSE_1_0.txt or copy at
 // http://www.boost.org/LICENSE_1_0.txt)
 
+#include <algorithm>
 #include <cassert>
 #include <iostream>
 #include <chrono>
@@ -18,19 +19,27 @@
 #include "DebugViewppLib/FileReader.h"
 #include "DebugViewppLib/BinaryFileReader.h"
 #include "DebugViewppLib/AnyFileReader.h"
+#include "DebugViewppLib/MergeFileReader.h"
 #include "DebugViewppLib/DBWinReader.h"
 #include "DebugViewppLib/KernelReader.h"
+#include "DebugViewppLib/ShmRingReader.h"
 #include "DebugViewppLib/DbgviewReader.h"
-#include "DebugViewppLib/SocketReader.h"
+#include "DebugViewppLib/UdpReader.h"
+#include "DebugViewppLib/TcpReader.h"
 #include "DebugViewppLib/TestSource.h"
+#include "DebugViewppLib/ReplaySource.h"
+#include "DebugViewppLib/Trace.h"
 #include "DebugViewppLib/ProcessInfo.h"
 #include "DebugViewppLib/Conversions.h"
 #include "DebugViewppLib/LineBuffer.h"
 #include "DebugViewppLib/VectorLineBuffer.h"
 #include "DebugViewppLib/Loopback.h"
+#include "DebugViewppLib/LatencyTrace.h"
+#include "DebugViewppLib/Metrics.h"
 
 // class Logsources has a vector<LogSource> and start a thread for LogSources::Listen()
-// - Listen() executes every LogSource::GetHandle() in m_sources and calls Notify() for any signaled handle.
+// - Listen() adds and removes the sources in m_sources to and from the ListenerPool.
+// - the ListenerPool waits for every LogSource::GetHandle() and calls Notify() for any signaled handle.
 // - LogSource::Notify reads input en writes to linebuffer (passed at construction)
 //
 
@@ -44,8 +53,11 @@ LogSources::LogSources(IExecutor& executor, bool startListening) :
     m_linebuffer(64 * 1024),
     m_loopback(std::make_unique<Loopback>(m_timer, m_linebuffer)),
     m_executor(executor),
-    m_throttledUpdate(m_executor, 25, [&] { m_update(); })
+    m_throttledUpdate(m_executor, 25, [&] { m_update(); }),
+    m_listeners(ListenerPool::DefaultThreadCount(), [this] { m_throttledUpdate(); })
 {
+    // the loopback is a special LogSource that is never added to m_sources
+    m_sourceRegistry.Add(m_loopback->GetSourceId());
     m_processMonitor.ConnectProcessEnded([this](DWORD pid, HANDLE handle) { OnProcessEnded(pid, handle); });
     if (startListening)
     {
@@ -84,6 +96,8 @@ void LogSources::UpdateSettings(const std::unique_ptr<LogSource>& pSource)
 
 void LogSources::Add(std::unique_ptr<LogSource> pSource)
 {
+    // lines that a source adds before the listening thread picks it up are not dropped
+    m_sourceRegistry.Add(pSource->GetSourceId());
     {
         std::lock_guard<std::mutex> lock(m_sourcesSchedule_mutex);
         m_sourcesScheduleToAdd.emplace_back(std::move(pSource));
@@ -165,6 +179,7 @@ void LogSources::Abort()
     m_processMonitor.Abort();
     m_update.disconnect_all_slots();
     m_end = true;
+    m_listeners.Abort();
 
     CallSources([](LogSource* logsource) { logsource->Abort(); });
     RemoveSources([](LogSource* /*unused*/) { return true; });
@@ -205,52 +220,9 @@ void LogSources::Listen()
 void LogSources::ListenUntilUpdateEvent()
 {
     UpdateSources();
-
-    std::vector<HANDLE> waitHandles;
-    std::vector<LogSource*> sources;
-    {
-        for (auto& source : m_sources)
-        {
-            if (source->AtEnd())
-            {
-                continue;
-            }
-            HANDLE handle = source->GetHandle();
-            assert(handle != nullptr && "GetHandle() cant return nullptr");
-            if (handle != INVALID_HANDLE_VALUE)
-            {
-                waitHandles.push_back(handle);
-                sources.push_back(source.get());
-            }
-            // here LogSource::Initialize is called on the m_listenThread, currently only FileReader::Initialize uses this to start reading from the file.
-            // This will block all other logsources while the file is being read (which is normally not a problem)
-            source->Initialize();
-        }
-    }
-
-    auto updateEventIndex = waitHandles.size();
-    waitHandles.push_back(m_updateEvent.get());
-    while (!m_end)
+    if (!m_end)
     {
-        auto res = Win32::WaitForAnyObject(waitHandles, INFINITE);
-        if (m_end)
-        {
-            return;
-        }
-
-        if (res.signaled)
-        {
-            int index = res.index - WAIT_OBJECT_0;
-            if (index == updateEventIndex)
-            {
-                break;
-            }
-
-            assert((index < static_cast<int>(sources.size())) && "res.index out of range");
-            auto logsource = sources[index];
-            logsource->Notify();
-            m_throttledUpdate();
-        }
+        Win32::WaitForSingleObject(m_updateEvent);
     }
 }
 
@@ -266,9 +238,11 @@ void LogSources::UpdateSources()
 
     if (m_end)
     {
+        m_listeners.Abort();
         for (auto const& pLogSource : m_sources)
         {
             pLogSource->Abort();
+            m_sourceRegistry.Remove(pLogSource->GetSourceId());
         }
         m_sources.clear();
         return;
@@ -276,6 +250,8 @@ void LogSources::UpdateSources()
 
     for (auto pLogSource : sourcesToRemove)
     {
+        m_listeners.Remove(pLogSource);
+        m_sourceRegistry.Remove(pLogSource->GetSourceId());
         pLogSource->Abort();
         InternalRemove(pLogSource);
     }
@@ -283,6 +259,7 @@ void LogSources::UpdateSources()
     for (auto&& pLogSource : sourcesToAdd)
     {
         UpdateSettings(pLogSource);
+        m_listeners.Add(pLogSource.get());
         m_sources.emplace_back(std::move(pLogSource));
     }
 
@@ -343,42 +320,40 @@ void LogSources::OnProcessEnded(DWORD pid, HANDLE handle)
         }
         AddTerminateMessage(pid, handle);
         m_throttledUpdate();
-        auto it = m_pidMap.find(pid);
-        if (it != m_pidMap.end())
-        {
-            m_pidMap.erase(it);
-        }
-    });
-}
-
-bool LogSources::IsRemoved(const LogSource* logsource) const
-{
-    // the loopback is a special LogSource that is never added to m_sources
-    if (logsource == m_loopback.get())
-        return false;
-
-    bool present = false;
-    CallSources([&](const LogSource* l) {
-        if (l == logsource)
-        {
-            present = true;
-        }
+        m_pidMap.Remove(pid);
     });
-    return !present;
 }
 
 Lines LogSources::GetLines()
 {
     assert(m_executor.IsExecutorThread());
+    static auto& drainLines = GetMetrics().GetHistogram("getlines.lines");
+    static auto& drainTime = GetMetrics().GetHistogram("getlines.us");
+    static auto& newlineTime = GetMetrics().GetHistogram("newline.us");
+    static auto& bufferDepth = GetMetrics().GetGauge("linebuffer.depth");
+    ScopedTimer timer(drainTime);
     Lines lines;
 
-    for (auto&& inputLine : m_linebuffer.GetLines())
+    // one snapshot of the live sources per batch, lines of sources removed in the meantime are dropped
+    if (m_sourceRegistry.Update(m_liveSources))
+    {
+        RemoveSourceMetrics();
+    }
+    auto inputLines = m_linebuffer.GetLines();
+    ListenerPool::Merge(inputLines);
+    bufferDepth.Set(static_cast<int64_t>(inputLines.size()));
+    drainLines.Record(inputLines.size());
+    auto now = m_timer.Get();
+    std::chrono::steady_clock::duration newlineDuration {};
+    for (auto&& inputLine : inputLines)
     {
-        if (IsRemoved(inputLine.pLogSource))
+        if (!m_liveSources.Contains(inputLine.sourceId))
         {
             std::cerr << "'" << inputLine.message << "' ignored because source was removed\n";
             continue;
         }
+        RecordLatency(LatencyStage::Drain, inputLine.ingestTicks);
+
         // let the logsource decide how to create processname
         if (inputLine.pLogSource != nullptr)
         {
@@ -387,21 +362,33 @@ Lines LogSources::GetLines()
 
         if (inputLine.handle != nullptr)
         {
-            Win32::Handle handle(inputLine.handle);
-            inputLine.pid = GetProcessId(inputLine.handle);
-
-            auto it = m_pidMap.find(inputLine.pid);
-            if (it == m_pidMap.end())
+            HANDLE handle = inputLine.handle;
+            inputLine.pid = GetProcessId(handle);
+            if (m_pidMap.Add(inputLine.pid, Win32::Handle(handle), inputLine.processName))
             {
-                m_pidMap[inputLine.pid] = std::move(handle);
-                m_processMonitor.Add(inputLine.pid, inputLine.handle);
+                m_processMonitor.Add(inputLine.pid, handle);
             }
             else
             {
-                inputLine.handle = nullptr;
+                inputLine.handle = nullptr; // closed by m_pidMap, the process already has a handle
             }
         }
 
+        if (m_pRecorder)
+        {
+            m_pRecorder->Write(inputLine);
+        }
+
+        auto& sourceMetrics = GetSourceMetrics(inputLine);
+        sourceMetrics.lines.Add();
+        sourceMetrics.bytes.Add(inputLine.message.size());
+
+        // internal messages, including the suppression reports, and empty lines, that only carry a process handle, are never limited
+        if (m_rateLimiter.IsEnabled() && inputLine.pLogSource != m_loopback.get() && !inputLine.message.empty() && !m_rateLimiter.Admit(inputLine, now))
+        {
+            continue;
+        }
+
         if (inputLine.message.empty())
         {
             lines.emplace_back(std::move(inputLine));
@@ -412,20 +399,68 @@ Lines LogSources::GetLines()
             // multiple lines, in this case the timestamp for each line is the same.
             // NewlineFilter::Process will also eat any \r\n's
 
+            auto start = std::chrono::steady_clock::now();
             for (auto&& line : m_newlineFilter.Process(std::move(inputLine)))
             {
                 lines.emplace_back(std::move(line));
             }
+            newlineDuration += std::chrono::steady_clock::now() - start;
         }
     }
+    newlineTime.Record(GetMicroseconds(newlineDuration));
 
+    if (m_rateLimiter.IsEnabled())
+    {
+        for (auto& suppression : m_rateLimiter.TakeSuppressions(now))
+        {
+            AddMessage(suppression.pid, suppression.processName, stringbuilder() << "<" << suppression.count << " lines suppressed from " << suppression.processName << ">");
+        }
+    }
     return lines;
 }
 
+LogSources::SourceMetrics& LogSources::GetSourceMetrics(const Line& line)
+{
+    auto it = m_sourceMetrics.find(line.sourceId);
+    if (it == m_sourceMetrics.end())
+    {
+        auto name = "source." + (line.pLogSource != nullptr ? Str(line.pLogSource->GetDescription()).str() : std::to_string(line.sourceId));
+        auto& metrics = GetMetrics();
+        it = m_sourceMetrics.emplace(line.sourceId, SourceMetrics{name, metrics.GetCounter(name + ".lines"), metrics.GetCounter(name + ".bytes")}).first;
+    }
+    return it->second;
+}
+
+// drops the metrics of removed sources, unless a live source with the same description still reports to them
+void LogSources::RemoveSourceMetrics()
+{
+    std::vector<std::string> names;
+    for (auto it = m_sourceMetrics.begin(); it != m_sourceMetrics.end();)
+    {
+        if (m_liveSources.Contains(it->first))
+        {
+            ++it;
+            continue;
+        }
+        names.push_back(it->second.name);
+        it = m_sourceMetrics.erase(it);
+    }
+
+    auto& metrics = GetMetrics();
+    for (auto& name : names)
+    {
+        if (std::none_of(m_sourceMetrics.begin(), m_sourceMetrics.end(), [&name](const auto& item) { return item.second.name == name; }))
+        {
+            metrics.Remove(name + ".lines");
+            metrics.Remove(name + ".bytes");
+        }
+    }
+}
+
 DBWinReader* LogSources::AddDBWinReader(bool global)
 {
     assert(m_executor.IsExecutorThread());
-    auto pDbWinReader = std::make_unique<DBWinReader>(m_timer, m_linebuffer, global);
+    auto pDbWinReader = std::make_unique<DBWinReader>(m_timer, m_linebuffer, global, &m_pidMap);
     auto pResult = pDbWinReader.get();
     Add(std::move(pDbWinReader));
     return pResult;
@@ -440,6 +475,15 @@ KernelReader* LogSources::AddKernelReader()
     return pResult;
 }
 
+ShmRingReader* LogSources::AddShmRingReader(const std::string& name)
+{
+    assert(m_executor.IsExecutorThread());
+    auto pRingReader = std::make_unique<ShmRingReader>(m_timer, m_linebuffer, name, &m_pidMap);
+    auto pResult = pRingReader.get();
+    Add(std::move(pRingReader));
+    return pResult;
+}
+
 TestSource* LogSources::AddTestSource()
 {
     assert(m_executor.IsExecutorThread());
@@ -451,6 +495,33 @@ TestSource* LogSources::AddTestSource()
     return pResult;
 }
 
+ReplaySource* LogSources::AddReplaySource(const std::wstring& filename, double speed)
+{
+    assert(m_executor.IsExecutorThread());
+    auto pReplaySource = std::make_unique<ReplaySource>(m_timer, m_linebuffer, filename, speed);
+    auto pResult = pReplaySource.get();
+    Add(std::move(pReplaySource));
+    return pResult;
+}
+
+void LogSources::StartRecording(const std::wstring& filename)
+{
+    assert(m_executor.IsExecutorThread());
+    m_pRecorder = std::make_unique<TraceWriter>(filename);
+}
+
+void LogSources::SetRateLimits(const RateLimitSettings& settings)
+{
+    assert(m_executor.IsExecutorThread());
+    m_rateLimiter.SetSettings(settings);
+}
+
+void LogSources::StopRecording()
+{
+    assert(m_executor.IsExecutorThread());
+    m_pRecorder.reset();
+}
+
 ProcessReader* LogSources::AddProcessReader(const std::wstring& pathName, const std::wstring& args)
 {
     assert(m_executor.IsExecutorThread());
@@ -499,10 +570,22 @@ AnyFileReader* LogSources::AddAnyFileReader(const std::wstring& filename, bool k
     return pResult;
 }
 
+MergeFileReader* LogSources::AddMergeFileReader(const std::vector<std::wstring>& filenames)
+{
+    assert(m_executor.IsExecutorThread());
+    AddMessage(stringbuilder() << "Merging " << filenames.size() << " files by time\n");
+
+    auto pMergeFileReader = std::make_unique<MergeFileReader>(m_timer, m_linebuffer, filenames);
+    pMergeFileReader->SubscribeToUpdate([&]() { m_throttledUpdate(); });
+    auto pResult = pMergeFileReader.get();
+    Add(std::move(pMergeFileReader));
+    return pResult;
+}
+
 PipeReader* LogSources::AddPipeReader(DWORD pid, HANDLE hPipe)
 {
     assert(m_executor.IsExecutorThread());
-    auto pPipeReader = std::make_unique<PipeReader>(m_timer, m_linebuffer, hPipe, pid, Str(ProcessInfo::GetProcessNameByPid(pid)).str(), 40);
+    auto pPipeReader = std::make_unique<PipeReader>(m_timer, m_linebuffer, hPipe, pid, Str(ProcessInfo::GetProcessNameByPid(pid)).str());
     auto pResult = pPipeReader.get();
     Add(std::move(pPipeReader));
     return pResult;
@@ -518,13 +601,23 @@ DbgviewReader* LogSources::AddDbgviewReader(const std::string& hostname)
     return pResult;
 }
 
-SocketReader* LogSources::AddUDPReader(int port)
+UdpReader* LogSources::AddUDPReader(int port)
+{
+    assert(m_executor.IsExecutorThread());
+    auto pUdpReader = std::make_unique<UdpReader>(m_timer, m_linebuffer, port);
+    m_loopback->Add(stringbuilder() << "Source '" << pUdpReader->GetDescription() << "' was added.");
+    auto pResult = pUdpReader.get();
+    Add(std::move(pUdpReader));
+    return pResult;
+}
+
+TcpReader* LogSources::AddTCPReader(int port)
 {
     assert(m_executor.IsExecutorThread());
-    auto pSocketReader = std::make_unique<SocketReader>(m_timer, m_linebuffer, port);
-    m_loopback->Add(stringbuilder() << "Source '" << pSocketReader->GetDescription() << "' was added.");
-    auto pResult = pSocketReader.get();
-    Add(std::move(pSocketReader));
+    auto pTcpReader = std::make_unique<TcpReader>(m_timer, m_linebuffer, port);
+    m_loopback->Add(stringbuilder() << "Source '" << pTcpReader->GetDescription() << "' was added.");
+    auto pResult = pTcpReader.get();
+    Add(std::move(pTcpReader));
     return pResult;
 }
 
@@ -0,0 +1,99 @@
+// (C) Copyright Gert-Jan de Vos and Jan Wilmans 2013.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#include <limits>
+#include "DebugViewppLib/MemoryGovernor.h"
+#include "DebugViewppLib/Metrics.h"
+
+namespace fusion {
+namespace debugviewpp {
+
+const char* MemoryGovernor::GetName(Action action)
+{
+    switch (action)
+    {
+    case Action::ShrinkCaches: return "shrink-caches";
+    case Action::CompressWriteBlock: return "compress-write-block";
+    case Action::SpillBlocks: return "spill-blocks";
+    case Action::EvictHistory: return "evict-history";
+    default: break;
+    }
+    return "none";
+}
+
+size_t MemoryGovernor::MegabytesToBytes(uint64_t megabytes)
+{
+    const uint64_t megabyte = 1024 * 1024;
+    if (megabytes > std::numeric_limits<size_t>::max() / megabyte)
+    {
+        return std::numeric_limits<size_t>::max();
+    }
+    return static_cast<size_t>(megabytes * megabyte);
+}
+
+void MemoryGovernor::SetLimit(size_t limit)
+{
+    m_limit = limit;
+    m_acting = false;
+    GetMetrics().GetGauge("memory.limit").Set(static_cast<int64_t>(limit));
+}
+
+size_t MemoryGovernor::GetLimit() const
+{
+    return m_limit;
+}
+
+void MemoryGovernor::Account(const std::string& component, size_t bytes)
+{
+    m_components[component] = bytes;
+    GetMetrics().GetGauge("memory." + component).Set(static_cast<int64_t>(bytes));
+}
+
+size_t MemoryGovernor::GetTotal() const
+{
+    size_t total = 0;
+    for (auto& component : m_components)
+    {
+        total += component.second;
+    }
+    return total;
+}
+
+size_t MemoryGovernor::GetLowMark() const
+{
+    return m_limit - m_limit / 10;
+}
+
+size_t MemoryGovernor::GetExcess() const
+{
+    auto total = GetTotal();
+    if (m_limit == 0 || (total <= m_limit && !m_acting) || total <= GetLowMark())
+    {
+        return 0;
+    }
+    return total - GetLowMark();
+}
+
+void MemoryGovernor::BeginRound()
+{
+    m_action = Action::None;
+    GetMetrics().GetGauge("memory.total").Set(static_cast<int64_t>(GetTotal()));
+}
+
+MemoryGovernor::Action MemoryGovernor::Next()
+{
+    m_acting = GetExcess() != 0;
+    if (!m_acting || m_action == Action::EvictHistory)
+    {
+        return Action::None;
+    }
+
+    m_action = static_cast<Action>(static_cast<int>(m_action) + 1);
+    GetMetrics().GetCounter(std::string("memory.action.") + GetName(m_action)).Add();
+    return m_action;
+}
+
+} // namespace debugviewpp
+} // namespace fusion
@@ -0,0 +1,265 @@
+// (C) Copyright Gert-Jan de Vos and Jan Wilmans 2013.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include "CobaltFusion/Str.h"
+#include "CobaltFusion/stringbuilder.h"
+#include "DebugViewppLib/Conversions.h"
+#include "DebugViewppLib/FileIO.h"
+#include "DebugViewppLib/MergeFileReader.h"
+
+namespace fusion {
+namespace debugviewpp {
+
+struct MergeFileReader::File
+{
+    std::wstring filename;
+    std::string filenameOnly;
+    FileType::type fileType;
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::deque<Line> lines; // the read-ahead window, protected by 'mutex' like 'end' and 'abort'
+    bool end = false;
+    bool abort = false;
+    std::thread thread;
+};
+
+MergeFileReader::MergeFileReader(Timer& timer, ILineBuffer& linebuffer, const std::vector<std::wstring>& filenames) :
+    LogSource(timer, SourceType::File, linebuffer)
+{
+    SetDescription(wstringbuilder() << L"Merge of " << filenames.size() << L" files");
+    for (auto& filename : filenames)
+    {
+        m_files.emplace_back(std::make_unique<File>());
+        auto& file = *m_files.back();
+        file.filename = filename;
+        file.filenameOnly = Str(std::filesystem::path(filename).filename().wstring()).str();
+        file.fileType = IdentifyFile(filename);
+    }
+
+    for (auto& pFile : m_files)
+    {
+        pFile->thread = std::thread([this, &file = *pFile] { Read(file); });
+    }
+    m_thread = std::thread([this] { Merge(); });
+}
+
+MergeFileReader::~MergeFileReader()
+{
+    Abort();
+}
+
+boost::signals2::connection MergeFileReader::SubscribeToUpdate(UpdateSignal::slot_type slot)
+{
+    return m_update.connect(slot);
+}
+
+void MergeFileReader::Abort()
+{
+    LogSource::Abort();
+    for (auto& pFile : m_files)
+    {
+        std::lock_guard<std::mutex> lock(pFile->mutex);
+        pFile->abort = true;
+        pFile->cv.notify_all();
+    }
+
+    if (m_thread.joinable())
+    {
+        m_thread.join();
+    }
+    for (auto& pFile : m_files)
+    {
+        if (pFile->thread.joinable())
+        {
+            pFile->thread.join();
+        }
+    }
+}
+
+HANDLE MergeFileReader::GetHandle() const
+{
+    return INVALID_HANDLE_VALUE;
+}
+
+void MergeFileReader::Notify()
+{
+}
+
+// the same line parsing as AnyFileReader, except for the relative time that Merge() derives from the merged order
+void MergeFileReader::Read(File& file)
+{
+    FILETIME lastTime = FILETIME();
+    auto error = [&](const std::string& message) {
+        Line line;
+        line.systemTime = lastTime;
+        line.processName = file.filenameOnly;
+        line.message = message;
+        Push(file, std::move(line));
+    };
+
+    std::ifstream is(std::filesystem::path(file.filename));
+    switch (file.fileType)
+    {
+    case FileType::Unknown:
+        if (!is)
+        {
+            error("Unable to open '" + Str(file.filename).str() + "'");
+        }
+        break;
+    case FileType::UTF16BE:
+    case FileType::UTF16LE:
+        error("UTF-16 encoded files cannot be merged");
+        break;
+    case FileType::UTF8:
+        is.seekg(3); // byte order mark
+        break;
+    default:
+        break;
+    }
+
+    if (file.fileType != FileType::UTF16BE && file.fileType != FileType::UTF16LE)
+    {
+        USTimeConverter converter;
+        long linenumber = 0;
+        std::string data;
+        while (std::getline(is, data))
+        {
+            ++linenumber;
+            if (!data.empty() && data.back() == '\r')
+            {
+                data.pop_back();
+            }
+
+            Line line;
+            try
+            {
+                switch (file.fileType)
+                {
+                case FileType::Sysinternals:
+                    ReadSysInternalsLogFileMessage(data, line, converter);
+                    break;
+                case FileType::DebugViewPP1:
+                case FileType::DebugViewPP2:
+                    if (linenumber == 1) // ignore the header line
+                    {
+                        continue;
+                    }
+                    ReadLogFileMessage(data, line);
+                    break;
+                default:
+                    line.systemTime = lastTime;
+                    line.message = data;
+                    break;
+                }
+            }
+            catch (std::exception& e)
+            {
+                line.systemTime = lastTime;
+                line.message = stringbuilder() << "Error parsing line: " << e.what();
+            }
+
+            line.processName = file.filenameOnly;
+            lastTime = line.systemTime;
+            if (!Push(file, std::move(line)))
+            {
+                return;
+            }
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(file.mutex);
+    file.end = true;
+    file.cv.notify_all();
+}
+
+// waits for room in the window of 'file', returns false if the merge was aborted
+bool MergeFileReader::Push(File& file, Line&& line)
+{
+    std::unique_lock<std::mutex> lock(file.mutex);
+    file.cv.wait(lock, [&file] { return file.lines.size() < ReadAhead || file.abort; });
+    if (file.abort)
+    {
+        return false;
+    }
+    file.lines.push_back(std::move(line));
+    file.cv.notify_all();
+    return true;
+}
+
+// waits for the next line of 'file', returns false at the end of the file or if the merge was aborted
+bool MergeFileReader::Next(File& file, Line& line)
+{
+    std::unique_lock<std::mutex> lock(file.mutex);
+    file.cv.wait(lock, [&file] { return !file.lines.empty() || file.end || file.abort; });
+    if (file.lines.empty() || file.abort)
+    {
+        return false;
+    }
+    line = std::move(file.lines.front());
+    file.lines.pop_front();
+    file.cv.notify_all();
+    return true;
+}
+
+// a k-way merge over the heads of the files, lines with the same time keep the order of their files
+void MergeFileReader::Merge()
+{
+    std::vector<Line> heads(m_files.size());
+    std::vector<size_t> heap;
+    auto later = [&heads](size_t a, size_t b) {
+        auto timeA = FileTimeToUInt64(heads[a].systemTime);
+        auto timeB = FileTimeToUInt64(heads[b].systemTime);
+        return timeA != timeB ? timeA > timeB : a > b;
+    };
+
+    for (size_t i = 0; i < m_files.size(); ++i)
+    {
+        if (Next(*m_files[i], heads[i]))
+        {
+            heap.push_back(i);
+        }
+    }
+    std::make_heap(heap.begin(), heap.end(), later);
+
+    // the relative time counts from the earliest line of all files
+    FILETIME firstTime = FILETIME();
+    int count = 0;
+    while (!heap.empty())
+    {
+        std::pop_heap(heap.begin(), heap.end(), later);
+        auto i = heap.back();
+        auto& line = heads[i];
+        if (firstTime == FILETIME())
+        {
+            firstTime = line.systemTime;
+        }
+        auto time = line.systemTime == FILETIME() ? line.time : GetDifference(firstTime, line.systemTime);
+        Add(time, line.systemTime, line.pid, line.processName, line.message);
+
+        if (Next(*m_files[i], line))
+        {
+            std::push_heap(heap.begin(), heap.end(), later);
+        }
+        else
+        {
+            heap.pop_back();
+        }
+
+        if ((++count % 5000) == 0)
+        {
+            m_update();
+        }
+    }
+    m_update();
+}
+
+} // namespace debugviewpp
+} // namespace fusion
@@ -0,0 +1,295 @@
+// (C) Copyright Gert-Jan de Vos and Jan Wilmans 2013.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#include <algorithm>
+#include <bit>
+#include <cstdio>
+#include "DebugViewppLib/Metrics.h"
+#include "DebugViewppLib/StreamWriter.h"
+
+namespace fusion {
+namespace debugviewpp {
+
+namespace {
+
+size_t GetThreadSlot()
+{
+    static std::atomic<size_t> nextSlot = 0;
+    thread_local size_t slot = nextSlot++ % Counter::Slots;
+    return slot;
+}
+
+void AppendJsonSection(std::string& json, const MetricsSnapshot& snapshot, MetricType type, const char* name)
+{
+    json += ",\"";
+    json += name;
+    json += "\":{";
+    bool first = true;
+    for (auto& value : snapshot.values)
+    {
+        if (value.type != type)
+        {
+            continue;
+        }
+        if (!first)
+        {
+            json += ',';
+        }
+        first = false;
+        AppendJsonString(json, value.name);
+        json += ':';
+        if (type == MetricType::Histogram)
+        {
+            auto& h = value.histogram;
+            json += "{\"count\":" + std::to_string(h.count) + ",\"sum\":" + std::to_string(h.sum) + ",\"max\":" + std::to_string(h.max) +
+                    ",\"p50\":" + std::to_string(h.p50) + ",\"p90\":" + std::to_string(h.p90) + ",\"p99\":" + std::to_string(h.p99) + "}";
+        }
+        else
+        {
+            json += std::to_string(value.value);
+        }
+    }
+    json += '}';
+}
+
+} // namespace
+
+void Counter::Add(uint64_t value)
+{
+    m_slots[GetThreadSlot()].value.fetch_add(value, std::memory_order_relaxed);
+}
+
+uint64_t Counter::Get() const
+{
+    uint64_t sum = 0;
+    for (auto& slot : m_slots)
+    {
+        sum += slot.value.load(std::memory_order_relaxed);
+    }
+    return sum;
+}
+
+void Gauge::Set(int64_t value)
+{
+    m_value.store(value, std::memory_order_relaxed);
+}
+
+int64_t Gauge::Get() const
+{
+    return m_value.load(std::memory_order_relaxed);
+}
+
+size_t Histogram::GetBucket(uint64_t value)
+{
+    if (value < SubBuckets)
+    {
+        return static_cast<size_t>(value);
+    }
+    auto shift = static_cast<size_t>(std::bit_width(value)) - 1 - SubBucketBits;
+    return SubBuckets + shift * SubBuckets + static_cast<size_t>(value >> shift) - SubBuckets;
+}
+
+uint64_t Histogram::GetUpperBound(size_t bucket)
+{
+    if (bucket < SubBuckets)
+    {
+        return bucket;
+    }
+    auto shift = (bucket - SubBuckets) / SubBuckets;
+    auto subBucket = (bucket - SubBuckets) % SubBuckets;
+    return ((SubBuckets + subBucket + 1) << shift) - 1;
+}
+
+void Histogram::Record(uint64_t value)
+{
+    m_buckets[GetBucket(value)].fetch_add(1, std::memory_order_relaxed);
+    m_count.fetch_add(1, std::memory_order_relaxed);
+    m_sum.fetch_add(value, std::memory_order_relaxed);
+    auto max = m_max.load(std::memory_order_relaxed);
+    while (value > max && !m_max.compare_exchange_weak(max, value, std::memory_order_relaxed))
+    {
+    }
+}
+
+HistogramSummary Histogram::GetSummary() const
+{
+    HistogramSummary summary;
+    std::array<uint64_t, Buckets> buckets;
+    for (size_t i = 0; i < Buckets; ++i)
+    {
+        buckets[i] = m_buckets[i].load(std::memory_order_relaxed);
+        summary.count += buckets[i];
+    }
+    summary.sum = m_sum.load(std::memory_order_relaxed);
+    summary.max = m_max.load(std::memory_order_relaxed);
+
+    auto percentile = [&](uint64_t permille) {
+        auto rank = (summary.count * permille + 999) / 1000;
+        uint64_t seen = 0;
+        for (size_t i = 0; i < Buckets; ++i)
+        {
+            seen += buckets[i];
+            if (seen >= rank && seen > 0)
+            {
+                return std::min(GetUpperBound(i), summary.max);
+            }
+        }
+        return summary.max;
+    };
+    summary.p50 = percentile(500);
+    summary.p90 = percentile(900);
+    summary.p99 = percentile(990);
+    return summary;
+}
+
+uint64_t GetMicroseconds(std::chrono::steady_clock::duration duration)
+{
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(duration).count());
+}
+
+ScopedTimer::ScopedTimer(Histogram& histogram) :
+    m_histogram(histogram),
+    m_start(std::chrono::steady_clock::now())
+{
+}
+
+ScopedTimer::~ScopedTimer()
+{
+    m_histogram.Record(GetMicroseconds(std::chrono::steady_clock::now() - m_start));
+}
+
+MetricsRegistry::MetricsRegistry() :
+    m_start(std::chrono::steady_clock::now())
+{
+}
+
+template <typename T>
+T& GetOrCreate(std::map<std::string, std::unique_ptr<T>>& metrics, const std::string& name)
+{
+    auto& pMetric = metrics[name];
+    if (!pMetric)
+    {
+        pMetric = std::make_unique<T>();
+    }
+    return *pMetric;
+}
+
+Counter& MetricsRegistry::GetCounter(const std::string& name)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return GetOrCreate(m_counters, name);
+}
+
+Gauge& MetricsRegistry::GetGauge(const std::string& name)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return GetOrCreate(m_gauges, name);
+}
+
+Histogram& MetricsRegistry::GetHistogram(const std::string& name)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return GetOrCreate(m_histograms, name);
+}
+
+void MetricsRegistry::Remove(const std::string& name)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_counters.erase(name);
+    m_gauges.erase(name);
+    m_histograms.erase(name);
+}
+
+MetricsSnapshot MetricsRegistry::Sample() const
+{
+    MetricsSnapshot snapshot;
+    snapshot.time = std::chrono::duration<double>(std::chrono::steady_clock::now() - m_start).count();
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    snapshot.values.reserve(m_counters.size() + m_gauges.size() + m_histograms.size());
+    for (auto& [name, pCounter] : m_counters)
+    {
+        MetricValue value;
+        value.name = name;
+        value.type = MetricType::Counter;
+        value.value = static_cast<int64_t>(pCounter->Get());
+        snapshot.values.push_back(std::move(value));
+    }
+    for (auto& [name, pGauge] : m_gauges)
+    {
+        MetricValue value;
+        value.name = name;
+        value.type = MetricType::Gauge;
+        value.value = pGauge->Get();
+        snapshot.values.push_back(std::move(value));
+    }
+    for (auto& [name, pHistogram] : m_histograms)
+    {
+        MetricValue value;
+        value.name = name;
+        value.type = MetricType::Histogram;
+        value.histogram = pHistogram->GetSummary();
+        snapshot.values.push_back(std::move(value));
+    }
+    return snapshot;
+}
+
+MetricsRegistry& GetMetrics()
+{
+    static MetricsRegistry registry;
+    return registry;
+}
+
+MetricsHistory::MetricsHistory(size_t capacity) :
+    m_capacity(capacity)
+{
+}
+
+void MetricsHistory::Add(MetricsSnapshot snapshot)
+{
+    m_snapshots.push_back(std::move(snapshot));
+    while (m_snapshots.size() > m_capacity)
+    {
+        m_snapshots.pop_front();
+    }
+}
+
+const std::deque<MetricsSnapshot>& MetricsHistory::GetSnapshots() const
+{
+    return m_snapshots;
+}
+
+std::string ToJson(const MetricsSnapshot& snapshot)
+{
+    char time[32];
+    std::snprintf(time, sizeof(time), "%.3f", snapshot.time);
+    std::string json = "{\"time\":";
+    json += time;
+    AppendJsonSection(json, snapshot, MetricType::Counter, "counters");
+    AppendJsonSection(json, snapshot, MetricType::Gauge, "gauges");
+    AppendJsonSection(json, snapshot, MetricType::Histogram, "histograms");
+    json += '}';
+    return json;
+}
+
+std::string ToJson(const MetricsHistory& history)
+{
+    std::string json = "[";
+    bool first = true;
+    for (auto& snapshot : history.GetSnapshots())
+    {
+        if (!first)
+        {
+            json += ',';
+        }
+        first = false;
+        json += ToJson(snapshot);
+    }
+    json += ']';
+    return json;
+}
+
+} // namespace debugviewpp
+} // namespace fusion
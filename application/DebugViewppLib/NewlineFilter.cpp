@@ -4,6 +4,7 @@
 // http://www.boost.org/LICENSE_1_0.txt)
 
 #include "CobaltFusion/stringbuilder.h"
+#include "DebugViewppLib/LatencyTrace.h"
 #include "DebugViewppLib/LogSource.h"
 #include "DebugViewppLib/ProcessInfo.h"
 #include "DebugViewppLib/NewlineFilter.h"
@@ -28,6 +29,7 @@ Lines NewlineFilter::Process(const Line& line)
         if (c == '\n')
         {
             Line outputLine(line.time, line.systemTime, line.pid, line.processName, "", line.pLogSource);
+            outputLine.ingestTicks = line.ingestTicks;
             std::swap(outputLine.message, message);
             lines.emplace_back(std::move(outputLine));
         }
@@ -42,10 +44,12 @@ Lines NewlineFilter::Process(const Line& line)
         if (line.pLogSource->GetAutoNewLine() || message.size() > 8192) // 8k line limit prevents stack overflow in handling code
         {
             Line outputLine(line.time, line.systemTime, line.pid, line.processName, "", line.pLogSource);
+            outputLine.ingestTicks = line.ingestTicks;
             std::swap(outputLine.message, message);
             lines.emplace_back(std::move(outputLine));
         }
     }
+    RecordLatency(LatencyStage::Newline, line.ingestTicks);
     return lines;
 }
 
@@ -8,64 +8,110 @@
 #include "DebugViewppLib/PipeReader.h"
 #include "DebugViewppLib/LineBuffer.h"
 #include <array>
+#include <chrono>
 
 namespace fusion {
 namespace debugviewpp {
 
-PipeReader::PipeReader(Timer& timer, ILineBuffer& linebuffer, HANDLE hPipe, DWORD pid, const std::string& processName, long pollFrequency) :
-    PolledLogSource(timer, SourceType::Pipe, linebuffer, pollFrequency),
+// lines longer than this are split, like the NewlineFilter does
+constexpr size_t MaxLineLength = 4000;
+
+PipeReader::PipeReader(Timer& timer, ILineBuffer& linebuffer, HANDLE hPipe, DWORD pid, const std::string& processName) :
+    PipeReader(timer, linebuffer, hPipe, pid, processName, *this)
+{
+}
+
+PipeReader::PipeReader(Timer& timer, ILineBuffer& linebuffer, HANDLE hPipe, DWORD pid, const std::string& processName, PolledLogSource& target) :
+    PolledLogSource(timer, SourceType::Pipe, linebuffer, 0),
     m_hPipe(hPipe),
     m_pid(pid),
-    m_process(processName)
+    m_process(processName),
+    m_target(target)
 {
     SetDescription(wstringbuilder() << L"Piped from " << processName);
-    StartThread();
+    m_thread = std::thread([this] { Read(); });
 }
 
-PipeReader::~PipeReader() = default;
+PipeReader::~PipeReader()
+{
+    PipeReader::Abort();
+}
 
 bool PipeReader::AtEnd() const
 {
-    return LogSource::AtEnd() || PeekNamedPipe(m_hPipe, nullptr, 0, nullptr, nullptr, nullptr) == FALSE;
+    return LogSource::AtEnd() || m_done;
 }
 
-void PipeReader::Poll()
+void PipeReader::Abort()
 {
-    Poll(*this);
+    using namespace std::chrono_literals;
+
+    LogSource::Abort();
+    if (m_thread.joinable())
+    {
+        // a blocking ReadFile can only be interrupted from another thread,
+        // keep cancelling in case the reader thread was just about to start the next read
+        while (!m_done)
+        {
+            CancelSynchronousIo(m_thread.native_handle());
+            std::this_thread::sleep_for(1ms);
+        }
+        m_thread.join();
+    }
+    PolledLogSource::Abort();
 }
 
-void PipeReader::Poll(PolledLogSource& logsource)
+void PipeReader::Read()
 {
     std::array<char, 4096> buf;
-
-    // copy m_buffer into 'buf', set 'start' to the position one past the last element copied
-    char* start = std::copy(m_buffer.data(), m_buffer.data() + m_buffer.size(), buf.data());
-
-    DWORD avail = 0;
-    while ((PeekNamedPipe(m_hPipe, nullptr, 0, nullptr, &avail, nullptr) != 0) && avail > 0)
+    while (!LogSource::AtEnd())
     {
-        auto size = static_cast<DWORD>(buf.data() + sizeof(buf) - start);
         DWORD read = 0;
-        ReadFile(m_hPipe, start, size, &read, nullptr);
-
-        char* begin = buf.data();
-        char* end = start + read;
-        char* p = start;
-        while (p != end)
+        if (ReadFile(m_hPipe, buf.data(), static_cast<DWORD>(buf.size()), &read, nullptr) == FALSE)
         {
-            if (*p == '\0' || *p == '\n' || p - begin > 4000)
-            {
-                logsource.AddMessage(m_pid, m_process, std::string(begin, p));
-                begin = p + 1;
-            }
-            ++p;
+            break; // ERROR_BROKEN_PIPE when the writing end is closed, ERROR_OPERATION_ABORTED when cancelled by Abort()
         }
-        start = std::copy(begin, end, buf.data());
+        AddLines(buf.data(), buf.data() + read);
     }
-    // keep remainer of line for next poll()
-    m_buffer = std::string(buf.data(), start);
+
+    if (!m_buffer.empty())
+    {
+        m_target.AddMessage(m_pid, m_process, m_buffer);
+        m_buffer.clear();
+    }
+    m_target.Signal();
+    m_done = true;
 }
 
+void PipeReader::AddLines(const char* begin, const char* end)
+{
+    std::vector<std::string> messages;
+    for (const char* p = begin; p != end; ++p)
+    {
+        if (*p == '\0' || *p == '\n')
+        {
+            m_buffer.append(begin, p);
+            messages.push_back(std::move(m_buffer));
+            m_buffer.clear();
+            begin = p + 1;
+        }
+        else if (m_buffer.size() + (p - begin) >= MaxLineLength)
+        {
+            m_buffer.append(begin, p);
+            messages.push_back(std::move(m_buffer));
+            m_buffer.clear();
+            begin = p;
+        }
+    }
+    // keep remainder of line for the next read
+    m_buffer.append(begin, end);
+
+    if (!messages.empty())
+    {
+        m_target.AddMessages(m_pid, m_process, messages);
+        m_target.Signal();
+    }
+}
 
 } // namespace debugviewpp
 } // namespace fusion
@@ -6,6 +6,7 @@
 #include "Win32/Win32Lib.h"
 #include "DebugViewppLib/PolledLogSource.h"
 #include "DebugViewppLib/LineBuffer.h"
+#include <algorithm>
 #include <iostream>
 
 namespace fusion {
@@ -23,13 +24,13 @@ PollLine::PollLine(Win32::Handle handle, const std::string& message, const LogSo
 {
 }
 
-PollLine::PollLine(DWORD pid, const std::string& processName, const std::string& message, const LogSource* pLogSource) :
+PollLine::PollLine(DWORD pid, const std::string& processName, std::string message, const LogSource* pLogSource) :
     timesAreValid(false),
     time(0.0),
     systemTime(FILETIME()),
     pid(pid),
     processName(processName),
-    message(message),
+    message(std::move(message)),
     pLogSource(pLogSource)
 {
 }
@@ -73,7 +74,11 @@ long PolledLogSource::GetMicrosecondInterval() const
 
 void PolledLogSource::Abort()
 {
-    LogSource::Abort();
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        LogSource::Abort();
+    }
+    m_wakeup.notify_all();
     if (m_thread)
     {
         m_thread->join();
@@ -84,16 +89,21 @@ void PolledLogSource::Abort()
 
 void PolledLogSource::Loop()
 {
+    auto interval = std::min(MinPollInterval, m_microsecondInterval);
     for (;;)
     {
-        Poll();
+        bool active = Poll();
         Signal();
-        if (LogSource::AtEnd())
+
+        // poll at full speed while data is arriving, back off exponentially while idle
+        interval = active ? std::min(MinPollInterval, m_microsecondInterval) : std::min(interval * 2, m_microsecondInterval);
+
+        // sub 16ms waits depend on available hardware for accuracy, Abort() ends the wait immediately
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if (m_wakeup.wait_for(lock, interval, [this] { return LogSource::AtEnd(); }))
         {
             break;
         }
-        // sub 16ms sleep, depends on available hardware for accuracy
-        std::this_thread::sleep_for(m_microsecondInterval);
     }
 }
 
@@ -116,6 +126,10 @@ void PolledLogSource::Notify()
         {
             Add(line.handle.release(), line.message);
         }
+        else if (line.timesAreValid && !line.source.empty())
+        {
+            Add(line.time, line.systemTime, line.pid, line.processName, line.message, line.source);
+        }
         else if (line.timesAreValid)
         {
             Add(line.time, line.systemTime, line.pid, line.processName, line.message);
@@ -128,8 +142,9 @@ void PolledLogSource::Notify()
     m_backBuffer.clear();
 }
 
-void PolledLogSource::Poll()
+bool PolledLogSource::Poll()
 {
+    return false;
 }
 
 void PolledLogSource::AddMessage(Win32::Handle handle, const std::string& message)
@@ -138,10 +153,10 @@ void PolledLogSource::AddMessage(Win32::Handle handle, const std::string& messag
     m_lines.emplace_back(PollLine(std::move(handle), message, this));
 }
 
-void PolledLogSource::AddMessage(DWORD pid, const std::string& processName, const std::string& message)
+void PolledLogSource::AddMessage(DWORD pid, const std::string& processName, std::string message)
 {
     std::lock_guard<std::mutex> lock(m_mutex);
-    m_lines.emplace_back(PollLine(pid, processName, message, this));
+    m_lines.emplace_back(PollLine(pid, processName, std::move(message), this));
 }
 
 void PolledLogSource::AddMessage(const std::string& message)
@@ -157,6 +172,33 @@ void PolledLogSource::AddMessage(double time, FILETIME systemTime, DWORD pid, co
     m_lines.emplace_back(PollLine(time, systemTime, pid, processName, message, this));
 }
 
+void PolledLogSource::AddMessage(double time, FILETIME systemTime, DWORD pid, const std::string& processName, const std::string& message, const std::string& source)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_lines.emplace_back(PollLine(time, systemTime, pid, processName, message, this));
+    m_lines.back().source = source;
+}
+
+void PolledLogSource::AddMessages(DWORD pid, const std::string& processName, const std::vector<std::string>& messages)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_lines.reserve(m_lines.size() + messages.size());
+    for (const auto& message : messages)
+    {
+        m_lines.emplace_back(PollLine(pid, processName, message, this));
+    }
+}
+
+void PolledLogSource::AddMessages(const Lines& lines)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_lines.reserve(m_lines.size() + lines.size());
+    for (const auto& line : lines)
+    {
+        m_lines.emplace_back(PollLine(line.time, line.systemTime, line.pid, line.processName, line.message, this));
+    }
+}
+
 void PolledLogSource::Signal()
 {
     std::lock_guard<std::mutex> lock(m_mutex);
@@ -8,9 +8,11 @@
 #include "Win32/Win32Lib.h"
 #include "DebugViewppLib/Conversions.h"
 #include "DebugViewppLib/Colors.h"
+#include "DebugViewppLib/Snapshot.h"
 
 #include <cassert>
 #include <array>
+#include <boost/container_hash/hash.hpp>
 
 #include "windows.h"
 #include <psapi.h>
@@ -20,36 +22,21 @@
 namespace fusion {
 namespace debugviewpp {
 
-InternalProcessProperties::InternalProcessProperties() :
-    pid(0),
-    color(0)
-{
-}
-
-InternalProcessProperties::InternalProcessProperties(DWORD pid, const std::wstring& name, COLORREF color) :
+ProcessProperties::ProcessProperties(DWORD uid, DWORD pid, std::string_view name, COLORREF color) :
+    uid(uid),
     pid(pid),
     name(name),
     color(color)
 {
 }
 
-ProcessProperties::ProcessProperties(const InternalProcessProperties& iprops) :
-    uid(0),
-    pid(iprops.pid),
-    name(iprops.name),
-    color(iprops.color)
-{
-}
-
-ProcessInfo::ProcessInfo() :
-    m_unqiueId(0)
-{
-}
+ProcessInfo::ProcessInfo() = default;
 
 void ProcessInfo::Clear()
 {
-    m_unqiueId = 0;
     m_processProperties.clear();
+    m_index.clear();
+    m_names.clear();
 }
 
 size_t ProcessInfo::GetPrivateBytes()
@@ -101,41 +88,78 @@ std::wstring ProcessInfo::GetProcessNameByPid(DWORD processId)
     return L"";
 }
 
-DWORD ProcessInfo::GetUid(DWORD processId, const std::wstring& processName)
+size_t ProcessInfo::GetHash(DWORD processId, std::string_view processName)
+{
+    auto seed = std::hash<std::string_view>()(processName);
+    boost::hash_combine(seed, processId);
+    return seed;
+}
+
+const std::string& ProcessInfo::InternName(std::string_view processName)
 {
-    for (auto& item : m_processProperties)
+    return *m_names.emplace(processName).first;
+}
+
+DWORD ProcessInfo::GetUid(DWORD processId, std::string_view processName)
+{
+    auto hash = GetHash(processId, processName);
+    auto range = m_index.equal_range(hash);
+    for (auto it = range.first; it != range.second; ++it)
     {
-        if (item.second.pid == processId && item.second.name == processName)
+        auto& props = m_processProperties[it->second];
+        if (props.pid == processId && props.name == processName)
         {
-            return item.first;
+            return props.uid;
         }
     }
 
-    DWORD index = m_unqiueId;
-    ++m_unqiueId;
-
-    m_processProperties[index] = InternalProcessProperties(processId, processName, GetRandomProcessColor());
-    return index;
+    auto uid = static_cast<DWORD>(m_processProperties.size());
+    auto& name = InternName(processName);
+    m_processProperties.emplace_back(uid, processId, name, GetRandomProcessColor());
+    m_index.emplace(hash, uid);
+    return uid;
 }
 
-ProcessProperties ProcessInfo::GetProcessProperties(DWORD processId, const std::wstring& processName)
+ProcessProperties ProcessInfo::GetProcessProperties(DWORD processId, std::string_view processName)
 {
-    auto uid = GetUid(processId, processName);
-    ProcessProperties props(m_processProperties[uid]);
-    props.uid = uid;
-    return props;
+    return m_processProperties[GetUid(processId, processName)];
 }
 
 ProcessProperties ProcessInfo::GetProcessProperties(DWORD uid) const
 {
-    auto it = m_processProperties.find(uid);
-    assert(it != m_processProperties.end());
-    if (it == m_processProperties.end())
+    assert(uid < m_processProperties.size());
+    return m_processProperties[uid];
+}
+
+size_t ProcessInfo::GetCount() const
+{
+    return m_processProperties.size();
+}
+
+void ProcessInfo::SaveSnapshot(SnapshotWriter& writer) const
+{
+    writer.WriteNumber(m_processProperties.size());
+    for (auto& props : m_processProperties)
     {
-        return ProcessProperties(InternalProcessProperties());
+        writer.WriteNumber(props.pid);
+        writer.WriteString(props.name);
+        writer.WriteNumber(props.color);
     }
+}
 
-    return ProcessProperties(it->second);
+void ProcessInfo::LoadSnapshot(SnapshotReader& reader)
+{
+    Clear();
+    auto count = reader.ReadCount();
+    for (size_t i = 0; i < count; ++i)
+    {
+        auto pid = static_cast<DWORD>(reader.ReadNumber());
+        auto& name = InternName(reader.ReadString());
+        auto color = static_cast<COLORREF>(reader.ReadNumber());
+        auto uid = static_cast<DWORD>(m_processProperties.size());
+        m_processProperties.emplace_back(uid, pid, name, color);
+        m_index.emplace(GetHash(pid, name), uid);
+    }
 }
 
 } // namespace debugviewpp
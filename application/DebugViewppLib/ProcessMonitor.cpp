@@ -3,22 +3,39 @@
 // (See accompanying file LICENSE_1_0.txt or copy at
 // http://www.boost.org/LICENSE_1_0.txt)
 
-#include <array>
 #include "Win32/Win32Lib.h"
 #include "DebugViewppLib/ProcessMonitor.h"
 
 namespace fusion {
 namespace debugviewpp {
 
-ProcessMonitor::ProcessInfo::ProcessInfo(DWORD pid, HANDLE handle) :
-    pid(pid),
-    handle(handle)
+bool PidMap::Add(DWORD pid, Win32::Handle handle, const std::string& processName)
 {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_processes.emplace(pid, Process{std::move(handle), processName}).second;
+}
+
+void PidMap::Remove(DWORD pid)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_processes.erase(pid);
+}
+
+bool PidMap::Find(DWORD pid, std::string& processName) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_processes.find(pid);
+    if (it == m_processes.end())
+    {
+        return false;
+    }
+    processName = it->second.processName;
+    return true;
 }
 
 ProcessMonitor::ProcessMonitor() :
     m_end(false),
-    m_event(Win32::CreateEvent(nullptr, false, false, nullptr)),
+    m_watcher([this](processexit::ProcessExitWatcher::Pid pid) { m_q.Push([this, pid] { Ended(static_cast<DWORD>(pid)); }); }),
     m_thread([this] { Run(); })
 {
 }
@@ -31,9 +48,11 @@ ProcessMonitor::~ProcessMonitor()
 void ProcessMonitor::Add(DWORD pid, HANDLE handle)
 {
     m_q.Push([this, pid, handle] {
-        m_processes.emplace_back(ProcessMonitor::ProcessInfo(pid, handle));
+        if (m_watcher.Add(pid, handle))
+        {
+            m_handles.emplace(pid, handle);
+        }
     });
-    Win32::SetEvent(m_event);
 }
 
 boost::signals2::connection ProcessMonitor::ConnectProcessEnded(ProcessEnded::slot_type slot)
@@ -41,39 +60,24 @@ boost::signals2::connection ProcessMonitor::ConnectProcessEnded(ProcessEnded::sl
     return m_processEnded.connect(slot);
 }
 
+void ProcessMonitor::Ended(DWORD pid)
+{
+    auto it = m_handles.find(pid);
+    if (it == m_handles.end())
+    {
+        return;
+    }
+
+    auto handle = it->second;
+    m_handles.erase(it);
+    m_processEnded(pid, handle);
+}
+
 void ProcessMonitor::Run()
 {
-    size_t offset = 0;
     while (!m_end)
     {
-        std::array<HANDLE, MAXIMUM_WAIT_OBJECTS> handles;
-        handles[0] = m_event.get();
-        size_t processCount = m_processes.size();
-        auto count = std::min<size_t>(processCount, MAXIMUM_WAIT_OBJECTS - 1);
-        for (size_t i = 0; i < count; ++i)
-        {
-            handles[i + 1] = m_processes[(offset + i) % processCount].handle;
-        }
-        DWORD timeout = static_cast<size_t>(count) < m_processes.size() ? 1000 : INFINITE;
-        auto result = Win32::WaitForAnyObject(handles.data(), handles.data() + count + 1, timeout);
-        if (!result.signaled)
-        {
-            offset = (offset + count) % processCount;
-        }
-        else if (result.index == 0)
-        {
-            while (!m_q.Empty())
-            {
-                m_q.Pop()();
-            }
-        }
-        else
-        {
-            size_t i = (offset + result.index - 1) % processCount;
-            m_processEnded(m_processes[i].pid, m_processes[i].handle);
-            m_processes[i] = m_processes.back();
-            m_processes.resize(processCount - 1);
-        }
+        m_q.Pop()();
     }
 }
 
@@ -84,8 +88,11 @@ void ProcessMonitor::Abort()
     if (m_thread.joinable())
     {
         m_q.Push([this] { m_end = true; });
-        Win32::SetEvent(m_event);
         m_thread.join();
+
+        // blocks until callbacks that already started have returned, the calls they queued are never executed
+        m_watcher.Abort();
+        m_handles.clear();
     }
 }
 
@@ -12,15 +12,14 @@ namespace fusion {
 namespace debugviewpp {
 
 ProcessReader::ProcessReader(Timer& timer, ILineBuffer& linebuffer, const std::wstring& pathName, const std::wstring& args) :
-    PolledLogSource(timer, SourceType::Pipe, linebuffer, 40),
+    PolledLogSource(timer, SourceType::Pipe, linebuffer, 0),
     m_process(pathName, args),
-    m_stdout(timer, linebuffer, m_process.GetStdOut(), m_process.GetProcessId(), Str(m_process.GetName()).str() + ":stdout", 0),
-    m_stderr(timer, linebuffer, m_process.GetStdErr(), m_process.GetProcessId(), Str(m_process.GetName()).str() + ":stderr", 0)
+    m_stdout(timer, linebuffer, m_process.GetStdOut(), m_process.GetProcessId(), Str(m_process.GetName()).str() + ":stdout", *this),
+    m_stderr(timer, linebuffer, m_process.GetStdErr(), m_process.GetProcessId(), Str(m_process.GetName()).str() + ":stderr", *this)
 {
     SetDescription(m_process.GetName() + L" stdout/stderr");
     AddMessage(Win32::DuplicateHandle(m_process.GetProcessHandle()), "Started capturing output of stdout/stderr");
     Signal();
-    StartThread();
 }
 
 ProcessReader::~ProcessReader() = default;
@@ -28,6 +27,8 @@ ProcessReader::~ProcessReader() = default;
 void ProcessReader::Abort()
 {
     AddMessage(m_process.GetProcessId(), Str(m_process.GetName()).str(), "<process reader aborted>");
+    m_stdout.Abort();
+    m_stderr.Abort();
     Signal();
     PolledLogSource::Abort();
 }
@@ -37,11 +38,5 @@ bool ProcessReader::AtEnd() const
     return m_stdout.AtEnd() && m_stderr.AtEnd();
 }
 
-void ProcessReader::Poll()
-{
-    m_stdout.Poll(*this);
-    m_stderr.Poll(*this);
-}
-
 } // namespace debugviewpp
 } // namespace fusion
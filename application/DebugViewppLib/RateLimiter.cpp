@@ -0,0 +1,157 @@
+// (C) Copyright Gert-Jan de Vos and Jan Wilmans 2013.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <boost/algorithm/string.hpp>
+#include "DebugViewppLib/RateLimiter.h"
+
+namespace fusion {
+namespace debugviewpp {
+
+namespace {
+
+// buckets of processes that stopped logging are forgotten after a minute
+const double BucketIdleTime = 60.0;
+
+} // namespace
+
+std::map<std::string, double> ParseProcessLimits(const std::string& text)
+{
+    std::map<std::string, double> limits;
+    std::vector<std::string> entries;
+    boost::split(entries, text, boost::is_any_of(";\r\n"));
+    for (auto& entry : entries)
+    {
+        auto equals = entry.rfind('=');
+        if (equals == std::string::npos)
+        {
+            continue;
+        }
+        auto name = boost::to_lower_copy(boost::trim_copy(entry.substr(0, equals)));
+        auto rate = boost::trim_copy(entry.substr(equals + 1));
+
+        // entries without a valid rate are skipped, the text is typed by the user or read from the registry
+        double value = 0;
+        auto end = rate.data() + rate.size();
+        auto result = std::from_chars(rate.data(), end, value);
+        if (!name.empty() && result.ec == std::errc() && result.ptr == end && std::isfinite(value) && value >= 0)
+        {
+            limits[name] = value;
+        }
+    }
+    return limits;
+}
+
+std::string FormatProcessLimits(const std::map<std::string, double>& limits, const std::string& separator)
+{
+    std::string text;
+    for (auto& limit : limits)
+    {
+        if (!text.empty())
+        {
+            text += separator;
+        }
+
+        // the shortest text that parses back to the same value, a fractional limit must not become 0, unlimited
+        char rate[64];
+        auto result = std::to_chars(rate, rate + sizeof(rate), limit.second, std::chars_format::fixed);
+        if (result.ec != std::errc())
+        {
+            result = std::to_chars(rate, rate + sizeof(rate), limit.second);
+        }
+        text += limit.first + "=" + std::string(rate, result.ptr);
+    }
+    return text;
+}
+
+void RateLimiter::SetSettings(const RateLimitSettings& settings)
+{
+    m_settings = settings;
+    m_enabled = settings.linesPerSecond > 0 || !settings.processLimits.empty();
+    m_buckets.clear();
+}
+
+bool RateLimiter::IsEnabled() const
+{
+    return m_enabled;
+}
+
+RateLimiter::Bucket& RateLimiter::GetBucket(const Line& line, double now)
+{
+    auto key = (static_cast<uint64_t>(line.sourceId) << 32) | line.pid;
+    auto it = m_buckets.find(key);
+    if (it != m_buckets.end())
+    {
+        return it->second;
+    }
+
+    auto linesPerSecond = m_settings.linesPerSecond;
+    auto limit = m_settings.processLimits.find(boost::to_lower_copy(line.processName));
+    if (limit != m_settings.processLimits.end())
+    {
+        linesPerSecond = limit->second;
+    }
+    auto burst = m_settings.burst > 0 ? m_settings.burst : std::max(linesPerSecond, 1.0);
+
+    // the first suppression is reported right away, later ones at most once per second
+    Bucket bucket{linesPerSecond, burst, burst, now, now - 1.0, 0, 0, line.pid, line.processName};
+    return m_buckets.emplace(key, std::move(bucket)).first->second;
+}
+
+bool RateLimiter::Admit(const Line& line, double now)
+{
+    auto& bucket = GetBucket(line, now);
+    if (bucket.linesPerSecond <= 0)
+    {
+        bucket.lastTime = now;
+        return true;
+    }
+
+    bucket.tokens = std::min(bucket.burst, bucket.tokens + std::max(now - bucket.lastTime, 0.0) * bucket.linesPerSecond);
+    bucket.lastTime = now;
+    if (bucket.tokens >= 1.0)
+    {
+        bucket.tokens -= 1.0;
+        return true;
+    }
+
+    ++bucket.excess;
+    if (m_settings.sampleInterval != 0 && bucket.excess % m_settings.sampleInterval == 0)
+    {
+        return true;
+    }
+    ++bucket.suppressed;
+    return false;
+}
+
+std::vector<RateLimiter::Suppression> RateLimiter::TakeSuppressions(double now)
+{
+    std::vector<Suppression> suppressions;
+    for (auto it = m_buckets.begin(); it != m_buckets.end();)
+    {
+        auto& bucket = it->second;
+        if (bucket.suppressed != 0 && now - bucket.lastReport >= 1.0)
+        {
+            suppressions.push_back(Suppression{bucket.pid, bucket.processName, bucket.suppressed});
+            bucket.suppressed = 0;
+            bucket.lastReport = now;
+        }
+
+        if (bucket.suppressed == 0 && now - bucket.lastTime > BucketIdleTime)
+        {
+            it = m_buckets.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+    return suppressions;
+}
+
+} // namespace debugviewpp
+} // namespace fusion
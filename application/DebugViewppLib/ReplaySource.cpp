@@ -0,0 +1,136 @@
+// (C) Copyright Gert-Jan de Vos and Jan Wilmans 2013.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#include "CobaltFusion/stringbuilder.h"
+#include "Win32/Win32Lib.h"
+#include "DebugViewppLib/ReplaySource.h"
+#include "DebugViewppLib/LineBuffer.h"
+
+namespace fusion {
+namespace debugviewpp {
+
+ReplaySource::ReplaySource(Timer& timer, ILineBuffer& lineBuffer, const std::wstring& filename, double speed) :
+    PolledLogSource(timer, SourceType::File, lineBuffer, 0),
+    m_reader(filename),
+    m_speed(speed)
+{
+    SetDescription(L"Replay of " + filename);
+    m_thread = std::thread([this] { Run(); });
+}
+
+ReplaySource::~ReplaySource()
+{
+    ReplaySource::Abort();
+}
+
+void ReplaySource::Notify()
+{
+    // m_mutex is held so m_pendingLines always matches the lines that were not handed over yet
+    std::lock_guard<std::mutex> lock(m_mutex);
+    PolledLogSource::Notify();
+    m_pendingLines = 0;
+    m_cv.notify_all();
+}
+
+void ReplaySource::Abort()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_abort = true;
+    }
+    m_cv.notify_all();
+    if (m_thread.joinable())
+    {
+        m_thread.join();
+    }
+    PolledLogSource::Abort();
+}
+
+// true when the whole trace was read and handed to the line buffer
+bool ReplaySource::IsFinished() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_finished && m_pendingLines == 0;
+}
+
+size_t ReplaySource::GetCount() const
+{
+    return m_count;
+}
+
+// adds 'record' at 'due', returns false when the replay was aborted
+bool ReplaySource::Replay(std::chrono::steady_clock::time_point due, const TraceRecord& record)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (due > std::chrono::steady_clock::now())
+    {
+        m_cv.wait_until(lock, due, [this] { return m_abort; });
+    }
+    if (m_pendingLines >= MaxPendingLines)
+    {
+        lock.unlock();
+        Signal();
+        lock.lock();
+        m_cv.wait(lock, [this] { return m_abort || m_pendingLines < MaxPendingLines; });
+    }
+    if (m_abort)
+    {
+        return false;
+    }
+    // the time is when the line is replayed, the system time and the source are those of the recording
+    AddMessage(GetTimeSinceOrigin(GetTicks()), record.systemTime, record.pid, record.processName, record.message, record.source);
+    ++m_pendingLines;
+    return true;
+}
+
+void ReplaySource::Run()
+{
+    try
+    {
+        TraceRecord record;
+        auto start = std::chrono::steady_clock::now();
+        double origin = -1.0;
+        size_t batch = 0;
+        while (m_reader.Read(record))
+        {
+            auto due = start;
+            if (m_speed > 0.0)
+            {
+                if (origin < 0.0)
+                {
+                    origin = record.time;
+                }
+                due += std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>((record.time - origin) / m_speed));
+                if (due > std::chrono::steady_clock::now())
+                {
+                    Signal(); // hand over what is pending before sleeping through the gap
+                    batch = 0;
+                }
+            }
+            if (!Replay(due, record))
+            {
+                return;
+            }
+            ++m_count;
+            if (++batch == BatchSize)
+            {
+                Signal();
+                batch = 0;
+            }
+        }
+    }
+    catch (std::exception& e)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        AddMessage(stringbuilder() << GetDescription() << " stopped: " << e.what() << "\n");
+        ++m_pendingLines;
+    }
+    Signal();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_finished = true;
+}
+
+} // namespace debugviewpp
+} // namespace fusion
@@ -0,0 +1,69 @@
+// (C) Copyright Gert-Jan de Vos and Jan Wilmans 2013.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#include "DebugViewppLib/ShmRingReader.h"
+#include "DebugViewppLib/ProcessMonitor.h"
+#include "DebugViewppLib/LineBuffer.h"
+#include "CobaltFusion/stringbuilder.h"
+
+namespace fusion {
+namespace debugviewpp {
+
+ShmRingReader::ShmRingReader(Timer& timer, ILineBuffer& linebuffer, const std::string& name, const PidMap* pPidMap) :
+    LogSource(timer, SourceType::System, linebuffer),
+    m_ring(name),
+    m_pPidMap(pPidMap)
+{
+    SetDescription(L"Shared-Memory Ring Messages");
+}
+
+HANDLE ShmRingReader::GetHandle() const
+{
+    return m_ring.GetReadySignal().GetHandle();
+}
+
+void ShmRingReader::SetPaused(bool paused)
+{
+    m_paused = paused;
+}
+
+void ShmRingReader::Notify()
+{
+    if (m_paused)
+    {
+        m_ring.Read([](uint32_t, std::string_view) {});
+        m_dropped = m_ring.GetDropped();
+        return;
+    }
+
+    m_ring.Read([this](uint32_t pid, std::string_view message) { Add(pid, message); });
+
+    auto dropped = m_ring.GetDropped();
+    if (dropped != m_dropped)
+    {
+        AddInternal(stringbuilder() << "<" << dropped - m_dropped << " messages dropped on a full shared-memory ring>");
+        m_dropped = dropped;
+    }
+}
+
+void ShmRingReader::Add(uint32_t pid, std::string_view message)
+{
+    // the same process identification as DBWinReader::Notify()
+    if (std::string processName; m_pPidMap != nullptr && m_pPidMap->Find(pid, processName))
+    {
+        LogSource::Add(pid, processName, std::string(message));
+    }
+    else if (HANDLE handle = ::OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION | SYNCHRONIZE, FALSE, pid); handle != nullptr)
+    {
+        LogSource::Add(handle, std::string(message));
+    }
+    else
+    {
+        LogSource::Add(pid, "<system>", std::string(message));
+    }
+}
+
+} // namespace debugviewpp
+} // namespace fusion
@@ -0,0 +1,174 @@
+// (C) Copyright Gert-Jan de Vos and Jan Wilmans 2013.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#include <bit>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include "CobaltFusion/Str.h"
+#include "DebugViewppLib/Snapshot.h"
+
+namespace fusion {
+namespace debugviewpp {
+
+namespace {
+
+const char Signature[] = {'D', 'V', 'S', 'N', 'A', 'P', '0', '2'};
+
+static_assert(std::endian::native == std::endian::little, "snapshot numbers are written little-endian");
+
+} // namespace
+
+SnapshotWriter::SnapshotWriter(const std::wstring& filename) :
+    m_filename(filename)
+{
+    WriteBytes(Signature, sizeof(Signature));
+}
+
+void SnapshotWriter::WriteNumber(uint64_t value)
+{
+    WriteBytes(&value, sizeof(value));
+}
+
+void SnapshotWriter::WriteDouble(double value)
+{
+    WriteNumber(std::bit_cast<uint64_t>(value));
+}
+
+void SnapshotWriter::WriteString(std::string_view value)
+{
+    WriteNumber(value.size());
+    WriteBytes(value.data(), value.size());
+}
+
+void SnapshotWriter::WriteStrings(const std::vector<std::string>& values)
+{
+    WriteNumber(values.size());
+    for (auto& value : values)
+    {
+        WriteString(value);
+    }
+}
+
+void SnapshotWriter::WriteString(std::function<std::string()> source)
+{
+    m_sources.push_back(Source{m_buffer.size(), std::move(source)});
+}
+
+void SnapshotWriter::WriteBytes(const void* data, size_t size)
+{
+    m_buffer.append(static_cast<const char*>(data), size);
+}
+
+void SnapshotWriter::Commit()
+{
+    auto tempFilename = std::filesystem::path(m_filename + L".tmp");
+    std::ofstream file(tempFilename, std::ofstream::binary | std::ofstream::trunc);
+    if (!file)
+    {
+        throw std::runtime_error("unable to create snapshot '" + Str(m_filename).str() + "'");
+    }
+
+    try
+    {
+        size_t position = 0;
+        for (auto& source : m_sources)
+        {
+            file.write(m_buffer.data() + position, static_cast<std::streamsize>(source.position - position));
+            position = source.position;
+            auto value = source.source();
+            uint64_t size = value.size();
+            file.write(reinterpret_cast<const char*>(&size), sizeof(size));
+            file.write(value.data(), static_cast<std::streamsize>(value.size()));
+        }
+        file.write(m_buffer.data() + position, static_cast<std::streamsize>(m_buffer.size() - position));
+        file.close();
+        if (!file)
+        {
+            throw std::runtime_error("unable to write snapshot '" + Str(m_filename).str() + "'");
+        }
+        std::filesystem::rename(tempFilename, std::filesystem::path(m_filename));
+    }
+    catch (...)
+    {
+        file.close();
+        std::error_code ec;
+        std::filesystem::remove(tempFilename, ec);
+        throw;
+    }
+}
+
+SnapshotReader::SnapshotReader(const std::wstring& filename)
+{
+    if (std::filesystem::file_size(std::filesystem::path(filename)) < sizeof(Signature))
+    {
+        throw std::runtime_error("'" + Str(filename).str() + "' is not a DebugView++ snapshot");
+    }
+
+    m_mapping = boost::interprocess::file_mapping(std::filesystem::path(filename).c_str(), boost::interprocess::read_only);
+    m_region = boost::interprocess::mapped_region(m_mapping, boost::interprocess::read_only);
+    m_data = static_cast<const char*>(m_region.get_address());
+    m_size = m_region.get_size();
+    if (std::memcmp(ReadBytes(sizeof(Signature)), Signature, sizeof(Signature)) != 0)
+    {
+        throw std::runtime_error("'" + Str(filename).str() + "' is not a DebugView++ snapshot");
+    }
+}
+
+uint64_t SnapshotReader::ReadNumber()
+{
+    uint64_t value;
+    std::memcpy(&value, ReadBytes(sizeof(value)), sizeof(value));
+    return value;
+}
+
+double SnapshotReader::ReadDouble()
+{
+    return std::bit_cast<double>(ReadNumber());
+}
+
+size_t SnapshotReader::ReadCount()
+{
+    // every element takes at least a byte
+    auto count = ReadNumber();
+    if (count > m_size - m_pos)
+    {
+        throw std::runtime_error("snapshot is damaged");
+    }
+    return static_cast<size_t>(count);
+}
+
+std::string SnapshotReader::ReadString()
+{
+    auto size = static_cast<size_t>(ReadNumber());
+    return std::string(ReadBytes(size), size);
+}
+
+std::vector<std::string> SnapshotReader::ReadStrings()
+{
+    auto count = ReadCount();
+    std::vector<std::string> values;
+    values.reserve(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        values.push_back(ReadString());
+    }
+    return values;
+}
+
+const char* SnapshotReader::ReadBytes(size_t count, size_t size)
+{
+    if (count > (m_size - m_pos) / size)
+    {
+        throw std::runtime_error("snapshot is truncated");
+    }
+
+    auto data = m_data + m_pos;
+    m_pos += count * size;
+    return data;
+}
+
+} // namespace debugviewpp
+} // namespace fusion
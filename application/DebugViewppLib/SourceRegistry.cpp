@@ -0,0 +1,57 @@
+// (C) Copyright Gert-Jan de Vos and Jan Wilmans 2013.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#include "DebugViewppLib/SourceRegistry.h"
+
+namespace fusion {
+namespace debugviewpp {
+
+bool SourceRegistry::Snapshot::Contains(SourceId id) const
+{
+    return id < m_live.size() && m_live[id];
+}
+
+void SourceRegistry::Add(SourceId id)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (id >= m_live.size())
+    {
+        m_live.resize(id + 1);
+    }
+    m_live[id] = true;
+    ++m_generation;
+}
+
+void SourceRegistry::Remove(SourceId id)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (id < m_live.size())
+    {
+        m_live[id] = false;
+    }
+    ++m_generation;
+}
+
+void SourceRegistry::Clear()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_live.clear();
+    ++m_generation;
+}
+
+bool SourceRegistry::Update(Snapshot& snapshot) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (snapshot.m_generation == m_generation)
+    {
+        return false;
+    }
+    snapshot.m_live = m_live;
+    snapshot.m_generation = m_generation;
+    return true;
+}
+
+} // namespace debugviewpp
+} // namespace fusion
@@ -0,0 +1,299 @@
+// (C) Copyright Gert-Jan de Vos and Jan Wilmans 2013.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#include <charconv>
+#include <cstdio>
+#include <ostream>
+#include <stdexcept>
+#include "Win32/Win32Lib.h"
+#include "DebugViewppLib/StreamWriter.h"
+
+namespace fusion {
+namespace debugviewpp {
+
+namespace {
+
+const unsigned long long FileTimeTicksPerSecond = 10000000;
+const unsigned long long FileTimeTicksPerMillisecond = 10000;
+
+template <typename T>
+void AppendNumber(std::string& buffer, T value)
+{
+    char buf[32];
+    auto result = std::to_chars(buf, buf + sizeof(buf), value);
+    buffer.append(buf, result.ptr);
+}
+
+void AppendFixed(std::string& buffer, double value)
+{
+    char buf[512];
+    auto result = std::to_chars(buf, buf + sizeof(buf), value, std::chars_format::fixed, 6);
+    buffer.append(buf, result.ptr);
+}
+
+void AppendPadded(std::string& buffer, unsigned long long value, size_t width)
+{
+    char buf[32];
+    auto result = std::to_chars(buf, buf + sizeof(buf), value);
+    auto size = static_cast<size_t>(result.ptr - buf);
+    if (size < width)
+    {
+        buffer.append(width - size, '0');
+    }
+    buffer.append(buf, size);
+}
+
+} // namespace
+
+OutputFormat ParseOutputFormat(const std::string& name)
+{
+    if (name == "text")
+    {
+        return OutputFormat::Text;
+    }
+    if (name == "json")
+    {
+        return OutputFormat::JsonLines;
+    }
+    if (name == "native")
+    {
+        return OutputFormat::Native;
+    }
+    throw std::runtime_error("unknown output format '" + name + "', expected text, json or native");
+}
+
+void AppendJsonString(std::string& buffer, const std::string& text)
+{
+    static const char hex[] = "0123456789abcdef";
+    buffer.push_back('"');
+    for (char c : text)
+    {
+        switch (c)
+        {
+        case '"': buffer.append("\\\""); break;
+        case '\\': buffer.append("\\\\"); break;
+        case '\n': buffer.append("\\n"); break;
+        case '\r': buffer.append("\\r"); break;
+        case '\t': buffer.append("\\t"); break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20)
+            {
+                buffer.append("\\u00");
+                buffer.push_back(hex[(c >> 4) & 0xf]);
+                buffer.push_back(hex[c & 0xf]);
+            }
+            else
+            {
+                buffer.push_back(c);
+            }
+            break;
+        }
+    }
+    buffer.push_back('"');
+}
+
+LineFormatter::LineFormatter(OutputFormat format, const OutputColumns& columns) :
+    m_format(format),
+    m_columns(columns)
+{
+}
+
+void LineFormatter::Format(const Line& line, std::string& buffer)
+{
+    ++m_lineNumber;
+    switch (m_format)
+    {
+    case OutputFormat::Text: FormatText(line, buffer); break;
+    case OutputFormat::JsonLines: FormatJson(line, buffer); break;
+    case OutputFormat::Native: FormatNative(line, buffer); break;
+    }
+}
+
+// same columns as the original DebugViewConsole output, including the extra separator before the message
+void LineFormatter::FormatText(const Line& line, std::string& buffer)
+{
+    char separator = m_columns.tabs ? '\t' : ' ';
+    if (m_columns.lineNumber)
+    {
+        AppendPadded(buffer, m_lineNumber, 5);
+        buffer.push_back(separator);
+    }
+    if (m_columns.systemTime)
+    {
+        if (line.systemTime.dwHighDateTime == 0 && line.systemTime.dwLowDateTime == 0)
+        {
+            buffer.push_back('0');
+        }
+        else
+        {
+            AppendTime(line.systemTime, false, buffer);
+        }
+        buffer.push_back(separator);
+    }
+    if (m_columns.time)
+    {
+        AppendFixed(buffer, line.time);
+        buffer.push_back(separator);
+    }
+    if (m_columns.pid)
+    {
+        AppendNumber(buffer, line.pid);
+        buffer.push_back(separator);
+    }
+    if (m_columns.processName)
+    {
+        buffer.append(line.processName);
+        buffer.push_back(separator);
+    }
+    buffer.push_back(separator);
+    buffer.append(line.message);
+    buffer.push_back('\n');
+}
+
+void LineFormatter::FormatJson(const Line& line, std::string& buffer)
+{
+    buffer.append("{\"line\":");
+    AppendNumber(buffer, m_lineNumber);
+    buffer.append(",\"time\":");
+    AppendFixed(buffer, line.time);
+    buffer.append(",\"systemTime\":\"");
+    AppendTime(line.systemTime, true, buffer);
+    buffer.append("\",\"pid\":");
+    AppendNumber(buffer, line.pid);
+    buffer.append(",\"process\":");
+    AppendJsonString(buffer, line.processName);
+    buffer.append(",\"message\":");
+    AppendJsonString(buffer, line.message);
+    buffer.append("}\n");
+}
+
+// same output as WriteLogFileMessage
+void LineFormatter::FormatNative(const Line& line, std::string& buffer)
+{
+    AppendFixed(buffer, line.time);
+    buffer.push_back('\t');
+    AppendTime(line.systemTime, true, buffer);
+    buffer.push_back('\t');
+    AppendNumber(buffer, line.pid);
+    buffer.push_back('\t');
+    buffer.append(line.processName);
+    buffer.push_back('\t');
+    auto end = line.message.find_last_not_of(" \r\n\t");
+    buffer.append(line.message, 0, end == std::string::npos ? 0 : end + 1);
+    buffer.push_back('\n');
+}
+
+// local time as "yyyy/mm/dd hh:mm:ss.mmm" or "hh:mm:ss.mmm"
+void LineFormatter::AppendTime(FILETIME systemTime, bool date, std::string& buffer)
+{
+    auto ticks = (static_cast<unsigned long long>(systemTime.dwHighDateTime) << 32) | systemTime.dwLowDateTime;
+    auto second = ticks / FileTimeTicksPerSecond;
+    if (second != m_second)
+    {
+        // time zone offsets are whole minutes, so the milliseconds are the same in UTC and local time
+        FILETIME ft;
+        auto secondTicks = second * FileTimeTicksPerSecond;
+        ft.dwLowDateTime = static_cast<DWORD>(secondTicks);
+        ft.dwHighDateTime = static_cast<DWORD>(secondTicks >> 32);
+        auto st = Win32::FileTimeToSystemTime(Win32::FileTimeToLocalFileTime(ft));
+        char buf[32];
+        snprintf(buf, sizeof(buf), "%04d/%02d/%02d ", st.wYear, st.wMonth, st.wDay);
+        m_datePrefix = buf;
+        snprintf(buf, sizeof(buf), "%02d:%02d:%02d.", st.wHour, st.wMinute, st.wSecond);
+        m_timePrefix = buf;
+        m_second = second;
+    }
+    if (date)
+    {
+        buffer.append(m_datePrefix);
+    }
+    buffer.append(m_timePrefix);
+    AppendPadded(buffer, (ticks % FileTimeTicksPerSecond) / FileTimeTicksPerMillisecond, 3);
+}
+
+StreamWriter::StreamWriter(std::ostream& os) :
+    m_os(os),
+    m_thread([this] { Run(); })
+{
+}
+
+StreamWriter::~StreamWriter()
+{
+    Flush();
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_end = true;
+    }
+    m_cv.notify_all();
+    m_thread.join();
+}
+
+void StreamWriter::Write(std::string& buffer)
+{
+    if (buffer.empty())
+    {
+        return;
+    }
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_cv.wait(lock, [this] { return m_pending.size() < MaxPendingBuffers; });
+    m_pending.push_back(std::move(buffer));
+    if (m_free.empty())
+    {
+        buffer = std::string();
+        buffer.reserve(BufferSize);
+    }
+    else
+    {
+        buffer = std::move(m_free.back());
+        m_free.pop_back();
+    }
+    lock.unlock();
+    m_cv.notify_all();
+}
+
+void StreamWriter::Flush()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_cv.wait(lock, [this] { return m_pending.empty() && !m_writing; });
+    m_os.flush();
+}
+
+void StreamWriter::Run()
+{
+    std::vector<std::string> buffers;
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (;;)
+    {
+        m_cv.wait(lock, [this] { return m_end || !m_pending.empty(); });
+        if (m_pending.empty())
+        {
+            return;
+        }
+
+        buffers.swap(m_pending);
+        m_writing = true;
+        lock.unlock();
+        for (auto& buffer : buffers)
+        {
+            m_os.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+            buffer.clear();
+        }
+        lock.lock();
+        m_writing = false;
+        for (auto& buffer : buffers)
+        {
+            if (m_free.size() < MaxPendingBuffers)
+            {
+                m_free.push_back(std::move(buffer));
+            }
+        }
+        buffers.clear();
+        m_cv.notify_all();
+    }
+}
+
+} // namespace debugviewpp
+} // namespace fusion
@@ -0,0 +1,280 @@
+// (C) Copyright Gert-Jan de Vos and Jan Wilmans 2013.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#include <cstring>
+#include "CobaltFusion/stringbuilder.h"
+#include "DebugViewppLib/TcpReader.h"
+#include "DebugViewppLib/LineBuffer.h"
+
+namespace fusion {
+namespace debugviewpp {
+
+using boost::asio::ip::tcp;
+
+constexpr size_t LengthPrefixSize = 4;
+
+class TcpReader::Connection : public std::enable_shared_from_this<Connection>
+{
+public:
+    Connection(TcpReader& reader, tcp::socket socket) :
+        m_reader(reader),
+        m_socket(std::move(socket)),
+        m_buffer(ReceiveBufferSize)
+    {
+        boost::system::error_code ec;
+        auto endpoint = m_socket.remote_endpoint(ec);
+        m_processName = stringbuilder() << "[TCP " << endpoint.address().to_string() << ":" << endpoint.port() << "]";
+    }
+
+    const std::string& GetProcessName() const
+    {
+        return m_processName;
+    }
+
+    void BeginRead()
+    {
+        auto buffer = boost::asio::buffer(m_buffer.data() + m_end, m_buffer.size() - m_end);
+        m_socket.async_read_some(buffer, [self = shared_from_this()](const boost::system::error_code& ec, size_t size) {
+            self->OnRead(ec, size);
+        });
+    }
+
+    void Close()
+    {
+        boost::system::error_code ec;
+        m_socket.close(ec);
+    }
+
+private:
+    void OnRead(const boost::system::error_code& ec, size_t size)
+    {
+        if (ec)
+        {
+            if (ec != boost::asio::error::operation_aborted)
+            {
+                Flush();
+                m_reader.Close(shared_from_this());
+            }
+            return;
+        }
+
+        m_end += size;
+        if (!Consume())
+        {
+            m_reader.AddMessage(stringbuilder() << "Connection " << m_processName << " closed, message exceeds " << ReceiveBufferSize << " bytes.\n");
+            m_reader.Close(shared_from_this());
+            return;
+        }
+        m_reader.Signal();
+
+        if (m_reader.GetPendingBytes() > MaxPendingBytes)
+        {
+            m_reader.m_paused.push_back(shared_from_this());
+            return;
+        }
+        BeginRead();
+    }
+
+    // frames are sliced out of m_buffer in place, only the remainder of an incomplete frame is moved to the front
+    bool Consume()
+    {
+        const char* data = m_buffer.data();
+        if (m_reader.m_framing == TcpFraming::Newline)
+        {
+            for (;;)
+            {
+                auto p = static_cast<const char*>(std::memchr(data + m_begin, '\n', m_end - m_begin));
+                if (p == nullptr)
+                {
+                    break;
+                }
+                auto end = static_cast<size_t>(p - data) + 1;
+                m_reader.AddFrame(m_processName, std::string_view(data + m_begin, end - m_begin));
+                m_begin = end;
+            }
+            if (m_begin == 0 && m_end == m_buffer.size())
+            {
+                // a line that does not fit the buffer is split, like the NewlineFilter does for very long lines
+                Flush();
+            }
+        }
+        else
+        {
+            while (m_end - m_begin >= LengthPrefixSize)
+            {
+                auto bytes = reinterpret_cast<const unsigned char*>(data + m_begin);
+                size_t length = bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | (static_cast<size_t>(bytes[3]) << 24);
+                if (length > m_buffer.size() - LengthPrefixSize)
+                {
+                    return false;
+                }
+                if (m_end - m_begin < LengthPrefixSize + length)
+                {
+                    break;
+                }
+                m_reader.AddFrame(m_processName, std::string_view(data + m_begin + LengthPrefixSize, length));
+                m_begin += LengthPrefixSize + length;
+            }
+        }
+        Compact();
+        return true;
+    }
+
+    void Flush()
+    {
+        if (m_end > m_begin && m_reader.m_framing == TcpFraming::Newline)
+        {
+            m_reader.AddFrame(m_processName, std::string_view(m_buffer.data() + m_begin, m_end - m_begin));
+        }
+        m_begin = m_end;
+    }
+
+    void Compact()
+    {
+        if (m_begin == m_end)
+        {
+            m_begin = 0;
+            m_end = 0;
+        }
+        else if (m_begin > 0 && m_end == m_buffer.size())
+        {
+            std::memmove(m_buffer.data(), m_buffer.data() + m_begin, m_end - m_begin);
+            m_end -= m_begin;
+            m_begin = 0;
+        }
+    }
+
+    TcpReader& m_reader;
+    tcp::socket m_socket;
+    std::string m_processName;
+    std::vector<char> m_buffer;
+    size_t m_begin = 0;
+    size_t m_end = 0;
+};
+
+TcpReader::TcpReader(Timer& timer, ILineBuffer& lineBuffer, int port, TcpFraming framing) :
+    PolledLogSource(timer, SourceType::Tcp, lineBuffer, 0),
+    m_acceptor(m_ioContext, tcp::endpoint(tcp::v4(), static_cast<unsigned short>(port))),
+    m_framing(framing)
+{
+    SetDescription(wstringbuilder() << L"Listening at TCP port " << GetPort());
+    BeginAccept();
+    m_thread = std::thread([this] { m_ioContext.run(); });
+}
+
+TcpReader::~TcpReader()
+{
+    TcpReader::Abort();
+}
+
+void TcpReader::Abort()
+{
+    if (m_thread.joinable())
+    {
+        boost::asio::post(m_ioContext, [this] {
+            boost::system::error_code ec;
+            m_acceptor.close(ec);
+            for (auto& pConnection : m_connections)
+            {
+                pConnection->Close();
+            }
+            m_connections.clear();
+            m_paused.clear();
+        });
+        m_thread.join();
+    }
+    PolledLogSource::Abort();
+}
+
+// frames counted before the lines are taken were added before, so they are taken now. Frames added meanwhile stay
+// counted until the next Notify(), a difference of a single snapshot would leave them counted for good and
+// eventually keep the connections paused with no lines left to notify about.
+void TcpReader::Notify()
+{
+    auto added = m_addedBytes.load();
+    PolledLogSource::Notify();
+    m_consumedBytes = added;
+    boost::asio::post(m_ioContext, [this] { Resume(); });
+}
+
+unsigned short TcpReader::GetPort() const
+{
+    return m_acceptor.local_endpoint().port();
+}
+
+size_t TcpReader::GetConnectionCount() const
+{
+    return m_connectionCount;
+}
+
+void TcpReader::BeginAccept()
+{
+    m_acceptor.async_accept([this](const boost::system::error_code& ec, tcp::socket socket) {
+        if (ec == boost::asio::error::operation_aborted)
+        {
+            return;
+        }
+        if (!ec)
+        {
+            auto pConnection = std::make_shared<Connection>(*this, std::move(socket));
+            m_connections.insert(pConnection);
+            m_connectionCount = m_connections.size();
+            pConnection->BeginRead();
+        }
+        BeginAccept();
+    });
+}
+
+void TcpReader::Resume()
+{
+    if (GetPendingBytes() > MaxPendingBytes)
+    {
+        return;
+    }
+
+    std::vector<std::shared_ptr<Connection>> paused;
+    paused.swap(m_paused);
+    for (auto& pConnection : paused)
+    {
+        if (m_connections.count(pConnection) != 0)
+        {
+            pConnection->BeginRead();
+        }
+    }
+}
+
+// only called on the asio thread, where the frames are added
+size_t TcpReader::GetPendingBytes() const
+{
+    auto consumed = m_consumedBytes.load();
+    return m_addedBytes - consumed;
+}
+
+void TcpReader::AddFrame(const std::string& processName, std::string_view frame)
+{
+    // complete frames always end in a newline, so partial lines from different peers cannot be joined by the NewlineFilter.
+    // The frame is copied out of the receive buffer into the string that is queued, PolledLogSource::Notify() copies it
+    // once more into the line.
+    bool terminated = !frame.empty() && frame.back() == '\n';
+    std::string message;
+    message.reserve(frame.size() + (terminated ? 0 : 1));
+    message.assign(frame);
+    if (!terminated)
+    {
+        message.push_back('\n');
+    }
+    AddMessage(0, processName, std::move(message));
+    m_addedBytes += frame.size();
+}
+
+void TcpReader::Close(const std::shared_ptr<Connection>& pConnection)
+{
+    pConnection->Close();
+    m_connections.erase(pConnection);
+    m_connectionCount = m_connections.size();
+}
+
+} // namespace debugviewpp
+} // namespace fusion
@@ -0,0 +1,324 @@
+// (C) Copyright Gert-Jan de Vos and Jan Wilmans 2013.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#include <algorithm>
+#include <stdexcept>
+#include "DebugViewppLib/Snapshot.h"
+#include "DebugViewppLib/TemplateMiner.h"
+
+namespace fusion {
+namespace debugviewpp {
+
+namespace {
+
+const size_t GroupDepth = 2;       // leading tokens that select the group, next to the number of tokens
+const size_t MaxGroupSize = 64;    // templates in one group, a line compares itself to all of them
+const size_t MaxTokens = 128;
+const std::string WildcardText = "<*>";
+
+bool HasDigit(std::string_view token)
+{
+    return std::any_of(token.begin(), token.end(), [](char c) { return c >= '0' && c <= '9'; });
+}
+
+// splits on every single space, so joining the tokens with spaces restores the text exactly
+std::vector<std::string_view> Tokenize(std::string_view text)
+{
+    std::vector<std::string_view> tokens;
+    size_t begin = 0;
+    for (;;)
+    {
+        auto end = text.find(' ', begin);
+        if (end == std::string_view::npos)
+        {
+            tokens.push_back(text.substr(begin));
+            return tokens;
+        }
+        tokens.push_back(text.substr(begin, end - begin));
+        begin = end + 1;
+    }
+}
+
+} // namespace
+
+TemplateMiner::TemplateMiner(double similarity) :
+    m_similarity(similarity)
+{
+    Clear();
+}
+
+void TemplateMiner::Clear()
+{
+    m_patterns.assign(1, Pattern{0, {}, {}});
+    m_templates.assign(1, Template{0, 0});
+    m_groups.clear();
+}
+
+std::string TemplateMiner::GetGroupKey(const std::vector<std::string_view>& tokens)
+{
+    // tokens with digits are most likely parameters, grouping on them would give every value its own group
+    auto key = std::to_string(tokens.size());
+    for (size_t i = 0; i < std::min(GroupDepth, tokens.size()); ++i)
+    {
+        key += ' ';
+        key.append(HasDigit(tokens[i]) ? std::string_view(WildcardText) : tokens[i]);
+    }
+    return key;
+}
+
+double TemplateMiner::GetSimilarity(const Pattern& pattern, const std::vector<std::string_view>& tokens) const
+{
+    size_t equal = 0;
+    for (size_t i = 0; i < tokens.size(); ++i)
+    {
+        if (!pattern.wildcards[i] && pattern.tokens[i] == tokens[i])
+        {
+            ++equal;
+        }
+    }
+    return static_cast<double>(equal) / tokens.size();
+}
+
+TemplateId TemplateMiner::AddTemplate(const std::vector<std::string_view>& tokens)
+{
+    auto id = static_cast<TemplateId>(m_templates.size());
+    Pattern pattern{id, {}, {}};
+    for (auto token : tokens)
+    {
+        bool wildcard = HasDigit(token);
+        pattern.tokens.emplace_back(wildcard ? std::string_view() : token);
+        pattern.wildcards.push_back(wildcard);
+    }
+    m_templates.push_back(Template{static_cast<uint32_t>(m_patterns.size()), 0});
+    m_patterns.push_back(std::move(pattern));
+    return id;
+}
+
+void TemplateMiner::Generalize(Template& t, const std::vector<std::string_view>& tokens)
+{
+    auto& current = m_patterns[t.patternId];
+    bool changed = false;
+    for (size_t i = 0; i < tokens.size() && !changed; ++i)
+    {
+        changed = !current.wildcards[i] && current.tokens[i] != tokens[i];
+    }
+    if (!changed)
+    {
+        return;
+    }
+
+    Pattern pattern = current;
+    for (size_t i = 0; i < tokens.size(); ++i)
+    {
+        if (!pattern.wildcards[i] && pattern.tokens[i] != tokens[i])
+        {
+            pattern.tokens[i].clear();
+            pattern.wildcards[i] = true;
+        }
+    }
+    t.patternId = static_cast<uint32_t>(m_patterns.size());
+    m_patterns.push_back(std::move(pattern));
+}
+
+TemplateMatch TemplateMiner::Add(std::string_view text, std::string& params)
+{
+    params.clear();
+    if (text.find('\n') != std::string_view::npos)
+    {
+        return TemplateMatch();
+    }
+    auto tokens = Tokenize(text);
+    if (tokens.size() > MaxTokens)
+    {
+        return TemplateMatch();
+    }
+
+    auto& group = m_groups[GetGroupKey(tokens)];
+    TemplateId best = 0;
+    double bestSimilarity = 0;
+    for (auto id : group)
+    {
+        auto similarity = GetSimilarity(m_patterns[m_templates[id].patternId], tokens);
+        if (similarity > bestSimilarity)
+        {
+            best = id;
+            bestSimilarity = similarity;
+        }
+    }
+
+    if (best == 0 || bestSimilarity < m_similarity)
+    {
+        if (group.size() >= MaxGroupSize)
+        {
+            return TemplateMatch();
+        }
+        best = AddTemplate(tokens);
+        group.push_back(best);
+    }
+
+    auto& t = m_templates[best];
+    Generalize(t, tokens);
+    ++t.count;
+
+    auto& pattern = m_patterns[t.patternId];
+    bool first = true;
+    for (size_t i = 0; i < tokens.size(); ++i)
+    {
+        if (pattern.wildcards[i])
+        {
+            if (!first)
+            {
+                params += '\n';
+            }
+            params.append(tokens[i]);
+            first = false;
+        }
+    }
+    return TemplateMatch{best, t.patternId};
+}
+
+std::string TemplateMiner::Format(uint32_t patternId, std::string_view params) const
+{
+    auto& pattern = m_patterns[patternId];
+    std::string text;
+    size_t begin = 0;
+    for (size_t i = 0; i < pattern.tokens.size(); ++i)
+    {
+        if (i > 0)
+        {
+            text += ' ';
+        }
+        if (pattern.wildcards[i])
+        {
+            auto end = std::min(params.find('\n', begin), params.size());
+            text.append(params.substr(begin, end - begin));
+            begin = end + 1;
+        }
+        else
+        {
+            text += pattern.tokens[i];
+        }
+    }
+    return text;
+}
+
+TemplateId TemplateMiner::GetTemplateId(uint32_t patternId) const
+{
+    return m_patterns[patternId].templateId;
+}
+
+std::string TemplateMiner::GetText(TemplateId id) const
+{
+    auto& pattern = m_patterns[m_templates[id].patternId];
+    std::string text;
+    for (size_t i = 0; i < pattern.tokens.size(); ++i)
+    {
+        if (i > 0)
+        {
+            text += ' ';
+        }
+        text += pattern.wildcards[i] ? WildcardText : pattern.tokens[i];
+    }
+    return text;
+}
+
+uint64_t TemplateMiner::GetCount(TemplateId id) const
+{
+    return m_templates[id].count;
+}
+
+size_t TemplateMiner::GetTemplateCount() const
+{
+    return m_templates.size() - 1;
+}
+
+size_t TemplateMiner::GetPatternCount() const
+{
+    return m_patterns.size() - 1;
+}
+
+void TemplateMiner::SaveSnapshot(SnapshotWriter& writer) const
+{
+    writer.WriteNumber(m_patterns.size());
+    for (auto& pattern : m_patterns)
+    {
+        writer.WriteNumber(pattern.templateId);
+        writer.WriteStrings(pattern.tokens);
+        writer.WriteArray(std::vector<uint8_t>(pattern.wildcards.begin(), pattern.wildcards.end()));
+    }
+    writer.WriteNumber(m_templates.size());
+    for (auto& t : m_templates)
+    {
+        writer.WriteNumber(t.patternId);
+        writer.WriteNumber(t.count);
+    }
+    writer.WriteNumber(m_groups.size());
+    for (auto& group : m_groups)
+    {
+        writer.WriteString(group.first);
+        writer.WriteArray(group.second);
+    }
+}
+
+void TemplateMiner::LoadSnapshot(SnapshotReader& reader)
+{
+    Clear();
+    m_patterns.clear();
+    auto patterns = reader.ReadCount();
+    for (size_t i = 0; i < patterns; ++i)
+    {
+        Pattern pattern;
+        pattern.templateId = static_cast<TemplateId>(reader.ReadNumber());
+        pattern.tokens = reader.ReadStrings();
+        std::vector<uint8_t> wildcards;
+        reader.ReadArray(wildcards);
+        pattern.wildcards.assign(wildcards.begin(), wildcards.end());
+        m_patterns.push_back(std::move(pattern));
+    }
+    m_templates.clear();
+    auto templates = reader.ReadCount();
+    for (size_t i = 0; i < templates; ++i)
+    {
+        Template t;
+        t.patternId = static_cast<uint32_t>(reader.ReadNumber());
+        t.count = reader.ReadNumber();
+        m_templates.push_back(t);
+    }
+    auto groups = reader.ReadCount();
+    for (size_t i = 0; i < groups; ++i)
+    {
+        auto key = reader.ReadString();
+        reader.ReadArray(m_groups[key]);
+    }
+
+    // Add() and Format() index by these ids without checking them
+    bool valid = !m_patterns.empty() && !m_templates.empty();
+    for (size_t i = 1; valid && i < m_patterns.size(); ++i)
+    {
+        auto& pattern = m_patterns[i];
+        valid = pattern.templateId >= 1 && pattern.templateId < m_templates.size() && pattern.tokens.size() == pattern.wildcards.size();
+    }
+    for (size_t i = 1; valid && i < m_templates.size(); ++i)
+    {
+        valid = m_templates[i].patternId >= 1 && m_templates[i].patternId < m_patterns.size();
+    }
+    for (auto it = m_groups.begin(); valid && it != m_groups.end(); ++it)
+    {
+        for (auto id : it->second)
+        {
+            // a group holds the templates with the number of tokens its key starts with
+            valid = valid && id >= 1 && id < m_templates.size() &&
+                it->first.rfind(std::to_string(m_patterns[m_templates[id].patternId].tokens.size()) + ' ', 0) == 0;
+        }
+    }
+    if (!valid)
+    {
+        Clear();
+        throw std::runtime_error("snapshot is damaged");
+    }
+}
+
+} // namespace debugviewpp
+} // namespace fusion
@@ -0,0 +1,55 @@
+// (C) Copyright Gert-Jan de Vos and Jan Wilmans 2013.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#include "DebugViewppLib/TimeIndex.h"
+
+namespace fusion {
+namespace debugviewpp {
+
+void TimeIndex::Clear()
+{
+    m_count = 0;
+    m_blocks.clear();
+    m_maxSkyline.clear();
+    m_minSkyline.clear();
+}
+
+void TimeIndex::Add(uint64_t time)
+{
+    if (m_count % BlockSize == 0)
+    {
+        m_blocks.push_back(Block{time, time});
+        m_maxSkyline.push_back(m_maxSkyline.empty() ? time : std::max(m_maxSkyline.back(), time));
+    }
+    else
+    {
+        auto& block = m_blocks.back();
+        block.max = std::max(block.max, time);
+        m_maxSkyline.back() = std::max(m_maxSkyline.back(), time);
+        if (time >= block.min)
+        {
+            ++m_count;
+            return;
+        }
+        block.min = time;
+    }
+
+    // the last block always is on the min skyline, an earlier block only while its minimum is the lower
+    int last = static_cast<int>(m_blocks.size()) - 1;
+    while (!m_minSkyline.empty() && m_blocks[m_minSkyline.back()].min >= time)
+    {
+        m_minSkyline.pop_back();
+    }
+    m_minSkyline.push_back(last);
+    ++m_count;
+}
+
+int TimeIndex::Count() const
+{
+    return m_count;
+}
+
+} // namespace debugviewpp
+} // namespace fusion
@@ -0,0 +1,253 @@
+// (C) Copyright Gert-Jan de Vos and Jan Wilmans 2013.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+#include "CobaltFusion/Str.h"
+#include "DebugViewppLib/Conversions.h"
+#include "DebugViewppLib/LogSource.h"
+#include "DebugViewppLib/Trace.h"
+
+namespace fusion {
+namespace debugviewpp {
+
+namespace {
+
+const char Signature[] = {'D', 'V', 'T', 'R', 'A', 'C', 'E', '1'};
+const size_t FlushSize = 1024 * 1024;
+const size_t ReadSize = 1024 * 1024;
+
+long long ToMicroseconds(double time)
+{
+    return std::llround(time * 1e6);
+}
+
+FILETIME ToFileTime(long long ticks)
+{
+    FILETIME ft;
+    ft.dwLowDateTime = static_cast<DWORD>(ticks);
+    ft.dwHighDateTime = static_cast<DWORD>(static_cast<unsigned long long>(ticks) >> 32);
+    return ft;
+}
+
+} // namespace
+
+TraceWriter::TraceWriter(const std::wstring& filename) :
+    m_file(std::filesystem::path(filename), std::ofstream::binary | std::ofstream::trunc)
+{
+    if (!m_file)
+    {
+        throw std::runtime_error("unable to create trace '" + Str(filename).str() + "'");
+    }
+    m_buffer.reserve(FlushSize + 64 * 1024);
+    m_buffer.append(Signature, sizeof(Signature));
+}
+
+TraceWriter::~TraceWriter()
+{
+    Flush();
+}
+
+size_t TraceWriter::GetCount() const
+{
+    return m_count;
+}
+
+void TraceWriter::Write(const Line& line)
+{
+    if (!line.source.empty())
+    {
+        Write(line.time, line.systemTime, line.pid, line.processName, line.source, line.message);
+        return;
+    }
+
+    auto it = m_sourceIds.find(line.sourceId);
+    if (it == m_sourceIds.end())
+    {
+        it = m_sourceIds.emplace(line.sourceId, line.pLogSource != nullptr ? Str(line.pLogSource->GetDescription()).str() : std::string()).first;
+    }
+    Write(line.time, line.systemTime, line.pid, line.processName, it->second, line.message);
+}
+
+void TraceWriter::Write(const TraceRecord& record)
+{
+    Write(record.time, record.systemTime, record.pid, record.processName, record.source, record.message);
+}
+
+void TraceWriter::Write(double time, FILETIME systemTime, DWORD pid, const std::string& processName, const std::string& source, const std::string& message)
+{
+    // lines of different sources are not strictly ordered in time, so the deltas are signed
+    auto microseconds = ToMicroseconds(time);
+    auto ticks = static_cast<long long>(FileTimeToUInt64(systemTime));
+    WriteSigned(microseconds - m_time);
+    WriteSigned(ticks - m_systemTime);
+    m_time = microseconds;
+    m_systemTime = ticks;
+    WriteNumber(pid);
+    WriteName(m_processNames, processName);
+    WriteName(m_sources, source);
+    WriteString(message);
+    ++m_count;
+
+    if (m_buffer.size() >= FlushSize)
+    {
+        Flush();
+    }
+}
+
+void TraceWriter::Flush()
+{
+    m_file.write(m_buffer.data(), static_cast<std::streamsize>(m_buffer.size()));
+    m_file.flush();
+    m_buffer.clear();
+}
+
+void TraceWriter::WriteName(std::unordered_map<std::string, size_t>& names, const std::string& name)
+{
+    auto result = names.emplace(name, names.size());
+    WriteNumber(result.first->second);
+    if (result.second)
+    {
+        WriteString(name);
+    }
+}
+
+void TraceWriter::WriteString(const std::string& value)
+{
+    WriteNumber(value.size());
+    m_buffer.append(value);
+}
+
+void TraceWriter::WriteNumber(unsigned long long value)
+{
+    while (value >= 0x80)
+    {
+        m_buffer.push_back(static_cast<char>((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    m_buffer.push_back(static_cast<char>(value));
+}
+
+void TraceWriter::WriteSigned(long long value)
+{
+    WriteNumber((static_cast<unsigned long long>(value) << 1) ^ static_cast<unsigned long long>(value >> 63));
+}
+
+TraceReader::TraceReader(const std::wstring& filename) :
+    m_file(std::filesystem::path(filename), std::ifstream::binary),
+    m_buffer(ReadSize)
+{
+    if (!m_file)
+    {
+        throw std::runtime_error("unable to open trace '" + Str(filename).str() + "'");
+    }
+    if (!Fill(sizeof(Signature)) || std::memcmp(m_buffer.data(), Signature, sizeof(Signature)) != 0)
+    {
+        throw std::runtime_error("'" + Str(filename).str() + "' is not a DebugView++ trace");
+    }
+    m_pos = sizeof(Signature);
+}
+
+bool TraceReader::Read(TraceRecord& record)
+{
+    if (!Fill(1))
+    {
+        return false;
+    }
+
+    m_time += ReadSigned();
+    m_systemTime += ReadSigned();
+    record.time = m_time / 1e6;
+    record.systemTime = ToFileTime(m_systemTime);
+    record.pid = static_cast<DWORD>(ReadNumber());
+    record.processName = ReadName(m_processNames);
+    record.source = ReadName(m_sources);
+    ReadString(record.message);
+    return true;
+}
+
+// makes at least 'size' bytes available from m_pos, returns false if the file ends before that
+bool TraceReader::Fill(size_t size)
+{
+    if (m_end - m_pos >= size)
+    {
+        return true;
+    }
+
+    std::memmove(m_buffer.data(), m_buffer.data() + m_pos, m_end - m_pos);
+    m_end -= m_pos;
+    m_pos = 0;
+    if (m_buffer.size() < size)
+    {
+        m_buffer.resize(size);
+    }
+    while (m_end < size && m_file)
+    {
+        m_file.read(m_buffer.data() + m_end, static_cast<std::streamsize>(m_buffer.size() - m_end));
+        m_end += static_cast<size_t>(m_file.gcount());
+    }
+    return m_end >= size;
+}
+
+unsigned char TraceReader::ReadByte()
+{
+    if (!Fill(1))
+    {
+        throw std::runtime_error("trace is truncated");
+    }
+    return static_cast<unsigned char>(m_buffer[m_pos++]);
+}
+
+unsigned long long TraceReader::ReadNumber()
+{
+    unsigned long long value = 0;
+    for (int shift = 0; shift < 64; shift += 7)
+    {
+        auto byte = ReadByte();
+        value |= static_cast<unsigned long long>(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0)
+        {
+            return value;
+        }
+    }
+    throw std::runtime_error("trace is damaged");
+}
+
+long long TraceReader::ReadSigned()
+{
+    auto value = ReadNumber();
+    return static_cast<long long>(value >> 1) ^ -static_cast<long long>(value & 1);
+}
+
+void TraceReader::ReadString(std::string& value)
+{
+    auto size = static_cast<size_t>(ReadNumber());
+    if (!Fill(size))
+    {
+        throw std::runtime_error("trace is truncated");
+    }
+    value.assign(m_buffer.data() + m_pos, size);
+    m_pos += size;
+}
+
+const std::string& TraceReader::ReadName(std::vector<std::string>& names)
+{
+    auto index = static_cast<size_t>(ReadNumber());
+    if (index == names.size())
+    {
+        names.emplace_back();
+        ReadString(names.back());
+    }
+    else if (index > names.size())
+    {
+        throw std::runtime_error("trace is damaged");
+    }
+    return names[index];
+}
+
+} // namespace debugviewpp
+} // namespace fusion
@@ -0,0 +1,216 @@
+// (C) Copyright Gert-Jan de Vos and Jan Wilmans 2013.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#include <cstring>
+#include <array>
+#include "CobaltFusion/stringbuilder.h"
+#include "DebugViewppLib/UdpReader.h"
+#include "DebugViewppLib/LineBuffer.h"
+
+#ifdef __linux__
+#include <sys/socket.h>
+#endif
+
+namespace fusion {
+namespace debugviewpp {
+
+using boost::asio::ip::udp;
+
+// large enough to absorb a burst of datagrams from dozens of senders while the reader thread is busy
+constexpr int ReceiveBufferSize = 4 * 1024 * 1024;
+
+// a process name per sender is cached, this limit only protects against address scanning
+constexpr size_t MaxCachedProcessNames = 4096;
+
+UdpReader::UdpReader(Timer& timer, ILineBuffer& lineBuffer, int port) :
+    PolledLogSource(timer, SourceType::Udp, lineBuffer, 0),
+    m_socket(m_ioContext, udp::endpoint(udp::v4(), static_cast<unsigned short>(port))),
+    m_buffer(BatchSize * MaxDatagramSize)
+{
+    SetDescription(wstringbuilder() << L"Listening at UDP port " << GetPort());
+
+    boost::system::error_code ec;
+    m_socket.set_option(udp::socket::receive_buffer_size(ReceiveBufferSize), ec);
+    m_socket.non_blocking(true);
+#ifdef __linux__
+    int enable = 1;
+    setsockopt(m_socket.native_handle(), SOL_SOCKET, SO_RXQ_OVFL, &enable, sizeof(enable));
+#endif
+
+    BeginWait();
+    m_thread = std::thread([this] { m_ioContext.run(); });
+}
+
+UdpReader::~UdpReader()
+{
+    UdpReader::Abort();
+}
+
+void UdpReader::Abort()
+{
+    if (m_thread.joinable())
+    {
+        boost::asio::post(m_ioContext, [this] { m_socket.close(); });
+        m_thread.join();
+    }
+    PolledLogSource::Abort();
+}
+
+// 0 once the socket is closed
+unsigned short UdpReader::GetPort() const
+{
+    boost::system::error_code ec;
+    auto endpoint = m_socket.local_endpoint(ec);
+    return ec ? 0 : endpoint.port();
+}
+
+size_t UdpReader::GetDroppedCount() const
+{
+    return m_dropped;
+}
+
+void UdpReader::BeginWait()
+{
+    m_socket.async_wait(udp::socket::wait_read, [this](const boost::system::error_code& ec) {
+        if (ec)
+        {
+            return; // operation_aborted when the socket is closed by Abort()
+        }
+        Receive();
+        BeginWait();
+    });
+}
+
+void UdpReader::Receive()
+{
+    // keep draining while full batches come in, the listening thread is signaled once per batch
+    for (;;)
+    {
+        auto count = ReceiveBatch();
+        if (count > 0)
+        {
+            Signal();
+        }
+        if (count < BatchSize)
+        {
+            break;
+        }
+    }
+}
+
+#ifdef __linux__
+
+size_t UdpReader::ReceiveBatch()
+{
+    using Control = std::array<char, CMSG_SPACE(sizeof(uint32_t))>;
+
+    std::array<mmsghdr, BatchSize> headers = {};
+    std::array<iovec, BatchSize> iovecs;
+    std::array<sockaddr_storage, BatchSize> addresses;
+    std::array<Control, BatchSize> controls;
+
+    for (size_t i = 0; i < BatchSize; ++i)
+    {
+        iovecs[i].iov_base = m_buffer.data() + i * MaxDatagramSize;
+        iovecs[i].iov_len = MaxDatagramSize;
+        auto& header = headers[i].msg_hdr;
+        header.msg_iov = &iovecs[i];
+        header.msg_iovlen = 1;
+        header.msg_name = &addresses[i];
+        header.msg_namelen = sizeof(addresses[i]);
+        header.msg_control = controls[i].data();
+        header.msg_controllen = controls[i].size();
+    }
+
+    int count = ::recvmmsg(m_socket.native_handle(), headers.data(), BatchSize, MSG_DONTWAIT, nullptr);
+    if (count <= 0)
+    {
+        return 0;
+    }
+
+    for (int i = 0; i < count; ++i)
+    {
+        auto& header = headers[i].msg_hdr;
+        for (auto cmsg = CMSG_FIRSTHDR(&header); cmsg != nullptr; cmsg = CMSG_NXTHDR(&header, cmsg))
+        {
+            if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SO_RXQ_OVFL)
+            {
+                uint32_t counter = 0;
+                std::memcpy(&counter, CMSG_DATA(cmsg), sizeof(counter));
+                UpdateDropCounter(counter);
+            }
+        }
+
+        udp::endpoint endpoint;
+        std::memcpy(endpoint.data(), &addresses[i], header.msg_namelen);
+        endpoint.resize(header.msg_namelen);
+        AddDatagram(endpoint, m_buffer.data() + i * MaxDatagramSize, headers[i].msg_len);
+    }
+    return static_cast<size_t>(count);
+}
+
+#else
+
+size_t UdpReader::ReceiveBatch()
+{
+    size_t count = 0;
+    while (count < BatchSize)
+    {
+        udp::endpoint endpoint;
+        boost::system::error_code ec;
+        auto size = m_socket.receive_from(boost::asio::buffer(m_buffer.data(), MaxDatagramSize), endpoint, 0, ec);
+        if (ec == boost::asio::error::connection_reset)
+        {
+            continue; // windows reports ICMP port unreachable from an earlier send on the next receive
+        }
+        if (ec)
+        {
+            break;
+        }
+        AddDatagram(endpoint, m_buffer.data(), size);
+        ++count;
+    }
+    return count;
+}
+
+#endif
+
+void UdpReader::AddDatagram(const udp::endpoint& endpoint, const char* data, size_t size)
+{
+    // multi-line datagrams are split by the NewlineFilter, trailing '\0's are not part of the message
+    auto length = strnlen(data, size);
+    AddMessage(0, GetProcessText(endpoint), std::string(data, length));
+}
+
+void UdpReader::UpdateDropCounter(uint32_t counter)
+{
+    // SO_RXQ_OVFL reports the total number of datagrams dropped on this socket so far
+    auto dropped = counter - m_dropCounter;
+    m_dropCounter = counter;
+    if (dropped > 0)
+    {
+        m_dropped += dropped;
+        AddMessage(stringbuilder() << "<" << dropped << " UDP datagrams were dropped by the kernel, receive buffer overflow>\n");
+    }
+}
+
+const std::string& UdpReader::GetProcessText(const udp::endpoint& endpoint)
+{
+    auto it = m_processNames.find(endpoint);
+    if (it != m_processNames.end())
+    {
+        return it->second;
+    }
+
+    if (m_processNames.size() >= MaxCachedProcessNames)
+    {
+        m_processNames.clear();
+    }
+    std::string processText = stringbuilder() << "[UDP " << endpoint.address().to_string() << ":" << endpoint.port() << "]";
+    return m_processNames.emplace(endpoint, processText).first->second;
+}
+
+} // namespace debugviewpp
+} // namespace fusion
@@ -3,6 +3,7 @@
 // (See accompanying file LICENSE_1_0.txt or copy at
 // http://www.boost.org/LICENSE_1_0.txt)
 
+#include "DebugViewppLib/LatencyTrace.h"
 #include "DebugViewppLib/ProcessInfo.h"
 #include "DebugViewppLib/VectorLineBuffer.h"
 
@@ -14,16 +15,28 @@ VectorLineBuffer::VectorLineBuffer(size_t /*unused*/)
 {
 }
 
+// every LogSource::Add ends up here, so this is where lines are stamped for latency tracing
 void VectorLineBuffer::Add(double time, FILETIME systemTime, HANDLE handle, const std::string& message, const LogSource* pSource)
 {
+    auto ingestTicks = SampleLatency();
     std::lock_guard<std::mutex> lock(m_linesMutex);
     m_buffer.emplace_back(time, systemTime, handle, message, pSource);
+    m_buffer.back().ingestTicks = ingestTicks;
 }
 
 void VectorLineBuffer::Add(double time, FILETIME systemTime, DWORD pid, const std::string& processName, const std::string& message, const LogSource* pSource)
 {
+    auto ingestTicks = SampleLatency();
     std::lock_guard<std::mutex> lock(m_linesMutex);
     m_buffer.emplace_back(time, systemTime, pid, processName, message, pSource);
+    m_buffer.back().ingestTicks = ingestTicks;
+}
+
+void VectorLineBuffer::Add(Line line)
+{
+    line.ingestTicks = SampleLatency();
+    std::lock_guard<std::mutex> lock(m_linesMutex);
+    m_buffer.push_back(std::move(line));
 }
 
 // returning a 'const Lines&' here might be an performance improvement, however, tests reveiled no measureable difference.
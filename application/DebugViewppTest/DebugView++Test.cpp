@@ -11,6 +11,12 @@
 #include <random>
 #include <fstream>
 #include <iostream>
+#include <limits>
+#include <map>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <sstream>
 
 #include "Win32/Utilities.h"
 #include "Win32/Win32Lib.h"
@@ -18,13 +24,33 @@
 #include "CobaltFusion/ExecutorClient.h"
 #include "CobaltFusion/Executor.h"
 #include "IndexedStorageLib/IndexedStorage.h"
+#include "ShmRingLib/ShmRing.h"
 #include "DebugViewppLib/ProcessInfo.h"
+#include "DebugViewppLib/BatchFilter.h"
 #include "DebugViewppLib/DBWinBuffer.h"
+#include "DebugViewppLib/DbgviewReader.h"
+#include "DebugViewppLib/FilterEvaluator.h"
+#include "DebugViewppLib/LatencyTrace.h"
+#include "DebugViewppLib/ListenerPool.h"
 #include "DebugViewppLib/LogSources.h"
 #include "DebugViewppLib/LogSource.h"
+#include "DebugViewppLib/MemoryGovernor.h"
+#include "DebugViewppLib/Metrics.h"
+#include "DebugViewppLib/PipeReader.h"
+#include "DebugViewppLib/ProcessMonitor.h"
+#include "DebugViewppLib/RateLimiter.h"
+#include "DebugViewppLib/ReplaySource.h"
+#include "DebugViewppLib/Snapshot.h"
+#include "DebugViewppLib/SourceRegistry.h"
+#include "DebugViewppLib/StreamWriter.h"
+#include "DebugViewppLib/TemplateMiner.h"
 #include "DebugViewppLib/TestSource.h"
+#include "DebugViewppLib/UdpReader.h"
+#include "DebugViewppLib/TcpReader.h"
+#include "DebugViewppLib/Trace.h"
 #include "DebugViewppLib/VectorLineBuffer.h"
 #include "DebugViewppLib/LogFile.h"
+#include "DebugViewppLib/LogLine.h"
 #include "DebugViewppLib/FileIO.h"
 #include "DebugViewppLib/Conversions.h"
 #include "CobaltFusion/scope_guard.h"
@@ -56,6 +82,45 @@ public:
 };
 
 
+// counts the lines added, so a test can wait for them instead of sleeping
+class CountingLineBuffer : public VectorLineBuffer
+{
+public:
+    using VectorLineBuffer::VectorLineBuffer;
+
+    void Add(double time, FILETIME systemTime, HANDLE handle, const std::string& message, const LogSource* pSource) override
+    {
+        VectorLineBuffer::Add(time, systemTime, handle, message, pSource);
+        Count();
+    }
+
+    void Add(double time, FILETIME systemTime, DWORD pid, const std::string& processName, const std::string& message, const LogSource* pSource) override
+    {
+        VectorLineBuffer::Add(time, systemTime, pid, processName, message, pSource);
+        Count();
+    }
+
+    bool WaitFor(size_t count)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        return m_added.wait_for(lock, std::chrono::seconds(10), [this, count] { return m_count >= count; });
+    }
+
+private:
+    void Count()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            ++m_count;
+        }
+        m_added.notify_all();
+    }
+
+    std::mutex m_mutex;
+    std::condition_variable m_added;
+    size_t m_count = 0;
+};
+
 class ScopedTimezoneBias
 {
 public:
@@ -257,6 +322,69 @@ BOOST_AUTO_TEST_CASE(HandleTest)
     }
 }
 
+BOOST_AUTO_TEST_CASE(ProcessMonitorManyProcesses)
+{
+    // events stand in for process handles, far more than fit a single WaitForMultipleObjects call
+    const DWORD count = 200;
+    std::vector<Win32::Handle> handles;
+    for (DWORD i = 0; i < count; ++i)
+    {
+        handles.push_back(Win32::CreateEvent(nullptr, true, false, nullptr));
+    }
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::vector<DWORD> ended;
+    ProcessMonitor monitor;
+    auto guard = make_guard([&] { monitor.Abort(); });
+    monitor.ConnectProcessEnded([&](DWORD pid, HANDLE) {
+        std::lock_guard<std::mutex> lock(mutex);
+        ended.push_back(pid);
+        cv.notify_one();
+    });
+    for (DWORD i = 0; i < count; ++i)
+    {
+        monitor.Add(i + 1, handles[i].get());
+    }
+    for (auto& handle : handles)
+    {
+        Win32::SetEvent(handle);
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+    BOOST_TEST(cv.wait_for(lock, std::chrono::seconds(5), [&] { return ended.size() == count; }));
+    std::sort(ended.begin(), ended.end());
+    BOOST_TEST((std::adjacent_find(ended.begin(), ended.end()) == ended.end()));
+
+    PidMap pidMap;
+    std::string name;
+    BOOST_TEST(pidMap.Add(42, Win32::Handle(::OpenProcess(SYNCHRONIZE, FALSE, GetCurrentProcessId())), "test.exe"));
+    BOOST_TEST(!pidMap.Add(42, Win32::Handle(::OpenProcess(SYNCHRONIZE, FALSE, GetCurrentProcessId())), "other.exe"));
+    BOOST_TEST(pidMap.Find(42, name));
+    BOOST_TEST(name == "test.exe");
+    pidMap.Remove(42);
+    BOOST_TEST(!pidMap.Find(42, name));
+}
+
+BOOST_AUTO_TEST_CASE(ProcessInfoUid)
+{
+    ProcessInfo processInfo;
+    for (DWORD pid = 0; pid < 10000; ++pid)
+    {
+        BOOST_TEST(processInfo.GetUid(pid, "cl.exe") == pid);
+    }
+    BOOST_TEST(processInfo.GetUid(42, "cl.exe") == DWORD(42));
+
+    auto uid = processInfo.GetUid(42, "link.exe");
+    BOOST_TEST(uid == DWORD(10000));
+    auto props = processInfo.GetProcessProperties(uid);
+    BOOST_TEST(props.pid == DWORD(42));
+    BOOST_TEST(props.name == "link.exe");
+
+    // names are stored once for all processes that share them
+    BOOST_TEST(processInfo.GetProcessProperties(1).name.data() == processInfo.GetProcessProperties(2).name.data());
+}
+
 BOOST_AUTO_TEST_CASE(LineBufferTest1)
 {
     TestLineBuffer buffer(64);
@@ -362,6 +490,383 @@ BOOST_AUTO_TEST_CASE(IndexedStorageCompression)
     BOOST_TEST(size_t(0.50 * usedByVector) > usedBySnappy);
 }
 
+BOOST_AUTO_TEST_CASE(LogFileDeduplication)
+{
+    // a flood of one text interleaved with distinct texts, more of them than the table of recent texts holds
+    const int testSize = 20000;
+    const std::string longText(2000, 'x');
+    auto getText = [&](int i) { return i % 4 == 0 ? GetTestString(i) : i % 4 == 3 ? longText : std::string("flood"); };
+    LogFile logFile;
+    logFile.SetTemplateEncoding(false); // the parameters of a template are deduplicated just the same, but harder to count
+    size_t rawSize = 0;
+    for (int i = 0; i < testSize; ++i)
+    {
+        logFile.Add(Message(0, FILETIME(), i % 2 + 1, "a.exe", getText(i)));
+        rawSize += getText(i).size();
+    }
+
+    // every distinct and every long text is stored, the flood once and again after each turnover of the recent texts
+    BOOST_TEST(logFile.Count() == testSize);
+    BOOST_TEST(logFile.GetRawSize() == rawSize);
+    BOOST_TEST(logFile.GetDistinctCount() > static_cast<size_t>(testSize / 2));
+    BOOST_TEST(logFile.GetDistinctCount() < static_cast<size_t>(testSize / 2 + 10));
+    for (int i = 0; i < testSize; ++i)
+    {
+        BOOST_TEST(logFile[i].text == getText(i));
+    }
+
+    // a repeat needs the same text from the same process
+    BOOST_TEST(logFile.IsRepeat(1, 5));
+    BOOST_TEST(!logFile.IsRepeat(1, 2));
+    BOOST_TEST(!logFile.IsRepeat(0, 4));
+}
+
+BOOST_AUTO_TEST_CASE(TemplateMinerRoundTrip)
+{
+    TemplateMiner miner;
+    std::string params;
+    auto first = miner.Add("connect to host 10.0.0.1 port 80 ok", params);
+    BOOST_TEST(first.templateId != 0u);
+    BOOST_TEST(params == "10.0.0.1\n80");
+
+    // 'ok' differs from 'failed', the template generalizes but the line added before is still restored
+    auto second = miner.Add("connect to host 10.0.0.2 port 8080 failed", params);
+    BOOST_TEST(second.templateId == first.templateId);
+    BOOST_TEST(second.patternId != first.patternId);
+    BOOST_TEST(miner.GetText(first.templateId) == "connect to host <*> port <*> <*>");
+    BOOST_TEST(miner.Format(second.patternId, params) == "connect to host 10.0.0.2 port 8080 failed");
+    BOOST_TEST(miner.Format(first.patternId, "10.0.0.1\n80") == "connect to host 10.0.0.1 port 80 ok");
+
+    // a different number of tokens or a different text is a different template
+    BOOST_TEST(miner.Add("connect to host 10.0.0.3", params).templateId != first.templateId);
+    BOOST_TEST(miner.Add("disk full on volume C:", params).templateId != first.templateId);
+    BOOST_TEST(miner.Add("two\nlines", params).templateId == 0u);
+    BOOST_TEST(miner.GetCount(first.templateId) == 2u);
+    BOOST_TEST(miner.GetTemplateCount() == 3u);
+
+    // the log file stores the lines with a template as their parameters, and must restore every text exactly
+    std::vector<std::string> texts = {"", " ", "  leading and trailing  ", "a <*> b", "tab\tseparated 1", "x\ny", "\n"};
+    for (int i = 0; i < 1000; ++i)
+    {
+        texts.push_back(stringbuilder() << "request " << i << " took " << i * 3 << " ms " << (i % 2 == 0 ? "" : "slow"));
+    }
+    LogFile logFile;
+    for (auto& text : texts)
+    {
+        logFile.Add(Message(0, FILETIME(), 1, "a.exe", text));
+    }
+    for (int i = 0; i < logFile.Count(); ++i)
+    {
+        BOOST_TEST(logFile[i].text == texts[i]);
+    }
+    BOOST_TEST(logFile.GetTemplateId(7) == logFile.GetTemplateId(8));
+    BOOST_TEST(logFile.GetTemplates().GetCount(logFile.GetTemplateId(7)) == 1000u);
+    BOOST_TEST(logFile.GetTemplateId(5) == 0u);
+}
+
+BOOST_AUTO_TEST_CASE(LogFileTimeIndex)
+{
+    auto toFileTime = [](uint64_t time) {
+        FILETIME ft;
+        ft.dwLowDateTime = static_cast<DWORD>(time);
+        ft.dwHighDateTime = static_cast<DWORD>(time >> 32);
+        return ft;
+    };
+
+    // lines of several sources arrive in time order per source, but up to a few hundred ticks out of order overall
+    std::mt19937 random(42);
+    std::vector<uint64_t> times;
+    LogFile logFile;
+    for (int i = 0; i < 5000; ++i)
+    {
+        times.push_back(1000 + i * 10 + random() % 500);
+        logFile.Add(Message(0, toFileTime(times.back()), 1, "a.exe", "line"));
+    }
+
+    for (uint64_t time = 0; time < 52000; time += 37)
+    {
+        auto lower = static_cast<int>(std::find_if(times.begin(), times.end(), [time](uint64_t t) { return t >= time; }) - times.begin());
+        auto upper = static_cast<int>(std::find_if(times.rbegin(), times.rend(), [time](uint64_t t) { return t <= time; }).base() - times.begin());
+        BOOST_TEST(logFile.LowerBoundTime(toFileTime(time)) == lower);
+        BOOST_TEST(logFile.UpperBoundTime(toFileTime(time)) == upper);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(LogFileSnapshot)
+{
+    auto snapshot = std::filesystem::absolute("Snapshot_unique_test_filename.dvsnap").wstring();
+    auto guard = make_guard([&] { std::filesystem::remove(snapshot); });
+
+    LogFile logFile;
+    logFile.SetSpillFile(std::filesystem::absolute("Snapshot_unique_test_filename.spill").wstring());
+    for (int i = 0; i < 3000; ++i)
+    {
+        FILETIME ft = {static_cast<DWORD>(1000 + i), 0};
+        auto text = i % 3 == 0 ? std::string("flood") : std::string(stringbuilder() << "request " << i << " took " << i * 3 << " ms");
+        logFile.Add(Message(i * 0.5, ft, i % 5, i % 2 == 0 ? "a.exe" : "b.exe", text));
+    }
+
+    // the writer takes the compressed blocks when it commits, blocks spilled after saving are read from the spill file
+    auto storedSize = logFile.GetStoredSize();
+    {
+        SnapshotWriter writer(snapshot);
+        logFile.SaveSnapshot(writer);
+        writer.WriteString("views");
+        BOOST_TEST(logFile.SpillBlocks(storedSize / 2) > 0u);
+        writer.Commit();
+    }
+
+    // loading replaces what the log held, and the sections that follow are read back in order
+    LogFile restored;
+    restored.Add(Message(0, FILETIME(), 1, "x.exe", "replaced"));
+    SnapshotReader reader(snapshot);
+    restored.LoadSnapshot(reader);
+    BOOST_TEST(reader.ReadString() == "views");
+    BOOST_REQUIRE(restored.Count() == logFile.Count());
+    BOOST_TEST(restored.GetRawSize() == logFile.GetRawSize());
+    BOOST_TEST(restored.GetStoredSize() == storedSize);
+    BOOST_TEST(restored.GetTemplates().GetTemplateCount() == logFile.GetTemplates().GetTemplateCount());
+    for (int i = 0; i < restored.Count(); ++i)
+    {
+        auto expected = logFile[i];
+        auto msg = restored[i];
+        BOOST_TEST(msg.text == expected.text);
+        BOOST_TEST(msg.processName == expected.processName);
+        BOOST_TEST(msg.processId == expected.processId);
+        BOOST_TEST(msg.time == expected.time);
+        BOOST_TEST(msg.color == expected.color);
+        BOOST_TEST(restored.GetTemplateId(i) == logFile.GetTemplateId(i));
+    }
+
+    // the time index is rebuilt and new lines continue the log
+    FILETIME ft = {2500, 0};
+    BOOST_TEST(restored.LowerBoundTime(ft) == 1500);
+    restored.Add(Message(0, FILETIME(), 1, "a.exe", "request 1 took 99 ms"));
+    BOOST_TEST(restored[restored.Count() - 1].text == "request 1 took 99 ms");
+
+    // a line that refers to a text the snapshot does not hold, its textId follows the signature, the line count, the
+    // time, the system time and the uid
+    {
+        std::fstream file(std::filesystem::path(snapshot), std::ios::in | std::ios::out | std::ios::binary);
+        file.seekp(40);
+        uint64_t textId = 1000000;
+        file.write(reinterpret_cast<const char*>(&textId), sizeof(textId));
+    }
+    SnapshotReader damaged(snapshot);
+    BOOST_CHECK_THROW(restored.LoadSnapshot(damaged), std::runtime_error);
+    BOOST_TEST(restored.Count() == 0);
+}
+
+BOOST_AUTO_TEST_CASE(LogLinesSnapshot)
+{
+    auto snapshot = std::filesystem::absolute("LogLines_unique_test_filename.dvsnap").wstring();
+    auto guard = make_guard([&] { std::filesystem::remove(snapshot); });
+
+    // a filtered view of a 3000 line log, the focus is on a line of the log beyond the number of lines in the view
+    const int logCount = 3000;
+    std::vector<LogLine> logLines;
+    for (int line = 0; line < logCount; line += 3)
+    {
+        LogLine logLine(line);
+        logLine.lastLine = line + line % 2;
+        logLine.repeats = line % 2;
+        logLine.bookmark = line % 7 == 0;
+        logLine.expanded = line % 11 == 0;
+        logLines.push_back(logLine);
+    }
+    const int focusLine = 2400;
+    {
+        SnapshotWriter writer(snapshot);
+        SaveLogLines(writer, logLines, focusLine);
+        SaveLogLines(writer, logLines, logCount);
+        writer.Commit();
+    }
+
+    SnapshotReader reader(snapshot);
+    int restoredFocus = -1;
+    auto restored = LoadLogLines(reader, logCount, restoredFocus);
+    BOOST_TEST(restoredFocus == focusLine);
+    BOOST_REQUIRE(restored.size() == logLines.size());
+    for (size_t i = 0; i < restored.size(); ++i)
+    {
+        BOOST_TEST(restored[i].line == logLines[i].line);
+        BOOST_TEST(restored[i].lastLine == logLines[i].lastLine);
+        BOOST_TEST(restored[i].repeats == logLines[i].repeats);
+        BOOST_TEST(restored[i].bookmark == logLines[i].bookmark);
+        BOOST_TEST(restored[i].expanded == logLines[i].expanded);
+    }
+
+    // a focus line that is not in the log
+    BOOST_CHECK_THROW(LoadLogLines(reader, logCount, restoredFocus), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(MemoryGovernorEscalation)
+{
+    // the actions come cheapest first, only while over the limit and at most once per round
+    MemoryGovernor governor;
+    governor.Account("a", 600);
+    governor.Account("b", 600);
+    governor.BeginRound();
+    BOOST_TEST((governor.Next() == MemoryGovernor::Action::None));
+
+    // over the limit the governor frees down to a tenth below it
+    governor.SetLimit(1000);
+    BOOST_TEST(governor.GetExcess() == 300u);
+    auto shrinks = GetMetrics().GetCounter("memory.action.shrink-caches").Get();
+    governor.BeginRound();
+    BOOST_TEST((governor.Next() == MemoryGovernor::Action::ShrinkCaches));
+    BOOST_TEST((governor.Next() == MemoryGovernor::Action::CompressWriteBlock));
+    BOOST_TEST((governor.Next() == MemoryGovernor::Action::SpillBlocks));
+    BOOST_TEST((governor.Next() == MemoryGovernor::Action::EvictHistory));
+    BOOST_TEST((governor.Next() == MemoryGovernor::Action::None));
+    BOOST_TEST(GetMetrics().GetCounter("memory.action.shrink-caches").Get() == shrinks + 1);
+    BOOST_TEST(GetMetrics().GetGauge("memory.a").Get() == 600);
+
+    governor.BeginRound();
+    BOOST_TEST((governor.Next() == MemoryGovernor::Action::ShrinkCaches));
+    governor.Account("b", 100);
+    BOOST_TEST((governor.Next() == MemoryGovernor::Action::None));
+
+    // between the low mark and the limit it only acts when it did not get under the low mark yet
+    governor.Account("b", 350);
+    governor.BeginRound();
+    BOOST_TEST((governor.Next() == MemoryGovernor::Action::None));
+    governor.Account("b", 500);
+    governor.BeginRound();
+    BOOST_TEST((governor.Next() == MemoryGovernor::Action::ShrinkCaches));
+    governor.Account("b", 350);
+    BOOST_TEST(governor.GetExcess() == 50u);
+    BOOST_TEST((governor.Next() == MemoryGovernor::Action::CompressWriteBlock));
+    BOOST_TEST(MemoryGovernor::MegabytesToBytes(1) == 1024u * 1024u);
+    BOOST_TEST(MemoryGovernor::MegabytesToBytes(std::numeric_limits<uint64_t>::max()) == std::numeric_limits<size_t>::max());
+
+    // spilled blocks read back from disk, evicted lines are gone and the later lines move down
+    const int testSize = 5000;
+    LogFile logFile;
+    for (int i = 0; i < testSize; ++i)
+    {
+        logFile.Add(Message(0, FILETIME{static_cast<DWORD>(i), 0}, 1, "a.exe", GetTestString(i)));
+    }
+    auto storedSize = logFile.GetStoredSize();
+    logFile.SetSpillFile(std::filesystem::absolute("MemoryGovernor_unique_test_filename.spill").wstring(), storedSize / 4);
+    logFile.CompressWriteBlock();
+    BOOST_TEST(logFile.SpillBlocks(storedSize / 2) > 0u);
+    BOOST_TEST(logFile.GetSpilledSize() > 0u);
+    BOOST_TEST(logFile.GetSpilledSize() <= storedSize / 4);
+    BOOST_TEST(logFile.GetStoredSize() < storedSize);
+    for (int i = 0; i < testSize; ++i)
+    {
+        BOOST_TEST(logFile[i].text == GetTestString(i));
+    }
+
+    // the spill file is full, the space of the evicted blocks is written again
+    auto spilledSize = logFile.GetSpilledSize();
+    logFile.Evict(testSize / 2);
+    BOOST_TEST(logFile.GetSpilledSize() < spilledSize);
+    BOOST_TEST(logFile.SpillBlocks(storedSize / 2) > 0u);
+    BOOST_TEST(logFile.GetSpilledSize() <= storedSize / 4);
+    BOOST_TEST(logFile.Count() == testSize / 2);
+    BOOST_TEST(logFile[0].text == GetTestString(testSize / 2));
+    BOOST_TEST(logFile.LowerBoundTime(FILETIME{testSize - 1, 0}) == testSize / 2 - 1);
+    logFile.Add(Message(0, FILETIME(), 1, "a.exe", "after eviction"));
+    BOOST_TEST(logFile[logFile.Count() - 1].text == "after eviction");
+}
+
+BOOST_AUTO_TEST_CASE(ListenerPoolPreservesSourceOrder)
+{
+    Timer timer;
+    CountingLineBuffer buffer(0);
+    ListenerPool pool(2, [] {});
+
+    // more sources than a single WaitForMultipleObjects can handle
+    std::vector<std::unique_ptr<PolledLogSource>> sources;
+    for (int i = 0; i < 150; ++i)
+    {
+        sources.emplace_back(std::make_unique<PolledLogSource>(timer, SourceType::System, buffer, 0));
+        pool.Add(sources.back().get());
+    }
+    BOOST_TEST(pool.GetThreadCount() == 3);
+
+    for (int line = 0; line < 100; ++line)
+    {
+        for (auto& pSource : sources)
+        {
+            pSource->AddMessage(0, "test", std::to_string(line));
+            pSource->Signal();
+        }
+    }
+    BOOST_REQUIRE(buffer.WaitFor(sources.size() * 100));
+    pool.Abort();
+
+    auto lines = buffer.GetLines();
+    std::map<const LogSource*, int> next;
+    for (auto& line : lines)
+    {
+        BOOST_TEST(std::stoi(line.message) == next[line.pLogSource]++);
+    }
+    BOOST_TEST(next.size() == sources.size());
+    for (auto& item : next)
+    {
+        BOOST_TEST(item.second == 100);
+    }
+
+    // the merged order does not depend on how the threads interleaved the sources
+    Lines reversed;
+    for (auto it = lines.rbegin(); it != lines.rend(); ++it)
+    {
+        reversed.push_back(*it);
+    }
+    std::stable_sort(reversed.begin(), reversed.end(), [](const Line& a, const Line& b) { return a.sourceId > b.sourceId; });
+    for (size_t begin = 0, end = 0; begin < reversed.size(); begin = end)
+    {
+        while (end < reversed.size() && reversed[end].sourceId == reversed[begin].sourceId)
+        {
+            ++end;
+        }
+        std::reverse(reversed.begin() + begin, reversed.begin() + end);
+    }
+    ListenerPool::Merge(lines);
+    ListenerPool::Merge(reversed);
+    BOOST_REQUIRE(lines.size() == reversed.size());
+    for (size_t i = 0; i < lines.size(); ++i)
+    {
+        BOOST_TEST(lines[i].sourceId == reversed[i].sourceId);
+        BOOST_TEST(lines[i].message == reversed[i].message);
+    }
+    for (size_t i = 1; i < lines.size(); ++i)
+    {
+        BOOST_TEST(lines[i - 1].time <= lines[i].time);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(SourceRegistrySnapshot)
+{
+    Timer timer;
+    VectorLineBuffer buffer(0);
+    TestSource source1(timer, buffer);
+    TestSource source2(timer, buffer);
+    BOOST_TEST(source1.GetSourceId() != source2.GetSourceId());
+
+    SourceRegistry registry;
+    registry.Add(source1.GetSourceId());
+    registry.Add(source2.GetSourceId());
+    SourceRegistry::Snapshot snapshot;
+    BOOST_TEST(registry.Update(snapshot));
+    BOOST_TEST(!registry.Update(snapshot));
+    BOOST_TEST(snapshot.Contains(source1.GetSourceId()));
+    BOOST_TEST(snapshot.Contains(source2.GetSourceId()));
+    BOOST_TEST(!snapshot.Contains(0));
+
+    source1.AddInternal("line");
+    registry.Remove(source1.GetSourceId());
+    BOOST_TEST(snapshot.Contains(source1.GetSourceId())); // a snapshot only changes on Update()
+    BOOST_TEST(registry.Update(snapshot));
+    auto lines = buffer.GetLines();
+    BOOST_REQUIRE(lines.size() == 1);
+    BOOST_TEST(!snapshot.Contains(lines[0].sourceId));
+    BOOST_TEST(snapshot.Contains(source2.GetSourceId()));
+}
+
 // execute as:
 // "DebugView++Test.exe" --log_level=test_suite --run_test=*/LogSourcesReceiveMessages
 BOOST_AUTO_TEST_CASE(LogSourcesReceiveMessages)
@@ -511,6 +1016,204 @@ BOOST_AUTO_TEST_CASE(LogSourceDBWinReader)
     BOOST_TEST(lines.size() == 1);
 }
 
+BOOST_AUTO_TEST_CASE(LogSourceUdpReader)
+{
+    using namespace std::chrono_literals;
+    using boost::asio::ip::udp;
+
+    auto executor = std::make_unique<ActiveExecutorClient>();
+    Lines lines;
+    {
+        LogSources logsources(*executor, true);
+        UdpReader* pUdpReader = nullptr;
+        executor->Call([&] { logsources.SetAutoNewLine(true); });
+        executor->Call([&] { pUdpReader = logsources.AddUDPReader(0); });
+
+        boost::asio::io_context ioContext;
+        udp::socket socket(ioContext, udp::endpoint(udp::v4(), 0));
+        udp::endpoint target(boost::asio::ip::address_v4::loopback(), pUdpReader->GetPort());
+        socket.send_to(boost::asio::buffer(std::string("datagram 1\n")), target);
+        socket.send_to(boost::asio::buffer(std::string("datagram 2 line 1\ndatagram 2 line 2\n")), target);
+        socket.send_to(boost::asio::buffer(std::string("datagram 3")), target);
+        std::this_thread::sleep_for(200ms);
+
+        executor->Call([&] { lines = logsources.GetLines(); });
+        executor->Call([&] { logsources.Abort(); });
+    }
+    executor.reset();
+
+    std::vector<std::string> messages;
+    for (auto& line : lines)
+    {
+        if (line.processName.find("[UDP 127.0.0.1:") == 0)
+        {
+            messages.push_back(line.message);
+        }
+    }
+    BOOST_TEST(messages.size() == 4);
+    BOOST_TEST(messages.at(0) == "datagram 1");
+    BOOST_TEST(messages.at(1) == "datagram 2 line 1");
+    BOOST_TEST(messages.at(2) == "datagram 2 line 2");
+    BOOST_TEST(messages.at(3) == "datagram 3");
+}
+
+BOOST_AUTO_TEST_CASE(LogSourceTcpReader)
+{
+    using namespace std::chrono_literals;
+    using boost::asio::ip::tcp;
+
+    const int clientCount = 100;
+    const int linesPerClient = 50;
+
+    auto executor = std::make_unique<ActiveExecutorClient>();
+    std::map<std::string, std::vector<std::string>> messagesByPeer;
+    {
+        LogSources logsources(*executor, true);
+        TcpReader* pTcpReader = nullptr;
+        executor->Call([&] { pTcpReader = logsources.AddTCPReader(0); });
+
+        // loopback client generator, every client sends its own numbered lines
+        boost::asio::io_context ioContext;
+        tcp::endpoint target(boost::asio::ip::address_v4::loopback(), pTcpReader->GetPort());
+        std::vector<tcp::socket> clients;
+        for (int i = 0; i < clientCount; ++i)
+        {
+            clients.emplace_back(ioContext);
+            clients.back().connect(target);
+        }
+        for (int line = 0; line < linesPerClient; ++line)
+        {
+            for (auto& client : clients)
+            {
+                boost::asio::write(client, boost::asio::buffer(std::string(stringbuilder() << "line " << line << "\n")));
+            }
+        }
+        clients.clear();
+
+        size_t received = 0;
+        for (int i = 0; i < 50 && received < clientCount * linesPerClient; ++i)
+        {
+            std::this_thread::sleep_for(100ms);
+            Lines lines;
+            executor->Call([&] { lines = logsources.GetLines(); });
+            for (auto& line : lines)
+            {
+                if (line.processName.find("[TCP 127.0.0.1:") == 0)
+                {
+                    messagesByPeer[line.processName].push_back(line.message);
+                    ++received;
+                }
+            }
+        }
+        executor->Call([&] { logsources.Abort(); });
+    }
+    executor.reset();
+
+    BOOST_TEST(messagesByPeer.size() == clientCount);
+    for (auto& peer : messagesByPeer)
+    {
+        BOOST_TEST(peer.second.size() == linesPerClient);
+        for (size_t i = 0; i < peer.second.size(); ++i)
+        {
+            BOOST_TEST(peer.second[i] == std::string(stringbuilder() << "line " << i));
+        }
+    }
+}
+
+Lines CreateDbgviewTestLines(size_t count)
+{
+    Lines lines;
+    for (size_t i = 0; i < count; ++i)
+    {
+        lines.emplace_back(i * 0.5, Win32::GetSystemTimeAsFileTime(), static_cast<DWORD>(1000 + i), "", GetTestString(i), nullptr);
+    }
+    return lines;
+}
+
+BOOST_AUTO_TEST_CASE(DbgviewDecoderSplitBlocks)
+{
+    auto block = DbgviewDecoder::Encode(CreateDbgviewTestLines(5), 1000000);
+    std::vector<char> stream = block;
+    stream.insert(stream.end(), sizeof(DWORD), '\0'); // keep alive
+    stream.insert(stream.end(), block.begin(), block.end());
+
+    // every split point must yield the same records, incomplete blocks are left in the buffer
+    for (size_t split = 0; split <= stream.size(); ++split)
+    {
+        DbgviewDecoder decoder(1000000);
+        Lines lines;
+        auto consumed = decoder.Decode(stream.data(), split, lines);
+        consumed += decoder.Decode(stream.data() + consumed, stream.size() - consumed, lines);
+        BOOST_TEST(consumed == stream.size());
+        BOOST_REQUIRE(lines.size() == 10);
+        BOOST_TEST(lines[3].pid == DWORD(1003));
+        BOOST_TEST(lines[3].message == GetTestString(3) + "\n");
+        BOOST_TEST(std::fabs(lines[3].time - 1.5) < 0.000001);
+    }
+
+    // a length beyond the protocol bound is rejected before anything is buffered for it
+    std::vector<char> bogus(sizeof(DWORD));
+    DWORD length = DbgviewDecoder::MaxMessageLength + 1;
+    std::memcpy(bogus.data(), &length, sizeof(length));
+    DbgviewDecoder decoder(1000000);
+    Lines lines;
+    BOOST_CHECK_THROW(decoder.Decode(bogus.data(), bogus.size(), lines), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(LogSourceDbgviewReader)
+{
+    using namespace std::chrono_literals;
+
+    Timer timer;
+    TestLineBuffer buffer(64);
+    DbgviewAgentSimulator agent;
+    DbgviewReader reader(timer, buffer, "127.0.0.1", std::to_string(agent.GetPort()));
+    agent.Accept();
+    agent.Send(DbgviewDecoder::Encode(CreateDbgviewTestLines(100), 1000000));
+    agent.Close();
+    std::this_thread::sleep_for(200ms);
+
+    reader.Notify();
+    auto lines = buffer.GetLines();
+    BOOST_REQUIRE(lines.size() == 102); // "Connected to..." + 100 records + "Connection to ... closed."
+    BOOST_TEST(lines[1].pid == DWORD(1000));
+    BOOST_TEST(lines[100].message == GetTestString(99) + "\n");
+    BOOST_TEST(reader.AtEnd());
+}
+
+BOOST_AUTO_TEST_CASE(LogSourcePipeReader)
+{
+    using namespace std::chrono_literals;
+
+    HANDLE hRead = nullptr;
+    HANDLE hWrite = nullptr;
+    BOOST_REQUIRE(CreatePipe(&hRead, &hWrite, nullptr, 0));
+    Win32::Handle readPipe(hRead);
+
+    Timer timer;
+    TestLineBuffer buffer(64);
+    PipeReader reader(timer, buffer, hRead, 42, "pipe");
+
+    // the string literal would end at the embedded NUL, its length is given explicitly
+    std::string data("line 1\nline 2\0line", 18);
+    data += std::string(5000, 'x') + "\n";
+    DWORD written = 0;
+    WriteFile(hWrite, data.data(), static_cast<DWORD>(data.size()), &written, nullptr);
+    CloseHandle(hWrite);
+    std::this_thread::sleep_for(200ms);
+
+    BOOST_TEST(reader.AtEnd());
+    reader.Notify();
+    auto lines = buffer.GetLines();
+    BOOST_REQUIRE(lines.size() == 4); // the NUL ends "line 2", the 5004 character line is split at 4000 characters
+    BOOST_TEST(lines[0].message == "line 1");
+    BOOST_TEST(lines[1].message == "line 2");
+    BOOST_TEST(lines[2].message.size() == 4000);
+    BOOST_TEST(lines[2].message.substr(0, 5) == "linex");
+    BOOST_TEST(lines[3].message == std::string(1004, 'x'));
+    BOOST_TEST(lines[3].pid == DWORD(42));
+}
+
 std::string CreateTestFile()
 {
     Timer timer;
@@ -682,6 +1385,70 @@ BOOST_AUTO_TEST_CASE(LogSourceAnyFileReaderEmptyLines)
     }
 }
 
+BOOST_AUTO_TEST_CASE(LogSourceMergeFileReader)
+{
+    using namespace std::chrono_literals;
+    using namespace std::filesystem;
+
+    // the lines of the files take turns in time, 10 ms apart
+    const int files = 3;
+    const int count = 1000;
+    const size_t total = files * count;
+    auto start = FileTimeToUInt64(Win32::GetSystemTimeAsFileTime());
+    std::vector<std::wstring> filenames;
+    auto guard = make_guard([&] {
+        for (auto& filename : filenames)
+        {
+            remove(filename);
+        }
+    });
+    for (int f = 0; f < files; ++f)
+    {
+        filenames.push_back(absolute(path(stringbuilder() << "Merge_unique_test_filename" << f << ".dblog")).wstring());
+        std::ofstream fs;
+        OpenLogFile(fs, filenames.back(), OpenMode::Truncate);
+        for (int i = 0; i < count; ++i)
+        {
+            int n = i * files + f;
+            auto time = start + n * 100000ULL;
+            FILETIME ft;
+            ft.dwLowDateTime = static_cast<DWORD>(time);
+            ft.dwHighDateTime = static_cast<DWORD>(time >> 32);
+            WriteLogFileMessage(fs, 0.0, ft, 42, "test.exe", std::to_string(n));
+        }
+    }
+
+    auto executor = std::make_unique<ActiveExecutorClient>();
+    LogSources logsources(*executor, true);
+    executor->Call([&] { logsources.AddMergeFileReader(filenames); });
+
+    Lines lines;
+    for (int i = 0; i < 50 && lines.size() < total; ++i)
+    {
+        std::this_thread::sleep_for(100ms);
+        executor->Call([&] {
+            for (auto& line : logsources.GetLines())
+            {
+                if (line.processName.find("Merge_unique_test_filename") == 0)
+                {
+                    lines.push_back(line);
+                }
+            }
+        });
+    }
+
+    BOOST_TEST_REQUIRE(lines.size() == total);
+    for (int n = 0; n < files * count; ++n)
+    {
+        std::string filename = stringbuilder() << "Merge_unique_test_filename" << n % files << ".dblog";
+        BOOST_TEST(lines[n].message == std::to_string(n));
+        BOOST_TEST(lines[n].processName == filename);
+    }
+
+    // a line of an unsorted file can be earlier than the first line of the merge
+    BOOST_TEST(GetDifference(MakeFileTime(start + 10000000), MakeFileTime(start)) == -1.0);
+}
+
 BOOST_AUTO_TEST_CASE(LogSourceLoopbackOrdering)
 {
     using namespace std::chrono_literals;
@@ -728,6 +1495,487 @@ std::string CreateUTF16LETestFile(int linecount)
     return filename;
 }
 
+BOOST_AUTO_TEST_CASE(StreamWriterOutputFormats)
+{
+    auto ft = Win32::GetSystemTimeAsFileTime();
+    Line line(1.5, ft, 42, "test.exe", "say \"hi\"\t\n");
+
+    std::string native;
+    LineFormatter(OutputFormat::Native).Format(line, native);
+    BOOST_TEST(native == "1.500000\t" + GetDateTimeText(ft) + "\t42\ttest.exe\tsay \"hi\"\n");
+
+    OutputColumns columns;
+    columns.lineNumber = true;
+    columns.pid = true;
+    std::string text;
+    LineFormatter(OutputFormat::Text, columns).Format(line, text);
+    BOOST_TEST(text == "00001 42  say \"hi\"\t\n\n");
+
+    std::string json;
+    LineFormatter(OutputFormat::JsonLines).Format(line, json);
+    BOOST_TEST(json == R"({"line":1,"time":1.500000,"systemTime":")" + GetDateTimeText(ft) + R"(","pid":42,"process":"test.exe","message":"say \"hi\"\t\n"})" + "\n");
+
+    std::ostringstream os;
+    std::string expected;
+    {
+        StreamWriter writer(os);
+        std::string buffer;
+        for (int i = 0; i < 1000; ++i)
+        {
+            buffer += stringbuilder() << "line " << i << "\n";
+            expected += stringbuilder() << "line " << i << "\n";
+            writer.Write(buffer);
+            BOOST_TEST(buffer.empty());
+        }
+        writer.Flush();
+        BOOST_TEST(os.str() == expected);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(BatchFilterPreservesOrder)
+{
+    using namespace std::filesystem;
+    auto dblog = absolute(path("BatchFilter_unique_test_filename.dblog")).wstring();
+    auto text = absolute(path("BatchFilter_unique_test_filename.txt")).wstring();
+    auto guard = make_guard([&] {
+        remove(dblog);
+        remove(text);
+    });
+
+    // large enough to be split into several chunks
+    const int count = 200000;
+    {
+        std::ofstream fs;
+        OpenLogFile(fs, dblog, OpenMode::Truncate);
+        std::ofstream ts(text);
+        for (int i = 0; i < count; ++i)
+        {
+            std::string message = stringbuilder() << "message " << i << (i % 7 == 0 ? " match" : "");
+            WriteLogFileMessage(fs, i * 0.001, Win32::GetSystemTimeAsFileTime(), 42, "test.exe", message);
+            ts << message << "\n";
+        }
+    }
+
+    LogFilter filter;
+    filter.messageFilters.push_back(Filter("match", MatchType::Simple, FilterType::Include));
+    BatchFilter batchFilter(filter, 4);
+    std::vector<std::string> processNames;
+    std::vector<int> numbers;
+    int errors = 0;
+    batchFilter.Run(
+        {dblog, text, L"BatchFilter_missing_file.txt"},
+        [&](const Line& line) {
+            processNames.push_back(line.processName);
+            numbers.push_back(std::stoi(line.message.substr(8)));
+        },
+        [&](const std::wstring&, const std::string&) { ++errors; });
+
+    const size_t matches = (count + 6) / 7;
+    BOOST_TEST_REQUIRE(numbers.size() == 2 * matches);
+    BOOST_TEST(errors == 1);
+    for (size_t i = 0; i < numbers.size(); ++i)
+    {
+        BOOST_TEST(numbers[i] == static_cast<int>(i % matches) * 7);
+        BOOST_TEST(processNames[i] == (i < matches ? "test.exe" : "BatchFilter_unique_test_filename.txt"));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(FilterEvaluatorSharesFilters)
+{
+    // two views with overlapping filters, every view must decide as if it ran its own filters
+    std::vector<LogFilter> filters(2);
+    filters[0].messageFilters.push_back(Filter("error", MatchType::Simple, FilterType::Include));
+    filters[0].messageFilters.push_back(Filter("ignore", MatchType::Simple, FilterType::Exclude));
+    filters[0].messageFilters.push_back(Filter("[0-9]+", MatchType::Regex, FilterType::Token, Colors::Auto));
+    filters[0].processFilters.push_back(Filter("b.exe", MatchType::Simple, FilterType::Bookmark));
+    filters[1].messageFilters.push_back(Filter("error", MatchType::Simple, FilterType::Stop));
+    filters[1].messageFilters.push_back(Filter("ignore", MatchType::Simple, FilterType::Exclude));
+    filters[1].messageFilters.push_back(Filter("start", MatchType::Simple, FilterType::Once));
+    filters[1].messageFilters.push_back(Filter("disabled", MatchType::Simple, FilterType::Include, Colors::BackGround, Colors::Text, false));
+    filters[1].processFilters.push_back(Filter("b.exe", MatchType::Simple, FilterType::Bookmark));
+
+    // small enough to run on the calling thread and large enough to be split over threads
+    FilterEvaluator serial(1);
+    FilterEvaluator parallel(4);
+    std::vector<LogFilter> shared = filters;
+    std::vector<FilterSlots> messageSlots;
+    std::vector<FilterSlots> processSlots;
+    for (auto* evaluator : {&serial, &parallel})
+    {
+        evaluator->BeginRegistration();
+        messageSlots.clear();
+        processSlots.clear();
+        for (auto& filter : shared)
+        {
+            messageSlots.push_back(evaluator->Register(filter.messageFilters, FilterSubject::Text));
+            processSlots.push_back(evaluator->Register(filter.processFilters, FilterSubject::ProcessName));
+        }
+        BOOST_TEST(evaluator->GetRegisteredCount() == 8u);
+        BOOST_TEST(evaluator->GetSlotCount() == 5u);
+    }
+    BOOST_TEST(messageSlots[1][3] == FilterEvaluator::NoSlot);
+
+    std::vector<Message> messages;
+    for (int i = 0; i < 2000; ++i)
+    {
+        std::string text = stringbuilder() << (i % 3 == 0 ? "error " : "info ") << i << (i % 5 == 0 ? " ignore" : "") << (i % 50 == 0 ? " start" : "");
+        messages.emplace_back(0, FILETIME(), i, i % 2 ? "a.exe" : "b.exe", text);
+    }
+    std::vector<FilterResult> serialResults;
+    std::vector<FilterResult> parallelResults;
+    serial.Evaluate(messages, serialResults);
+    parallel.Evaluate(messages, parallelResults);
+
+    for (size_t i = 0; i < messages.size(); ++i)
+    {
+        BOOST_TEST((serialResults[i].matches == parallelResults[i].matches));
+        for (size_t view = 0; view < filters.size(); ++view)
+        {
+            auto& msg = messages[i];
+            auto& result = serialResults[i];
+            MatchColors matchColors;
+            MatchColors sharedMatchColors;
+            bool included = IsIncluded(filters[view].processFilters, msg.processName, matchColors) && IsIncluded(filters[view].messageFilters, msg.text, matchColors);
+            bool sharedIncluded = IsIncluded(shared[view].processFilters, processSlots[view], result, sharedMatchColors) && IsIncluded(shared[view].messageFilters, messageSlots[view], result, sharedMatchColors);
+            BOOST_TEST(included == sharedIncluded);
+            BOOST_TEST(matchColors.size() == sharedMatchColors.size());
+            for (auto type : {FilterType::Stop, FilterType::Bookmark})
+            {
+                BOOST_TEST(MatchFilterType(filters[view].messageFilters, type, msg.text) == MatchFilterType(shared[view].messageFilters, messageSlots[view], type, result));
+                BOOST_TEST(MatchFilterType(filters[view].processFilters, type, msg.processName) == MatchFilterType(shared[view].processFilters, processSlots[view], type, result));
+            }
+        }
+    }
+
+    // the threads of the pool take the next batches, of any size
+    for (size_t count : {messages.size(), size_t(700), size_t(10), messages.size()})
+    {
+        std::vector<Message> batch(messages.begin(), messages.begin() + count);
+        parallel.Evaluate(batch, parallelResults);
+        BOOST_REQUIRE(parallelResults.size() == count);
+        for (size_t i = 0; i < count; ++i)
+        {
+            BOOST_TEST((parallelResults[i].matches == serialResults[i].matches));
+        }
+    }
+    BOOST_TEST(FilterEvaluator(1000).GetThreadCount() == FilterEvaluator::MaxThreadCount);
+
+    // a filter nobody registers anymore is no longer evaluated
+    serial.BeginRegistration();
+    serial.Register(filters[0].messageFilters, FilterSubject::Text);
+    BOOST_TEST(serial.GetSlotCount() == 3u);
+}
+
+BOOST_AUTO_TEST_CASE(TraceRecordAndReplay)
+{
+    using namespace std::chrono_literals;
+    auto trace = std::filesystem::absolute("Trace_unique_test_filename.dvtrace").wstring();
+    auto rerecorded = std::filesystem::absolute("Trace_unique_test_filename2.dvtrace").wstring();
+    auto guard = make_guard([&] {
+        std::filesystem::remove(trace);
+        std::filesystem::remove(rerecorded);
+    });
+
+    const int testsize = 10000;
+    {
+        ActiveExecutorClient executor;
+        LogSources logsources(executor, false);
+        LogSource* logsource;
+        executor.Call([&] {
+            logsource = logsources.AddTestSource();
+            logsources.StartRecording(trace);
+        });
+
+        // lines of different sources are not ordered in time, the trace must handle going back in time
+        for (int i = 0; i < testsize; ++i)
+        {
+            FILETIME systemTime = {static_cast<DWORD>(1000 + i), 0};
+            logsource->Add(i % 2 == 0 ? i * 0.001 : i * 0.001 - 0.5, systemTime, i % 3, i % 3 == 0 ? "a.exe" : "b.exe", stringbuilder() << "message " << i << "\n");
+        }
+        Lines lines;
+        executor.Call([&] {
+            lines = logsources.GetLines();
+            logsources.StopRecording();
+        });
+        BOOST_TEST(lines.size() == testsize);
+    }
+
+    TraceReader reader(trace);
+    TraceRecord record;
+    for (int i = 0; i < testsize; ++i)
+    {
+        BOOST_TEST_REQUIRE(reader.Read(record));
+        BOOST_TEST(record.time == (i % 2 == 0 ? i * 0.001 : i * 0.001 - 0.5), boost::test_tools::tolerance(1e-6));
+        BOOST_TEST(record.pid == static_cast<DWORD>(i % 3));
+        BOOST_TEST(record.processName == (i % 3 == 0 ? "a.exe" : "b.exe"));
+        BOOST_TEST(record.source == "TestSource");
+        BOOST_TEST(record.message == std::string(stringbuilder() << "message " << i << "\n"));
+    }
+    BOOST_TEST(!reader.Read(record));
+
+    ActiveExecutorClient executor;
+    LogSources logsources(executor, true);
+    ReplaySource* pSource = nullptr;
+    executor.Call([&] {
+        logsources.StartRecording(rerecorded);
+        pSource = logsources.AddReplaySource(trace, 0.0);
+    });
+    Lines lines;
+    for (int retry = 0; retry < 100 && lines.size() < testsize; ++retry)
+    {
+        std::this_thread::sleep_for(50ms);
+        executor.Call([&] {
+            for (auto& line : logsources.GetLines())
+            {
+                lines.emplace_back(std::move(line));
+            }
+        });
+    }
+    BOOST_TEST(pSource->IsFinished());
+    BOOST_TEST(pSource->GetCount() == testsize);
+    BOOST_TEST_REQUIRE(lines.size() == testsize);
+    for (int i = 0; i < testsize; ++i)
+    {
+        BOOST_TEST(lines[i].message == std::string(stringbuilder() << "message " << i));
+        BOOST_TEST(lines[i].processName == (i % 3 == 0 ? "a.exe" : "b.exe"));
+        BOOST_TEST(lines[i].systemTime.dwLowDateTime == static_cast<DWORD>(1000 + i));
+    }
+
+    // recording a replay keeps the source of the original recording
+    executor.Call([&] { logsources.StopRecording(); });
+    TraceReader replayed(rerecorded);
+    BOOST_TEST_REQUIRE(replayed.Read(record));
+    BOOST_TEST(record.source == "TestSource");
+    BOOST_TEST(record.systemTime.dwLowDateTime == 1000u);
+}
+
+BOOST_AUTO_TEST_CASE(MetricsRegistrySnapshot)
+{
+    MetricsRegistry metrics;
+    auto& counter = metrics.GetCounter("lines");
+    BOOST_TEST(&counter == &metrics.GetCounter("lines"));
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t)
+    {
+        threads.emplace_back([&counter] {
+            for (int i = 0; i < 10000; ++i)
+            {
+                counter.Add();
+            }
+        });
+    }
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+    BOOST_TEST(counter.Get() == 40000u);
+
+    auto& histogram = metrics.GetHistogram("latency.us");
+    for (uint64_t i = 1; i <= 100; ++i)
+    {
+        histogram.Record(i);
+    }
+    auto summary = histogram.GetSummary();
+    BOOST_TEST(summary.count == 100u);
+    BOOST_TEST(summary.sum == 5050u);
+    BOOST_TEST(summary.max == 100u);
+    BOOST_TEST(summary.p50 == 51u); // 50 falls in the [48, 52) bucket
+    BOOST_TEST(summary.p99 == 100u);
+
+    metrics.GetGauge("depth \"quoted\"").Set(-3);
+    MetricsHistory history(2);
+    for (int i = 0; i < 3; ++i)
+    {
+        history.Add(metrics.Sample());
+    }
+    BOOST_TEST(history.GetSnapshots().size() == 2u);
+
+    auto json = ToJson(history.GetSnapshots().back());
+    BOOST_TEST(json.find("\"counters\":{\"lines\":40000}") != std::string::npos);
+    BOOST_TEST(json.find("\"depth \\\"quoted\\\"\":-3") != std::string::npos);
+    BOOST_TEST(json.find("\"latency.us\":{\"count\":100,\"sum\":5050,\"max\":100,\"p50\":51,") != std::string::npos);
+
+    metrics.Remove("lines");
+    BOOST_TEST(ToJson(metrics.Sample()).find("\"lines\"") == std::string::npos);
+    BOOST_TEST(metrics.GetCounter("lines").Get() == 0u);
+}
+
+BOOST_AUTO_TEST_CASE(LatencyTraceSampling)
+{
+    auto& drain = GetMetrics().GetHistogram("latency.drain.us");
+    auto count = drain.GetSummary().count;
+
+    SetLatencySampling(4);
+    auto guard = make_guard([] { SetLatencySampling(0); });
+    std::vector<long long> stamps;
+    for (int i = 0; i < 8; ++i)
+    {
+        stamps.push_back(SampleLatency());
+    }
+    BOOST_TEST(std::count(stamps.begin(), stamps.end(), 0LL) == 6);
+
+    for (auto stamp : stamps)
+    {
+        RecordLatency(LatencyStage::Drain, stamp);
+    }
+    BOOST_TEST(drain.GetSummary().count == count + 2);
+
+    SetLatencySampling(0);
+    BOOST_TEST(SampleLatency() == 0);
+}
+
+BOOST_AUTO_TEST_CASE(RateLimiterTokenBucket)
+{
+    auto limits = ParseProcessLimits(" Noisy.exe = 2;quiet.exe=0\r\nbroken;bad.exe=fast;neg.exe=-1;half.exe=1x;empty.exe=");
+    BOOST_TEST(limits.size() == 2);
+    BOOST_TEST(limits["noisy.exe"] == 2.0);
+    BOOST_TEST(ParseProcessLimits(FormatProcessLimits(limits, "\r\n")) == limits);
+
+    // fractional limits survive the round trip
+    std::map<std::string, double> fractional{{"slow.exe", 0.5}, {"tenth.exe", 0.1}, {"fast.exe", 1e6}, {"tiny.exe", 1e-100}};
+    BOOST_TEST(FormatProcessLimits(fractional) == "fast.exe=1000000;slow.exe=0.5;tenth.exe=0.1;tiny.exe=1e-100");
+    BOOST_TEST(ParseProcessLimits(FormatProcessLimits(fractional)) == fractional);
+
+    RateLimitSettings settings;
+    settings.linesPerSecond = 10;
+    settings.processLimits = limits;
+    RateLimiter limiter;
+    BOOST_TEST(!limiter.IsEnabled());
+    limiter.SetSettings(settings);
+    BOOST_TEST(limiter.IsEnabled());
+
+    // a burst of one second worth of lines is admitted, 'quiet.exe' is not limited at all
+    auto admit = [&](DWORD pid, const std::string& processName, int count, double now) {
+        int admitted = 0;
+        for (int i = 0; i < count; ++i)
+        {
+            admitted += limiter.Admit(Line(now, FILETIME(), pid, processName, "message"), now) ? 1 : 0;
+        }
+        return admitted;
+    };
+    BOOST_TEST(admit(1, "a.exe", 20, 0.0) == 10);
+    BOOST_TEST(admit(2, "NOISY.exe", 20, 0.0) == 2);
+    BOOST_TEST(admit(3, "quiet.exe", 20, 0.0) == 20);
+
+    auto take = [&](double now) {
+        std::map<DWORD, uint64_t> suppressed;
+        for (auto& suppression : limiter.TakeSuppressions(now))
+        {
+            suppressed[suppression.pid] = suppression.count;
+        }
+        return suppressed;
+    };
+    BOOST_TEST((take(0.0) == std::map<DWORD, uint64_t>{{1, 10}, {2, 18}}));
+
+    // the tokens refill at the configured rate, suppressions are reported at most once per second
+    BOOST_TEST(admit(1, "a.exe", 20, 0.5) == 5);
+    BOOST_TEST(admit(2, "NOISY.exe", 20, 0.5) == 1);
+    BOOST_TEST(take(0.5).empty());
+    BOOST_TEST((take(1.0) == std::map<DWORD, uint64_t>{{1, 15}, {2, 19}}));
+
+    // sampling keeps every 4th line over the limit
+    settings = RateLimitSettings();
+    settings.linesPerSecond = 1;
+    settings.sampleInterval = 4;
+    limiter.SetSettings(settings);
+    BOOST_TEST(admit(1, "a.exe", 13, 0.0) == 4);
+    BOOST_TEST((take(0.0) == std::map<DWORD, uint64_t>{{1, 9}}));
+}
+
+BOOST_AUTO_TEST_CASE(ShmRingMultiProducer)
+{
+    const std::string name = stringbuilder() << "DebugViewppTestRing" << GetCurrentProcessId();
+    BOOST_CHECK_THROW(shmring::ShmRingWriter writer(name), std::exception);
+
+    // a small ring wraps many times and runs full, the writers retry so nothing may be lost or reordered
+    shmring::ShmRing ring(name, 4096);
+    const uint32_t writers = 4;
+    const size_t messages = 5000;
+    std::atomic<size_t> full = 0;
+    std::vector<std::thread> threads;
+    for (uint32_t pid = 0; pid < writers; ++pid)
+    {
+        threads.emplace_back([&, pid] {
+            shmring::ShmRingWriter writer(name);
+            for (size_t i = 0; i < messages; ++i)
+            {
+                while (!writer.Write(pid, GetTestString(i)))
+                {
+                    ++full;
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+
+    std::vector<size_t> next(writers);
+    size_t received = 0;
+    while (received < writers * messages && ring.GetReadySignal().Wait(5000))
+    {
+        received += ring.Read([&](uint32_t pid, std::string_view message) {
+            BOOST_REQUIRE(pid < writers);
+            BOOST_TEST(message == GetTestString(next[pid]));
+            ++next[pid];
+        });
+    }
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+
+    BOOST_TEST(received == writers * messages);
+    BOOST_TEST(ring.IsEmpty());
+    BOOST_TEST(ring.GetDropped() == full);
+}
+
+BOOST_AUTO_TEST_CASE(ShmRingStalledWriter)
+{
+    const std::string name = stringbuilder() << "DebugViewppTestStalledRing" << GetCurrentProcessId();
+    shmring::ShmRing ring(name, 4096);
+    shmring::ShmRingWriter writer(name);
+
+    // a writer that stopped right after its reservation, ahead of one that commits
+    shmring::SharedMemory memory(name);
+    auto& header = *static_cast<shmring::RingHeader*>(memory.Ptr());
+    auto& stalled = *reinterpret_cast<shmring::RecordHeader*>(static_cast<char*>(memory.Ptr()) + sizeof(shmring::RingHeader) + header.reserve.fetch_add(32));
+    std::atomic_ref<uint32_t>(stalled.size).store(32);
+    BOOST_TEST(writer.Write(1, "after"));
+
+    std::vector<std::string> messages;
+    auto read = [&] { return ring.Read([&](uint32_t, std::string_view message) { messages.emplace_back(message); }); };
+    BOOST_TEST(ring.GetReadySignal().Wait(5000));
+    BOOST_TEST(read() == 0u);
+
+    // only the retry timer wakes the reader to give up the reservation
+    BOOST_TEST(ring.GetReadySignal().Wait(5000));
+    BOOST_TEST(read() == 1u);
+    BOOST_TEST(messages == std::vector<std::string>{"after"});
+    BOOST_TEST(ring.GetDropped() == 1u);
+    BOOST_TEST(header.read.load() == 0u); // the writer may still write to the abandoned record
+
+    // the late commit fails, the writer marks the record discarded and the reader frees the space
+    std::atomic_ref<uint32_t> state(stalled.state);
+    auto expected = static_cast<uint32_t>(shmring::RecordState::Empty);
+    BOOST_TEST(!state.compare_exchange_strong(expected, static_cast<uint32_t>(shmring::RecordState::Message)));
+    BOOST_TEST(expected == static_cast<uint32_t>(shmring::RecordState::Abandoned));
+    state.store(static_cast<uint32_t>(shmring::RecordState::Discarded));
+    BOOST_TEST(read() == 0u);
+    BOOST_TEST(header.read.load() == header.reserve.load());
+    BOOST_TEST(stalled.state == 0u);
+
+    // a writer that stopped before it stored its size, the reader skips only up to the record that follows
+    header.reserve.fetch_add(48);
+    BOOST_TEST(writer.Write(1, "next"));
+    BOOST_TEST(writer.Write(1, "last"));
+    BOOST_TEST(ring.GetReadySignal().Wait(5000));
+    BOOST_TEST(read() == 0u);
+    BOOST_TEST(ring.GetReadySignal().Wait(5000));
+    BOOST_TEST(read() == 2u);
+    BOOST_TEST((messages == std::vector<std::string>{"after", "next", "last"}));
+    BOOST_TEST(ring.GetDropped() == 2u);
+}
+
 BOOST_AUTO_TEST_CASE(LoadUTF16LE)
 {
     using namespace std::chrono_literals;
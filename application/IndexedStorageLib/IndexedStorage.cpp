@@ -3,6 +3,9 @@
 // (See accompanying file LICENSE_1_0.txt or copy at
 // http://www.boost.org/LICENSE_1_0.txt)
 
+#include <algorithm>
+#include <filesystem>
+#include <stdexcept>
 #include <vector>
 #include "IndexedStorageLib/IndexedStorage.h"
 #include "snappy.h"
@@ -44,6 +47,122 @@ void VectorStorage::shrink_to_fit()
     m_storage.shrink_to_fit();
 }
 
+SpillFile::SpillFile(const std::wstring& filename, uint64_t maxSize) :
+    m_filename(filename),
+    m_file(std::filesystem::path(filename), std::fstream::in | std::fstream::out | std::fstream::binary | std::fstream::trunc),
+    m_maxSize(maxSize)
+{
+    if (!m_file)
+    {
+        throw std::runtime_error("unable to create spill file");
+    }
+}
+
+SpillFile::~SpillFile()
+{
+    m_file.close();
+    std::error_code ec;
+    std::filesystem::remove(std::filesystem::path(m_filename), ec);
+}
+
+std::map<uint64_t, uint64_t>::iterator SpillFile::FindFree(size_t size)
+{
+    return std::find_if(m_free.begin(), m_free.end(), [size](auto& space) { return space.second >= size; });
+}
+
+bool SpillFile::Fits(size_t size)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return FindFree(size) != m_free.end() || size <= m_maxSize - std::min(m_size, m_maxSize);
+}
+
+uint64_t SpillFile::Write(const std::string& data)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto offset = m_size;
+    auto it = FindFree(data.size());
+    if (it != m_free.end())
+    {
+        offset = it->first;
+        if (it->second > data.size())
+        {
+            m_free.emplace(offset + data.size(), it->second - data.size());
+        }
+        m_free.erase(it);
+    }
+
+    m_file.seekp(static_cast<std::streamoff>(offset));
+    m_file.write(data.data(), static_cast<std::streamsize>(data.size()));
+    if (!m_file)
+    {
+        throw std::runtime_error("unable to write spill file");
+    }
+    m_size = std::max<uint64_t>(m_size, offset + data.size());
+    return offset;
+}
+
+void SpillFile::Free(uint64_t offset, size_t size)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    uint64_t end = offset + size;
+    auto next = m_free.lower_bound(offset);
+    if (next != m_free.end() && next->first == end)
+    {
+        end += next->second;
+        next = m_free.erase(next);
+    }
+    if (next != m_free.begin())
+    {
+        auto previous = std::prev(next);
+        if (previous->first + previous->second == offset)
+        {
+            offset = previous->first;
+            m_free.erase(previous);
+        }
+    }
+
+    // space at the end is written again when the file grows
+    if (end == m_size)
+    {
+        m_size = offset;
+    }
+    else
+    {
+        m_free.emplace(offset, end - offset);
+    }
+}
+
+std::string SpillFile::Read(uint64_t offset, size_t size)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::string data(size, '\0');
+    m_file.seekg(static_cast<std::streamoff>(offset));
+    m_file.read(data.data(), static_cast<std::streamsize>(size));
+    if (!m_file)
+    {
+        throw std::runtime_error("unable to read spill file");
+    }
+    return data;
+}
+
+size_t SnappyBlocks::Count() const
+{
+    return m_blocks.size();
+}
+
+std::string SnappyBlocks::operator[](size_t i) const
+{
+    if (m_blocks[i])
+    {
+        return *m_blocks[i];
+    }
+    if (i < m_spilledBlocks.size())
+    {
+        return m_spillFile->Read(m_spilledBlocks[i].offset, m_spilledBlocks[i].size);
+    }
+    return std::string();
+}
+
 bool SnappyStorage::Empty() const
 {
     return m_storage.empty();
@@ -61,23 +180,43 @@ void SnappyStorage::Clear()
     m_writeList.clear();
     m_writeList.shrink_to_fit();
     m_writeBlockIndex = 0;
+
+    m_rawSize = 0;
+    m_writeSize = 0;
+    m_compressedSize = 0;
+
+    m_spillFile.reset();
+    m_spilledBlocks.clear();
+    m_spilledBlocks.shrink_to_fit();
+    m_freedBlocks.clear();
+    m_spilledSize = 0;
+    m_releasedBlocks = 0;
 }
 
 size_t SnappyStorage::Add(const std::string& value)
 {
     auto id = m_writeList.size();
     m_writeList.push_back(value);
+    m_rawSize += value.size();
+    m_writeSize += value.size();
     auto result = m_writeBlockIndex * blockSize + id;
     if (id == blockSize - 1)
     {
-        std::string test = Compress(m_writeList);
-        m_storage.push_back(test);
-        m_writeList.clear();
-        ++m_writeBlockIndex;
+        CompressWriteList();
     }
     return result;
 }
 
+void SnappyStorage::CompressWriteList()
+{
+    auto block = std::make_shared<const std::string>(Compress(m_writeList));
+    m_compressedSize += block->size();
+    m_storage.push_back(std::move(block));
+    m_writeList.clear();
+    m_writeSize = 0;
+    ++m_writeBlockIndex;
+}
+
 size_t SnappyStorage::Count() const
 {
     return m_storage.size();
@@ -88,6 +227,185 @@ std::string SnappyStorage::operator[](size_t i)
     return GetString(i);
 }
 
+bool SnappyStorage::Contains(size_t index) const
+{
+    auto blockId = GetBlockIndex(index);
+    if (blockId == m_writeBlockIndex)
+    {
+        return GetRelativeIndex(index) < m_writeList.size();
+    }
+    return blockId < m_storage.size() && blockId >= m_releasedBlocks;
+}
+
+size_t SnappyStorage::GetRawSize() const
+{
+    return m_rawSize;
+}
+
+size_t SnappyStorage::GetStoredSize() const
+{
+    return m_compressedSize + m_writeSize;
+}
+
+size_t SnappyStorage::GetSpilledSize() const
+{
+    return m_spilledSize;
+}
+
+size_t SnappyStorage::GetCacheSize() const
+{
+    size_t size = m_readList.capacity() * sizeof(std::string);
+    for (auto& value : m_readList)
+    {
+        size += value.size();
+    }
+    return size;
+}
+
+void SnappyStorage::ClearCache()
+{
+    m_readList.clear();
+    m_readList.shrink_to_fit();
+    m_readBlockIndex = UNSET_VALUE;
+}
+
+void SnappyStorage::CompressWriteBlock()
+{
+    if (!m_writeList.empty())
+    {
+        m_writeList.resize(blockSize);
+        CompressWriteList();
+    }
+}
+
+void SnappyStorage::SetSpillFile(const std::wstring& filename, uint64_t maxSize)
+{
+    m_spillFilename = filename;
+    m_maxSpillSize = maxSize;
+}
+
+void SnappyStorage::FreeSpilled(const SpilledBlock& block)
+{
+    m_freedBlocks.push_back(block);
+    FreeSpilled();
+}
+
+void SnappyStorage::FreeSpilled()
+{
+    // a SnappyBlocks shares the spill file and reads the blocks it saw, their space is not written again before it
+    // is gone. Only this thread makes a SnappyBlocks, so no new one shows up after the check.
+    if (m_spillFile.use_count() != 1)
+    {
+        return;
+    }
+    for (auto& block : m_freedBlocks)
+    {
+        m_spillFile->Free(block.offset, block.size);
+    }
+    m_freedBlocks.clear();
+}
+
+size_t SnappyStorage::Spill(size_t bytes)
+{
+    if (m_spillFilename.empty())
+    {
+        return 0;
+    }
+    if (!m_spillFile)
+    {
+        m_spillFile = std::make_shared<SpillFile>(m_spillFilename + L"." + std::to_wstring(++m_spillFiles), m_maxSpillSize);
+    }
+    FreeSpilled();
+
+    size_t freed = 0;
+    while (freed < bytes && m_spilledBlocks.size() < m_storage.size())
+    {
+        auto& block = m_storage[m_spilledBlocks.size()];
+        if (!block)
+        {
+            m_spilledBlocks.push_back(SpilledBlock{0, 0}); // released
+            continue;
+        }
+        if (!m_spillFile->Fits(block->size()))
+        {
+            break; // the memory governor evicts lines instead
+        }
+        m_spilledBlocks.push_back(SpilledBlock{m_spillFile->Write(*block), block->size()});
+        freed += block->size();
+        m_compressedSize -= block->size();
+        m_spilledSize += block->size();
+        block.reset();
+    }
+    return freed;
+}
+
+void SnappyStorage::Release(size_t index)
+{
+    auto blocks = std::min(GetBlockIndex(index), m_storage.size());
+    for (; m_releasedBlocks < blocks; ++m_releasedBlocks)
+    {
+        auto& block = m_storage[m_releasedBlocks];
+        if (block)
+        {
+            m_compressedSize -= block->size();
+            block.reset();
+        }
+        else if (m_releasedBlocks < m_spilledBlocks.size() && m_spilledBlocks[m_releasedBlocks].size != 0)
+        {
+            auto& spilled = m_spilledBlocks[m_releasedBlocks];
+            m_spilledSize -= spilled.size;
+            FreeSpilled(spilled);
+            spilled.size = 0;
+        }
+    }
+    if (m_readBlockIndex != UNSET_VALUE && m_readBlockIndex < m_releasedBlocks)
+    {
+        ClearCache();
+    }
+}
+
+SnappyBlocks SnappyStorage::GetBlocks() const
+{
+    SnappyBlocks blocks;
+    blocks.m_blocks = m_storage;
+    blocks.m_spillFile = m_spillFile;
+    blocks.m_spilledBlocks = m_spilledBlocks;
+    return blocks;
+}
+
+const std::vector<std::string>& SnappyStorage::GetWriteBlock() const
+{
+    return m_writeList;
+}
+
+void SnappyStorage::Restore(std::vector<std::string> blocks, std::vector<std::string> writeBlock, size_t rawSize)
+{
+    Clear();
+    m_storage.reserve(blocks.size());
+    for (auto& block : blocks)
+    {
+        if (block.empty())
+        {
+            if (m_releasedBlocks != m_storage.size())
+            {
+                throw std::runtime_error("released block after a block in use");
+            }
+            ++m_releasedBlocks;
+            m_storage.emplace_back();
+            continue;
+        }
+        m_compressedSize += block.size();
+        m_storage.push_back(std::make_shared<const std::string>(std::move(block)));
+    }
+    m_writeList = std::move(writeBlock);
+    m_writeBlockIndex = m_storage.size();
+    m_rawSize = rawSize;
+    for (auto& value : m_writeList)
+    {
+        m_writeSize += value.size();
+    }
+}
+
 size_t SnappyStorage::GetBlockIndex(size_t index)
 {
     return index / blockSize;
@@ -110,9 +428,20 @@ std::string SnappyStorage::GetString(size_t index)
 
     if (blockId != m_readBlockIndex)
     {
-        m_readList = Decompress(m_storage[blockId]);
+        if (m_storage[blockId])
+        {
+            m_readList = Decompress(*m_storage[blockId]);
+        }
+        else
+        {
+            m_readList = Decompress(m_spillFile->Read(m_spilledBlocks[blockId].offset, m_spilledBlocks[blockId].size));
+        }
         m_readBlockIndex = blockId;
     }
+    if (id >= m_readList.size())
+    {
+        throw std::runtime_error("damaged block");
+    }
     return m_readList[id];
 }
 
@@ -137,7 +466,10 @@ std::vector<std::string> SnappyStorage::Decompress(const std::string& value)
     std::vector<std::string> vec;
 
     std::string data;
-    snappy::Uncompress(value.c_str(), value.size(), &data);
+    if (!snappy::Uncompress(value.c_str(), value.size(), &data) || (!data.empty() && data.back() != '\0'))
+    {
+        throw std::runtime_error("damaged block");
+    }
 
     for (auto it = data.begin(); it != data.end(); ++it)
     {
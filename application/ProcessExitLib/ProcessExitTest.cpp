@@ -0,0 +1,180 @@
+// (C) Copyright Gert-Jan de Vos and Jan Wilmans 2013.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+// ProcessExitTest starts a number of child processes that exit one after the other and checks that the watcher
+// reports every one of them exactly once and soon after it exited, with more processes than a single wait set holds.
+// usage: ProcessExitTest [processes]
+
+#include <chrono>
+#include <condition_variable>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "ProcessExitLib/ProcessExitWatcher.h"
+
+#ifndef _WIN32
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+using namespace fusion::processexit;
+
+namespace {
+
+// a child that waits until it is released and then exits
+struct Child
+{
+    ProcessExitWatcher::Pid pid = 0;
+#ifdef _WIN32
+    HANDLE process = nullptr;
+    HANDLE release = nullptr;
+#endif
+};
+
+Child StartChild()
+{
+    Child child;
+#ifdef _WIN32
+    // the child exits when its stdin is closed
+    SECURITY_ATTRIBUTES sa = {sizeof(sa), nullptr, TRUE};
+    HANDLE read = nullptr;
+    ::CreatePipe(&read, &child.release, &sa, 0);
+    ::SetHandleInformation(child.release, HANDLE_FLAG_INHERIT, 0);
+    STARTUPINFOA si = {sizeof(si)};
+    si.dwFlags = STARTF_USESTDHANDLES;
+    si.hStdInput = read;
+    PROCESS_INFORMATION pi = {};
+    char commandLine[] = "cmd.exe /q /k";
+    if (!::CreateProcessA(nullptr, commandLine, nullptr, nullptr, TRUE, CREATE_NO_WINDOW, nullptr, nullptr, &si, &pi))
+    {
+        throw std::runtime_error("CreateProcess failed");
+    }
+    ::CloseHandle(read);
+    ::CloseHandle(pi.hThread);
+    child.pid = pi.dwProcessId;
+    child.process = pi.hProcess;
+#else
+    // the child exits on SIGTERM, a pipe would also be inherited by the children started after it
+    auto pid = ::fork();
+    if (pid < 0)
+    {
+        throw std::runtime_error("fork failed");
+    }
+    if (pid == 0)
+    {
+        for (;;)
+        {
+            ::pause();
+        }
+    }
+    child.pid = static_cast<ProcessExitWatcher::Pid>(pid);
+#endif
+    return child;
+}
+
+void ReleaseChild(Child& child)
+{
+#ifdef _WIN32
+    ::CloseHandle(child.release);
+#else
+    ::kill(static_cast<pid_t>(child.pid), SIGTERM);
+#endif
+}
+
+void ReapChild(Child& child)
+{
+#ifdef _WIN32
+    ::CloseHandle(child.process);
+#else
+    ::waitpid(static_cast<pid_t>(child.pid), nullptr, 0);
+#endif
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+try
+{
+    auto count = argc > 1 ? std::stoul(argv[1]) : 300ul;
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::map<ProcessExitWatcher::Pid, int> ended;
+    ProcessExitWatcher watcher([&](ProcessExitWatcher::Pid pid) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            ++ended[pid];
+        }
+        cv.notify_all();
+    });
+
+    std::vector<Child> children;
+    for (unsigned long i = 0; i < count; ++i)
+    {
+        children.push_back(StartChild());
+#ifdef _WIN32
+        void* handle = children.back().process;
+#else
+        void* handle = nullptr;
+#endif
+        if (!watcher.Add(children.back().pid, handle))
+        {
+            std::cerr << "unable to watch process " << children.back().pid << "\n";
+            return 1;
+        }
+        if (watcher.Add(children.back().pid, handle))
+        {
+            std::cerr << "process " << children.back().pid << " is watched twice\n";
+            return 1;
+        }
+    }
+
+    // every exit must be reported on its own, not when the next wait set comes around
+    int errors = 0;
+    auto slowest = std::chrono::steady_clock::duration::zero();
+    for (auto& child : children)
+    {
+        auto start = std::chrono::steady_clock::now();
+        ReleaseChild(child);
+        std::unique_lock<std::mutex> lock(mutex);
+        if (!cv.wait_for(lock, std::chrono::seconds(5), [&] { return ended.count(child.pid) != 0; }))
+        {
+            std::cerr << "exit of process " << child.pid << " not reported\n";
+            ++errors;
+        }
+        slowest = std::max(slowest, std::chrono::steady_clock::now() - start);
+    }
+
+    for (auto& child : children)
+    {
+        ReapChild(child);
+    }
+    watcher.Abort();
+
+    for (auto& item : ended)
+    {
+        if (item.second != 1)
+        {
+            std::cerr << "exit of process " << item.first << " reported " << item.second << " times\n";
+            ++errors;
+        }
+    }
+    if (ended.size() != children.size() || watcher.Count() != 0)
+    {
+        std::cerr << ended.size() << " of " << children.size() << " exits reported, " << watcher.Count() << " still watched\n";
+        ++errors;
+    }
+
+    std::cout << children.size() << " processes, slowest exit reported after " << std::chrono::duration_cast<std::chrono::milliseconds>(slowest).count() << " ms\n";
+    return errors == 0 ? 0 : 1;
+}
+catch (std::exception& e)
+{
+    std::cerr << e.what() << "\n";
+    return 1;
+}
@@ -0,0 +1,238 @@
+// (C) Copyright Gert-Jan de Vos and Jan Wilmans 2013.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#include <cerrno>
+#include <system_error>
+#include <vector>
+#include "ProcessExitLib/ProcessExitWatcher.h"
+
+#ifndef _WIN32
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace fusion {
+namespace processexit {
+
+#ifdef _WIN32
+
+ProcessExitWatcher::ProcessExitWatcher(Ended ended) :
+    m_ended(std::move(ended))
+{
+}
+
+ProcessExitWatcher::~ProcessExitWatcher()
+{
+    Abort();
+}
+
+bool ProcessExitWatcher::Add(Pid pid, void* handle)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_end || m_processes.count(pid) != 0)
+    {
+        return false;
+    }
+
+    // OnEnded takes m_mutex first, so it cannot look for the process before it is in m_processes
+    auto pProcess = std::make_unique<Process>(Process{this, pid, nullptr});
+    if (::RegisterWaitForSingleObject(&pProcess->waitHandle, handle, &ProcessExitWatcher::OnEnded, pProcess.get(), INFINITE, WT_EXECUTEONLYONCE) == FALSE)
+    {
+        return false;
+    }
+    m_processes.emplace(pid, std::move(pProcess));
+    return true;
+}
+
+// called on a thread pool thread
+void CALLBACK ProcessExitWatcher::OnEnded(void* context, BOOLEAN /*timedOut*/)
+{
+    auto& watcher = *static_cast<Process*>(context)->pWatcher;
+    std::unique_ptr<Process> pProcess;
+    {
+        std::lock_guard<std::mutex> lock(watcher.m_mutex);
+        if (watcher.m_end)
+        {
+            return; // Abort() unregisters the wait
+        }
+        auto it = watcher.m_processes.find(static_cast<Process*>(context)->pid);
+        pProcess = std::move(it->second);
+        watcher.m_processes.erase(it);
+        ++watcher.m_running;
+    }
+
+    // a wait cannot wait for its own callback, it is unregistered without waiting
+    ::UnregisterWaitEx(pProcess->waitHandle, nullptr);
+    watcher.m_ended(pProcess->pid);
+    {
+        std::lock_guard<std::mutex> lock(watcher.m_mutex);
+        --watcher.m_running;
+    }
+    watcher.m_idle.notify_all();
+}
+
+size_t ProcessExitWatcher::Count() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_processes.size();
+}
+
+void ProcessExitWatcher::Abort()
+{
+    std::unordered_map<Pid, std::unique_ptr<Process>> processes;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_end = true;
+        processes.swap(m_processes);
+    }
+
+    // blocks until callbacks that already started have returned
+    for (auto& item : processes)
+    {
+        ::UnregisterWaitEx(item.second->waitHandle, INVALID_HANDLE_VALUE);
+    }
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_idle.wait(lock, [this] { return m_running == 0; });
+}
+
+#else
+
+namespace {
+
+const uint64_t WakeupKey = ~uint64_t(0);
+
+[[noreturn]] void ThrowLastError(const std::string& what)
+{
+    throw std::system_error(errno, std::system_category(), what);
+}
+
+} // namespace
+
+ProcessExitWatcher::ProcessExitWatcher(Ended ended) :
+    m_ended(std::move(ended))
+{
+    m_epoll = ::epoll_create1(EPOLL_CLOEXEC);
+    if (m_epoll < 0)
+    {
+        ThrowLastError("epoll_create1");
+    }
+    m_wakeup = ::eventfd(0, EFD_CLOEXEC);
+    if (m_wakeup < 0)
+    {
+        ::close(m_epoll);
+        ThrowLastError("eventfd");
+    }
+
+    epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.u64 = WakeupKey;
+    ::epoll_ctl(m_epoll, EPOLL_CTL_ADD, m_wakeup, &event);
+    m_thread = std::thread([this] { Run(); });
+}
+
+ProcessExitWatcher::~ProcessExitWatcher()
+{
+    Abort();
+    ::close(m_wakeup);
+    ::close(m_epoll);
+}
+
+bool ProcessExitWatcher::Add(Pid pid, void* /*handle*/)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_end || m_processes.count(pid) != 0)
+    {
+        return false;
+    }
+
+    // a pidfd becomes readable when the process exits, also when it already is a zombie
+    int fd = static_cast<int>(::syscall(SYS_pidfd_open, static_cast<pid_t>(pid), 0));
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.u64 = pid;
+    if (::epoll_ctl(m_epoll, EPOLL_CTL_ADD, fd, &event) != 0)
+    {
+        ::close(fd);
+        return false;
+    }
+    m_processes.emplace(pid, fd);
+    return true;
+}
+
+void ProcessExitWatcher::Run()
+{
+    std::vector<epoll_event> events(64);
+    for (;;)
+    {
+        int count = ::epoll_wait(m_epoll, events.data(), static_cast<int>(events.size()), -1);
+        if (count < 0 && errno != EINTR)
+        {
+            return;
+        }
+
+        for (int i = 0; i < count; ++i)
+        {
+            if (events[i].data.u64 == WakeupKey)
+            {
+                return; // Abort()
+            }
+
+            auto pid = static_cast<Pid>(events[i].data.u64);
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                auto it = m_processes.find(pid);
+                if (it == m_processes.end())
+                {
+                    continue;
+                }
+                ::epoll_ctl(m_epoll, EPOLL_CTL_DEL, it->second, nullptr);
+                ::close(it->second);
+                m_processes.erase(it);
+            }
+            m_ended(pid);
+        }
+    }
+}
+
+size_t ProcessExitWatcher::Count() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_processes.size();
+}
+
+void ProcessExitWatcher::Abort()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_end = true;
+    }
+
+    if (m_thread.joinable())
+    {
+        uint64_t one = 1;
+        [[maybe_unused]] auto written = ::write(m_wakeup, &one, sizeof(one));
+        m_thread.join();
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (auto& item : m_processes)
+    {
+        ::close(item.second);
+    }
+    m_processes.clear();
+}
+
+#endif
+
+} // namespace processexit
+} // namespace fusion
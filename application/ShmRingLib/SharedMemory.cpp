@@ -0,0 +1,254 @@
+// (C) Copyright Gert-Jan de Vos and Jan Wilmans 2013.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#include <cerrno>
+#include <ctime>
+#include <stdexcept>
+#include <system_error>
+#include "ShmRingLib/SharedMemory.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace fusion {
+namespace shmring {
+
+namespace {
+
+[[noreturn]] void ThrowLastError(const std::string& what)
+{
+#ifdef _WIN32
+    throw std::system_error(static_cast<int>(GetLastError()), std::system_category(), what);
+#else
+    throw std::system_error(errno, std::system_category(), what);
+#endif
+}
+
+#ifndef _WIN32
+// POSIX names are a single path component that starts with a slash
+std::string GetPosixName(const std::string& name)
+{
+    return "/" + name;
+}
+#endif
+
+} // namespace
+
+#ifdef _WIN32
+
+SharedMemory::SharedMemory(const std::string& name, size_t size) :
+    m_name(name),
+    m_owner(true),
+    m_size(size)
+{
+    m_handle = ::CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, static_cast<DWORD>(static_cast<unsigned long long>(size) >> 32), static_cast<DWORD>(size), name.c_str());
+    if (m_handle == nullptr)
+    {
+        ThrowLastError("CreateFileMapping '" + name + "'");
+    }
+    if (GetLastError() == ERROR_ALREADY_EXISTS)
+    {
+        ::CloseHandle(m_handle);
+        throw std::runtime_error("shared memory '" + name + "' is already in use");
+    }
+    m_ptr = ::MapViewOfFile(m_handle, FILE_MAP_READ | FILE_MAP_WRITE, 0, 0, size);
+    if (m_ptr == nullptr)
+    {
+        ::CloseHandle(m_handle);
+        ThrowLastError("MapViewOfFile '" + name + "'");
+    }
+}
+
+SharedMemory::SharedMemory(const std::string& name) :
+    m_name(name),
+    m_owner(false)
+{
+    m_handle = ::OpenFileMappingA(FILE_MAP_READ | FILE_MAP_WRITE, FALSE, name.c_str());
+    if (m_handle == nullptr)
+    {
+        ThrowLastError("OpenFileMapping '" + name + "'");
+    }
+    m_ptr = ::MapViewOfFile(m_handle, FILE_MAP_READ | FILE_MAP_WRITE, 0, 0, 0);
+    if (m_ptr == nullptr)
+    {
+        ::CloseHandle(m_handle);
+        ThrowLastError("MapViewOfFile '" + name + "'");
+    }
+    MEMORY_BASIC_INFORMATION info;
+    ::VirtualQuery(m_ptr, &info, sizeof(info));
+    m_size = info.RegionSize;
+}
+
+SharedMemory::~SharedMemory()
+{
+    ::UnmapViewOfFile(m_ptr);
+    ::CloseHandle(m_handle);
+}
+
+SharedEvent::SharedEvent(const std::string& name, bool create) :
+    m_name(name),
+    m_owner(create),
+    m_handle(create ? ::CreateEventA(nullptr, FALSE, FALSE, name.c_str()) : ::OpenEventA(EVENT_MODIFY_STATE | SYNCHRONIZE, FALSE, name.c_str()))
+{
+    if (m_handle == nullptr)
+    {
+        ThrowLastError((create ? "CreateEvent '" : "OpenEvent '") + name + "'");
+    }
+}
+
+SharedEvent::~SharedEvent()
+{
+    ::CloseHandle(m_handle);
+}
+
+void SharedEvent::Set()
+{
+    ::SetEvent(m_handle);
+}
+
+bool SharedEvent::Wait(unsigned milliseconds)
+{
+    return ::WaitForSingleObject(m_handle, milliseconds) == WAIT_OBJECT_0;
+}
+
+HANDLE SharedEvent::GetHandle() const
+{
+    return m_handle;
+}
+
+#else
+
+SharedMemory::SharedMemory(const std::string& name, size_t size) :
+    m_name(GetPosixName(name)),
+    m_owner(true),
+    m_size(size)
+{
+    int fd = ::shm_open(m_name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd == -1)
+    {
+        if (errno == EEXIST)
+        {
+            throw std::runtime_error("shared memory '" + name + "' is already in use");
+        }
+        ThrowLastError("shm_open '" + name + "'");
+    }
+    if (::ftruncate(fd, static_cast<off_t>(size)) == -1)
+    {
+        ::close(fd);
+        ::shm_unlink(m_name.c_str());
+        ThrowLastError("ftruncate '" + name + "'");
+    }
+    m_ptr = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (m_ptr == MAP_FAILED)
+    {
+        ::shm_unlink(m_name.c_str());
+        ThrowLastError("mmap '" + name + "'");
+    }
+}
+
+SharedMemory::SharedMemory(const std::string& name) :
+    m_name(GetPosixName(name)),
+    m_owner(false)
+{
+    int fd = ::shm_open(m_name.c_str(), O_RDWR, 0);
+    if (fd == -1)
+    {
+        ThrowLastError("shm_open '" + name + "'");
+    }
+    struct stat info;
+    if (::fstat(fd, &info) == -1)
+    {
+        ::close(fd);
+        ThrowLastError("fstat '" + name + "'");
+    }
+    m_size = static_cast<size_t>(info.st_size);
+    m_ptr = ::mmap(nullptr, m_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (m_ptr == MAP_FAILED)
+    {
+        ThrowLastError("mmap '" + name + "'");
+    }
+}
+
+SharedMemory::~SharedMemory()
+{
+    ::munmap(m_ptr, m_size);
+    if (m_owner)
+    {
+        ::shm_unlink(m_name.c_str());
+    }
+}
+
+SharedEvent::SharedEvent(const std::string& name, bool create) :
+    m_name(GetPosixName(name)),
+    m_owner(create),
+    m_semaphore(create ? ::sem_open(m_name.c_str(), O_CREAT | O_EXCL, 0600, 0) : ::sem_open(m_name.c_str(), 0))
+{
+    if (m_semaphore == SEM_FAILED)
+    {
+        ThrowLastError("sem_open '" + name + "'");
+    }
+}
+
+SharedEvent::~SharedEvent()
+{
+    ::sem_close(m_semaphore);
+    if (m_owner)
+    {
+        ::sem_unlink(m_name.c_str());
+    }
+}
+
+void SharedEvent::Set()
+{
+    ::sem_post(m_semaphore);
+}
+
+bool SharedEvent::Wait(unsigned milliseconds)
+{
+    timespec deadline;
+    ::clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += milliseconds / 1000;
+    deadline.tv_nsec += static_cast<long>(milliseconds % 1000) * 1000000;
+    if (deadline.tv_nsec >= 1000000000)
+    {
+        ++deadline.tv_sec;
+        deadline.tv_nsec -= 1000000000;
+    }
+
+    while (::sem_timedwait(m_semaphore, &deadline) == -1)
+    {
+        if (errno != EINTR)
+        {
+            return false;
+        }
+    }
+
+    // a semaphore counts every Set(), an auto-reset event does not
+    while (::sem_trywait(m_semaphore) == 0)
+    {
+    }
+    return true;
+}
+
+#endif
+
+void* SharedMemory::Ptr() const
+{
+    return m_ptr;
+}
+
+size_t SharedMemory::Size() const
+{
+    return m_size;
+}
+
+} // namespace shmring
+} // namespace fusion
@@ -0,0 +1,444 @@
+// (C) Copyright Gert-Jan de Vos and Jan Wilmans 2013.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#include <algorithm>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include "ShmRingLib/ShmRing.h"
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+namespace fusion {
+namespace shmring {
+
+namespace {
+
+// a writer that has not committed its record after this long is assumed to have stopped halfway
+const auto StallTimeout = std::chrono::seconds(1);
+
+// the space of an abandoned reservation is reused after this long, even if its writer never let go of it
+const auto AbandonTimeout = std::chrono::seconds(30);
+
+uint64_t RecordSize(size_t length)
+{
+    return (sizeof(RecordHeader) + length + 15) & ~uint64_t(15);
+}
+
+std::atomic_ref<uint32_t> State(RecordHeader& record)
+{
+    return std::atomic_ref<uint32_t>(record.state);
+}
+
+std::atomic_ref<uint32_t> Size(RecordHeader& record)
+{
+    return std::atomic_ref<uint32_t>(record.size);
+}
+
+size_t CheckCapacity(size_t capacity)
+{
+    if (capacity < 4096 || (capacity & (capacity - 1)) != 0)
+    {
+        throw std::invalid_argument("shared-memory ring capacity must be a power of 2 of at least 4096");
+    }
+    return capacity;
+}
+
+RingHeader& OpenHeader(const SharedMemory& memory, const std::string& name)
+{
+    auto& header = *static_cast<RingHeader*>(memory.Ptr());
+    if (memory.Size() < sizeof(RingHeader) || header.magic.load(std::memory_order_acquire) != RingMagic || header.version != RingVersion ||
+        memory.Size() < sizeof(RingHeader) + header.capacity)
+    {
+        throw std::runtime_error("'" + name + "' is not a DebugView++ shared-memory ring");
+    }
+    return header;
+}
+
+uint32_t GetCurrentPid()
+{
+#ifdef _WIN32
+    return ::GetCurrentProcessId();
+#else
+    return static_cast<uint32_t>(::getpid());
+#endif
+}
+
+} // namespace
+
+ShmRing::ShmRing(const std::string& name, size_t capacity) :
+    m_memory(name, sizeof(RingHeader) + CheckCapacity(capacity)),
+    m_ready(name + "_READY", true),
+    m_header(*new (m_memory.Ptr()) RingHeader()),
+    m_data(static_cast<char*>(m_memory.Ptr()) + sizeof(RingHeader)),
+    m_mask(capacity - 1),
+    m_retryThread([this] { RunRetry(); })
+{
+    m_header.version = RingVersion;
+    m_header.capacity = capacity;
+    m_header.readerWaiting = 1;
+    m_header.magic.store(RingMagic, std::memory_order_release);
+}
+
+ShmRing::~ShmRing()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_retryMutex);
+        m_end = true;
+    }
+    m_retryChanged.notify_one();
+    m_retryThread.join();
+}
+
+RecordHeader& ShmRing::GetRecord(uint64_t position) const
+{
+    return *reinterpret_cast<RecordHeader*>(m_data + (position & m_mask));
+}
+
+size_t ShmRing::Read(const Callback& callback, size_t maxRecords)
+{
+    auto now = Clock::now();
+    ReleaseAbandoned(now);
+
+    size_t count = 0;
+    uint64_t published = m_read;
+    bool stalled = false;
+    while (count < maxRecords && m_read != m_header.reserve.load(std::memory_order_acquire))
+    {
+        auto& record = GetRecord(m_read);
+        auto state = static_cast<RecordState>(State(record).load(std::memory_order_acquire));
+        if (state == RecordState::Empty)
+        {
+            if (SkipStalledRecord(now))
+            {
+                continue;
+            }
+            stalled = true;
+            break;
+        }
+
+        if (state == RecordState::Message)
+        {
+            callback(record.pid, std::string_view(reinterpret_cast<const char*>(&record + 1), record.length));
+            ++count;
+        }
+        Consume(Size(record).load(std::memory_order_relaxed));
+
+        // hand space back to the writers while a large backlog is drained
+        if (m_read - published > m_mask / 4)
+        {
+            Publish();
+            published = m_read;
+        }
+    }
+    Publish();
+
+    if (count == maxRecords && !IsEmpty())
+    {
+        m_ready.Set();
+    }
+    else
+    {
+        EnableSignal();
+    }
+
+    // no writer signals the end of a stall or of the abandon timeout, the retry timer does
+    auto retry = Clock::time_point::max();
+    if (stalled)
+    {
+        retry = m_stallTime + StallTimeout;
+    }
+    if (!m_abandoned.empty())
+    {
+        retry = std::min(retry, m_abandoned.front().time + AbandonTimeout);
+    }
+    SetRetry(retry);
+    return count;
+}
+
+bool ShmRing::SkipStalledRecord(Clock::time_point now)
+{
+    if (m_stallPosition != m_read)
+    {
+        m_stallPosition = m_read;
+        m_stallTime = now;
+        return false;
+    }
+    if (now - m_stallTime < StallTimeout)
+    {
+        return false;
+    }
+
+    // the writer's commit fails on an abandoned record, if it just committed or discarded it, it is read as usual
+    auto& record = GetRecord(m_read);
+    auto expected = static_cast<uint32_t>(RecordState::Empty);
+    if (!State(record).compare_exchange_strong(expected, static_cast<uint32_t>(RecordState::Abandoned), std::memory_order_seq_cst))
+    {
+        return true;
+    }
+
+    // the writer stores the size right after its reservation, without it the reader skips to the first record that
+    // follows, or gives up all reservations made so far if there is none. The writers of the skipped space are not
+    // known, so it is only reused after the abandon timeout.
+    auto end = m_header.reserve.load(std::memory_order_acquire);
+    auto size = Size(record).load(std::memory_order_acquire);
+    bool known = size != 0 && size <= end - m_read;
+    if (!known)
+    {
+        auto next = m_read + sizeof(RecordHeader);
+        while (next != end && !IsRecordChain(next, end))
+        {
+            next += sizeof(RecordHeader);
+        }
+
+        // the writer may have stored its size meanwhile
+        size = Size(record).load(std::memory_order_acquire);
+        known = size != 0 && size <= end - m_read;
+        if (!known)
+        {
+            size = static_cast<uint32_t>(next - m_read);
+        }
+    }
+    m_abandoned.push_back(AbandonedSpace{m_read, size, known, now});
+    m_read += size;
+    m_header.dropped.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+// true if the records from 'position' follow each other up to 'end', or up to a reservation without a size yet
+bool ShmRing::IsRecordChain(uint64_t position, uint64_t end) const
+{
+    if (Size(GetRecord(position)).load(std::memory_order_acquire) == 0)
+    {
+        return false;
+    }
+
+    while (position != end)
+    {
+        auto& record = GetRecord(position);
+        auto state = static_cast<RecordState>(State(record).load(std::memory_order_acquire));
+        auto size = Size(record).load(std::memory_order_acquire);
+        if (state == RecordState::Empty && size == 0)
+        {
+            return true;
+        }
+
+        // a record never wraps, padding and a gap that may become padding end exactly at the end of the ring
+        bool wrap = ((position + size) & m_mask) == 0;
+        bool valid = size != 0 && size % sizeof(RecordHeader) == 0 && size <= end - position;
+        switch (state)
+        {
+        case RecordState::Message:
+            valid = valid && record.length <= MaxMessageSize && RecordSize(record.length) == size;
+            break;
+        case RecordState::Padding:
+            valid = valid && wrap;
+            break;
+        case RecordState::Empty:
+        case RecordState::Discarded:
+            valid = valid && (size <= RecordSize(MaxMessageSize) || wrap);
+            break;
+        default:
+            valid = false;
+            break;
+        }
+        if (!valid)
+        {
+            return false;
+        }
+        position += size;
+    }
+    return true;
+}
+
+void ShmRing::ReleaseAbandoned(Clock::time_point now)
+{
+    // in order, the writers can only use the space up to the first abandoned record
+    while (!m_abandoned.empty())
+    {
+        auto& space = m_abandoned.front();
+        bool discarded = space.record && State(GetRecord(space.position)).load(std::memory_order_acquire) == static_cast<uint32_t>(RecordState::Discarded);
+        if (!discarded && now - space.time < AbandonTimeout)
+        {
+            break;
+        }
+        Clear(space.position, space.size);
+        m_abandoned.pop_front();
+    }
+}
+
+void ShmRing::Clear(uint64_t position, uint64_t size)
+{
+    // free space must read as empty records when the writers come around again
+    while (size > 0)
+    {
+        auto offset = position & m_mask;
+        auto count = std::min(size, m_mask + 1 - offset);
+        std::memset(m_data + offset, 0, static_cast<size_t>(count));
+        position += count;
+        size -= count;
+    }
+}
+
+void ShmRing::Consume(uint64_t size)
+{
+    Clear(m_read, size);
+    m_read += size;
+}
+
+void ShmRing::Publish()
+{
+    m_header.read.store(m_abandoned.empty() ? m_read : m_abandoned.front().position, std::memory_order_release);
+}
+
+void ShmRing::EnableSignal()
+{
+    // pairs with the commit in ShmRingWriter::Write(): either the writer sees the flag or we see its record
+    m_header.readerWaiting.store(1, std::memory_order_seq_cst);
+    if (State(GetRecord(m_read)).load(std::memory_order_seq_cst) != static_cast<uint32_t>(RecordState::Empty) &&
+        m_header.readerWaiting.exchange(0, std::memory_order_seq_cst) == 1)
+    {
+        m_ready.Set();
+    }
+}
+
+bool ShmRing::IsEmpty() const
+{
+    return m_read == m_header.reserve.load(std::memory_order_acquire);
+}
+
+uint64_t ShmRing::GetDropped() const
+{
+    return m_header.dropped.load(std::memory_order_relaxed);
+}
+
+SharedEvent& ShmRing::GetReadySignal()
+{
+    return m_ready;
+}
+
+const SharedEvent& ShmRing::GetReadySignal() const
+{
+    return m_ready;
+}
+
+void ShmRing::SetRetry(Clock::time_point time)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_retryMutex);
+        if (time == m_retryTime)
+        {
+            return;
+        }
+        m_retryTime = time;
+    }
+    m_retryChanged.notify_one();
+}
+
+void ShmRing::RunRetry()
+{
+    std::unique_lock<std::mutex> lock(m_retryMutex);
+    while (!m_end)
+    {
+        if (m_retryTime == Clock::time_point::max())
+        {
+            m_retryChanged.wait(lock);
+        }
+        else if (m_retryChanged.wait_until(lock, m_retryTime) == std::cv_status::timeout)
+        {
+            m_retryTime = Clock::time_point::max();
+            m_ready.Set();
+        }
+    }
+}
+
+ShmRingWriter::ShmRingWriter(const std::string& name) :
+    m_memory(name),
+    m_header(OpenHeader(m_memory, name)),
+    m_ready(name + "_READY", false),
+    m_data(static_cast<char*>(m_memory.Ptr()) + sizeof(RingHeader)),
+    m_capacity(m_header.capacity),
+    m_pid(GetCurrentPid())
+{
+}
+
+bool ShmRingWriter::Write(std::string_view message)
+{
+    return Write(m_pid, message);
+}
+
+bool ShmRingWriter::Write(uint32_t pid, std::string_view message)
+{
+    auto length = static_cast<uint32_t>(std::min<uint64_t>({message.size(), MaxMessageSize, m_capacity / 2 - sizeof(RecordHeader)}));
+    auto size = RecordSize(length);
+
+    // a record never wraps, when it does not fit before the end of the ring the rest of the ring is reserved as padding
+    auto position = m_header.reserve.load(std::memory_order_relaxed);
+    uint64_t padding;
+    for (;;)
+    {
+        auto contiguous = m_capacity - (position & (m_capacity - 1));
+        padding = size <= contiguous ? 0 : contiguous;
+        if (position + padding + size - m_header.read.load(std::memory_order_acquire) > m_capacity)
+        {
+            m_header.dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        if (m_header.reserve.compare_exchange_weak(position, position + padding + size, std::memory_order_acquire, std::memory_order_relaxed))
+        {
+            break;
+        }
+    }
+
+    // both sizes go first, the reader needs them to skip a reservation that is not committed in time
+    RecordHeader* pGap = nullptr;
+    if (padding != 0)
+    {
+        pGap = reinterpret_cast<RecordHeader*>(m_data + (position & (m_capacity - 1)));
+        Size(*pGap).store(static_cast<uint32_t>(padding), std::memory_order_relaxed);
+        position += padding;
+    }
+    auto& record = *reinterpret_cast<RecordHeader*>(m_data + (position & (m_capacity - 1)));
+    Size(record).store(static_cast<uint32_t>(size), std::memory_order_relaxed);
+    if (pGap != nullptr && !Commit(*pGap, RecordState::Padding))
+    {
+        Commit(record, RecordState::Discarded);
+        return false;
+    }
+
+    record.pid = pid;
+    record.length = length;
+    std::memcpy(&record + 1, message.data(), length);
+    if (!Commit(record, RecordState::Message))
+    {
+        return false;
+    }
+
+    // only the first commit after the reader ran dry signals it
+    if (m_header.readerWaiting.load(std::memory_order_seq_cst) != 0 && m_header.readerWaiting.exchange(0, std::memory_order_seq_cst) == 1)
+    {
+        m_ready.Set();
+    }
+    return true;
+}
+
+bool ShmRingWriter::Commit(RecordHeader& record, RecordState state)
+{
+    auto expected = static_cast<uint32_t>(RecordState::Empty);
+    if (State(record).compare_exchange_strong(expected, static_cast<uint32_t>(state), std::memory_order_seq_cst))
+    {
+        return true;
+    }
+
+    // the reader abandoned the record and counted it as dropped, it may reuse the space as soon as it sees this
+    State(record).store(static_cast<uint32_t>(RecordState::Discarded), std::memory_order_release);
+    m_ready.Set();
+    return false;
+}
+
+} // namespace shmring
+} // namespace fusion
@@ -0,0 +1,89 @@
+// (C) Copyright Gert-Jan de Vos and Jan Wilmans 2013.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+// ShmRingStress runs a number of writer threads, each with its own mapping of the ring like a separate process would
+// have, against one reader. The writers retry when the ring is full, so the reader must see every message exactly
+// once and in order per writer, and the ring must count every full ring as a drop.
+// usage: ShmRingStress [writers] [messages per writer] [capacity]
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "ShmRingLib/ShmRing.h"
+
+using namespace fusion::shmring;
+
+int main(int argc, char* argv[])
+try
+{
+    auto writers = argc > 1 ? std::stoul(argv[1]) : 8ul;
+    auto messages = argc > 2 ? std::stoul(argv[2]) : 200000ul;
+    auto capacity = argc > 3 ? std::stoul(argv[3]) : 65536ul;
+
+    auto name = "ShmRingStress" + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count());
+    ShmRing ring(name, capacity);
+
+    std::atomic<unsigned long> fullCount = 0;
+    std::vector<std::thread> threads;
+    auto start = std::chrono::steady_clock::now();
+    for (unsigned long i = 0; i < writers; ++i)
+    {
+        threads.emplace_back([&, i]() {
+            ShmRingWriter writer(name);
+            for (unsigned long n = 0; n < messages; ++n)
+            {
+                auto message = std::to_string(n) + std::string(n % 200, 'x');
+                while (!writer.Write(static_cast<uint32_t>(i), message))
+                {
+                    ++fullCount;
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+
+    std::vector<unsigned long> next(writers);
+    unsigned long received = 0;
+    unsigned long errors = 0;
+    auto total = writers * messages;
+    while (received < total)
+    {
+        if (!ring.GetReadySignal().Wait(5000))
+        {
+            std::cerr << "timeout waiting for the ring, received " << received << " of " << total << "\n";
+            return 1;
+        }
+        received += ring.Read([&](uint32_t pid, std::string_view message) {
+            auto n = std::stoul(std::string(message.substr(0, message.find('x'))));
+            if (pid >= writers || n != next[pid] || message.size() != std::to_string(n).size() + n % 200)
+            {
+                ++errors;
+            }
+            else
+            {
+                ++next[pid];
+            }
+        });
+    }
+
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+    auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << writers << " writers, " << total << " messages in " << seconds << " s (" << total / seconds << " messages/s), "
+              << fullCount << " full, " << ring.GetDropped() << " dropped, " << errors << " errors\n";
+    return errors == 0 && ring.IsEmpty() && ring.GetDropped() == fullCount ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+catch (std::exception& ex)
+{
+    std::cerr << ex.what() << "\n";
+    return EXIT_FAILURE;
+}
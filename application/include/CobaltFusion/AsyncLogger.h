@@ -0,0 +1,87 @@
+// (C) Copyright Gert-Jan de Vos and Jan Wilmans 2013.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include "CobaltFusion/dbgstream.h"
+
+#include "windows.h"
+
+namespace fusion {
+
+// LogTransport ships the batches of an AsyncLogger, Send() is only called from the logger's writer thread.
+// A batch holds one or more complete lines, each terminated by '\n'.
+class LogTransport
+{
+public:
+    virtual ~LogTransport() = default;
+    virtual void Send(const std::string& batch) = 0;
+};
+
+// OutputDebugStringA for every line, still one DBWIN round trip per line, but no longer on the logging thread
+std::unique_ptr<LogTransport> MakeOdsTransport();
+
+// the batch in as few datagrams as possible, for DebugView++'s UDP source
+std::unique_ptr<LogTransport> MakeUdpTransport(const std::string& host, int port);
+
+// the batch in one WriteFile, for a process started by DebugView++ that has stdout connected to a pipe
+std::unique_ptr<LogTransport> MakePipeTransport(HANDLE hPipe = GetStdHandle(STD_OUTPUT_HANDLE));
+
+// every line as a message in the shared-memory ring of DebugView++, see ShmRingLib/ShmRing.h
+std::unique_ptr<LogTransport> MakeRingTransport(const std::string& name);
+
+// AsyncLogger takes the lines that cdbg and wcdbg format in a buffer per thread and sends them from a background
+// thread, so the logging thread only pays for a short append under a lock. Lines written while the transport is busy
+// are collected in one batch of at most 'maxPending' bytes; lines that do not fit are dropped and counted, and the
+// count is reported in the next batch.
+//
+// dbgstream::set_line_sink(&logger) routes cdbg to the logger, set_line_sink(nullptr) restores OutputDebugString.
+// Restore it before the logger is destroyed, while no other thread is logging.
+class AsyncLogger : public dbgstream::line_sink
+{
+public:
+    static constexpr size_t DefaultMaxPending = 1024 * 1024;
+
+    explicit AsyncLogger(std::unique_ptr<LogTransport> pTransport, size_t maxPending = DefaultMaxPending);
+
+    // sends the pending lines before it returns
+    ~AsyncLogger();
+
+    AsyncLogger(const AsyncLogger&) = delete;
+    AsyncLogger& operator=(const AsyncLogger&) = delete;
+
+    // 'lines' must be complete lines, terminated by '\n'
+    void write(std::string_view lines) override;
+
+    // waits until all lines written so far are sent
+    void Flush();
+
+    uint64_t GetDropped() const;
+
+private:
+    void Run();
+
+    std::unique_ptr<LogTransport> m_pTransport;
+    size_t m_maxPending;
+    std::mutex m_mutex;
+    std::condition_variable m_pendingCondition;
+    std::condition_variable m_sentCondition;
+    std::string m_pending;
+    uint64_t m_written = 0; // protected by m_mutex, the number of writes and ...
+    uint64_t m_sent = 0;    // ... of those, the number sent
+    std::atomic<uint64_t> m_dropped = 0;
+    bool m_end = false;
+    std::thread m_thread;
+};
+
+} // namespace fusion
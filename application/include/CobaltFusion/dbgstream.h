@@ -16,6 +16,9 @@
 // #    define CDBG cdbg
 // #    define WCDBG wcdbg
 // #endif
+//
+// Every thread formats into its own line buffer, complete lines go to OutputDebugString or, when one is set with
+// dbgstream::set_line_sink(), to a line_sink like fusion::AsyncLogger that sends them from a background thread.
 
 
 #ifndef DBGSTREAM_H
@@ -23,24 +26,58 @@
 
 #pragma once
 
+#include <atomic>
 #include <streambuf>
 #include <ostream>
 #include <string>
+#include <string_view>
 #include "windows.h"
 
 namespace dbgstream {
 
+class line_sink
+{
+public:
+    // receives one or more complete lines in UTF-8, from any thread
+    virtual void write(std::string_view lines) = 0;
+
+protected:
+    ~line_sink() = default;
+};
+
+inline std::atomic<line_sink*> g_line_sink = nullptr;
+
+inline void set_line_sink(line_sink* sink)
+{
+    g_line_sink.store(sink, std::memory_order_release);
+}
+
 template <class Elem, class Tr = std::char_traits<Elem>, class Alloc = std::allocator<Elem>>
 class basic_debugbuf : public std::basic_streambuf<Elem, Tr>
 {
     using _int_type = typename std::basic_streambuf<Elem, Tr>::int_type;
     using _traits_type = typename std::basic_streambuf<Elem, Tr>::traits_type;
 
+    using _string_type = std::basic_string<Elem, Tr, Alloc>;
+
 protected:
+    // a line_sink only takes complete lines, the rest of a flushed line stays in the buffer until its newline arrives
     int sync() override
     {
-        output(m_buf.c_str());
-        m_buf.clear();
+        auto& buf = thread_buffer();
+        auto sink = g_line_sink.load(std::memory_order_acquire);
+        auto end = sink != nullptr ? buf.rfind(_traits_type::to_char_type('\n')) + 1 : buf.size();
+        if (end == buf.size())
+        {
+            if (!buf.empty())
+                output(sink, buf);
+            buf.clear();
+        }
+        else if (end != 0)
+        {
+            output(sink, buf.substr(0, end));
+            buf.erase(0, end);
+        }
         return 0;
     }
 
@@ -49,23 +86,58 @@ protected:
         if (c == _traits_type::eof())
             return 0;
 
-        m_buf += _traits_type::to_char_type(c);
+        thread_buffer() += _traits_type::to_char_type(c);
         if (c == '\n')
             sync();
         return c;
     }
 
+    // takes whole strings at once instead of a virtual overflow() call per character
+    std::streamsize xsputn(const Elem* s, std::streamsize n) override
+    {
+        auto& buf = thread_buffer();
+        const Elem* end = s + n;
+        while (s != end)
+        {
+            const Elem* newline = _traits_type::find(s, static_cast<size_t>(end - s), _traits_type::to_char_type('\n'));
+            if (newline == nullptr)
+            {
+                buf.append(s, end);
+                break;
+            }
+            buf.append(s, newline + 1);
+            s = newline + 1;
+            sync();
+        }
+        return n;
+    }
+
 private:
-    std::basic_string<Elem, Tr, Alloc> m_buf;
+    // cdbg is shared by all threads, a buffer per thread keeps their lines apart
+    static _string_type& thread_buffer()
+    {
+        thread_local _string_type buf;
+        return buf;
+    }
 
-    static void output(const char* msg)
+    static void output(line_sink* sink, const std::string& msg)
     {
-        OutputDebugStringA(msg);
+        if (sink != nullptr)
+            sink->write(msg);
+        else
+            OutputDebugStringA(msg.c_str());
     }
 
-    static void output(const wchar_t* msg)
+    static void output(line_sink* sink, const std::wstring& msg)
     {
-        OutputDebugStringW(msg);
+        if (sink != nullptr)
+        {
+            std::string utf8(WideCharToMultiByte(CP_UTF8, 0, msg.data(), static_cast<int>(msg.size()), nullptr, 0, nullptr, nullptr), '\0');
+            WideCharToMultiByte(CP_UTF8, 0, msg.data(), static_cast<int>(msg.size()), utf8.data(), static_cast<int>(utf8.size()), nullptr, nullptr);
+            sink->write(utf8);
+        }
+        else
+            OutputDebugStringW(msg.c_str());
     }
 };
 
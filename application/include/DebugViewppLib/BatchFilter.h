@@ -0,0 +1,64 @@
+// (C) Copyright Gert-Jan de Vos and Jan Wilmans 2013.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "DebugViewppLib/FileIO.h"
+#include "DebugViewppLib/Filter.h"
+#include "DebugViewppLib/Line.h"
+
+namespace fusion {
+namespace debugviewpp {
+
+// BatchFilter applies a LogFilter to saved log files, like a grep that understands the DebugView++ and Sysinternals formats.
+// The files are memory mapped and cut into chunks at line boundaries, the chunks are parsed and filtered on all cores
+// and the matching lines are reported in file and line order.
+class BatchFilter
+{
+public:
+    using Output = std::function<void(const Line& line)>;
+    using Error = std::function<void(const std::wstring& filename, const std::string& message)>;
+
+    static constexpr size_t ChunkSize = 4 * 1024 * 1024;
+
+    // 'threadCount' 0 uses all cores, FilterType::Once filters depend on the line order and always run on a single thread
+    explicit BatchFilter(const LogFilter& filter, size_t threadCount = 0);
+    ~BatchFilter();
+
+    // 'output' and 'error' are called on the calling thread, files that cannot be read are reported to 'error' and skipped
+    void Run(const std::vector<std::wstring>& filenames, const Output& output, const Error& error);
+
+    [[nodiscard]] size_t GetThreadCount() const;
+
+private:
+    struct File;
+    struct Chunk;
+
+    void Work();
+    void MapNextFile();
+    Lines Parse(const Chunk& chunk, LogFilter& filter) const;
+
+    LogFilter m_filter;
+    size_t m_threadCount;
+    size_t m_window;
+    const std::vector<std::wstring>* m_pFilenames = nullptr;
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::deque<std::unique_ptr<File>> m_files;
+    std::deque<Chunk> m_chunks;
+    size_t m_next = 0;
+    size_t m_output = 0;
+    bool m_end = false;
+};
+
+} // namespace debugviewpp
+} // namespace fusion
@@ -19,6 +19,14 @@ std::string GetDateTimeText(const FILETIME& filetime);
 std::string GetTimeText(const SYSTEMTIME& st);
 std::string GetTimeText(const FILETIME& ft);
 
+uint64_t FileTimeToUInt64(const FILETIME& ft);
+
+// reads a time of day as "hh:mm[:ss[.fff]]" into the time fields of 'st', its date is left as it is
+bool ReadTimeOfDay(const std::string& text, SYSTEMTIME& st);
+
+// returns the time from ft1 to ft2 in seconds, negative if ft2 is earlier
+double GetDifference(FILETIME ft1, FILETIME ft2);
+
 template <typename CharT>
 std::basic_string<CharT> TabsToSpaces(const std::basic_string<CharT>& s, int tabsize = 4)
 {
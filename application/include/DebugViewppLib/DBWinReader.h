@@ -12,6 +12,7 @@ namespace fusion {
 namespace debugviewpp {
 
 class ILineBuffer;
+class PidMap;
 
 struct DBWinMessage
 {
@@ -27,7 +28,8 @@ struct DbWinBuffer;
 class DBWinReader : public LogSource
 {
 public:
-    DBWinReader(Timer& timer, ILineBuffer& lineBuffer, bool global);
+    // when 'pPidMap' is given, processes it knows are identified by pid instead of opening a handle for every message
+    DBWinReader(Timer& timer, ILineBuffer& lineBuffer, bool global, const PidMap* pPidMap = nullptr);
 
     HANDLE GetHandle() const override;
     void Notify() override;
@@ -38,6 +40,7 @@ private:
     Win32::Handle m_dbWinDataReady;
     Win32::MappedViewOfFile m_mappedViewOfFile;
     const DbWinBuffer* m_dbWinBuffer;
+    const PidMap* m_pPidMap;
 };
 
 } // namespace debugviewpp
@@ -5,6 +5,8 @@
 
 #pragma once
 
+#include <thread>
+#include <vector>
 #include <boost/asio.hpp>
 #include "PolledLogSource.h"
 
@@ -13,35 +15,82 @@ namespace debugviewpp {
 
 class ILineBuffer;
 
-template <typename T, class S>
-T Read(S& is)
-{
-    T t = T();
-    is.read(reinterpret_cast<char*>(&t), sizeof(t));
-    return t;
-}
+extern const std::string SysinternalsDebugViewAgentPort;
 
-template <typename T, class S>
-void Write(S& is, T t)
+// Decodes the Sysinternals DebugView agent protocol straight out of a receive buffer.
+// The stream consists of [DWORD length][message block] units, a block contains one or more records:
+// [DWORD lineNr][FILETIME systemTime][QWORD qpcTime]["\1pid\2 " (optional)][text]['\0'] padded to a multiple of 4 bytes.
+class DbgviewDecoder
 {
-    is.write(reinterpret_cast<const char*>(&t), sizeof(t));
-}
+public:
+    // the agent sends its buffered messages in blocks of a few kilobytes, a larger length is a protocol error
+    static constexpr DWORD MaxMessageLength = 4 * 1024 * 1024;
+
+    explicit DbgviewDecoder(DWORD qpFrequency = 1);
+
+    // decodes all complete message blocks in [data, data + size) into 'lines' and returns the number of bytes consumed.
+    // throws std::runtime_error when the stream cannot be parsed.
+    size_t Decode(const char* data, size_t size, Lines& lines);
+
+    // encodes one message block including its length prefix, used to simulate an agent in tests and benchmarks.
+    static std::vector<char> Encode(const Lines& lines, DWORD qpFrequency);
+
+private:
+    void DecodeBlock(const char* data, size_t size, Lines& lines);
+
+    double m_timerUnit;
+    long long m_t0 = 0;
+    bool m_first = true;
+};
 
 class DbgviewReader : public PolledLogSource
 {
 public:
-    DbgviewReader(Timer& timer, ILineBuffer& linebuffer, const std::string& hostname);
+    DbgviewReader(Timer& timer, ILineBuffer& linebuffer, const std::string& hostname, const std::string& port = SysinternalsDebugViewAgentPort);
+    ~DbgviewReader() override;
 
     void SetAutoNewLine(bool value) override;
     void Abort() override;
 
 private:
-    void Loop();
-    std::string m_hostname;
-    boost::asio::ip::tcp::iostream m_iostream;
+    void Connected();
+    void Handshake();
+    void BeginRead();
+    void Close(const std::string& message);
 
+    std::string m_hostname;
+    std::string m_port;
+    boost::asio::io_context m_ioContext;
+    boost::asio::ip::tcp::resolver m_resolver;
+    boost::asio::ip::tcp::socket m_socket;
+    DWORD m_qpFrequency = 0;
+    std::vector<char> m_request;
+    std::vector<char> m_buffer;
+    size_t m_end = 0;
+    DbgviewDecoder m_decoder;
     std::thread m_thread;
 };
 
+// DbgviewAgentSimulator accepts a single DbgviewReader connection on the loopback interface
+// and answers the handshake like the Sysinternals agent, used by the tests and benchmarks.
+class DbgviewAgentSimulator
+{
+public:
+    explicit DbgviewAgentSimulator(DWORD qpFrequency = 1000000);
+
+    [[nodiscard]] unsigned short GetPort() const;
+
+    // blocks until a reader is connected and the handshake is complete
+    void Accept();
+    void Send(const std::vector<char>& block);
+    void Close();
+
+private:
+    boost::asio::io_context m_ioContext;
+    boost::asio::ip::tcp::acceptor m_acceptor;
+    boost::asio::ip::tcp::socket m_socket;
+    DWORD m_qpFrequency;
+};
+
 } // namespace debugviewpp
 } // namespace fusion
@@ -45,6 +45,9 @@ bool ReadLogFileMessage(const std::string& data, Line& line);
 
 std::ostream& operator<<(std::ostream& os, const FILETIME& ft);
 
+// the inverse of FileTimeToUInt64()
+FILETIME MakeFileTime(uint64_t t);
+
 struct OpenMode
 {
     enum type
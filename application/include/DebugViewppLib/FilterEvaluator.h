@@ -0,0 +1,117 @@
+// (C) Copyright Gert-Jan de Vos and Jan Wilmans 2013.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <condition_variable>
+#include <exception>
+#include <limits>
+#include <mutex>
+#include <regex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "DebugViewppLib/Filter.h"
+#include "DebugViewppLib/LogFile.h"
+
+namespace fusion {
+namespace debugviewpp {
+
+enum class FilterSubject
+{
+    Text,
+    ProcessName
+};
+
+// the slot of every filter of a view, in the order of its filters
+using FilterSlots = std::vector<size_t>;
+
+struct FilterResult
+{
+    std::vector<bool> matches;                          // by slot
+    std::vector<std::pair<size_t, std::string>> tokens; // slot and MatchKey() of every match of the slots that color their matches
+
+    [[nodiscard]] bool IsMatch(size_t slot) const;
+};
+
+// FilterEvaluator runs the filters of all views over a line once. The views register their filters before a batch of
+// lines, identical filters of different views share a slot and each slot is evaluated once per line, no matter how
+// many views use it. A view decides on a line from its FilterResult with the IsIncluded() and MatchFilterType()
+// overloads below, which decide exactly as the ones in Filter.h.
+// A large batch is split over a pool of threads that is started with the first batch that needs it and waits for the
+// next batch after that; the calling thread evaluates the first part itself.
+class FilterEvaluator
+{
+public:
+    static constexpr size_t NoSlot = std::numeric_limits<size_t>::max();
+    static constexpr size_t MinLinesPerThread = 256;
+    static constexpr size_t MaxThreadCount = 8;
+
+    // 'threadCount' 0 uses all cores, at most MaxThreadCount threads evaluate a batch and only when each gets
+    // MinLinesPerThread lines
+    explicit FilterEvaluator(size_t threadCount = 0);
+    ~FilterEvaluator();
+
+    FilterEvaluator(const FilterEvaluator&) = delete;
+    FilterEvaluator& operator=(const FilterEvaluator&) = delete;
+
+    // drops the slots nobody registered since the previous BeginRegistration(), the other slots are renumbered
+    void BeginRegistration();
+
+    // the slot of 'filter' on 'subject', NoSlot when it is disabled
+    size_t Register(const Filter& filter, FilterSubject subject);
+    FilterSlots Register(const std::vector<Filter>& filters, FilterSubject subject);
+
+    [[nodiscard]] size_t GetSlotCount() const;
+    [[nodiscard]] size_t GetRegisteredCount() const;
+    [[nodiscard]] size_t GetThreadCount() const;
+
+    void Evaluate(const Message& msg, FilterResult& result) const;
+
+    // must not run at the same time as Register()
+    void Evaluate(const std::vector<Message>& messages, std::vector<FilterResult>& results);
+
+private:
+    struct Slot
+    {
+        std::string key;
+        std::regex re;
+        MatchType::type matchType;
+        FilterSubject subject;
+        bool tokens;
+        bool used;
+    };
+
+    static std::string MakeKey(const Filter& filter, FilterSubject subject);
+    void Evaluate(const std::vector<Message>& messages, std::vector<FilterResult>& results, size_t begin, size_t end) const;
+    void Work();
+
+    size_t m_threadCount;
+    std::vector<Slot> m_slots;
+    std::unordered_map<std::string, size_t> m_keys;
+    size_t m_registered = 0;
+
+    // the batch the pool works on, its chunks are taken in order, the calling thread takes chunk 0
+    std::mutex m_mutex;
+    std::condition_variable m_workAvailable;
+    std::condition_variable m_batchDone;
+    const std::vector<Message>* m_pMessages = nullptr;
+    std::vector<FilterResult>* m_pResults = nullptr;
+    size_t m_chunkSize = 0;
+    size_t m_chunkCount = 0;
+    size_t m_nextChunk = 0;
+    size_t m_pending = 0; // chunks of the pool that are not done yet
+    std::exception_ptr m_error; // of a pool thread, rethrown by Evaluate()
+    bool m_end = false;
+    std::vector<std::thread> m_threads;
+};
+
+bool IsIncluded(std::vector<Filter>& filters, const FilterSlots& slots, const FilterResult& result, MatchColors& matchColors);
+bool MatchFilterType(const std::vector<Filter>& filters, const FilterSlots& slots, FilterType::type type, const FilterResult& result);
+
+} // namespace debugviewpp
+} // namespace fusion
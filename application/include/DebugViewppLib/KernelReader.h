@@ -31,7 +31,7 @@ public:
     void SetPassThrough(bool value);
 
 private:
-    void Poll() override;
+    bool Poll() override;
 
     void StartListening();
     void StopListening();
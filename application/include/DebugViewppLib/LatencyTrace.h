@@ -0,0 +1,42 @@
+// (C) Copyright Gert-Jan de Vos and Jan Wilmans 2013.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+namespace fusion {
+namespace debugviewpp {
+
+// Latency tracing stamps a sample of the lines with the QueryPerformanceCounter ticks at which their LogSource added
+// them to the line buffer (Line::ingestTicks). Every stage the line passes records the time since that stamp in the
+// "latency.<stage>.us" histogram of the metrics registry, so the stage where lines are delayed stands out.
+// Lines that are not sampled have ingestTicks 0 and cost a single compare per stage.
+enum class LatencyStage
+{
+    Drain,   // LogSources::GetLines took the line from the line buffer
+    Newline, // NewlineFilter split the line
+    Store,   // LogFile::Add stored the line
+    Filter,  // CLogView::Add filtered the line
+    Paint    // CLogView painted the line for the first time
+};
+
+// one in 'interval' lines is traced, 0 turns tracing off, which is the default
+void SetLatencySampling(unsigned interval);
+unsigned GetLatencySampling();
+
+// returns the stamp for the next line that is added: the current ticks if it is sampled, 0 otherwise
+long long SampleLatency();
+
+void RecordLatencySample(LatencyStage stage, long long ingestTicks);
+
+inline void RecordLatency(LatencyStage stage, long long ingestTicks)
+{
+    if (ingestTicks != 0)
+    {
+        RecordLatencySample(stage, ingestTicks);
+    }
+}
+
+} // namespace debugviewpp
+} // namespace fusion
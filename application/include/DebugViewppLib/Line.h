@@ -15,6 +15,9 @@ namespace debugviewpp {
 
 class LogSource;
 
+// identifies the LogSource a line came from, ids are never reused so they can be checked after the source is gone
+using SourceId = unsigned;
+
 struct Line
 {
     Line(double time, FILETIME systemTime, HANDLE handle, const std::string& message, const LogSource* pLogSource);
@@ -33,6 +36,9 @@ struct Line
     std::string processName;
     std::string message;
     const LogSource* pLogSource;
+    SourceId sourceId;
+    std::string source; // the source a replayed line was recorded from, empty for lines of pLogSource itself
+    long long ingestTicks; // see LatencyTrace.h, 0 if the line is not traced
 };
 
 using Lines = std::vector<Line>;
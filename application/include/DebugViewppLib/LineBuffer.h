@@ -20,6 +20,7 @@ public:
 
     virtual void Add(double time, FILETIME systemTime, HANDLE handle, const std::string& message, const LogSource* pLogSource) = 0;
     virtual void Add(double time, FILETIME systemTime, DWORD pid, const std::string& processName, const std::string& message, const LogSource* pLogSource) = 0;
+    virtual void Add(Line line) = 0;
     virtual Lines GetLines() = 0;
     virtual bool Empty() const = 0;
 };
@@ -0,0 +1,94 @@
+// (C) Copyright Gert-Jan de Vos and Jan Wilmans 2013.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "Win32/Win32Lib.h"
+#include "DebugViewppLib/Line.h"
+
+namespace fusion {
+namespace debugviewpp {
+
+class LogSource;
+
+// ListenerPool shards LogSources over a number of listening threads, each thread waits for the handles of its own
+// sources with a single WaitForAnyObject and calls LogSource::Notify() for the signaled ones.
+// When a Notify() takes longer than ExpensiveNotification, or for LogSource::Initialize(), the call is queued
+// and picked up by whichever listening thread is idle first, so a slow source does not hold up the rest of its shard.
+// A source is never notified by two threads at the same time: its handle is not waited for while a queued call
+// is pending, so the lines of one source always reach the line buffer in order. How the lines of different sources
+// interleave in the line buffer depends on the timing of the threads, Merge() puts a batch in an order that does not.
+class ListenerPool
+{
+public:
+    // two slots of every wait set are taken by the shard's update event and the shared work queue semaphore
+    static constexpr size_t MaxSourcesPerShard = MAXIMUM_WAIT_OBJECTS - 2;
+    static constexpr std::chrono::milliseconds ExpensiveNotification = std::chrono::milliseconds(10);
+
+    // 'notified' is called from the listening threads after every Notify()
+    ListenerPool(size_t threadCount, std::function<void()> notified);
+    ~ListenerPool();
+
+    static size_t DefaultThreadCount();
+
+    // orders a batch taken from the line buffer: the lines of each source keep their order and the sources are merged
+    // by time, equal times in SourceId order. The result only depends on the lines of each source in the batch.
+    static void Merge(Lines& lines);
+
+    void Add(LogSource* pLogSource);
+
+    // returns when no listening thread is using pLogSource anymore, must not be called from a listening thread
+    void Remove(LogSource* pLogSource);
+    void Abort();
+
+    [[nodiscard]] size_t GetThreadCount() const;
+
+private:
+    struct Shard
+    {
+        Win32::Handle updateEvent;
+        size_t sourceCount = 0;
+        size_t generation = 0;
+        std::thread thread;
+    };
+
+    struct Entry
+    {
+        LogSource* pLogSource;
+        Shard* pShard;
+        bool initialized = false;
+        bool expensive = false;
+        bool busy = false;
+        bool removed = false;
+    };
+
+    Shard& SelectShard();
+    void Listen(Shard& shard);
+    bool Dispatch(Entry& entry);
+    void Queue(Entry& entry);
+    void RunQueued();
+    void Run(Entry& entry);
+
+    size_t m_threadCount;
+    std::function<void()> m_notified;
+    Win32::Handle m_queueSemaphore;
+    mutable std::mutex m_mutex;
+    std::condition_variable m_idle;
+    std::vector<std::unique_ptr<Shard>> m_shards;
+    std::vector<std::unique_ptr<Entry>> m_entries;
+    std::deque<Entry*> m_queue;
+    bool m_end = false;
+};
+
+} // namespace debugviewpp
+} // namespace fusion
@@ -5,15 +5,23 @@
 
 #pragma once
 
+#include <cstdint>
+#include <limits>
 #include <string>
+#include <unordered_map>
 #include <vector>
 #include "DebugviewppLib/Colors.h"
 #include "DebugviewppLib/ProcessInfo.h"
+#include "DebugviewppLib/TemplateMiner.h"
+#include "DebugviewppLib/TimeIndex.h"
 #include "IndexedStorageLib/IndexedStorage.h"
 
 namespace fusion {
 namespace debugviewpp {
 
+class SnapshotWriter;
+class SnapshotReader;
+
 struct Message
 {
     Message(double time, FILETIME systemTime, DWORD pid, const std::string& processName, const std::string& msg, COLORREF color = Colors::BackGround);
@@ -24,6 +32,7 @@ struct Message
     std::string processName;
     std::string text;
     COLORREF color;
+    long long ingestTicks; // see LatencyTrace.h, 0 if the line is not traced
 };
 
 class LogFile
@@ -36,28 +45,83 @@ public:
     int BeginIndex() const;
     int EndIndex() const;
     int Count() const;
+    size_t GetRawSize() const;
+    size_t GetStoredSize() const;
+    size_t GetDistinctCount() const;
     Message operator[](int i) const;
+
+    // true if line 'j' has the same text and process as line 'i', without decompressing either
+    bool IsRepeat(int i, int j) const;
+
+    // every line is assigned a template by the TemplateMiner as it is added
+    TemplateId GetTemplateId(int i) const;
+    const TemplateMiner& GetTemplates() const;
+
+    // stores a line that has a template as the parameters of its template instead of its text, on by default
+    void SetTemplateEncoding(bool enable);
+    bool GetTemplateEncoding() const;
+
+    // the first line with a system time at or after 'time', Count() if there is none
+    int LowerBoundTime(const FILETIME& time) const;
+
+    // one past the last line with a system time at or before 'time', 0 if there is none
+    int UpperBoundTime(const FILETIME& time) const;
+
     int GetHistorySize() const;
     void SetHistorySize(int size);
 
+    // memory pressure, see MemoryGovernor: the bytes of the line records and the caches, the caches rebuild on demand
+    size_t GetLineMemorySize() const;
+    size_t GetCacheSize() const;
+    size_t GetSpilledSize() const;
+    void ShrinkCaches();
+    void CompressWriteBlock();
+    void SetSpillFile(const std::wstring& filename, uint64_t maxSize = std::numeric_limits<uint64_t>::max());
+    size_t SpillBlocks(size_t bytes);
+
+    // drops the first 'count' lines, the later lines move down by 'count'
+    void Evict(int count);
+
+    // saves the lines as they are stored, compressed and encoded, so loading them back is mostly copying
+    void SaveSnapshot(SnapshotWriter& writer) const;
+    void LoadSnapshot(SnapshotReader& reader);
+
 private:
     struct InternalMessage
     {
-        InternalMessage(double time, FILETIME systemTime, DWORD uid) :
+        InternalMessage(double time, FILETIME systemTime, DWORD uid, uint32_t textId, uint32_t patternId, bool encoded) :
             time(time),
             systemTime(systemTime),
-            uid(uid)
+            uid(uid),
+            textId(textId),
+            patternId(patternId),
+            encoded(encoded)
         {
         }
 
         double time;
         FILETIME systemTime;
         DWORD uid;
+        uint32_t textId;    // index in m_storage, shared by the lines with identical text
+        uint32_t patternId; // see TemplateMiner, 0 if the line has no template
+        bool encoded;       // m_storage holds the parameters of the pattern instead of the text
     };
 
+    uint32_t AddText(const std::string& text);
+    std::string GetText(const InternalMessage& msg) const;
+
     std::vector<InternalMessage> m_messages;
     ProcessInfo m_processInfo;
     mutable indexedstorage::SnappyStorage m_storage;
+    std::unordered_map<std::string, uint32_t> m_recentTexts; // text to textId of the most recent distinct texts
+    std::unordered_map<uint32_t, const std::string*> m_recentTextIds; // and back, reading them needs no decompression
+    size_t m_recentTextSize = 0;
+    size_t m_rawSize = 0;
+    size_t m_distinctCount = 0;
+    TemplateMiner m_templateMiner;
+    bool m_templateEncoding = true;
+    std::string m_params;
+    TimeIndex m_timeIndex;
     //    indexedstorage::VectorStorage m_storage;
     int m_historySize = 0;
 };
@@ -0,0 +1,35 @@
+// (C) Copyright Gert-Jan de Vos and Jan Wilmans 2013.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <vector>
+
+namespace fusion {
+namespace debugviewpp {
+
+class SnapshotWriter;
+class SnapshotReader;
+
+// a line of a view, it shows line 'line' of the LogFile
+struct LogLine
+{
+    explicit LogLine(int line);
+
+    bool bookmark;
+    bool expanded; // part of an expanded run, no repeats are collapsed into it
+    int line;
+    int lastLine;  // the last line collapsed into this one, 'line' if there are no repeats
+    int repeats;   // lines repeating 'line' collapsed into this one
+    mutable long long ingestTicks; // see LatencyTrace.h, reset when the line is painted for the first time
+};
+
+// the lines of a view and the line of the log that has the focus, -1 if none.
+// LoadLogLines() throws if the lines are out of order or the lines or the focus line are not in a log of 'logCount' lines
+void SaveLogLines(SnapshotWriter& writer, const std::vector<LogLine>& logLines, int focusLine);
+std::vector<LogLine> LoadLogLines(SnapshotReader& reader, int logCount, int& focusLine);
+
+} // namespace debugviewpp
+} // namespace fusion
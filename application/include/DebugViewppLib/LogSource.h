@@ -48,6 +48,7 @@ public:
     void SetDescription(const std::wstring& description);
 
     SourceType::type GetSourceType() const;
+    SourceId GetSourceId() const;
 
     // for DBWIN messages
     void Add(HANDLE handle, const std::string& message) const;
@@ -58,6 +59,9 @@ public:
     // used when reading from files
     void Add(double time, FILETIME systemTime, DWORD pid, const std::string& processName, const std::string& message);
 
+    // used by ReplaySource, 'source' is the source the line was recorded from
+    void Add(double time, FILETIME systemTime, DWORD pid, const std::string& processName, const std::string& message, const std::string& source);
+
     // used by Loopback and PolledLogSources writing internal status messages
     void AddInternal(const std::string& message) const;
 
@@ -72,6 +76,7 @@ private:
     ILineBuffer& m_linebuffer;
     std::wstring m_description;
     SourceType::type m_sourceType;
+    SourceId m_sourceId;
     Timer& m_timer;
     bool m_end = false;
 };
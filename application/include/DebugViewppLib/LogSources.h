@@ -6,6 +6,7 @@
 #pragma once
 
 #include <memory>
+#include <unordered_map>
 #include <boost/signals2.hpp>
 #include "Win32/Win32Lib.h"
 #include "DebugviewppLib/LogSource.h"
@@ -13,6 +14,9 @@
 #include "CobaltFusion/ExecutorClient.h"
 #include "DebugviewppLib/NewlineFilter.h"
 #include "DebugviewppLib/ProcessMonitor.h"
+#include "DebugviewppLib/ListenerPool.h"
+#include "DebugviewppLib/RateLimiter.h"
+#include "DebugviewppLib/SourceRegistry.h"
 #include "CobaltFusion/Throttle.h"
 
 namespace fusion {
@@ -20,15 +24,21 @@ namespace debugviewpp {
 
 class DBWinReader;
 class KernelReader;
+class ShmRingReader;
 class ProcessReader;
 class FileReader;
 class AnyFileReader;
 class BinaryFileReader;
+class MergeFileReader;
 class PipeReader;
 class TestSource;
 class Loopback;
 class DbgviewReader;
-class SocketReader;
+class UdpReader;
+class TcpReader;
+class ReplaySource;
+class TraceWriter;
+class Counter;
 
 using LogSourceHandles = std::vector<HANDLE>;
 
@@ -66,7 +76,6 @@ public:
     void ResetTimer();
     void Listen();
     void Abort();
-    bool IsRemoved(const LogSource* logsource) const;
     Lines GetLines();
     void Remove(LogSource* pLogSource);
     void RemoveSources(std::function<bool(LogSource*)> predicate);
@@ -75,13 +84,24 @@ public:
 
     DBWinReader* AddDBWinReader(bool global);
     KernelReader* AddKernelReader();
+    ShmRingReader* AddShmRingReader(const std::string& name);
     ProcessReader* AddProcessReader(const std::wstring& pathName, const std::wstring& args);
     BinaryFileReader* AddBinaryFileReader(const std::wstring& filename);
     AnyFileReader* AddAnyFileReader(const std::wstring& filename, bool keeptailing);
+    MergeFileReader* AddMergeFileReader(const std::vector<std::wstring>& filenames);
     DbgviewReader* AddDbgviewReader(const std::string& hostname);
-    SocketReader* AddUDPReader(int port);
+    UdpReader* AddUDPReader(int port);
+    TcpReader* AddTCPReader(int port);
     PipeReader* AddPipeReader(DWORD pid, HANDLE hPipe);
     TestSource* AddTestSource(); // for unittesting
+    ReplaySource* AddReplaySource(const std::wstring& filename, double speed);
+
+    // limits the lines every process of a source may add, see RateLimiter
+    void SetRateLimits(const RateLimitSettings& settings);
+
+    // records every line received from the sources to a trace that ReplaySource can play back
+    void StartRecording(const std::wstring& filename);
+    void StopRecording();
     void AddMessage(const std::string& message);
     void AddMessage(DWORD pid, const std::string& processName, const std::string& message);
     boost::signals2::connection SubscribeToUpdate(UpdateSignal::slot_type slot);
@@ -95,6 +115,15 @@ private:
     void OnProcessEnded(DWORD pid, HANDLE handle);
     void AddTerminateMessage(DWORD pid, HANDLE handle) const;
 
+    struct SourceMetrics
+    {
+        std::string name;
+        Counter& lines;
+        Counter& bytes;
+    };
+    SourceMetrics& GetSourceMetrics(const Line& line);
+    void RemoveSourceMetrics();
+
     mutable std::mutex m_sources_mutex;                // protects access to m_sources
     std::vector<std::unique_ptr<LogSource>> m_sources; // owned by the thread that calls Listen(), nobody else is allowed to read/write it.
 
@@ -102,6 +131,9 @@ private:
     std::vector<std::unique_ptr<LogSource>> m_sourcesScheduleToAdd;
     std::vector<LogSource*> m_sourcesScheduledToRemove;
 
+    SourceRegistry m_sourceRegistry;
+    SourceRegistry::Snapshot m_liveSources; // only used by GetLines()
+
     bool m_autoNewLine = true;
     bool m_processPrefix = false;
     Win32::Handle m_updateEvent;
@@ -110,6 +142,9 @@ private:
     PidMap m_pidMap;
     ProcessMonitor m_processMonitor;
     NewlineFilter m_newlineFilter;
+    std::unique_ptr<TraceWriter> m_pRecorder; // only used by GetLines()
+    RateLimiter m_rateLimiter;                // only used by GetLines()
+    std::unordered_map<SourceId, SourceMetrics> m_sourceMetrics; // only used by GetLines()
 
     // not part of this class so const members can write to m_loopback
     std::unique_ptr<Loopback> m_loopback;
@@ -118,6 +153,7 @@ private:
     IExecutor& m_executor;
     UpdateSignal m_update;
     Throttle m_throttledUpdate;
+    ListenerPool m_listeners;
 
     // make sure this thread is last to initialize
     ActiveExecutorClient m_listenThread;
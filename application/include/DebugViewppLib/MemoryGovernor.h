@@ -0,0 +1,66 @@
+// (C) Copyright Gert-Jan de Vos and Jan Wilmans 2013.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+
+namespace fusion {
+namespace debugviewpp {
+
+// MemoryGovernor keeps the memory of a capture under a ceiling. The owner accounts the bytes of every component and
+// while their total is over the limit the governor hands out actions, cheapest first:
+//   ShrinkCaches        drop what is rebuilt on demand
+//   CompressWriteBlock  compress the storage block that is being filled before it is full
+//   SpillBlocks         move the oldest compressed blocks to disk
+//   EvictHistory        drop the oldest lines
+// Once over the limit the actions free down to a tenth below it, so they do not run again as soon as the memory grows
+// back. Every component is published as the gauge "memory.<component>" and every action as the counter
+// "memory.action.<action>", so the statistics show what the governor did and why.
+class MemoryGovernor
+{
+public:
+    enum class Action
+    {
+        None,
+        ShrinkCaches,
+        CompressWriteBlock,
+        SpillBlocks,
+        EvictHistory
+    };
+
+    static const char* GetName(Action action);
+
+    // a limit in MB as bytes, the largest size_t if it does not fit
+    static size_t MegabytesToBytes(uint64_t megabytes);
+
+    // bytes, 0 is unlimited
+    void SetLimit(size_t limit);
+    size_t GetLimit() const;
+
+    void Account(const std::string& component, size_t bytes);
+    size_t GetTotal() const;
+    size_t GetExcess() const; // the bytes over the low mark, a tenth below the limit, while the governor acts
+
+    // starts over with the cheapest action, once per round of accounting
+    void BeginRound();
+
+    // the next action while the total is over the limit, None when it is not or when all actions were taken this round
+    Action Next();
+
+private:
+    size_t GetLowMark() const;
+
+    size_t m_limit = 0;
+    std::map<std::string, size_t> m_components;
+    Action m_action = Action::None;
+    bool m_acting = false; // went over the limit and did not get under the low mark yet
+};
+
+} // namespace debugviewpp
+} // namespace fusion
@@ -0,0 +1,55 @@
+// (C) Copyright Gert-Jan de Vos and Jan Wilmans 2013.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <boost/signals2.hpp>
+#include "DebugviewppLib/LogSource.h"
+
+namespace fusion {
+namespace debugviewpp {
+
+class ILineBuffer;
+
+// MergeFileReader loads several log files as one log in system time order, to correlate the logs of services that ran
+// side by side. Every file is read and parsed on a thread of its own into a window of at most ReadAhead lines, and a
+// merge thread adds the earliest line of all windows, so memory stays bounded however large the files are.
+//
+// Lines keep the name of their file as process name. A line without a timestamp, like any line of a plain text file,
+// takes the time of the line before it in the same file.
+class MergeFileReader : public LogSource
+{
+public:
+    static constexpr size_t ReadAhead = 4096;
+
+    MergeFileReader(Timer& timer, ILineBuffer& linebuffer, const std::vector<std::wstring>& filenames);
+    ~MergeFileReader() override;
+
+    using UpdateSignal = boost::signals2::signal<void()>;
+    boost::signals2::connection SubscribeToUpdate(UpdateSignal::slot_type slot);
+
+    void Abort() override;
+    HANDLE GetHandle() const override;
+    void Notify() override;
+
+private:
+    struct File;
+
+    void Read(File& file);
+    bool Push(File& file, Line&& line);
+    bool Next(File& file, Line& line);
+    void Merge();
+
+    std::vector<std::unique_ptr<File>> m_files;
+    UpdateSignal m_update;
+    std::thread m_thread;
+};
+
+} // namespace debugviewpp
+} // namespace fusion
@@ -0,0 +1,171 @@
+// (C) Copyright Gert-Jan de Vos and Jan Wilmans 2013.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace fusion {
+namespace debugviewpp {
+
+// Counter is incremented from any thread, every thread adds to one of a few cache line sized slots
+// so threads counting the same event do not contend. Get() sums the slots.
+class Counter
+{
+public:
+    static constexpr size_t Slots = 16;
+
+    void Add(uint64_t value = 1);
+    [[nodiscard]] uint64_t Get() const;
+
+private:
+    struct alignas(64) Slot
+    {
+        std::atomic<uint64_t> value = 0;
+    };
+
+    std::array<Slot, Slots> m_slots;
+};
+
+// Gauge holds the last value that was set, like a queue depth
+class Gauge
+{
+public:
+    void Set(int64_t value);
+    [[nodiscard]] int64_t Get() const;
+
+private:
+    std::atomic<int64_t> m_value = 0;
+};
+
+struct HistogramSummary
+{
+    uint64_t count = 0;
+    uint64_t sum = 0;
+    uint64_t max = 0;
+    uint64_t p50 = 0; // the percentiles are the upper bound of the bucket they fall in, within 12.5% of the exact value
+    uint64_t p90 = 0;
+    uint64_t p99 = 0;
+};
+
+// Histogram counts values in log-linear buckets like an HDR histogram: values below 8 are counted exactly and
+// every power of two range above that is split in 8 equal sub-buckets, so the relative error stays below 12.5%
+// from microseconds to hours.
+class Histogram
+{
+public:
+    static constexpr size_t SubBucketBits = 3;
+    static constexpr size_t SubBuckets = 1 << SubBucketBits;
+    static constexpr size_t Buckets = SubBuckets + (64 - SubBucketBits) * SubBuckets;
+
+    static size_t GetBucket(uint64_t value);
+    static uint64_t GetUpperBound(size_t bucket);
+
+    void Record(uint64_t value);
+    [[nodiscard]] HistogramSummary GetSummary() const;
+
+private:
+    std::array<std::atomic<uint64_t>, Buckets> m_buckets = {};
+    std::atomic<uint64_t> m_count = 0;
+    std::atomic<uint64_t> m_sum = 0;
+    std::atomic<uint64_t> m_max = 0;
+};
+
+// records the lifetime of the scope in microseconds
+class ScopedTimer
+{
+public:
+    explicit ScopedTimer(Histogram& histogram);
+    ~ScopedTimer();
+
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+private:
+    Histogram& m_histogram;
+    std::chrono::steady_clock::time_point m_start;
+};
+
+uint64_t GetMicroseconds(std::chrono::steady_clock::duration duration);
+
+enum class MetricType
+{
+    Counter,
+    Gauge,
+    Histogram
+};
+
+struct MetricValue
+{
+    std::string name;
+    MetricType type = MetricType::Counter;
+    int64_t value = 0; // Counter and Gauge
+    HistogramSummary histogram;
+};
+
+struct MetricsSnapshot
+{
+    double time = 0.0; // seconds since the registry was created
+    std::vector<MetricValue> values;
+};
+
+// MetricsRegistry owns all metrics by name, the references it returns stay valid until the metric is removed.
+// Lookup takes a lock, so hot paths look up their metrics once and keep the reference.
+class MetricsRegistry
+{
+public:
+    MetricsRegistry();
+
+    Counter& GetCounter(const std::string& name);
+    Gauge& GetGauge(const std::string& name);
+    Histogram& GetHistogram(const std::string& name);
+
+    // removes the metrics named 'name' of any type, references to them must no longer be used
+    void Remove(const std::string& name);
+
+    [[nodiscard]] MetricsSnapshot Sample() const;
+
+private:
+    std::chrono::steady_clock::time_point m_start;
+    mutable std::mutex m_mutex;
+    std::map<std::string, std::unique_ptr<Counter>> m_counters;
+    std::map<std::string, std::unique_ptr<Gauge>> m_gauges;
+    std::map<std::string, std::unique_ptr<Histogram>> m_histograms;
+};
+
+// the process wide registry that the DebugViewppLib pipeline reports to
+MetricsRegistry& GetMetrics();
+
+// MetricsHistory keeps the last 'capacity' snapshots as a time series
+class MetricsHistory
+{
+public:
+    explicit MetricsHistory(size_t capacity);
+
+    void Add(MetricsSnapshot snapshot);
+    [[nodiscard]] const std::deque<MetricsSnapshot>& GetSnapshots() const;
+
+private:
+    size_t m_capacity;
+    std::deque<MetricsSnapshot> m_snapshots;
+};
+
+// one JSON object: {"time":1.5,"counters":{...},"gauges":{...},"histograms":{"name":{"count":..}}}
+std::string ToJson(const MetricsSnapshot& snapshot);
+
+// a JSON array of the snapshots
+std::string ToJson(const MetricsHistory& history);
+
+} // namespace debugviewpp
+} // namespace fusion
@@ -5,6 +5,8 @@
 
 #pragma once
 
+#include <atomic>
+#include <thread>
 #include "PolledLogSource.h"
 
 namespace fusion {
@@ -12,21 +14,32 @@ namespace debugviewpp {
 
 class ILineBuffer;
 
+// PipeReader blocks in ReadFile on its own thread, anonymous pipes do not support overlapped I/O or waiting
+// for data, but a blocking read returns as soon as anything is written. Each read is split into lines that
+// are handed to the listening thread as one batch.
 class PipeReader : public PolledLogSource
 {
 public:
-    PipeReader(Timer& timer, ILineBuffer& lineBuffer, HANDLE hPipe, DWORD pid, const std::string& processName, long pollFrequency);
-    virtual ~PipeReader();
+    PipeReader(Timer& timer, ILineBuffer& lineBuffer, HANDLE hPipe, DWORD pid, const std::string& processName);
+
+    // lines are added to 'target', used by ProcessReader to collect stdout and stderr in a single source
+    PipeReader(Timer& timer, ILineBuffer& lineBuffer, HANDLE hPipe, DWORD pid, const std::string& processName, PolledLogSource& target);
+    ~PipeReader() override;
 
     bool AtEnd() const override;
-    void Poll() override;
-    void Poll(PolledLogSource& logSource);
+    void Abort() override;
 
 private:
+    void Read();
+    void AddLines(const char* begin, const char* end);
+
     HANDLE m_hPipe;
     DWORD m_pid;
     std::string m_process;
     std::string m_buffer;
+    PolledLogSource& m_target;
+    std::atomic<bool> m_done = false;
+    std::thread m_thread;
 };
 
 } // namespace debugviewpp
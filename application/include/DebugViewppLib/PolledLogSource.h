@@ -5,6 +5,8 @@
 
 #pragma once
 
+#include <chrono>
+#include <condition_variable>
 #include <thread>
 #include "Win32/Win32Lib.h"
 #include "LogSource.h"
@@ -17,7 +19,7 @@ class ILineBuffer;
 struct PollLine
 {
     PollLine(Win32::Handle handle, const std::string& message, const LogSource* pLogSource);
-    PollLine(DWORD pid, const std::string& processName, const std::string& message, const LogSource* pLogSource);
+    PollLine(DWORD pid, const std::string& processName, std::string message, const LogSource* pLogSource);
     PollLine(double time, FILETIME systemTime, DWORD pid, const std::string& processName, const std::string& message, const LogSource* pLogSource);
 
     bool timesAreValid; // indicated 'time' and 'systemTime' were assigned values at construction
@@ -27,26 +29,41 @@ struct PollLine
     DWORD pid;
     std::string processName;
     std::string message;
+    std::string source; // see Line::source
     const LogSource* pLogSource;
 };
 
+// PolledLogSource de-couples reader threads from the listening thread, lines added by AddMessage(s) are
+// handed over when Signal() wakes the listening thread. Sources that can block on readiness run their own
+// thread and only use AddMessage(s) and Signal(), sources without a readiness notification implement Poll()
+// and call StartThread(): the poll interval is adaptive, it drops to MinPollInterval as soon as data arrives
+// and doubles while idle until it reaches the interval given by pollFrequency.
 class PolledLogSource : public LogSource
 {
 public:
+    static constexpr std::chrono::microseconds MinPollInterval = std::chrono::milliseconds(1);
+
     PolledLogSource(Timer& timer, SourceType::type sourceType, ILineBuffer& lineBuffer, long pollFrequency);
     ~PolledLogSource() override;
 
     HANDLE GetHandle() const override;
     void Notify() override;
-    virtual void Poll();
+
+    // returns true if any data was read
+    virtual bool Poll();
     void Abort() override;
 
     // in contrast to the LogSource::Add methods, these methods are de-coupled using m_backBuffer so they
     // can be used to add messages from any thread. The typical use-case are messages from the UI thread.
     void AddMessage(Win32::Handle handle, const std::string& message);
-    void AddMessage(DWORD pid, const std::string& processName, const std::string& message);
+    void AddMessage(DWORD pid, const std::string& processName, std::string message);
     void AddMessage(const std::string& message);
     void AddMessage(double time, FILETIME systemTime, DWORD pid, const std::string& processName, const std::string& message);
+    void AddMessage(double time, FILETIME systemTime, DWORD pid, const std::string& processName, const std::string& message, const std::string& source);
+
+    // adds a batch of lines taking the lock only once
+    void AddMessages(DWORD pid, const std::string& processName, const std::vector<std::string>& messages);
+    void AddMessages(const Lines& lines);
 
     void Signal();
     void StartThread();
@@ -61,6 +78,7 @@ private:
     std::chrono::microseconds m_microsecondInterval;
     Win32::Handle m_handle;
     std::mutex m_mutex;
+    std::condition_variable m_wakeup;
     std::unique_ptr<std::thread> m_thread;
 };
 
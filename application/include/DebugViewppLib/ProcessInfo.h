@@ -6,33 +6,32 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 #include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 #include "windows.h"
 
 namespace fusion {
 namespace debugviewpp {
 
-struct InternalProcessProperties
-{
-    InternalProcessProperties();
-    InternalProcessProperties(DWORD pid, const std::wstring& name, COLORREF color);
-
-    DWORD pid; // system processId
-    std::wstring name;
-    COLORREF color;
-};
+class SnapshotWriter;
+class SnapshotReader;
 
 struct ProcessProperties
 {
-    explicit ProcessProperties(const InternalProcessProperties& iprops);
+    ProcessProperties(DWORD uid, DWORD pid, std::string_view name, COLORREF color);
 
     DWORD uid; // unique id
     DWORD pid; // system processId
-    std::wstring name;
+    std::string_view name;
     COLORREF color;
 };
 
+// ProcessInfo assigns a unique id to every (pid, process name) combination.
+// Names are interned, each distinct name is stored once and the ProcessProperties refer to it, the names stay
+// valid until Clear() is called. The properties are returned by value, GetUid() may move them.
 class ProcessInfo
 {
 public:
@@ -43,13 +42,22 @@ public:
     static std::wstring GetStartTime(HANDLE handle);
     static std::wstring GetProcessNameByPid(DWORD processId);
 
-    DWORD GetUid(DWORD processId, const std::wstring& processName);
-    ProcessProperties GetProcessProperties(DWORD processId, const std::wstring& processName);
+    DWORD GetUid(DWORD processId, std::string_view processName);
+    ProcessProperties GetProcessProperties(DWORD processId, std::string_view processName);
     ProcessProperties GetProcessProperties(DWORD uid) const;
+    size_t GetCount() const; // uids are below
+
+    // the uids stay the same, a snapshot of the log refers to its processes by uid
+    void SaveSnapshot(SnapshotWriter& writer) const;
+    void LoadSnapshot(SnapshotReader& reader);
 
 private:
-    std::unordered_map<DWORD, InternalProcessProperties> m_processProperties;
-    DWORD m_unqiueId;
+    static size_t GetHash(DWORD processId, std::string_view processName);
+    const std::string& InternName(std::string_view processName);
+
+    std::vector<ProcessProperties> m_processProperties; // indexed by uid
+    std::unordered_multimap<size_t, DWORD> m_index;     // hash of (pid, name) -> uid
+    std::unordered_set<std::string> m_names;
 };
 
 } // namespace debugviewpp
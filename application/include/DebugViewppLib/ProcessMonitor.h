@@ -5,17 +5,42 @@
 
 #pragma once
 
+#include <memory>
+#include <mutex>
+#include <string>
 #include <unordered_map>
 #include <boost/signals2.hpp>
 #include <thread>
 #include "Win32/Win32Lib.h"
 #include "CobaltFusion/SynchronizedQueue.h"
+#include "ProcessExitLib/ProcessExitWatcher.h"
 
 namespace fusion {
 namespace debugviewpp {
 
-using PidMap = std::unordered_map<DWORD, Win32::Handle>;
+// PidMap holds the one canonical handle of every process that sent a message until ProcessMonitor reports it ended.
+// Sources can look up a known pid to skip opening a new process handle for every message.
+class PidMap
+{
+public:
+    // takes ownership of 'handle', returns false and closes 'handle' when the pid was already known
+    bool Add(DWORD pid, Win32::Handle handle, const std::string& processName);
+    void Remove(DWORD pid);
+    bool Find(DWORD pid, std::string& processName) const;
+
+private:
+    struct Process
+    {
+        Win32::Handle handle;
+        std::string processName;
+    };
 
+    mutable std::mutex m_mutex;
+    std::unordered_map<DWORD, Process> m_processes;
+};
+
+// ProcessMonitor watches any number of processes without delay through a ProcessExitWatcher, which is also built and
+// tested on Linux. The ProcessEnded signal is always raised from the ProcessMonitor thread.
 class ProcessMonitor
 {
 public:
@@ -29,21 +54,14 @@ public:
     void Abort();
 
 private:
-    struct ProcessInfo
-    {
-        explicit ProcessInfo(DWORD pid = 0, HANDLE handle = nullptr);
-
-        DWORD pid;
-        HANDLE handle;
-    };
-
+    void Ended(DWORD pid);
     void Run();
 
     bool m_end;
-    Win32::Handle m_event;
     ProcessEnded m_processEnded;
-    std::vector<ProcessInfo> m_processes;
+    std::unordered_map<DWORD, HANDLE> m_handles; // only used on the ProcessMonitor thread
     SynchronizedQueue<std::function<void()>> m_q;
+    processexit::ProcessExitWatcher m_watcher; // after m_q, it stops calling back before m_q is destroyed
     std::thread m_thread;
 };
 
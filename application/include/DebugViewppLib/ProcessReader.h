@@ -23,8 +23,6 @@ public:
     bool AtEnd() const override;
 
 private:
-    void Poll() override;
-
     Win32::Process m_process;
     PipeReader m_stdout;
     PipeReader m_stderr;
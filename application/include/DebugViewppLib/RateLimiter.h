@@ -0,0 +1,74 @@
+// (C) Copyright Gert-Jan de Vos and Jan Wilmans 2013.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "DebugViewppLib/Line.h"
+
+namespace fusion {
+namespace debugviewpp {
+
+struct RateLimitSettings
+{
+    double linesPerSecond = 0;            // limit of every process, 0 is unlimited
+    double burst = 0;                     // lines a process may send at once above the rate, 0 is one second worth
+    unsigned sampleInterval = 0;          // keep 1 in 'sampleInterval' lines over the limit, 0 drops them all
+    std::map<std::string, double> processLimits; // lines per second by lowercase process name, overrides linesPerSecond
+    size_t uiBudget = 0;                  // protect the UI: lines the UI may fall behind before the oldest are skipped, 0 is off
+};
+
+// "name=rate" entries, separated by ';' or newlines, process names are case-insensitive. Entries without a valid,
+// non-negative rate are skipped.
+std::map<std::string, double> ParseProcessLimits(const std::string& text);
+std::string FormatProcessLimits(const std::map<std::string, double>& limits, const std::string& separator = ";");
+
+// RateLimiter keeps a token bucket per process of every source, so one process flooding the log does not drown the
+// others. The lines it refuses are counted, TakeSuppressions() reports them at most once per second per process.
+class RateLimiter
+{
+public:
+    struct Suppression
+    {
+        DWORD pid;
+        std::string processName;
+        uint64_t count;
+    };
+
+    void SetSettings(const RateLimitSettings& settings);
+    bool IsEnabled() const;
+
+    // 'now' in seconds, returns false if the line must be dropped
+    bool Admit(const Line& line, double now);
+
+    std::vector<Suppression> TakeSuppressions(double now);
+
+private:
+    struct Bucket
+    {
+        double linesPerSecond;
+        double burst;
+        double tokens;
+        double lastTime;
+        double lastReport;
+        uint64_t excess;
+        uint64_t suppressed;
+        DWORD pid;
+        std::string processName;
+    };
+
+    Bucket& GetBucket(const Line& line, double now);
+
+    RateLimitSettings m_settings;
+    bool m_enabled = false;
+    std::unordered_map<uint64_t, Bucket> m_buckets;
+};
+
+} // namespace debugviewpp
+} // namespace fusion
@@ -0,0 +1,56 @@
+// (C) Copyright Gert-Jan de Vos and Jan Wilmans 2013.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include "PolledLogSource.h"
+#include "Trace.h"
+
+namespace fusion {
+namespace debugviewpp {
+
+class ILineBuffer;
+
+// ReplaySource plays back a trace recorded by LogSources::StartRecording() on its own thread, the lines are
+// timestamped when they are handed over so the drain latency of the replayed lines can be measured.
+// No more than MaxPendingLines wait for the listening thread, so a replay at maximum speed runs at the rate
+// LogSources can take the lines instead of buffering the whole trace.
+class ReplaySource : public PolledLogSource
+{
+public:
+    static constexpr size_t MaxPendingLines = 64 * 1024;
+    static constexpr size_t BatchSize = 1000;
+
+    // 'speed' scales the original inter-arrival gaps: 1 replays in real-time, 10 ten times faster and 0 as fast as possible
+    ReplaySource(Timer& timer, ILineBuffer& lineBuffer, const std::wstring& filename, double speed = 1.0);
+    ~ReplaySource() override;
+
+    void Notify() override;
+    void Abort() override;
+
+    [[nodiscard]] bool IsFinished() const;
+    [[nodiscard]] size_t GetCount() const;
+
+private:
+    void Run();
+    bool Replay(std::chrono::steady_clock::time_point due, const TraceRecord& record);
+
+    TraceReader m_reader;
+    double m_speed;
+    mutable std::mutex m_mutex;
+    std::condition_variable m_cv;
+    bool m_abort = false;
+    bool m_finished = false;
+    size_t m_pendingLines = 0;
+    std::atomic<size_t> m_count = 0;
+    std::thread m_thread;
+};
+
+} // namespace debugviewpp
+} // namespace fusion
@@ -0,0 +1,45 @@
+// (C) Copyright Gert-Jan de Vos and Jan Wilmans 2013.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <atomic>
+#include <string>
+#include "ShmRingLib/ShmRing.h"
+#include "LogSource.h"
+
+namespace fusion {
+namespace debugviewpp {
+
+class ILineBuffer;
+class PidMap;
+
+// ShmRingReader owns the shared-memory ring that ShmRingWriter clients write to, see ShmRingLib/ShmRing.h.
+// The ListenerPool waits on the ready event, which is only set when the ring goes non-empty, and every Notify()
+// drains a batch of messages.
+// The ring stays alive while capture is paused: writers keep their mapping and the ring is still drained, but the
+// messages are discarded, as the DBWIN buffer discards them when no one is reading.
+class ShmRingReader : public LogSource
+{
+public:
+    // when 'pPidMap' is given, processes it knows are identified by pid instead of opening a handle for every message
+    ShmRingReader(Timer& timer, ILineBuffer& lineBuffer, const std::string& name, const PidMap* pPidMap = nullptr);
+
+    HANDLE GetHandle() const override;
+    void Notify() override;
+
+    void SetPaused(bool paused);
+
+private:
+    void Add(uint32_t pid, std::string_view message);
+
+    shmring::ShmRing m_ring;
+    const PidMap* m_pPidMap;
+    uint64_t m_dropped = 0;
+    std::atomic<bool> m_paused = false;
+};
+
+} // namespace debugviewpp
+} // namespace fusion
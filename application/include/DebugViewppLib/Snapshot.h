@@ -0,0 +1,119 @@
+// (C) Copyright Gert-Jan de Vos and Jan Wilmans 2013.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+namespace fusion {
+namespace debugviewpp {
+
+// A snapshot is the in-memory log and the state of its views in one binary file, so a session is restored as it was
+// left without reading the log again or running the filters of the views over it.
+//
+// format: the 8 byte signature "DVSNAP02" followed by the sections of LogFile and the views, in the order they were
+// written. Every field is written by itself: numbers are 64 bit little-endian, a double is its 64 bit pattern, a string
+// is its size and bytes and an array of numbers is its size and its elements. Structs are never written as they are
+// in memory, so the format does not depend on their layout or padding.
+class SnapshotWriter
+{
+public:
+    // the snapshot is kept in memory until Commit()
+    explicit SnapshotWriter(const std::wstring& filename);
+
+    void WriteNumber(uint64_t value);
+    void WriteDouble(double value);
+    void WriteString(std::string_view value);
+    void WriteStrings(const std::vector<std::string>& values);
+
+    // a string that Commit() takes from 'source', for large data that stays the same, like the compressed blocks of
+    // the log, so it is not copied while the state is saved
+    void WriteString(std::function<std::string()> source);
+
+    template <typename Container>
+    void WriteArray(const Container& values);
+
+    // writes to a temporary file and replaces 'filename' with it, so a failed snapshot keeps the previous one.
+    // Commit() only uses what was written before and the sources, so it may run on another thread.
+    void Commit();
+
+private:
+    void WriteBytes(const void* data, size_t size);
+
+    struct Source
+    {
+        size_t position; // in m_buffer
+        std::function<std::string()> source;
+    };
+
+    std::wstring m_filename;
+    std::string m_buffer;
+    std::vector<Source> m_sources;
+};
+
+class SnapshotReader
+{
+public:
+    // maps 'filename', throws if it is not a snapshot
+    explicit SnapshotReader(const std::wstring& filename);
+
+    // all reads throw when the snapshot is truncated
+    uint64_t ReadNumber();
+    double ReadDouble();
+    std::string ReadString();
+    std::vector<std::string> ReadStrings();
+
+    // the number of elements that follow, throws "snapshot is damaged" if there are not as many bytes left
+    size_t ReadCount();
+
+    template <typename Container>
+    void ReadArray(Container& values);
+
+private:
+    const char* ReadBytes(size_t count, size_t size = 1);
+
+    boost::interprocess::file_mapping m_mapping;
+    boost::interprocess::mapped_region m_region;
+    const char* m_data = nullptr;
+    size_t m_size = 0;
+    size_t m_pos = 0;
+};
+
+template <typename Container>
+void SnapshotWriter::WriteArray(const Container& values)
+{
+    using T = typename Container::value_type;
+    static_assert(std::is_integral_v<T>, "snapshot arrays hold numbers, write the fields of a struct one by one");
+    WriteNumber(values.size());
+    for (auto& value : values)
+    {
+        WriteBytes(&value, sizeof(T));
+    }
+}
+
+template <typename Container>
+void SnapshotReader::ReadArray(Container& values)
+{
+    using T = typename Container::value_type;
+    static_assert(std::is_integral_v<T>, "snapshot arrays hold numbers, write the fields of a struct one by one");
+    auto count = static_cast<size_t>(ReadNumber());
+    auto data = ReadBytes(count, sizeof(T));
+    values.resize(count);
+    if (count != 0)
+    {
+        std::memcpy(values.data(), data, count * sizeof(T));
+    }
+}
+
+} // namespace debugviewpp
+} // namespace fusion
@@ -0,0 +1,46 @@
+// (C) Copyright Gert-Jan de Vos and Jan Wilmans 2013.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <mutex>
+#include <vector>
+#include "DebugViewppLib/Line.h"
+
+namespace fusion {
+namespace debugviewpp {
+
+// SourceRegistry keeps track of the LogSources that are alive, indexed by their SourceId.
+// Every Add() or Remove() starts a new generation, a Snapshot is only copied again when the generation changed,
+// so checking the source of each line of a batch is a bit test without taking a lock.
+class SourceRegistry
+{
+public:
+    class Snapshot
+    {
+    public:
+        bool Contains(SourceId id) const;
+
+    private:
+        friend class SourceRegistry;
+        size_t m_generation = 0;
+        std::vector<bool> m_live;
+    };
+
+    void Add(SourceId id);
+    void Remove(SourceId id);
+    void Clear();
+
+    // brings 'snapshot' up to date with the current generation, returns true if it changed
+    bool Update(Snapshot& snapshot) const;
+
+private:
+    mutable std::mutex m_mutex;
+    size_t m_generation = 1;
+    std::vector<bool> m_live;
+};
+
+} // namespace debugviewpp
+} // namespace fusion
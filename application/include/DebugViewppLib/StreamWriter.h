@@ -0,0 +1,98 @@
+// (C) Copyright Gert-Jan de Vos and Jan Wilmans 2013.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <condition_variable>
+#include <iosfwd>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "DebugViewppLib/Line.h"
+
+namespace fusion {
+namespace debugviewpp {
+
+enum class OutputFormat
+{
+    Text,      // the DebugViewConsole columns, selected by OutputColumns
+    JsonLines, // one JSON object per line
+    Native     // the .dblog format, as written by WriteLogFileMessage
+};
+
+// throws std::runtime_error for anything but "text", "json" or "native"
+OutputFormat ParseOutputFormat(const std::string& name);
+
+// appends 'text' as a quoted JSON string, also used for the metrics export
+void AppendJsonString(std::string& buffer, const std::string& text);
+
+// the optional columns of OutputFormat::Text
+struct OutputColumns
+{
+    bool lineNumber = false;
+    bool systemTime = false;
+    bool time = false;
+    bool pid = false;
+    bool processName = false;
+    bool tabs = false;
+};
+
+// LineFormatter appends lines to a reusable buffer without iostreams or temporary strings.
+// The local time text is only rebuilt when a line falls in a different second than the previous one.
+class LineFormatter
+{
+public:
+    explicit LineFormatter(OutputFormat format, const OutputColumns& columns = OutputColumns());
+
+    void Format(const Line& line, std::string& buffer);
+
+private:
+    void FormatText(const Line& line, std::string& buffer);
+    void FormatJson(const Line& line, std::string& buffer);
+    void FormatNative(const Line& line, std::string& buffer);
+    void AppendTime(FILETIME systemTime, bool date, std::string& buffer);
+
+    OutputFormat m_format;
+    OutputColumns m_columns;
+    unsigned long long m_lineNumber = 0;
+    unsigned long long m_second = ~0ull;
+    std::string m_datePrefix;
+    std::string m_timePrefix;
+};
+
+// StreamWriter writes formatted buffers to an ostream on its own thread, so formatting the next batch
+// overlaps with writing the previous one. Written buffers are recycled with their capacity.
+class StreamWriter
+{
+public:
+    static constexpr size_t BufferSize = 1024 * 1024;
+    static constexpr size_t MaxPendingBuffers = 16;
+
+    explicit StreamWriter(std::ostream& os);
+    ~StreamWriter();
+
+    // takes the contents of 'buffer' and leaves an empty buffer to format the next batch into,
+    // blocks while MaxPendingBuffers are waiting to be written
+    void Write(std::string& buffer);
+
+    // returns when all buffers are written and the ostream is flushed
+    void Flush();
+
+private:
+    void Run();
+
+    std::ostream& m_os;
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::vector<std::string> m_pending;
+    std::vector<std::string> m_free;
+    bool m_writing = false;
+    bool m_end = false;
+    std::thread m_thread;
+};
+
+} // namespace debugviewpp
+} // namespace fusion
@@ -0,0 +1,68 @@
+// (C) Copyright Gert-Jan de Vos and Jan Wilmans 2013.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <set>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include <boost/asio.hpp>
+#include "PolledLogSource.h"
+
+namespace fusion {
+namespace debugviewpp {
+
+class ILineBuffer;
+
+enum class TcpFraming
+{
+    Newline,       // messages are terminated by '\n'
+    LengthPrefixed // each message is preceded by its length as a 32-bit little-endian value
+};
+
+// TcpReader accepts any number of connections on its own boost::asio thread.
+// Messages are framed directly from a fixed size receive buffer per connection, when more than MaxPendingBytes
+// are waiting to be picked up by the listening thread the connections stop reading until Notify() is called,
+// so slow consumers push back on the senders through the TCP receive window instead of buffering without bounds.
+class TcpReader : public PolledLogSource
+{
+public:
+    static constexpr size_t ReceiveBufferSize = 64 * 1024;
+    static constexpr size_t MaxPendingBytes = 4 * 1024 * 1024;
+
+    TcpReader(Timer& timer, ILineBuffer& lineBuffer, int port, TcpFraming framing = TcpFraming::Newline);
+    ~TcpReader() override;
+
+    void Notify() override;
+    void Abort() override;
+
+    [[nodiscard]] unsigned short GetPort() const;
+    [[nodiscard]] size_t GetConnectionCount() const;
+
+private:
+    class Connection;
+
+    void BeginAccept();
+    void Resume();
+    size_t GetPendingBytes() const;
+    void AddFrame(const std::string& processName, std::string_view frame);
+    void Close(const std::shared_ptr<Connection>& pConnection);
+
+    boost::asio::io_context m_ioContext;
+    boost::asio::ip::tcp::acceptor m_acceptor;
+    TcpFraming m_framing;
+    std::set<std::shared_ptr<Connection>> m_connections;
+    std::vector<std::shared_ptr<Connection>> m_paused;
+    std::atomic<size_t> m_connectionCount = 0;
+    std::atomic<size_t> m_addedBytes = 0;    // only grows, counted after the frame is added
+    std::atomic<size_t> m_consumedBytes = 0; // the part of m_addedBytes that Notify() has taken
+    std::thread m_thread;
+};
+
+} // namespace debugviewpp
+} // namespace fusion
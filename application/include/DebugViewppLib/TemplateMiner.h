@@ -0,0 +1,88 @@
+// (C) Copyright Gert-Jan de Vos and Jan Wilmans 2013.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace fusion {
+namespace debugviewpp {
+
+class SnapshotWriter;
+class SnapshotReader;
+
+// identifies a template, 0 is 'no template'
+using TemplateId = uint32_t;
+
+struct TemplateMatch
+{
+    TemplateId templateId = 0;
+    uint32_t patternId = 0; // see TemplateMiner::Format()
+};
+
+// TemplateMiner finds the printf-style templates of the lines it is given, online, in the way of the Drain log parser:
+// lines are grouped by their number of space separated tokens and their first tokens, and within a group a line joins
+// the most similar template if enough of its tokens are equal. The tokens that differ become wildcards ("<*>"), the
+// parameters of the line.
+//
+// A template only gets more general over time, every generalization is a new pattern, so the parameters taken with
+// an older pattern still restore the exact line.
+class TemplateMiner
+{
+public:
+    static constexpr double DefaultSimilarity = 0.5;
+
+    explicit TemplateMiner(double similarity = DefaultSimilarity);
+
+    void Clear();
+
+    // 'params' receives the tokens at the wildcards, separated by '\n'.
+    // Returns no template for a line with a '\n' or too many tokens, or if its group is full.
+    TemplateMatch Add(std::string_view text, std::string& params);
+
+    // the line that Add() returned 'patternId' and 'params' for
+    std::string Format(uint32_t patternId, std::string_view params) const;
+
+    TemplateId GetTemplateId(uint32_t patternId) const;
+    std::string GetText(TemplateId id) const; // the tokens of the current pattern, "<*>" for wildcards
+    uint64_t GetCount(TemplateId id) const;   // lines added for the template
+    size_t GetTemplateCount() const;
+    size_t GetPatternCount() const;
+
+    // LoadSnapshot() throws if the snapshot refers to patterns or templates it does not hold
+    void SaveSnapshot(SnapshotWriter& writer) const;
+    void LoadSnapshot(SnapshotReader& reader);
+
+private:
+    struct Pattern
+    {
+        TemplateId templateId;
+        std::vector<std::string> tokens; // empty at wildcards
+        std::vector<bool> wildcards;
+    };
+
+    struct Template
+    {
+        uint32_t patternId;
+        uint64_t count;
+    };
+
+    static std::string GetGroupKey(const std::vector<std::string_view>& tokens);
+    double GetSimilarity(const Pattern& pattern, const std::vector<std::string_view>& tokens) const;
+    TemplateId AddTemplate(const std::vector<std::string_view>& tokens);
+    void Generalize(Template& t, const std::vector<std::string_view>& tokens);
+
+    double m_similarity;
+    std::vector<Pattern> m_patterns;   // by patternId, 0 is unused
+    std::vector<Template> m_templates; // by TemplateId, 0 is unused
+    std::unordered_map<std::string, std::vector<TemplateId>> m_groups;
+};
+
+} // namespace debugviewpp
+} // namespace fusion
@@ -0,0 +1,91 @@
+// (C) Copyright Gert-Jan de Vos and Jan Wilmans 2013.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+namespace fusion {
+namespace debugviewpp {
+
+// TimeIndex finds lines by time in a log where the lines of different sources arrive mostly, but not strictly, in
+// time order. It keeps the minimum and maximum time of every block of BlockSize lines and two monotonic skylines
+// over those blocks, so a query is a binary search over the blocks plus a scan of one block.
+//
+// The index does not store the time of every line, the queries take 'getTime(line)' to read them from the log.
+class TimeIndex
+{
+public:
+    static constexpr int BlockSize = 256;
+
+    void Clear();
+
+    // 'time' of the next line
+    void Add(uint64_t time);
+    int Count() const;
+
+    // the first line with a time at or after 'time', Count() if there is none
+    template <typename GetTime>
+    int LowerBound(uint64_t time, GetTime getTime) const;
+
+    // one past the last line with a time at or before 'time', 0 if there is none
+    template <typename GetTime>
+    int UpperBound(uint64_t time, GetTime getTime) const;
+
+private:
+    struct Block
+    {
+        uint64_t min;
+        uint64_t max;
+    };
+
+    int m_count = 0;
+    std::vector<Block> m_blocks;
+    std::vector<uint64_t> m_maxSkyline; // the maximum time of all blocks up to and including this one, non-decreasing
+    std::vector<int> m_minSkyline;      // the blocks whose minimum is below that of all later blocks, in block order
+};
+
+template <typename GetTime>
+int TimeIndex::LowerBound(uint64_t time, GetTime getTime) const
+{
+    // all lines before the first block that reaches 'time' are earlier
+    auto it = std::lower_bound(m_maxSkyline.begin(), m_maxSkyline.end(), time);
+    if (it == m_maxSkyline.end())
+    {
+        return m_count;
+    }
+
+    int line = static_cast<int>(it - m_maxSkyline.begin()) * BlockSize;
+    while (getTime(line) < time)
+    {
+        ++line;
+    }
+    return line;
+}
+
+template <typename GetTime>
+int TimeIndex::UpperBound(uint64_t time, GetTime getTime) const
+{
+    // all lines after the last skyline block at or before 'time' are later, the blocks in between have a minimum
+    // no lower than that of a later skyline block
+    auto it = std::upper_bound(m_minSkyline.begin(), m_minSkyline.end(), time, [this](uint64_t time, int block) { return time < m_blocks[block].min; });
+    if (it == m_minSkyline.begin())
+    {
+        return 0;
+    }
+
+    int block = *(it - 1);
+    int line = std::min((block + 1) * BlockSize, m_count);
+    while (getTime(line - 1) > time)
+    {
+        --line;
+    }
+    return line;
+}
+
+} // namespace debugviewpp
+} // namespace fusion
@@ -0,0 +1,90 @@
+// (C) Copyright Gert-Jan de Vos and Jan Wilmans 2013.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <fstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "DebugViewppLib/Line.h"
+
+namespace fusion {
+namespace debugviewpp {
+
+// A trace is a compact binary capture of the lines that LogSources receives from its sources, before newline
+// processing, so a flood recorded at a customer can be replayed offline by ReplaySource.
+//
+// format: the 8 byte signature "DVTRACE1" followed by one record per line, all numbers are LEB128 varints:
+//   time delta (microseconds, zigzag), systemTime delta (100ns ticks, zigzag), pid,
+//   process name index, source index, message length, message bytes
+// an index equal to the number of names seen so far introduces a new name: its length and bytes follow.
+struct TraceRecord
+{
+    double time = 0.0;
+    FILETIME systemTime = FILETIME();
+    DWORD pid = 0;
+    std::string processName;
+    std::string source;
+    std::string message;
+};
+
+class TraceWriter
+{
+public:
+    explicit TraceWriter(const std::wstring& filename);
+    ~TraceWriter();
+
+    void Write(const Line& line);
+    void Write(const TraceRecord& record);
+    void Flush();
+
+    [[nodiscard]] size_t GetCount() const;
+
+private:
+    void Write(double time, FILETIME systemTime, DWORD pid, const std::string& processName, const std::string& source, const std::string& message);
+    void WriteName(std::unordered_map<std::string, size_t>& names, const std::string& name);
+    void WriteString(const std::string& value);
+    void WriteNumber(unsigned long long value);
+    void WriteSigned(long long value);
+
+    std::ofstream m_file;
+    std::string m_buffer;
+    std::unordered_map<std::string, size_t> m_processNames;
+    std::unordered_map<std::string, size_t> m_sources;
+    std::unordered_map<SourceId, std::string> m_sourceIds; // avoids formatting the description of a known source for every line
+    long long m_time = 0;
+    long long m_systemTime = 0;
+    size_t m_count = 0;
+};
+
+class TraceReader
+{
+public:
+    explicit TraceReader(const std::wstring& filename);
+
+    // returns false at the end of the trace, throws when the trace is truncated or damaged
+    bool Read(TraceRecord& record);
+
+private:
+    bool Fill(size_t size);
+    unsigned char ReadByte();
+    unsigned long long ReadNumber();
+    long long ReadSigned();
+    void ReadString(std::string& value);
+    const std::string& ReadName(std::vector<std::string>& names);
+
+    std::ifstream m_file;
+    std::vector<char> m_buffer;
+    size_t m_pos = 0;
+    size_t m_end = 0;
+    std::vector<std::string> m_processNames;
+    std::vector<std::string> m_sources;
+    long long m_time = 0;
+    long long m_systemTime = 0;
+};
+
+} // namespace debugviewpp
+} // namespace fusion
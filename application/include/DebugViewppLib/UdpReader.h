@@ -0,0 +1,54 @@
+// (C) Copyright Gert-Jan de Vos and Jan Wilmans 2013.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <atomic>
+#include <map>
+#include <thread>
+#include <vector>
+#include <boost/asio.hpp>
+#include "PolledLogSource.h"
+
+namespace fusion {
+namespace debugviewpp {
+
+class ILineBuffer;
+
+// UdpReader receives datagrams on its own boost::asio thread and hands them to the listening thread in batches.
+// On linux up to BatchSize datagrams are drained per recvmmsg() call and kernel drops are counted using SO_RXQ_OVFL.
+class UdpReader : public PolledLogSource
+{
+public:
+    static constexpr size_t BatchSize = 32;
+    static constexpr size_t MaxDatagramSize = 64 * 1024;
+
+    UdpReader(Timer& timer, ILineBuffer& lineBuffer, int port);
+    ~UdpReader() override;
+
+    void Abort() override;
+
+    [[nodiscard]] unsigned short GetPort() const;
+    [[nodiscard]] size_t GetDroppedCount() const;
+
+private:
+    void BeginWait();
+    void Receive();
+    size_t ReceiveBatch();
+    void AddDatagram(const boost::asio::ip::udp::endpoint& endpoint, const char* data, size_t size);
+    void UpdateDropCounter(uint32_t counter);
+    const std::string& GetProcessText(const boost::asio::ip::udp::endpoint& endpoint);
+
+    boost::asio::io_context m_ioContext;
+    boost::asio::ip::udp::socket m_socket;
+    std::vector<char> m_buffer;
+    std::map<boost::asio::ip::udp::endpoint, std::string> m_processNames;
+    uint32_t m_dropCounter = 0;
+    std::atomic<size_t> m_dropped = 0;
+    std::thread m_thread;
+};
+
+} // namespace debugviewpp
+} // namespace fusion
@@ -17,6 +17,7 @@ public:
 
     void Add(double time, FILETIME systemTime, HANDLE handle, const std::string& message, const LogSource* pSource) override;
     void Add(double time, FILETIME systemTime, DWORD pid, const std::string& processName, const std::string& message, const LogSource* pSource) override;
+    void Add(Line line) override;
     [[nodiscard]] Lines GetLines() override;
     [[nodiscard]] bool Empty() const override;
 
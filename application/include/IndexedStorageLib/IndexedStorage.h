@@ -5,9 +5,14 @@
 
 #pragma once
 
-#include <vector>
-#include <string>
+#include <cstdint>
+#include <fstream>
 #include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
 
 namespace fusion {
 namespace indexedstorage {
@@ -28,6 +33,59 @@ private:
     std::vector<std::string> m_storage;
 };
 
+// holds the blocks a SnappyStorage moved out of memory, the file is removed when the SpillFile is destroyed.
+// Freed space is written again before the file grows, the file does not grow beyond 'maxSize'.
+// The members may be called from different threads.
+class SpillFile
+{
+public:
+    SpillFile(const std::wstring& filename, uint64_t maxSize);
+    ~SpillFile();
+
+    SpillFile(const SpillFile&) = delete;
+    SpillFile& operator=(const SpillFile&) = delete;
+
+    // true if Write() finds room for 'size' bytes
+    bool Fits(size_t size);
+
+    // returns the offset of 'data' in the file
+    uint64_t Write(const std::string& data);
+    std::string Read(uint64_t offset, size_t size);
+    void Free(uint64_t offset, size_t size);
+
+private:
+    std::map<uint64_t, uint64_t>::iterator FindFree(size_t size);
+
+    std::mutex m_mutex;
+    std::wstring m_filename;
+    std::fstream m_file;
+    uint64_t m_maxSize;
+    uint64_t m_size = 0;
+    std::map<uint64_t, uint64_t> m_free; // offset -> size of the freed space before m_size, adjacent ones are merged
+};
+
+struct SpilledBlock
+{
+    uint64_t offset;
+    size_t size;
+};
+
+// the compressed blocks of a SnappyStorage at the time it was taken, a block that was released since is empty.
+// It shares the blocks with the storage, so it can be read on another thread while the storage goes on.
+class SnappyBlocks
+{
+public:
+    [[nodiscard]] size_t Count() const;
+    std::string operator[](size_t i) const;
+
+private:
+    friend class SnappyStorage;
+
+    std::vector<std::shared_ptr<const std::string>> m_blocks;
+    std::shared_ptr<SpillFile> m_spillFile;
+    std::vector<SpilledBlock> m_spilledBlocks;
+};
+
 class SnappyStorage
 {
 public:
@@ -39,6 +97,33 @@ public:
     [[nodiscard]] size_t Count() const;
     std::string operator[](size_t i);
 
+    // true if the string 'index' can be read, false if it was never added or its block was released
+    [[nodiscard]] bool Contains(size_t index) const;
+
+    // bytes of all strings added, and the bytes kept for them in memory: the compressed blocks plus the uncompressed
+    // write block; the spilled blocks are on disk and the read cache holds the strings of the last block read
+    [[nodiscard]] size_t GetRawSize() const;
+    [[nodiscard]] size_t GetStoredSize() const;
+    [[nodiscard]] size_t GetSpilledSize() const;
+    [[nodiscard]] size_t GetCacheSize() const;
+
+    // memory pressure, see MemoryGovernor.
+    // CompressWriteBlock() compresses the write block before it is full, the indexes left in it are not used.
+    // Spill() moves the oldest compressed blocks to the spill file until 'bytes' are freed or the spill file is at
+    // 'maxSize', it returns the bytes freed.
+    // Release() frees the blocks of the strings before 'index', which must not be read anymore, also in the spill file.
+    void ClearCache();
+    void CompressWriteBlock();
+    void SetSpillFile(const std::wstring& filename, uint64_t maxSize = std::numeric_limits<uint64_t>::max());
+    size_t Spill(size_t bytes);
+    void Release(size_t index);
+
+    // the compressed blocks and the strings of the write block, to save the storage without decompressing it.
+    // Restore() takes an empty block as released.
+    [[nodiscard]] SnappyBlocks GetBlocks() const;
+    [[nodiscard]] const std::vector<std::string>& GetWriteBlock() const;
+    void Restore(std::vector<std::string> blocks, std::vector<std::string> writeBlock, size_t rawSize);
+
     [[nodiscard]] std::string Compress(const std::vector<std::string>& value) const;
     static std::vector<std::string> Decompress(const std::string& value);
     void shrink_to_fit();
@@ -47,12 +132,26 @@ private:
     static size_t GetBlockIndex(size_t index);
     static size_t GetRelativeIndex(size_t index);
     std::string GetString(size_t index);
+    void CompressWriteList();
+    void FreeSpilled(const SpilledBlock& block);
+    void FreeSpilled();
 
     size_t m_writeBlockIndex = 0;
     size_t m_readBlockIndex = UNSET_VALUE;
     std::vector<std::string> m_readList;
     std::vector<std::string> m_writeList;
-    std::vector<std::string> m_storage;
+    std::vector<std::shared_ptr<const std::string>> m_storage; // null once the block is spilled or released
+    size_t m_rawSize = 0;
+    size_t m_writeSize = 0;
+    size_t m_compressedSize = 0;
+    std::wstring m_spillFilename;
+    uint64_t m_maxSpillSize = 0;
+    size_t m_spillFiles = 0; // a SnappyBlocks may keep an earlier spill file after Clear(), each one gets its own name
+    std::shared_ptr<SpillFile> m_spillFile;
+    std::vector<SpilledBlock> m_spilledBlocks; // of the first m_spilledBlocks.size() blocks, spilled oldest first
+    std::vector<SpilledBlock> m_freedBlocks;   // released while a SnappyBlocks could still read them
+    size_t m_spilledSize = 0;
+    size_t m_releasedBlocks = 0;
 };
 
 } // namespace indexedstorage
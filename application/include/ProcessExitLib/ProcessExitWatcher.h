@@ -0,0 +1,77 @@
+// (C) Copyright Gert-Jan de Vos and Jan Wilmans 2013.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+namespace fusion {
+namespace processexit {
+
+// ProcessExitWatcher reports the exit of any number of processes as it happens, without rotating wait sets: a thread
+// pool wait per process handle on Windows and a pidfd per process in one epoll set on Linux. It keeps one entry per
+// pid, so a process is watched once no matter how often it is added.
+// 'ended' is called once per process on a thread of the watcher, and never after Abort() returned. It must not call
+// Abort() itself.
+class ProcessExitWatcher
+{
+public:
+    using Pid = unsigned long;
+    using Ended = std::function<void(Pid pid)>;
+
+    explicit ProcessExitWatcher(Ended ended);
+    ~ProcessExitWatcher();
+
+    ProcessExitWatcher(const ProcessExitWatcher&) = delete;
+    ProcessExitWatcher& operator=(const ProcessExitWatcher&) = delete;
+
+    // on Windows 'handle' is a process handle that the caller keeps open while the process is watched, elsewhere the
+    // process is opened by its pid and 'handle' is not used. Returns false if the pid is already watched or cannot be.
+    bool Add(Pid pid, void* handle = nullptr);
+
+    [[nodiscard]] size_t Count() const;
+
+    void Abort();
+
+private:
+#ifdef _WIN32
+    struct Process
+    {
+        ProcessExitWatcher* pWatcher;
+        Pid pid;
+        HANDLE waitHandle;
+    };
+
+    static void CALLBACK OnEnded(void* context, BOOLEAN timedOut);
+
+    std::unordered_map<Pid, std::unique_ptr<Process>> m_processes;
+    size_t m_running = 0; // 'ended' calls in progress
+    std::condition_variable m_idle;
+#else
+    void Run();
+
+    std::unordered_map<Pid, int> m_processes; // the pidfd of every process
+    int m_epoll = -1;
+    int m_wakeup = -1;
+    std::thread m_thread;
+#endif
+
+    Ended m_ended;
+    mutable std::mutex m_mutex;
+    bool m_end = false;
+};
+
+} // namespace processexit
+} // namespace fusion
@@ -0,0 +1,82 @@
+// (C) Copyright Gert-Jan de Vos and Jan Wilmans 2013.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <semaphore.h>
+#endif
+
+namespace fusion {
+namespace shmring {
+
+// SharedMemory is a named region of memory shared between processes: a file mapping backed by the paging file on
+// Windows and a POSIX shm_open object elsewhere. The creator owns the name, on POSIX systems it unlinks it when done.
+class SharedMemory
+{
+public:
+    // creates a zero-filled region, throws if the name is already in use
+    SharedMemory(const std::string& name, size_t size);
+
+    // opens and maps the whole region created by another process, throws if it does not exist
+    explicit SharedMemory(const std::string& name);
+
+    ~SharedMemory();
+
+    SharedMemory(const SharedMemory&) = delete;
+    SharedMemory& operator=(const SharedMemory&) = delete;
+
+    [[nodiscard]] void* Ptr() const;
+    [[nodiscard]] size_t Size() const;
+
+private:
+    std::string m_name;
+    bool m_owner;
+    void* m_ptr = nullptr;
+    size_t m_size = 0;
+#ifdef _WIN32
+    HANDLE m_handle = nullptr;
+#endif
+};
+
+// SharedEvent is a named auto-reset signal between processes: a Win32 event or a POSIX named semaphore.
+// Wait() returns after one or more Set() calls and consumes all of them.
+class SharedEvent
+{
+public:
+    // creates the event if 'create' is true, opens an existing event otherwise, throws on failure
+    SharedEvent(const std::string& name, bool create);
+    ~SharedEvent();
+
+    SharedEvent(const SharedEvent&) = delete;
+    SharedEvent& operator=(const SharedEvent&) = delete;
+
+    void Set();
+
+    // returns false if the event was not set within 'milliseconds'
+    bool Wait(unsigned milliseconds);
+
+#ifdef _WIN32
+    // for waiting together with other handles, like the ListenerPool does
+    [[nodiscard]] HANDLE GetHandle() const;
+#endif
+
+private:
+    std::string m_name;
+    bool m_owner;
+#ifdef _WIN32
+    HANDLE m_handle;
+#else
+    sem_t* m_semaphore;
+#endif
+};
+
+} // namespace shmring
+} // namespace fusion
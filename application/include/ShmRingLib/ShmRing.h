@@ -0,0 +1,163 @@
+// (C) Copyright Gert-Jan de Vos and Jan Wilmans 2013.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include "ShmRingLib/SharedMemory.h"
+
+namespace fusion {
+namespace shmring {
+
+// The shared-memory ring is a high-rate alternative to the single 4 KB DBWIN buffer, where every OutputDebugString
+// waits for the reader to take the previous message. Any number of writer processes reserve a record in the ring
+// with a compare-and-swap on the reserve position, copy their message in and commit it, without waiting for each
+// other or for the reader. A full ring drops the message and counts it instead of blocking the writer.
+// The reader consumes committed records in reservation order and is woken only when the ring goes non-empty: it
+// raises 'readerWaiting' when it runs dry and the first writer to commit after that takes the flag and sets the event.
+// A reservation that is not committed within a second is abandoned: the reader marks it and moves on, the writer's
+// commit fails if it comes after all. Its space is only reused once that writer reported it let go of the record, or
+// after a much longer timeout when the writer is gone.
+
+const char* const DefaultName = "DebugViewppRing";
+const size_t DefaultCapacity = 4 * 1024 * 1024;
+const size_t MaxMessageSize = 64 * 1024; // longer messages are truncated
+const size_t DefaultBatch = 4096;        // records per Read() call
+
+const uint32_t RingMagic = 0x52564244; // "DBVR"
+const uint32_t RingVersion = 2;
+
+// positions count bytes since the ring was created and never wrap, the offset in the ring is position & (capacity - 1)
+struct RingHeader
+{
+    std::atomic<uint32_t> magic; // stored last by the reader, writers check it before using the ring
+    uint32_t version;
+    uint64_t capacity;
+    alignas(64) std::atomic<uint64_t> reserve; // end of the last reserved record, advanced by the writers
+    alignas(64) std::atomic<uint64_t> read;    // end of the last consumed record, advanced by the reader
+    alignas(64) std::atomic<uint32_t> readerWaiting;
+    std::atomic<uint64_t> dropped;
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "the ring needs lock-free 64-bit atomics between processes");
+
+// the writer commits with a compare-and-swap from Empty, so it detects a record the reader abandoned
+enum class RecordState : uint32_t
+{
+    Empty = 0,     // reserved but not committed yet, or free
+    Message = 1,
+    Padding = 2,   // fills the end of the ring when a record does not fit before the wrap
+    Abandoned = 3, // given up by the reader, the writer must not commit it
+    Discarded = 4  // the writer will not touch the record again
+};
+
+// every record starts 16-byte aligned, the payload follows the header
+struct RecordHeader
+{
+    uint32_t state;  // RecordState, accessed atomically
+    uint32_t size;   // bytes from this header to the next record, accessed atomically
+    uint32_t pid;
+    uint32_t length; // payload bytes
+};
+
+static_assert(sizeof(RecordHeader) == 16);
+
+// ShmRing is the reading side and owns the ring: it creates the shared memory and the ready event, writers open them.
+class ShmRing
+{
+public:
+    using Callback = std::function<void(uint32_t pid, std::string_view message)>;
+
+    // capacity must be a power of 2 of at least 4 KB, throws if 'name' is already in use
+    explicit ShmRing(const std::string& name = DefaultName, size_t capacity = DefaultCapacity);
+    ~ShmRing();
+
+    // calls 'callback' for up to 'maxRecords' committed messages in order and frees their space. Afterwards the ready
+    // signal is set again if messages remain, otherwise the next commit will set it, or a timer when the reader waits
+    // for a stalled writer. Returns the number of messages.
+    size_t Read(const Callback& callback, size_t maxRecords = DefaultBatch);
+
+    [[nodiscard]] bool IsEmpty() const;
+
+    // messages the writers dropped on a full ring, plus records abandoned by a writer that stopped halfway
+    [[nodiscard]] uint64_t GetDropped() const;
+
+    SharedEvent& GetReadySignal();
+    const SharedEvent& GetReadySignal() const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    // space that is skipped but not free yet
+    struct AbandonedSpace
+    {
+        uint64_t position;
+        uint64_t size;
+        bool record; // a single record whose writer marks it Discarded when it lets go, or all reservations up to then
+        Clock::time_point time;
+    };
+
+    RecordHeader& GetRecord(uint64_t position) const;
+    bool SkipStalledRecord(Clock::time_point now);
+    bool IsRecordChain(uint64_t position, uint64_t end) const;
+    void ReleaseAbandoned(Clock::time_point now);
+    void Clear(uint64_t position, uint64_t size);
+    void Consume(uint64_t size);
+    void Publish();
+    void EnableSignal();
+    void SetRetry(Clock::time_point time);
+    void RunRetry();
+
+    SharedMemory m_memory;
+    SharedEvent m_ready;
+    RingHeader& m_header;
+    char* m_data;
+    uint64_t m_mask;
+    uint64_t m_read = 0;
+    uint64_t m_stallPosition = ~0ull;
+    Clock::time_point m_stallTime;
+    std::deque<AbandonedSpace> m_abandoned;
+
+    // sets m_ready at m_retryTime, ListenerPool waits for the signal without a timeout
+    std::mutex m_retryMutex;
+    std::condition_variable m_retryChanged;
+    Clock::time_point m_retryTime = Clock::time_point::max();
+    bool m_end = false;
+    std::thread m_retryThread;
+};
+
+// ShmRingWriter is the client side, one per process is enough; Write() may be called from any number of threads.
+class ShmRingWriter
+{
+public:
+    // throws if no reader created the ring 'name'
+    explicit ShmRingWriter(const std::string& name = DefaultName);
+
+    // returns false if the message was dropped, because the ring was full or the reader gave up waiting for it
+    bool Write(std::string_view message);
+    bool Write(uint32_t pid, std::string_view message);
+
+private:
+    bool Commit(RecordHeader& record, RecordState state);
+
+    SharedMemory m_memory;
+    RingHeader& m_header;
+    SharedEvent m_ready;
+    char* m_data;
+    uint64_t m_capacity;
+    uint32_t m_pid;
+};
+
+} // namespace shmring
+} // namespace fusion